@@ -0,0 +1,57 @@
+#include "AStarSearch.h"
+
+using namespace std;
+
+GeometricHeuristic::GeometricHeuristic(const CsrGraph &graph, const vector<Station> &nodes) : minutesPerUnit(0.0)
+{
+    x.reserve(nodes.size());
+    y.reserve(nodes.size());
+    for (const Station &node : nodes)
+    {
+        x.push_back(node.x);
+        y.push_back(node.y);
+    }
+    calibrate(graph);
+}
+
+GeometricHeuristic::GeometricHeuristic(const MetroNetwork &network) : minutesPerUnit(0.0)
+{
+    int n = network.graph.nodeCount();
+    x.reserve(n);
+    y.reserve(n);
+    for (int state = 0; state < n; ++state)
+    {
+        const Station &station = network.stations[network.stateStation[state]];
+        x.push_back(station.x);
+        y.push_back(station.y);
+    }
+    calibrate(network.graph);
+}
+
+void GeometricHeuristic::calibrate(const CsrGraph &graph)
+{
+    /* The smallest ratio of minutes to straight-line length, the top speed, bounds every route */
+    double best = -1.0;
+    for (int node = 0; node < graph.nodeCount(); ++node)
+    {
+        for (int arc = graph.arcBegin(node); arc < graph.arcEnd(node); ++arc)
+        {
+            int target = graph.target(arc);
+            double length = hypot(x[node] - x[target], y[node] - y[target]);
+            if (length <= 1e-9)
+                continue;
+            if (graph.minutes(arc) == 0)
+            {
+                minutesPerUnit = 0.0;
+                return;
+            }
+
+            double ratio = graph.minutes(arc) / length;
+            if (best < 0 || ratio < best)
+                best = ratio;
+        }
+    }
+
+    /* Shave off a little so rounding in sqrt() cannot push an estimate past the true time */
+    minutesPerUnit = best > 0 ? best * (1.0 - 1e-9) : 0.0;
+}
@@ -0,0 +1,177 @@
+#ifndef ASTARSEARCH_H
+#define ASTARSEARCH_H
+
+#include "CsrGraph.h"
+#include "MetroNetwork.h"
+#include "PriorityQueues.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Lower bound on travel times from straight-line distances
+ *
+ * No train covers more ground per minute than the fastest arc of the
+ * network, so the straight-line distance between two nodes divided by that
+ * top speed never exceeds the travel time between them. The speed is
+ * measured from the graph itself in coordinate units per minute, so the
+ * drawing coordinates of the built-in network work as well as kilometres.
+ * A network with a zero-minute arc between distinct points has no useful
+ * top speed; every estimate is then 0 and the search is plain Dijkstra.
+ */
+class GeometricHeuristic
+{
+public:
+    /**
+     * @brief Calibrate for a node-level graph
+     * @param graph CSR representation of the network
+     * @param nodes Coordinates of every node of graph, by index
+     */
+    GeometricHeuristic(const CsrGraph &graph, const std::vector<Station> &nodes);
+
+    /**
+     * @brief Calibrate for the routing graph of a canonical network
+     * @param network Network whose states take the coordinates of their station
+     */
+    explicit GeometricHeuristic(const MetroNetwork &network);
+
+    /**
+     * @brief Lower bound on the travel time between two nodes
+     * @param node Node the bound starts from
+     * @param target Node the bound leads to
+     * @return Minutes the route takes at least
+     */
+    int estimate(int node, int target) const
+    {
+        double dx = x[node] - x[target];
+        double dy = y[node] - y[target];
+        return static_cast<int>(std::sqrt(dx * dx + dy * dy) * minutesPerUnit);
+    }
+
+    /** @brief Minutes per coordinate unit at the network's top speed, 0 if there is none */
+    double scale() const { return minutesPerUnit; }
+
+private:
+    void calibrate(const CsrGraph &graph);
+
+    std::vector<double> x, y;
+    double minutesPerUnit;
+};
+
+/**
+ * @brief Goal-directed point-to-point search (A*)
+ *
+ * Orders nodes by the time taken so far plus a lower bound on the time still
+ * to go, so the search heads for the target instead of growing evenly in
+ * every direction. The heuristic is any object with an
+ * int estimate(int node, int target) const member returning a lower bound in
+ * whole minutes, or -1 when the target cannot be reached from the node:
+ * GeometricHeuristic or LandmarkTable. Both are consistent, so the first
+ * time the target is settled its route is the fastest one.
+ *
+ * As in PointToPointDijkstra, only the nodes a query touched are reset
+ * before the next one.
+ *
+ * @tparam Queue One of the policies from PriorityQueues.h
+ */
+template <typename Queue>
+class AStarSearch
+{
+public:
+    /**
+     * @brief Fastest route between two nodes
+     * @param start Starting node
+     * @param target Destination node
+     * @param graph CSR representation of the network
+     * @param heuristic Lower bound on the remaining travel time
+     * @param path Output nodes from start to target, empty if unreachable
+     * @return Travel time in minutes, or -1 if the target is unreachable
+     */
+    template <typename Heuristic>
+    int findRoute(int start, int target, const CsrGraph &graph, const Heuristic &heuristic, std::vector<int> &path)
+    {
+        int n = graph.nodeCount();
+        if (static_cast<int>(distances.size()) != n)
+        {
+            distances.assign(n, INT_MAX);
+            previous.assign(n, -1);
+            estimates.assign(n, 0);
+        }
+        else
+        {
+            for (int node : touched)
+            {
+                distances[node] = INT_MAX;
+                previous[node] = -1;
+            }
+        }
+        touched.clear();
+        queue.reset(n);
+        path.clear();
+
+        int startEstimate = heuristic.estimate(start, target);
+        if (startEstimate < 0)
+            return -1;
+        distances[start] = 0;
+        estimates[start] = startEstimate;
+        touched.push_back(start);
+        queue.push(start, startEstimate);
+
+        while (!queue.empty())
+        {
+            int key;
+            int current = queue.pop(key);
+            int distance = distances[current];
+            if (key > distance + estimates[current])
+                continue;
+            ++settled;
+
+            if (current == target)
+            {
+                for (int at = target; at != -1; at = previous[at])
+                    path.push_back(at);
+                std::reverse(path.begin(), path.end());
+                return distance;
+            }
+
+            for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+            {
+                int next = graph.target(arc);
+                int newDistance = distance + graph.minutes(arc);
+                if (newDistance >= distances[next])
+                    continue;
+
+                /* Estimates depend only on the node, so each is computed once per query */
+                if (distances[next] == INT_MAX)
+                {
+                    int estimate = heuristic.estimate(next, target);
+                    if (estimate < 0)
+                        continue;
+                    estimates[next] = estimate;
+                    touched.push_back(next);
+                }
+                distances[next] = newDistance;
+                previous[next] = current;
+                queue.push(next, newDistance + estimates[next]);
+            }
+        }
+        return -1;
+    }
+
+    /** @brief Nodes settled by all queries so far */
+    uint64_t settledCount() const { return settled; }
+
+private:
+    std::vector<int> distances;
+    std::vector<int> previous;
+    std::vector<int> estimates; /**< Heuristic of every touched node */
+    std::vector<int> touched;   /**< Nodes whose entries the last query changed */
+    Queue queue;
+    uint64_t settled = 0;
+};
+
+typedef AStarSearch<BucketQueue> BucketAStar;
+
+#endif // ASTARSEARCH_H
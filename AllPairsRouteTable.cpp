@@ -0,0 +1,199 @@
+#include "AllPairsRouteTable.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <thread>
+
+using namespace std;
+
+const uint16_t AllPairsRouteTable::Unreachable;
+const int AllPairsRouteTable::MaxStations;
+
+namespace
+{
+const char FileMagic[4] = {'M', 'R', 'A', 'P'};
+const uint32_t FileVersion = 2;
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t stationCount;
+    uint32_t reserved;
+    uint64_t fingerprint;
+};
+
+template <typename T>
+void writeArray(ofstream &out, const FlatArray<T> &values)
+{
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+bool readArray(ifstream &in, FlatArray<T> &values, size_t count)
+{
+    vector<T> read(count);
+    if (!in.read(reinterpret_cast<char *>(read.data()), count * sizeof(T)))
+        return false;
+    values = FlatArray<T>(move(read));
+    return true;
+}
+}
+
+AllPairsRouteTable::AllPairsRouteTable() : stationCount(0), graphFingerprint(0)
+{
+}
+
+bool AllPairsRouteTable::build(const CsrGraph &graph, int threadCount)
+{
+    int n = graph.nodeCount();
+    if (n <= 0 || n >= MaxStations)
+        return false;
+
+    size_t cells = static_cast<size_t>(n) * n;
+    vector<uint16_t> minutesBySource(cells, Unreachable);
+    vector<uint32_t> metresBySource(cells, 0);
+    vector<uint16_t> nextBySource(cells, Unreachable);
+
+    if (threadCount <= 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+    threadCount = min(threadCount, n);
+
+    /* Sources are handed out one at a time so uneven search costs balance out */
+    atomic<int> nextSource(0);
+
+    auto worker = [&]()
+    {
+        /*
+         * Each search orders labels by (minutes, metres). Breaking time ties by
+         * distance makes every suffix of a stored route a stored route itself,
+         * so walking next-hop entries reproduces the tabulated length.
+         */
+        typedef pair<uint64_t, int> Label;
+        priority_queue<Label, vector<Label>, greater<Label>> queue;
+        vector<uint64_t> cost(n);
+        vector<int> firstHop(n);
+
+        for (int source = nextSource++; source < n; source = nextSource++)
+        {
+            fill(cost.begin(), cost.end(), UINT64_MAX);
+            cost[source] = 0;
+            firstHop[source] = source;
+            queue.push(Label(0, source));
+
+            while (!queue.empty())
+            {
+                Label top = queue.top();
+                queue.pop();
+                int current = top.second;
+                if (top.first > cost[current])
+                    continue;
+
+                for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+                {
+                    int next = graph.target(arc);
+                    uint64_t newCost = top.first + (static_cast<uint64_t>(graph.minutes(arc)) << 32) + graph.metres(arc);
+                    if (newCost < cost[next])
+                    {
+                        cost[next] = newCost;
+                        firstHop[next] = current == source ? next : firstHop[current];
+                        queue.push(Label(newCost, next));
+                    }
+                }
+            }
+
+            size_t row = static_cast<size_t>(source) * n;
+            for (int target = 0; target < n; ++target)
+            {
+                uint64_t minutes = cost[target] >> 32;
+                if (minutes >= Unreachable)
+                    continue;
+
+                size_t cell = row + target;
+                minutesBySource[cell] = static_cast<uint16_t>(minutes);
+                metresBySource[cell] = static_cast<uint32_t>(cost[target]);
+                nextBySource[cell] = static_cast<uint16_t>(firstHop[target]);
+            }
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(worker);
+    worker();
+    for (thread &t : workers)
+        t.join();
+
+    stationCount = n;
+    graphFingerprint = graph.fingerprint();
+    minuteTable = FlatArray<uint16_t>(move(minutesBySource));
+    metreTable = FlatArray<uint32_t>(move(metresBySource));
+    nextTable = FlatArray<uint16_t>(move(nextBySource));
+    return true;
+}
+
+void AllPairsRouteTable::path(int from, int to, vector<int> &path) const
+{
+    path.clear();
+    if (!reachable(from, to))
+        return;
+
+    path.push_back(from);
+    for (int at = from; at != to;)
+    {
+        at = nextTable[index(at, to)];
+        path.push_back(at);
+    }
+}
+
+bool AllPairsRouteTable::save(const string &fileName) const
+{
+    ofstream out(fileName, ios::binary);
+    if (!out)
+        return false;
+
+    FileHeader header;
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.version = FileVersion;
+    header.stationCount = stationCount;
+    header.reserved = 0;
+    header.fingerprint = graphFingerprint;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeArray(out, minuteTable);
+    writeArray(out, metreTable);
+    writeArray(out, nextTable);
+    return static_cast<bool>(out);
+}
+
+bool AllPairsRouteTable::load(const string &fileName, const CsrGraph &graph)
+{
+    ifstream in(fileName, ios::binary);
+    if (!in)
+        return false;
+
+    FileHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+
+    if (memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 ||
+        header.version != FileVersion ||
+        static_cast<int>(header.stationCount) != graph.nodeCount() ||
+        header.fingerprint != graph.fingerprint())
+        return false;
+
+    size_t cells = static_cast<size_t>(header.stationCount) * header.stationCount;
+    if (!readArray(in, minuteTable, cells) || !readArray(in, metreTable, cells) || !readArray(in, nextTable, cells))
+    {
+        stationCount = 0;
+        return false;
+    }
+
+    stationCount = header.stationCount;
+    graphFingerprint = header.fingerprint;
+    return true;
+}
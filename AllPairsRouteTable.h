@@ -0,0 +1,97 @@
+#ifndef ALLPAIRSROUTETABLE_H
+#define ALLPAIRSROUTETABLE_H
+
+#include "CsrGraph.h"
+#include "FlatArray.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief Precomputed all-pairs route table for small and medium networks
+ *
+ * Runs one shortest path search per source station (in parallel) and stores
+ * the results in flat n x n tables of compact integers: travel time, route
+ * length and the first station to move to. A query
+ * is then a table lookup, and the full path is recovered by following
+ * next-hop entries from the origin.
+ *
+ * Memory grows quadratically (8 bytes per station pair), so this mode is
+ * meant for networks up to a few thousand stations.
+ */
+class AllPairsRouteTable
+{
+public:
+    /** @brief Marks an unreachable pair in the minute and next-hop tables */
+    static const uint16_t Unreachable = 0xFFFF;
+
+    /** @brief Largest network the 16-bit next-hop table can address */
+    static const int MaxStations = 0xFFFF;
+
+    /**
+     * @brief Construct an empty table; isBuilt() is false until build() or load()
+     */
+    AllPairsRouteTable();
+
+    /**
+     * @brief Compute all tables for a network
+     * @param graph CSR representation of the metro network
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     * @return False if the network is too large for the table format
+     */
+    bool build(const CsrGraph &graph, int threadCount = 0);
+
+    /** @brief True once the tables hold data */
+    bool isBuilt() const { return stationCount > 0; }
+
+    /** @brief Number of stations covered by the tables */
+    int size() const { return stationCount; }
+
+    /** @brief True if to can be reached from from */
+    bool reachable(int from, int to) const { return minuteTable[index(from, to)] != Unreachable; }
+
+    /** @brief Shortest travel time in minutes */
+    int travelTime(int from, int to) const { return minuteTable[index(from, to)]; }
+
+    /** @brief Length of the fastest route in whole metres */
+    uint32_t metres(int from, int to) const { return metreTable[index(from, to)]; }
+
+    /** @brief Length of the fastest route in kilometers */
+    double distance(int from, int to) const { return metreTable[index(from, to)] * 0.001; }
+
+    /**
+     * @brief Recover the fastest route by following next-hop entries
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param path Output vector of station IDs from origin to destination, empty if unreachable
+     */
+    void path(int from, int to, std::vector<int> &path) const;
+
+    /**
+     * @brief Write the tables to a binary file
+     * @param fileName Path of the file to create
+     * @return True on success
+     */
+    bool save(const std::string &fileName) const;
+
+    /**
+     * @brief Read tables written by save()
+     * @param fileName Path of the file to read
+     * @param graph Network the tables must have been built for
+     * @return False if the file is unreadable or belongs to a different network
+     */
+    bool load(const std::string &fileName, const CsrGraph &graph);
+
+private:
+    friend class NetworkSnapshot;
+
+    size_t index(int from, int to) const { return static_cast<size_t>(from) * stationCount + to; }
+
+    int stationCount;
+    uint64_t graphFingerprint;       /**< CsrGraph::fingerprint() of the source network */
+    FlatArray<uint16_t> minuteTable; /**< Travel time per pair */
+    FlatArray<uint32_t> metreTable;  /**< Route length per pair in metres */
+    FlatArray<uint16_t> nextTable;   /**< First station after the origin on the route */
+};
+
+#endif // ALLPAIRSROUTETABLE_H
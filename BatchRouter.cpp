@@ -0,0 +1,423 @@
+#include "BatchRouter.h"
+#include <algorithm>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+/* Bytes of input read per block; large enough to make locking negligible */
+static const size_t BlockBytes = 1 << 20;
+
+struct BatchRouter::Block
+{
+    uint64_t sequence; /**< Position of the block in the input */
+    string text;       /**< Whole input lines */
+    string output;     /**< Formatted results, one line per query */
+    uint64_t queries;  /**< Number of queries in the block */
+};
+
+BatchRouter::BatchRouter(const RoutePlanner &planner)
+    : source(planner), timetable(nullptr), fareTable(nullptr), departureTime(0), format(Csv), holiday(false), threadCount(0), queries(0)
+{
+    /* The first station with a name wins; IDs reach the others */
+    const vector<Station> &stations = planner.network().stations;
+    stationIds.reserve(stations.size());
+    for (const auto &station : stations)
+        stationIds.insert(make_pair(station.name, station.id));
+}
+
+int BatchRouter::findStation(const string &name) const
+{
+    auto found = stationIds.find(name);
+    if (found != stationIds.end())
+        return found->second;
+
+    if (name.empty() || name.size() > 9)
+        return -1;
+    int id = 0;
+    for (char c : name)
+    {
+        if (c < '0' || c > '9')
+            return -1;
+        id = id * 10 + (c - '0');
+    }
+
+    /* IDs are the nodes of the source data, as before interchanges were collapsed into stations */
+    const FlatArray<int32_t> &nodeStation = source.network().nodeStation;
+    return id < static_cast<int>(nodeStation.size()) ? nodeStation[id] : -1;
+}
+
+/* Read one comma- or tab-separated field starting at p, unquoting if needed */
+static const char *readField(const char *p, const char *end, string &field)
+{
+    field.clear();
+    while (p < end && (*p == ' ' || *p == '\t'))
+        ++p;
+
+    if (p < end && *p == '"')
+    {
+        for (++p; p < end; ++p)
+        {
+            if (*p == '"')
+            {
+                if (p + 1 < end && p[1] == '"')
+                    ++p;
+                else
+                {
+                    ++p;
+                    break;
+                }
+            }
+            field += *p;
+        }
+        while (p < end && *p != ',' && *p != '\t')
+            ++p;
+    }
+    else
+    {
+        const char *start = p;
+        while (p < end && *p != ',' && *p != '\t')
+            ++p;
+        const char *last = p;
+        while (last > start && (last[-1] == ' ' || last[-1] == '\r'))
+            --last;
+        field.assign(start, last);
+    }
+
+    return p < end ? p + 1 : p;
+}
+
+/* Append a CSV field, quoted only when it has to be */
+static void appendCsv(string &out, const string &value)
+{
+    if (value.find_first_of(",\"\n\r") == string::npos)
+    {
+        out += value;
+        return;
+    }
+    out += '"';
+    for (char c : value)
+    {
+        if (c == '"')
+            out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+/* Append a JSON string literal */
+static void appendJson(string &out, const string &value)
+{
+    out += '"';
+    for (char c : value)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out += escaped;
+            }
+            else
+                out += c;
+        }
+    }
+    out += '"';
+}
+
+void BatchRouter::processBlock(RoutePlanner &planner, ConnectionScan *scan, Block &block) const
+{
+    const vector<Station> &stations = planner.network().stations;
+    const FareTable &fares = fareTable ? *fareTable : FareTable::defaultTable();
+    int day = fares.dayType(holiday);
+    const char *p = block.text.data();
+    const char *end = p + block.text.size();
+    string from, to, path;
+    Journey journey;
+    RouteResult &route = journey.route;
+    char number[128];
+
+    block.output.clear();
+    block.queries = 0;
+    bool firstLine = block.sequence == 0;
+    while (p < end)
+    {
+        const char *lineEnd = static_cast<const char *>(memchr(p, '\n', end - p));
+        if (!lineEnd)
+            lineEnd = end;
+        const char *next = lineEnd < end ? lineEnd + 1 : end;
+
+        const char *q = p;
+        while (q < lineEnd && (*q == ' ' || *q == '\t' || *q == '\r'))
+            ++q;
+        if (q == lineEnd || *q == '#')
+        {
+            p = next;
+            continue;
+        }
+
+        q = readField(q, lineEnd, from);
+        readField(q, lineEnd, to);
+        p = next;
+
+        /* Skip a header line unless a station really is called "from" */
+        bool header = firstLine && from == "from" && stationIds.find(from) == stationIds.end();
+        firstLine = false;
+        if (header)
+            continue;
+
+        int fromId = findStation(from);
+        int toId = findStation(to);
+        bool known = fromId >= 0 && toId >= 0;
+        bool found = known && (scan ? scan->findJourney(fromId, toId, departureTime, journey)
+                                    : planner.findRoute(fromId, toId, route));
+        const char *status = found ? "ok" : known ? "no route" : "unknown station";
+        int fare = found ? fares.fare(route.distance, day, false) : 0;
+
+        if (format == Csv)
+        {
+            appendCsv(block.output, from);
+            block.output += ',';
+            appendCsv(block.output, to);
+            block.output += ',';
+            block.output += status;
+            if (scan)
+            {
+                block.output += ',';
+                if (found)
+                {
+                    block.output += formatTimeOfDay(journey.departure);
+                    block.output += ',';
+                    block.output += formatTimeOfDay(journey.arrival);
+                }
+                else
+                    block.output += ',';
+            }
+            if (found)
+            {
+                snprintf(number, sizeof(number), ",%d,%.3f,%d,%d,", route.travelTime, route.distance, fare,
+                         route.transfers);
+                block.output += number;
+                path.clear();
+                for (size_t i = 0; i < route.path.size(); ++i)
+                {
+                    if (i > 0)
+                        path += '|';
+                    path += stations[route.path[i]].name;
+                }
+                appendCsv(block.output, path);
+            }
+            else
+                block.output += ",,,,,";
+        }
+        else if (format == Directions && found)
+        {
+            renderer.render(route, fares, holiday, false, RouteRenderer::Json, block.output);
+            if (scan)
+            {
+                block.output.pop_back();
+                block.output += ",\"departure\":\"" + formatTimeOfDay(journey.departure) + "\",\"arrival\":\"" +
+                                formatTimeOfDay(journey.arrival) + "\"}";
+            }
+        }
+        else
+        {
+            block.output += "{\"from\":";
+            appendJson(block.output, from);
+            block.output += ",\"to\":";
+            appendJson(block.output, to);
+            if (found && scan)
+            {
+                block.output += ",\"departure\":\"" + formatTimeOfDay(journey.departure) + "\",\"arrival\":\"" +
+                                formatTimeOfDay(journey.arrival) + '"';
+            }
+            if (found)
+            {
+                snprintf(number, sizeof(number), ",\"minutes\":%d,\"distance\":%.3f,\"fare\":%d,\"transfers\":%d,\"path\":[",
+                         route.travelTime, route.distance, fare, route.transfers);
+                block.output += number;
+                for (size_t i = 0; i < route.path.size(); ++i)
+                {
+                    if (i > 0)
+                        block.output += ',';
+                    appendJson(block.output, stations[route.path[i]].name);
+                }
+                block.output += "]}";
+            }
+            else
+            {
+                block.output += ",\"error\":";
+                appendJson(block.output, status);
+                block.output += '}';
+            }
+        }
+        block.output += '\n';
+        ++block.queries;
+    }
+}
+
+bool BatchRouter::run(FILE *input, FILE *output)
+{
+    queries = 0;
+    error.clear();
+
+    int workers = threadCount > 0 ? threadCount : static_cast<int>(thread::hardware_concurrency());
+    workers = max(workers, 1);
+    const size_t maxInFlight = static_cast<size_t>(workers) * 2;
+
+    if (format == Directions)
+        renderer.setNetwork(source.network());
+    if (format == Csv)
+    {
+        fputs(timetable ? "from,to,status,departure,arrival,minutes,distance_km,fare,transfers,path\n"
+                        : "from,to,status,minutes,distance_km,fare,transfers,path\n",
+              output);
+    }
+
+    /* Blocks travel from the reader to the workers through pending and come
+       back through finished, from where they are written in sequence order */
+    mutex lock;
+    condition_variable workReady, slotFree;
+    deque<Block *> pending;
+    map<uint64_t, Block *> finished;
+    vector<Block *> spare;
+    size_t inFlight = 0;
+    uint64_t nextToWrite = 0;
+    bool inputDone = false, writing = false, writeFailed = false;
+
+    vector<thread> pool;
+    for (int t = 0; t < workers; ++t)
+    {
+        pool.emplace_back([&]() {
+            RoutePlanner planner(source);
+            unique_ptr<ConnectionScan> scan(timetable ? new ConnectionScan(*timetable) : nullptr);
+            unique_lock<mutex> guard(lock);
+            for (;;)
+            {
+                workReady.wait(guard, [&]() { return !pending.empty() || inputDone; });
+                if (pending.empty())
+                    return;
+                Block *block = pending.front();
+                pending.pop_front();
+
+                guard.unlock();
+                processBlock(planner, scan.get(), *block);
+                guard.lock();
+
+                finished[block->sequence] = block;
+                if (writing)
+                    continue;
+
+                /* Only one thread writes at a time, the others keep routing */
+                writing = true;
+                for (;;)
+                {
+                    auto next = finished.find(nextToWrite);
+                    if (next == finished.end())
+                        break;
+                    Block *done = next->second;
+                    finished.erase(next);
+
+                    guard.unlock();
+                    if (!writeFailed && fwrite(done->output.data(), 1, done->output.size(), output) != done->output.size())
+                        writeFailed = true;
+                    guard.lock();
+
+                    queries += done->queries;
+                    spare.push_back(done);
+                    ++nextToWrite;
+                    --inFlight;
+                    slotFree.notify_one();
+                }
+                writing = false;
+            }
+        });
+    }
+
+    /* Read whole lines in blocks; a partial last line is carried into the next block */
+    vector<char> buffer(BlockBytes);
+    string carry;
+    bool readFailed = false;
+    for (uint64_t sequence = 0;; ++sequence)
+    {
+        size_t bytes = fread(buffer.data(), 1, buffer.size(), input);
+        if (bytes < buffer.size() && ferror(input))
+            readFailed = true;
+        bool last = bytes < buffer.size();
+
+        Block *block;
+        {
+            unique_lock<mutex> guard(lock);
+            slotFree.wait(guard, [&]() { return inFlight < maxInFlight; });
+            ++inFlight;
+            if (spare.empty())
+                block = new Block;
+            else
+            {
+                block = spare.back();
+                spare.pop_back();
+            }
+        }
+
+        block->sequence = sequence;
+        block->text.swap(carry);
+        block->text.append(buffer.data(), bytes);
+        carry.clear();
+        if (!last)
+        {
+            size_t newline = block->text.rfind('\n');
+            if (newline != string::npos)
+            {
+                carry.assign(block->text, newline + 1, string::npos);
+                block->text.resize(newline + 1);
+            }
+            else
+            {
+                /* A single line longer than a block; keep reading into it */
+                carry.swap(block->text);
+            }
+        }
+
+        {
+            lock_guard<mutex> guard(lock);
+            pending.push_back(block);
+        }
+        workReady.notify_one();
+        if (last)
+            break;
+    }
+
+    {
+        lock_guard<mutex> guard(lock);
+        inputDone = true;
+    }
+    workReady.notify_all();
+    for (auto &worker : pool)
+        worker.join();
+
+    for (Block *block : spare)
+        delete block;
+    for (auto &entry : finished)
+        delete entry.second;
+
+    if (fflush(output) != 0)
+        writeFailed = true;
+    if (readFailed)
+        error = "Cannot read the queries";
+    else if (writeFailed)
+        error = "Cannot write the results";
+    return error.empty();
+}
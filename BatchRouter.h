@@ -0,0 +1,114 @@
+#ifndef BATCHROUTER_H
+#define BATCHROUTER_H
+
+#include "RoutePlanner.h"
+#include "ConnectionScan.h"
+#include "FareTable.h"
+#include "RouteRenderer.h"
+#include <cstdio>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+
+/**
+ * @brief Answers a stream of origin-destination queries on a pool of threads
+ *
+ * Input is text with one query per line: origin and destination separated
+ * by a comma or tab, each a station name or a node ID as loaded, before
+ * interchanges were collapsed into stations. Fields may be
+ * quoted as in CSV. Empty lines and lines starting with '#' are skipped, as
+ * is a first line whose origin reads "from".
+ *
+ * The input is read in blocks of whole lines. Each worker thread parses and
+ * answers one block at a time with its own RoutePlanner copy, so search
+ * buffers are never shared, and formats the results into one output buffer
+ * per block. Blocks are written in input order, so the output has exactly
+ * one line per query in the same order as the queries.
+ *
+ * With a timetable, every query instead asks for the earliest arrival when
+ * leaving at one time of day, and the output gains the departure of the
+ * first train and the arrival of the last.
+ */
+class BatchRouter
+{
+public:
+    /** @brief Output line format */
+    enum Format
+    {
+        Csv,       /**< Header plus from,to,status,[departure,arrival,]minutes,distance_km,fare,transfers,path */
+        JsonLines, /**< One JSON object per query */
+        Directions /**< One RouteRenderer JSON object per query, with every station and line change */
+    };
+
+    /**
+     * @brief Construct a router for a planner
+     * @param planner Planner whose network and indices are shared by all workers
+     */
+    explicit BatchRouter(const RoutePlanner &planner);
+
+    /** @brief Select the output format, CSV by default */
+    void setFormat(Format value) { format = value; }
+
+    /** @brief Charge holiday fares instead of weekday fares */
+    void setHoliday(bool value) { holiday = value; }
+
+    /**
+     * @brief Charge fares from a table instead of FareTable::defaultTable()
+     * @param table Fare table, must outlive the router; nullptr for the default
+     */
+    void setFareTable(const FareTable *table) { fareTable = table; }
+
+    /**
+     * @brief Answer queries from a timetable instead of travel times
+     * @param value Timetable of the planner's network, must outlive the router; nullptr for travel times
+     * @param departure Seconds after midnight every journey leaves at
+     */
+    void setTimetable(const Timetable *value, int departure)
+    {
+        timetable = value;
+        departureTime = departure;
+    }
+
+    /**
+     * @brief Set the number of worker threads
+     * @param count Number of threads, 0 to use all hardware threads
+     */
+    void setThreadCount(int count) { threadCount = count; }
+
+    /**
+     * @brief Answer all queries of a stream
+     * @param input Stream of queries
+     * @param output Stream receiving one result line per query
+     * @return False on a read or write error, see errorString()
+     */
+    bool run(std::FILE *input, std::FILE *output);
+
+    /** @brief Number of queries answered by the last run() */
+    uint64_t queryCount() const { return queries; }
+
+    /** @brief Description of the last failure */
+    const std::string &errorString() const { return error; }
+
+private:
+    struct Block;
+
+    /* Parse, route and format every query of a block */
+    void processBlock(RoutePlanner &planner, ConnectionScan *scan, Block &block) const;
+
+    /* Station ID for a name or a node ID of the source data, -1 if unknown */
+    int findStation(const std::string &name) const;
+
+    const RoutePlanner &source;
+    const Timetable *timetable;
+    const FareTable *fareTable;
+    int departureTime;
+    std::unordered_map<std::string, int> stationIds;
+    RouteRenderer renderer; /**< Built by run() for Directions */
+    Format format;
+    bool holiday;
+    int threadCount;
+    uint64_t queries;
+    std::string error;
+};
+
+#endif // BATCHROUTER_H
@@ -0,0 +1,283 @@
+#include "ConnectionScan.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+ConnectionScan::ConnectionScan(const Timetable &timetable) : timetable(timetable)
+{
+}
+
+void ConnectionScan::reset()
+{
+    int stations = timetable.stationCount();
+    int trips = timetable.tripCount();
+    if (static_cast<int>(ready.size()) != stations || static_cast<int>(boarded.size()) != trips)
+    {
+        ready.assign(stations, INT_MAX);
+        arrivedBy.assign(stations, -1);
+        profiles.assign(stations, vector<ProfileEntry>());
+        boarded.assign(trips, -1);
+        tripArrival.assign(trips, INT_MAX);
+        tripExit.assign(trips, -1);
+    }
+    else
+    {
+        for (int station : touchedStations)
+        {
+            ready[station] = INT_MAX;
+            profiles[station].clear();
+        }
+        for (int trip : touchedTrips)
+        {
+            boarded[trip] = -1;
+            tripArrival[trip] = INT_MAX;
+        }
+    }
+    touchedStations.clear();
+    touchedTrips.clear();
+}
+
+bool ConnectionScan::findJourney(int from, int to, int departure, Journey &journey)
+{
+    return earliestArrival(from, to, departure, INT_MAX, journey);
+}
+
+bool ConnectionScan::earliestArrival(int from, int to, int departure, int lastBoarding, Journey &journey)
+{
+    reset();
+    if (from == to)
+    {
+        legs.clear();
+        describe(legs, journey);
+        journey.route.path.assign(1, from);
+        journey.departure = departure;
+        journey.arrival = departure;
+        return true;
+    }
+
+    ready[from] = departure;
+    arrivedBy[from] = -1;
+    touchedStations.push_back(from);
+
+    const vector<Connection> &connections = timetable.connections();
+    int count = static_cast<int>(connections.size());
+    int best = INT_MAX;
+    int exit = -1;
+    int i = timetable.firstDeparture(departure);
+    for (; i < count; ++i)
+    {
+        const Connection &connection = connections[i];
+
+        /* Later trains cannot arrive any earlier */
+        if (connection.departure >= best)
+            break;
+
+        if (boarded[connection.trip] < 0)
+        {
+            if (ready[connection.from] > connection.departure)
+                continue;
+            if (connection.from == from && connection.departure > lastBoarding)
+                continue;
+            boarded[connection.trip] = i;
+            touchedTrips.push_back(connection.trip);
+        }
+
+        if (connection.to == to)
+        {
+            if (connection.arrival < best)
+            {
+                best = connection.arrival;
+                exit = i;
+            }
+            continue;
+        }
+
+        int time = connection.arrival + timetable.transferSeconds(connection.to);
+        if (time < ready[connection.to])
+        {
+            if (ready[connection.to] == INT_MAX)
+                touchedStations.push_back(connection.to);
+            ready[connection.to] = time;
+            arrivedBy[connection.to] = i;
+        }
+    }
+    scanned += i - timetable.firstDeparture(departure);
+    if (exit < 0)
+        return false;
+
+    /* Walk back train by train: alighting connection, where its trip was boarded, how that station was reached */
+    legs.clear();
+    while (exit >= 0 && legs.size() <= touchedTrips.size())
+    {
+        int enter = boarded[connections[exit].trip];
+        legs.push_back(make_pair(enter, exit));
+        int station = connections[enter].from;
+        exit = station == from ? -1 : arrivedBy[station];
+    }
+    reverse(legs.begin(), legs.end());
+    describe(legs, journey);
+    return true;
+}
+
+const ConnectionScan::ProfileEntry *ConnectionScan::evaluate(int station, int time) const
+{
+    /* Entries run from the latest departure down; the last one still leaving at or after
+       time is the earliest usable train and arrives first */
+    const vector<ProfileEntry> &profile = profiles[station];
+    auto end = partition_point(profile.begin(), profile.end(),
+                               [time](const ProfileEntry &entry) { return entry.departure >= time; });
+    return end == profile.begin() ? nullptr : &*(end - 1);
+}
+
+void ConnectionScan::findProfile(int from, int to, int earliest, int latest, vector<Journey> &journeys)
+{
+    journeys.clear();
+    if (from == to)
+    {
+        journeys.resize(1);
+        findJourney(from, to, earliest, journeys[0]);
+        return;
+    }
+
+    /* Leaving at the end of the window arrives by some time; the scan stops at trains leaving after it */
+    int bound = INT_MAX;
+    if (findJourney(from, to, latest, bounding))
+        bound = bounding.arrival;
+    for (;;)
+    {
+        /* Journeys are read out before the check below, which reuses the labels */
+        scanProfile(from, to, earliest, latest, bound);
+        describeWindow(to, journeys);
+
+        /*
+         * The bounding journey may leave after the window, so it does not rule out the journeys
+         * inside it that arrive later. Those can only leave after the last one found; if there is
+         * such a journey, scan again up to its arrival, which finds it and moves that point on.
+         */
+        if (bound == INT_MAX)
+            break;
+        int after = journeys.empty() ? earliest : journeys.back().departure + 1;
+        if (after > latest || !earliestArrival(from, to, after, latest, bounding) || bounding.arrival <= bound)
+            break;
+        bound = bounding.arrival;
+    }
+}
+
+void ConnectionScan::describeWindow(int to, vector<Journey> &journeys)
+{
+    const vector<Connection> &connections = timetable.connections();
+    size_t count = window.size();
+    journeys.resize(count);
+    for (size_t j = 0; j < count; ++j)
+    {
+        legs.clear();
+        const ProfileEntry *entry = &window[count - 1 - j];
+        while (entry && legs.size() <= touchedTrips.size())
+        {
+            legs.push_back(make_pair(entry->enter, entry->exit));
+            const Connection &alighting = connections[entry->exit];
+            if (alighting.to == to)
+                break;
+            entry = evaluate(alighting.to, alighting.arrival + timetable.transferSeconds(alighting.to));
+        }
+        describe(legs, journeys[j]);
+    }
+}
+
+void ConnectionScan::scanProfile(int from, int to, int earliest, int latest, int bound)
+{
+    reset();
+    window.clear();
+
+    const vector<Connection> &connections = timetable.connections();
+    int first = timetable.firstDeparture(earliest);
+    int last = bound == INT_MAX ? static_cast<int>(connections.size()) : timetable.firstDeparture(bound + 1);
+    for (int i = last - 1; i >= first; --i)
+    {
+        const Connection &connection = connections[i];
+
+        /* Best arrival when alighting here: at the destination, or by the best train onwards */
+        int arrival = INT_MAX;
+        if (connection.to == to)
+            arrival = connection.arrival;
+        else if (const ProfileEntry *next = evaluate(connection.to, connection.arrival + timetable.transferSeconds(connection.to)))
+            arrival = next->arrival;
+
+        int trip = connection.trip;
+        if (arrival < tripArrival[trip])
+        {
+            if (tripArrival[trip] == INT_MAX)
+                touchedTrips.push_back(trip);
+            tripArrival[trip] = arrival;
+            tripExit[trip] = i;
+        }
+
+        /* Boarding here pays off if it beats every later departure from the same station */
+        arrival = tripArrival[trip];
+        if (arrival == INT_MAX || connection.from == to)
+            continue;
+        ProfileEntry entry = {connection.departure, arrival, i, tripExit[trip]};
+
+        /* Journeys are compared only with those that leave inside the window too */
+        if (connection.from == from && connection.departure <= latest &&
+            (window.empty() || window.back().arrival > arrival))
+        {
+            if (!window.empty() && window.back().departure == connection.departure)
+                window.back() = entry;
+            else
+                window.push_back(entry);
+        }
+
+        vector<ProfileEntry> &profile = profiles[connection.from];
+        if (!profile.empty() && profile.back().arrival <= arrival)
+            continue;
+        if (profile.empty())
+            touchedStations.push_back(connection.from);
+
+        if (!profile.empty() && profile.back().departure == connection.departure)
+            profile.back() = entry;
+        else
+            profile.push_back(entry);
+    }
+    scanned += last - first;
+}
+
+void ConnectionScan::describe(const vector<pair<int, int>> &legs, Journey &journey) const
+{
+    const vector<Connection> &connections = timetable.connections();
+    RouteResult &route = journey.route;
+    route.path.clear();
+    route.legs.clear();
+    journey.legDepartures.clear();
+    journey.legArrivals.clear();
+    uint32_t metres = 0;
+
+    for (const pair<int, int> &leg : legs)
+    {
+        const Connection &boarding = connections[leg.first];
+        if (route.path.empty() || route.path.back() != boarding.from)
+            route.path.push_back(boarding.from);
+        int first = static_cast<int>(route.path.size()) - 1;
+
+        /* The rides of one trip are linked, so the stations in between come for free */
+        for (int connection = leg.first; connection >= 0; connection = timetable.nextInTrip(connection))
+        {
+            route.path.push_back(connections[connection].to);
+            metres += timetable.metres(connection);
+            if (connection == leg.second)
+                break;
+        }
+
+        RouteLeg routeLeg = {timetable.tripLine(boarding.trip), first, static_cast<int>(route.path.size()) - 1};
+        route.legs.push_back(routeLeg);
+        journey.legDepartures.push_back(boarding.departure);
+        journey.legArrivals.push_back(connections[leg.second].arrival);
+    }
+
+    journey.departure = legs.empty() ? 0 : journey.legDepartures.front();
+    journey.arrival = legs.empty() ? 0 : journey.legArrivals.back();
+    route.travelTime = (journey.arrival - journey.departure + 59) / 60;
+    route.distance = metres * 0.001;
+    route.transfers = legs.empty() ? 0 : static_cast<int>(legs.size()) - 1;
+}
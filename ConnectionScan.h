@@ -0,0 +1,121 @@
+#ifndef CONNECTIONSCAN_H
+#define CONNECTIONSCAN_H
+
+#include "Timetable.h"
+#include "MetroNetwork.h"
+#include <vector>
+
+/**
+ * @brief Timed route between two stations
+ *
+ * The route has one leg per train, so two trains of the same line in a row
+ * are two legs and every train change counts as a transfer.
+ */
+struct Journey
+{
+    int departure;                  /**< Seconds after midnight the first train leaves */
+    int arrival;                    /**< Seconds after midnight the last train arrives */
+    RouteResult route;              /**< Stations, legs and distance; travelTime from departure to arrival, rounded up */
+    std::vector<int> legDepartures; /**< Seconds after midnight the train of every leg leaves */
+    std::vector<int> legArrivals;   /**< Seconds after midnight the train of every leg arrives */
+};
+
+/**
+ * @brief Timetable queries with the Connection Scan Algorithm
+ *
+ * An earliest arrival query reads the connections from the requested time
+ * on in departure order and checks each against two labels: the time a
+ * rider can be ready at its departure station and whether its trip has
+ * already been boarded. No priority queue is involved; the scan is one
+ * linear pass over contiguous memory and stops once trains leave after the
+ * best arrival found.
+ *
+ * A profile query answers "when can I leave between two times": it scans
+ * the connections once backwards, from the last train down to the start of
+ * the window, and keeps for every station the departures that still pay off,
+ * ending with every journey of the window that no later departure beats.
+ *
+ * Holds the labels for one thread and resets only what a query touched, as
+ * ChQuery does.
+ */
+class ConnectionScan
+{
+public:
+    /**
+     * @brief Construct a query object
+     * @param timetable Timetable to query; must outlive this object
+     */
+    explicit ConnectionScan(const Timetable &timetable);
+
+    /**
+     * @brief Earliest arrival when leaving at a given time
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param departure Seconds after midnight the rider is ready at the origin
+     * @param journey Output journey; contents are unspecified when none exists
+     * @return False if no train reaches the destination after the departure
+     */
+    bool findJourney(int from, int to, int departure, Journey &journey);
+
+    /**
+     * @brief Every journey worth taking when leaving within a time window
+     *
+     * A journey is listed unless another one leaving no earlier, but still
+     * within the window, arrives no later, so departures and arrivals both
+     * increase along the list.
+     *
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param earliest Seconds after midnight of the earliest departure
+     * @param latest Seconds after midnight of the latest departure
+     * @param journeys Output journeys ordered by departure
+     */
+    void findProfile(int from, int to, int earliest, int latest, std::vector<Journey> &journeys);
+
+    /** @brief Connections read by all queries so far */
+    uint64_t scannedCount() const { return scanned; }
+
+private:
+    /* Departure from a station that reaches the destination by a given arrival */
+    struct ProfileEntry
+    {
+        int departure;
+        int arrival;
+        int enter; /**< Connection boarded */
+        int exit;  /**< Connection of the same trip to alight after */
+    };
+
+    /* Reset the labels a previous query touched */
+    void reset();
+
+    /* findJourney() boarding at the origin no later than lastBoarding */
+    bool earliestArrival(int from, int to, int departure, int lastBoarding, Journey &journey);
+
+    /* Profiles of connections leaving from earliest up to bound; the origin's journeys inside the window go to window */
+    void scanProfile(int from, int to, int earliest, int latest, int bound);
+
+    /* Journeys of the window, earliest departure first */
+    void describeWindow(int to, std::vector<Journey> &journeys);
+
+    /* First train of a station's profile a rider ready at a time can take, nullptr if none */
+    const ProfileEntry *evaluate(int station, int time) const;
+
+    /* Fill a journey from its legs, given as pairs of boarding and alighting connection */
+    void describe(const std::vector<std::pair<int, int>> &legs, Journey &journey) const;
+
+    const Timetable &timetable;
+    std::vector<int> ready;                         /**< Time a rider can board at every station */
+    std::vector<int> arrivedBy;                     /**< Connection behind ready, -1 at the origin */
+    std::vector<int> boarded;                       /**< Connection a trip was boarded at, -1 if not */
+    std::vector<int> tripArrival;                   /**< Profile: destination arrival staying on a trip */
+    std::vector<int> tripExit;                      /**< Profile: connection to alight after */
+    std::vector<std::vector<ProfileEntry>> profiles; /**< Profile of every station, latest departure first */
+    std::vector<int> touchedStations;
+    std::vector<int> touchedTrips;
+    std::vector<std::pair<int, int>> legs;
+    std::vector<ProfileEntry> window;               /**< Profile: journeys leaving inside the window, latest first */
+    Journey bounding;                                /**< Profile: journey bounding the scan */
+    uint64_t scanned = 0;
+};
+
+#endif // CONNECTIONSCAN_H
@@ -0,0 +1,115 @@
+#include "ConnectionScan.h"
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include "NetworkGenerator.h"
+#include "Timetable.h"
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Checks ConnectionScan::findProfile() against findJourney(): every journey
+ * findJourney() finds when leaving inside a window, and that itself leaves
+ * inside it, must be matched by a profile journey leaving no earlier and
+ * arriving at the same time. Exits with 1 on the first failing networks.
+ */
+
+namespace
+{
+int failures = 0;
+
+void fail(const char *network, int from, int to, int earliest, int latest, const char *what, int time)
+{
+    if (failures++ < 20)
+        printf("FAIL %s: profile %d -> %d in [%d, %d]: %s at %d\n", network, from, to, earliest, latest, what, time);
+}
+
+void checkWindow(const char *network, ConnectionScan &scan, int from, int to, int earliest, int latest)
+{
+    vector<Journey> profile;
+    scan.findProfile(from, to, earliest, latest, profile);
+    for (size_t i = 0; i < profile.size(); ++i)
+    {
+        const Journey &journey = profile[i];
+        if (journey.departure < earliest || journey.departure > latest)
+            fail(network, from, to, earliest, latest, "journey leaves outside the window", journey.departure);
+        if (i > 0 && (journey.departure <= profile[i - 1].departure || journey.arrival <= profile[i - 1].arrival))
+            fail(network, from, to, earliest, latest, "journeys out of order or dominated", journey.departure);
+    }
+
+    Journey journey;
+    for (int time = earliest; time <= latest; time += 30)
+    {
+        if (!scan.findJourney(from, to, time, journey) || journey.departure > latest)
+            continue;
+
+        bool matched = false;
+        for (const Journey &listed : profile)
+            matched = matched || (listed.departure >= journey.departure && listed.arrival == journey.arrival);
+        if (!matched)
+            fail(network, from, to, earliest, latest, "journey missing for departure", time);
+    }
+}
+
+void checkNetwork(const char *network, const vector<Station> &nodes, const vector<vector<Edge>> &graph, int headway,
+                  int windows)
+{
+    MetroNetwork metro;
+    buildMetroNetwork(nodes, graph, metro);
+    Timetable timetable;
+    if (!timetable.generate(metro, 5 * 3600, 24 * 3600, headway))
+    {
+        printf("FAIL %s: cannot generate a timetable\n", network);
+        ++failures;
+        return;
+    }
+
+    ConnectionScan scan(timetable);
+    int stations = static_cast<int>(metro.stations.size());
+    mt19937 random(17);
+    uniform_int_distribution<int> station(0, stations - 1);
+    uniform_int_distribution<int> start(5 * 3600, 22 * 3600);
+    uniform_int_distribution<int> length(60, 3600);
+    for (int i = 0; i < windows; ++i)
+    {
+        int from = station(random);
+        int to = station(random);
+        int earliest = start(random);
+        if (from != to)
+            checkWindow(network, scan, from, to, earliest, earliest + length(random));
+    }
+}
+}
+
+int main()
+{
+    vector<Station> nodes;
+    vector<vector<Edge>> graph;
+    initializeMetroNetwork(nodes, graph);
+
+    /* The window closes just before the departure that beats the last train inside it */
+    {
+        MetroNetwork metro;
+        buildMetroNetwork(nodes, graph, metro);
+        Timetable timetable;
+        timetable.generate(metro, 5 * 3600, 24 * 3600, 420);
+        ConnectionScan scan(timetable);
+        checkWindow("delhi", scan, 7, 1, 59000, 59596);
+    }
+    checkNetwork("delhi", nodes, graph, 420, 300);
+
+    NetworkGenerator generator;
+    generator.setStationCount(500);
+    generator.generate(nodes, graph);
+    checkNetwork("radial-500", nodes, graph, 300, 100);
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All profile checks passed\n");
+    return 0;
+}
@@ -0,0 +1,639 @@
+#include "ContractionHierarchy.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+using namespace std;
+
+namespace
+{
+const char FileMagic[4] = {'M', 'R', 'C', 'H'};
+const uint32_t FileVersion = 1;
+
+/* Witness searches give up after settling this many stations */
+const int WitnessSettleLimit = 1000;
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t nodeCount;
+    uint32_t upArcCount;
+    uint32_t downArcCount;
+    uint32_t reserved;
+    uint64_t fingerprint;
+};
+
+typedef ContractionHierarchy::Arc Arc;
+
+struct Shortcut
+{
+    int from;
+    Arc arc;
+};
+
+/* Run fn(index, worker) for every index in [0, count) on up to threadCount threads */
+template <typename Function>
+void parallelFor(int count, int threadCount, Function fn)
+{
+    atomic<int> next(0);
+    auto worker = [&](int workerIndex)
+    {
+        for (int i = next++; i < count; i = next++)
+            fn(i, workerIndex);
+    };
+
+    threadCount = max(1, min(threadCount, count));
+    vector<thread> workers;
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(worker, i);
+    worker(0);
+    for (thread &t : workers)
+        t.join();
+}
+
+/**
+ * Graph that shrinks while stations are contracted. out[u] holds arcs u -> w
+ * and in[w] holds the same arcs with target set to u. Only arcs between
+ * uncontracted stations are kept; a station's remaining arcs are frozen into
+ * the search graph when it is contracted.
+ */
+class ContractionGraph
+{
+public:
+    explicit ContractionGraph(const CsrGraph &graph)
+        : out(graph.nodeCount()), in(graph.nodeCount()),
+          contracted(graph.nodeCount(), 0), inRound(graph.nodeCount(), 0)
+    {
+        for (int u = 0; u < graph.nodeCount(); ++u)
+        {
+            for (int a = graph.arcBegin(u); a < graph.arcEnd(u); ++a)
+            {
+                if (graph.target(a) != u)
+                {
+                    Arc arc = {graph.target(a), graph.minutes(a), graph.metres(a), -1};
+                    addArc(u, arc);
+                }
+            }
+        }
+    }
+
+    /* Insert an arc, keeping only the better of two parallel arcs */
+    void addArc(int from, const Arc &arc)
+    {
+        for (Arc &existing : out[from])
+        {
+            if (existing.target != arc.target)
+                continue;
+
+            if (arc.minutes < existing.minutes ||
+                (arc.minutes == existing.minutes && arc.metres < existing.metres))
+            {
+                existing = arc;
+                for (Arc &reverse : in[arc.target])
+                {
+                    if (reverse.target == from)
+                    {
+                        reverse = arc;
+                        reverse.target = from;
+                    }
+                }
+            }
+            return;
+        }
+
+        out[from].push_back(arc);
+        Arc reverse = arc;
+        reverse.target = from;
+        in[arc.target].push_back(reverse);
+    }
+
+    /* Detach a station from its neighbours and hand over its remaining arcs */
+    void contract(int node, vector<Arc> &up, vector<Arc> &down)
+    {
+        for (const Arc &arc : out[node])
+            eraseTarget(in[arc.target], node);
+        for (const Arc &arc : in[node])
+            eraseTarget(out[arc.target], node);
+
+        up.swap(out[node]);
+        down.swap(in[node]);
+        out[node].clear();
+        in[node].clear();
+        contracted[node] = 1;
+    }
+
+    vector<vector<Arc>> out, in;
+    vector<char> contracted; /**< Station has been removed from the graph */
+    vector<char> inRound;    /**< Station is being contracted in the current round */
+
+private:
+    static void eraseTarget(vector<Arc> &arcs, int target)
+    {
+        auto matches = [target](const Arc &arc)
+        {
+            return arc.target == target;
+        };
+        arcs.erase(remove_if(arcs.begin(), arcs.end(), matches), arcs.end());
+    }
+};
+
+/* Per-thread local search used to decide whether a shortcut is necessary */
+class WitnessSearch
+{
+public:
+    explicit WitnessSearch(int n) : distances(n, INT_MAX) {}
+
+    /**
+     * Compute travel times from source avoiding the station being contracted
+     * and every station removed in this round, up to maxCost.
+     */
+    void run(const ContractionGraph &graph, int source, int avoid, int maxCost)
+    {
+        for (int node : touched)
+            distances[node] = INT_MAX;
+        touched.clear();
+
+        queue.reset(static_cast<int>(distances.size()));
+        distances[source] = 0;
+        touched.push_back(source);
+        queue.push(source, 0);
+
+        int settled = 0;
+        while (!queue.empty())
+        {
+            int key;
+            int current = queue.pop(key);
+            if (key > distances[current])
+                continue;
+            if (key > maxCost || ++settled > WitnessSettleLimit)
+                break;
+
+            for (const Arc &arc : graph.out[current])
+            {
+                int next = arc.target;
+                if (next == avoid || graph.inRound[next])
+                    continue;
+
+                int newDist = key + arc.minutes;
+                if (newDist < distances[next])
+                {
+                    if (distances[next] == INT_MAX)
+                        touched.push_back(next);
+                    distances[next] = newDist;
+                    queue.push(next, newDist);
+                }
+            }
+        }
+    }
+
+    int distance(int node) const { return distances[node]; }
+
+private:
+    vector<int> distances;
+    vector<int> touched;
+    BinaryHeapQueue queue;
+};
+
+/**
+ * Find the shortcuts needed to contract node. Fills shortcuts when given,
+ * otherwise only counts them for the priority estimate.
+ */
+int simulateContraction(const ContractionGraph &graph, int node, WitnessSearch &witness,
+                        vector<Shortcut> *shortcuts)
+{
+    const vector<Arc> &incoming = graph.in[node];
+    const vector<Arc> &outgoing = graph.out[node];
+    int count = 0;
+
+    for (const Arc &in : incoming)
+    {
+        int from = in.target;
+        int maxOut = -1;
+        for (const Arc &out : outgoing)
+        {
+            if (out.target != from)
+                maxOut = max(maxOut, out.minutes);
+        }
+        if (maxOut < 0)
+            continue;
+
+        witness.run(graph, from, node, in.minutes + maxOut);
+
+        for (const Arc &out : outgoing)
+        {
+            if (out.target == from)
+                continue;
+
+            int via = in.minutes + out.minutes;
+            if (witness.distance(out.target) <= via)
+                continue;
+
+            ++count;
+            if (shortcuts)
+            {
+                Shortcut shortcut = {from, {out.target, via, in.metres + out.metres, node}};
+                shortcuts->push_back(shortcut);
+            }
+        }
+    }
+    return count;
+}
+
+uint32_t tieBreak(int node)
+{
+    return static_cast<uint32_t>(node) * 2654435761u;
+}
+
+/* Flatten per-node arc lists into CSR form */
+void flatten(vector<vector<Arc>> &lists, FlatArray<uint32_t> &offsets, FlatArray<Arc> &arcs)
+{
+    vector<uint32_t> arcOffsets(lists.size() + 1, 0);
+    vector<Arc> flatArcs;
+    for (size_t u = 0; u < lists.size(); ++u)
+    {
+        flatArcs.insert(flatArcs.end(), lists[u].begin(), lists[u].end());
+        arcOffsets[u + 1] = static_cast<uint32_t>(flatArcs.size());
+        vector<Arc>().swap(lists[u]);
+    }
+    offsets = FlatArray<uint32_t>(move(arcOffsets));
+    arcs = FlatArray<Arc>(move(flatArcs));
+}
+
+template <typename T>
+void writeArray(ofstream &out, const FlatArray<T> &values)
+{
+    out.write(reinterpret_cast<const char *>(values.data()), values.size() * sizeof(T));
+}
+
+template <typename T>
+bool readArray(ifstream &in, FlatArray<T> &values, size_t count)
+{
+    vector<T> read(count);
+    if (!in.read(reinterpret_cast<char *>(read.data()), count * sizeof(T)))
+        return false;
+    values = FlatArray<T>(move(read));
+    return true;
+}
+}
+
+ContractionHierarchy::ContractionHierarchy() : graphFingerprint(0)
+{
+}
+
+void ContractionHierarchy::build(const CsrGraph &graph, int threadCount)
+{
+    int n = graph.nodeCount();
+    if (threadCount <= 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+
+    ContractionGraph work(graph);
+    vector<WitnessSearch> witnesses(threadCount, WitnessSearch(n));
+
+    /*
+     * Priority: edge difference (shortcuts added minus arcs removed) plus the
+     * number of contracted neighbours and the depth in the hierarchy, which
+     * spreads contraction evenly over the network and keeps queries shallow.
+     */
+    vector<int> priority(n), contractedNeighbours(n, 0), level(n, 0);
+    auto updatePriority = [&](int node, int workerIndex)
+    {
+        int shortcuts = simulateContraction(work, node, witnesses[workerIndex], nullptr);
+        int removed = static_cast<int>(work.in[node].size() + work.out[node].size());
+        priority[node] = 4 * (shortcuts - removed) + 2 * contractedNeighbours[node] + level[node];
+    };
+    parallelFor(n, threadCount, updatePriority);
+
+    vector<vector<Arc>> up(n), down(n);
+    vector<int> remaining(n);
+    for (int i = 0; i < n; ++i)
+        remaining[i] = i;
+
+    vector<char> selected(n, 0), dirty(n, 0);
+    vector<vector<Shortcut>> roundShortcuts(threadCount);
+
+    while (!remaining.empty())
+    {
+        /* A station is contracted this round if it beats all of its neighbours */
+        auto beats = [&](int a, int b)
+        {
+            return priority[a] != priority[b] ? priority[a] < priority[b] : tieBreak(a) < tieBreak(b);
+        };
+        auto select = [&](int i, int)
+        {
+            int node = remaining[i];
+            bool best = true;
+            for (const Arc &arc : work.out[node])
+                best = best && beats(node, arc.target);
+            for (const Arc &arc : work.in[node])
+                best = best && beats(node, arc.target);
+            selected[node] = best;
+        };
+        parallelFor(static_cast<int>(remaining.size()), threadCount, select);
+
+        vector<int> round;
+        vector<int> next;
+        for (int node : remaining)
+        {
+            if (selected[node])
+            {
+                round.push_back(node);
+                work.inRound[node] = 1;
+            }
+            else
+            {
+                next.push_back(node);
+            }
+        }
+
+        /* Shortcut searches only read the graph, so they run concurrently */
+        auto findShortcuts = [&](int i, int workerIndex)
+        {
+            simulateContraction(work, round[i], witnesses[workerIndex], &roundShortcuts[workerIndex]);
+        };
+        parallelFor(static_cast<int>(round.size()), threadCount, findShortcuts);
+
+        vector<int> neighbours;
+        for (int node : round)
+        {
+            for (const Arc &arc : work.out[node])
+                neighbours.push_back(arc.target);
+            for (const Arc &arc : work.in[node])
+                neighbours.push_back(arc.target);
+            sort(neighbours.begin(), neighbours.end());
+            neighbours.erase(unique(neighbours.begin(), neighbours.end()), neighbours.end());
+
+            for (int neighbour : neighbours)
+            {
+                contractedNeighbours[neighbour]++;
+                level[neighbour] = max(level[neighbour], level[node] + 1);
+                dirty[neighbour] = 1;
+            }
+            neighbours.clear();
+
+            work.contract(node, up[node], down[node]);
+            work.inRound[node] = 0;
+            selected[node] = 0;
+        }
+
+        for (vector<Shortcut> &shortcuts : roundShortcuts)
+        {
+            for (const Shortcut &shortcut : shortcuts)
+                work.addArc(shortcut.from, shortcut.arc);
+            shortcuts.clear();
+        }
+
+        vector<int> changed;
+        for (int node : next)
+        {
+            if (dirty[node])
+            {
+                changed.push_back(node);
+                dirty[node] = 0;
+            }
+        }
+        auto refresh = [&](int i, int workerIndex)
+        {
+            updatePriority(changed[i], workerIndex);
+        };
+        parallelFor(static_cast<int>(changed.size()), threadCount, refresh);
+
+        remaining.swap(next);
+    }
+
+    flatten(up, upOffsets, upArcs);
+    flatten(down, downOffsets, downArcs);
+    graphFingerprint = graph.fingerprint();
+}
+
+bool ContractionHierarchy::save(const string &fileName) const
+{
+    ofstream out(fileName, ios::binary);
+    if (!out)
+        return false;
+
+    FileHeader header;
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.version = FileVersion;
+    header.nodeCount = nodeCount();
+    header.upArcCount = static_cast<uint32_t>(upArcs.size());
+    header.downArcCount = static_cast<uint32_t>(downArcs.size());
+    header.reserved = 0;
+    header.fingerprint = graphFingerprint;
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    writeArray(out, upOffsets);
+    writeArray(out, upArcs);
+    writeArray(out, downOffsets);
+    writeArray(out, downArcs);
+    return static_cast<bool>(out);
+}
+
+bool ContractionHierarchy::load(const string &fileName, const CsrGraph &graph)
+{
+    ifstream in(fileName, ios::binary);
+    if (!in)
+        return false;
+
+    FileHeader header;
+    if (!in.read(reinterpret_cast<char *>(&header), sizeof(header)))
+        return false;
+
+    if (memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 ||
+        header.version != FileVersion ||
+        static_cast<int>(header.nodeCount) != graph.nodeCount() ||
+        header.fingerprint != graph.fingerprint())
+        return false;
+
+    if (!readArray(in, upOffsets, header.nodeCount + 1) || !readArray(in, upArcs, header.upArcCount) ||
+        !readArray(in, downOffsets, header.nodeCount + 1) || !readArray(in, downArcs, header.downArcCount))
+    {
+        upOffsets = FlatArray<uint32_t>();
+        return false;
+    }
+
+    graphFingerprint = header.fingerprint;
+    return true;
+}
+
+ChQuery::ChQuery(const ContractionHierarchy &hierarchy) : ch(hierarchy)
+{
+    int n = ch.nodeCount();
+    for (Side *side : {&forward, &backward})
+    {
+        side->distances.assign(n, INT_MAX);
+        side->parentArc.assign(n, -1);
+    }
+}
+
+void ChQuery::resetSide(Side &side)
+{
+    for (int node : side.touched)
+    {
+        side.distances[node] = INT_MAX;
+        side.parentArc[node] = -1;
+    }
+    side.touched.clear();
+    side.queue.reset(static_cast<int>(side.distances.size()));
+}
+
+int ChQuery::findRoute(int from, int to, vector<int> &path, uint32_t &metres)
+{
+    path.clear();
+    metres = 0;
+
+    resetSide(forward);
+    resetSide(backward);
+
+    forward.distances[from] = 0;
+    forward.touched.push_back(from);
+    forward.queue.push(from, 0);
+    backward.distances[to] = 0;
+    backward.touched.push_back(to);
+    backward.queue.push(to, 0);
+
+    int best = INT_MAX;
+    int meet = -1;
+    bool forwardDone = false, backwardDone = false;
+
+    for (int turn = 0; !forwardDone || !backwardDone; ++turn)
+    {
+        bool isForward = backwardDone || (!forwardDone && turn % 2 == 0);
+        Side &side = isForward ? forward : backward;
+        const Side &other = isForward ? backward : forward;
+        const FlatArray<uint32_t> &offsets = isForward ? ch.upOffsets : ch.downOffsets;
+        const FlatArray<Arc> &arcs = isForward ? ch.upArcs : ch.downArcs;
+
+        /* Arcs into the current station from above, used for stall-on-demand */
+        const FlatArray<uint32_t> &stallOffsets = isForward ? ch.downOffsets : ch.upOffsets;
+        const FlatArray<Arc> &stallArcs = isForward ? ch.downArcs : ch.upArcs;
+
+        if (side.queue.empty())
+        {
+            (isForward ? forwardDone : backwardDone) = true;
+            continue;
+        }
+
+        int key;
+        int current = side.queue.pop(key);
+        if (key >= best)
+        {
+            (isForward ? forwardDone : backwardDone) = true;
+            continue;
+        }
+
+        if (other.distances[current] != INT_MAX && key + other.distances[current] < best)
+        {
+            best = key + other.distances[current];
+            meet = current;
+        }
+
+        /* A station reachable faster through a higher one cannot be on a shortest path */
+        bool stalled = false;
+        for (uint32_t a = stallOffsets[current]; a < stallOffsets[current + 1] && !stalled; ++a)
+        {
+            int above = side.distances[stallArcs[a].target];
+            stalled = above != INT_MAX && above + stallArcs[a].minutes < key;
+        }
+        if (stalled)
+            continue;
+
+        for (uint32_t a = offsets[current]; a < offsets[current + 1]; ++a)
+        {
+            int next = arcs[a].target;
+            int newDist = key + arcs[a].minutes;
+            if (newDist < side.distances[next])
+            {
+                if (side.distances[next] == INT_MAX)
+                    side.touched.push_back(next);
+                side.distances[next] = newDist;
+                side.parentArc[next] = static_cast<int>(a);
+                side.queue.push(next, newDist);
+            }
+        }
+    }
+
+    if (meet == -1)
+        return -1;
+
+    /* Collect the upward arcs from the origin to the meeting station */
+    vector<int> forwardArcs;
+    for (int at = meet; at != from;)
+    {
+        int a = forward.parentArc[at];
+        forwardArcs.push_back(a);
+        at = static_cast<int>(upper_bound(ch.upOffsets.begin(), ch.upOffsets.end(), static_cast<uint32_t>(a)) - ch.upOffsets.begin()) - 1;
+    }
+
+    path.push_back(from);
+    int at = from;
+    for (auto it = forwardArcs.rbegin(); it != forwardArcs.rend(); ++it)
+    {
+        const Arc &arc = ch.upArcs[*it];
+        unpack(at, arc.target, arc.middle, path);
+        metres += arc.metres;
+        at = arc.target;
+    }
+
+    /* Then the downward arcs from the meeting station to the destination */
+    while (at != to)
+    {
+        int a = backward.parentArc[at];
+        int lower = static_cast<int>(upper_bound(ch.downOffsets.begin(), ch.downOffsets.end(), static_cast<uint32_t>(a)) - ch.downOffsets.begin()) - 1;
+        const Arc &arc = ch.downArcs[a];
+        unpack(at, lower, arc.middle, path);
+        metres += arc.metres;
+        at = lower;
+    }
+
+    return best;
+}
+
+void ChQuery::unpack(int from, int to, int middle, vector<int> &path)
+{
+    /* Each stack entry is a (from, to, middle) triple still to be expanded */
+    stack.clear();
+    stack.push_back(from);
+    stack.push_back(to);
+    stack.push_back(middle);
+
+    while (!stack.empty())
+    {
+        int mid = stack.back();
+        stack.pop_back();
+        int head = stack.back();
+        stack.pop_back();
+        int tail = stack.back();
+        stack.pop_back();
+
+        if (mid == -1)
+        {
+            path.push_back(head);
+            continue;
+        }
+
+        /* The bypassed station ranks below both ends: tail -> mid is a down arc of mid, mid -> head an up arc */
+        int firstMiddle = -1, secondMiddle = -1;
+        for (uint32_t a = ch.downOffsets[mid]; a < ch.downOffsets[mid + 1]; ++a)
+        {
+            if (ch.downArcs[a].target == tail)
+                firstMiddle = ch.downArcs[a].middle;
+        }
+        for (uint32_t a = ch.upOffsets[mid]; a < ch.upOffsets[mid + 1]; ++a)
+        {
+            if (ch.upArcs[a].target == head)
+                secondMiddle = ch.upArcs[a].middle;
+        }
+
+        /* Push the second half first so the first half is expanded first */
+        stack.push_back(mid);
+        stack.push_back(head);
+        stack.push_back(secondMiddle);
+        stack.push_back(tail);
+        stack.push_back(mid);
+        stack.push_back(firstMiddle);
+    }
+}
@@ -0,0 +1,138 @@
+#ifndef CONTRACTIONHIERARCHY_H
+#define CONTRACTIONHIERARCHY_H
+
+#include "CsrGraph.h"
+#include "FlatArray.h"
+#include "PriorityQueues.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief Contraction Hierarchies index for city-scale networks
+ *
+ * Preprocessing contracts stations one by one in order of importance and
+ * inserts shortcut arcs that preserve shortest travel times among the
+ * stations still left. Independent sets of stations are contracted in
+ * parallel rounds. Queries then only ever move "upwards" in the order, from
+ * both ends, and settle a few hundred stations even on networks with tens of
+ * thousands of nodes.
+ *
+ * The index is immutable after build() or load(); queries run through a
+ * ChQuery object so that several threads can share one hierarchy.
+ */
+class ContractionHierarchy
+{
+public:
+    /**
+     * @brief Arc of the upward or downward search graph
+     */
+    struct Arc
+    {
+        int32_t target;  /**< Higher-ranked endpoint of the arc */
+        int32_t minutes; /**< Travel time in minutes */
+        uint32_t metres; /**< Length in metres, including all bypassed arcs */
+        int32_t middle;  /**< Contracted station bypassed by a shortcut, -1 for an original arc */
+    };
+
+    /**
+     * @brief Construct an empty hierarchy; isBuilt() is false until build() or load()
+     */
+    ContractionHierarchy();
+
+    /**
+     * @brief Contract a network
+     * @param graph CSR representation of the metro network
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     */
+    void build(const CsrGraph &graph, int threadCount = 0);
+
+    /** @brief True once the hierarchy holds data */
+    bool isBuilt() const { return upOffsets.size() > 1; }
+
+    /** @brief Number of stations in the hierarchy */
+    int nodeCount() const { return static_cast<int>(upOffsets.size()) - 1; }
+
+    /** @brief Number of original and shortcut arcs in the search graphs */
+    int arcCount() const { return static_cast<int>(upArcs.size() + downArcs.size()); }
+
+    /**
+     * @brief Write the hierarchy to a binary file
+     * @param fileName Path of the file to create
+     * @return True on success
+     */
+    bool save(const std::string &fileName) const;
+
+    /**
+     * @brief Read a hierarchy written by save()
+     * @param fileName Path of the file to read
+     * @param graph Network the hierarchy must have been built for
+     * @return False if the file is unreadable or belongs to a different network
+     */
+    bool load(const std::string &fileName, const CsrGraph &graph);
+
+private:
+    friend class ChQuery;
+    friend class NetworkSnapshot;
+
+    /* Upward arcs u -> w with rank(w) > rank(u), grouped by u */
+    FlatArray<uint32_t> upOffsets;
+    FlatArray<Arc> upArcs;
+
+    /* Arcs w -> u with rank(w) > rank(u), grouped by u and pointing to w */
+    FlatArray<uint32_t> downOffsets;
+    FlatArray<Arc> downArcs;
+
+    uint64_t graphFingerprint; /**< CsrGraph::fingerprint() of the source network */
+};
+
+/**
+ * @brief Bidirectional upward query on a ContractionHierarchy
+ *
+ * Holds the search buffers for one thread. Buffers are reset only where a
+ * previous query touched them, so the cost of a query does not depend on the
+ * size of the network.
+ */
+class ChQuery
+{
+public:
+    /**
+     * @brief Construct a query object
+     * @param hierarchy Hierarchy to search; must outlive this object
+     */
+    explicit ChQuery(const ContractionHierarchy &hierarchy);
+
+    /**
+     * @brief Find the fastest route between two stations
+     *
+     * Shortcuts on the meeting path are unpacked recursively, so path holds the
+     * full station sequence exactly as a plain Dijkstra search would return it.
+     *
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param path Output vector of station IDs from origin to destination, empty if unreachable
+     * @param metres Output route length in metres
+     * @return Travel time in minutes, or -1 if the destination is unreachable
+     */
+    int findRoute(int from, int to, std::vector<int> &path, uint32_t &metres);
+
+private:
+    typedef ContractionHierarchy::Arc Arc;
+
+    struct Side
+    {
+        std::vector<int> distances; /**< Tentative travel time, INT_MAX if untouched */
+        std::vector<int> parentArc; /**< Index of the arc that reached each station */
+        std::vector<int> touched;   /**< Stations whose entries must be reset */
+        QuaternaryHeapQueue queue;
+    };
+
+    void resetSide(Side &side);
+    void unpack(int from, int to, int middle, std::vector<int> &path);
+
+    const ContractionHierarchy &ch;
+    Side forward, backward;
+    std::vector<int> stack;
+};
+
+#endif // CONTRACTIONHIERARCHY_H
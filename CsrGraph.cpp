@@ -0,0 +1,137 @@
+#include "CsrGraph.h"
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+CsrGraph::CsrGraph() : offsets(vector<uint32_t>(1, 0))
+{
+}
+
+CsrGraph::CsrGraph(const vector<vector<Edge>> &adjacency)
+{
+    size_t n = adjacency.size();
+    size_t m = 0;
+    for (const auto &edges : adjacency)
+        m += edges.size();
+
+    vector<uint32_t> arcOffsets(n + 1);
+    vector<int32_t> arcTargets;
+    vector<uint16_t> arcWeights;
+    vector<uint32_t> arcLengths;
+    arcTargets.reserve(m);
+    arcWeights.reserve(m);
+    arcLengths.reserve(m);
+
+    arcOffsets[0] = 0;
+    for (size_t u = 0; u < n; ++u)
+    {
+        for (const Edge &edge : adjacency[u])
+        {
+            /* Clamp into the packed ranges; real travel times are far below either limit */
+            int time = min(max(edge.weight, 0), 0xFFFF);
+            double metres = min(max(edge.distance * 1000.0, 0.0), 4294967295.0);
+
+            arcTargets.push_back(edge.destination);
+            arcWeights.push_back(static_cast<uint16_t>(time));
+            arcLengths.push_back(static_cast<uint32_t>(lround(metres)));
+        }
+        arcOffsets[u + 1] = static_cast<uint32_t>(arcTargets.size());
+    }
+
+    offsets = FlatArray<uint32_t>(move(arcOffsets));
+    targets = FlatArray<int32_t>(move(arcTargets));
+    weights = FlatArray<uint16_t>(move(arcWeights));
+    lengths = FlatArray<uint32_t>(move(arcLengths));
+}
+
+void CsrGraph::setMinutes(int arc, int minutes)
+{
+    weights.set(arc, static_cast<uint16_t>(min(max(minutes, 0), 0xFFFF)));
+}
+
+void CsrGraph::setTarget(int arc, int node)
+{
+    targets.set(arc, node);
+}
+
+int CsrGraph::findArc(int from, int to) const
+{
+    int best = -1;
+    for (int arc = arcBegin(from); arc < arcEnd(from); ++arc)
+    {
+        if (targets[arc] == to && (best == -1 || weights[arc] < weights[best]))
+            best = arc;
+    }
+    return best;
+}
+
+CsrGraph CsrGraph::reversed() const
+{
+    int n = nodeCount();
+    int m = arcCount();
+
+    /* Count incoming arcs per node, then place each arc after its target's predecessors */
+    vector<uint32_t> arcOffsets(n + 1, 0);
+    for (int arc = 0; arc < m; ++arc)
+        ++arcOffsets[targets[arc] + 1];
+    for (int u = 0; u < n; ++u)
+        arcOffsets[u + 1] += arcOffsets[u];
+
+    vector<uint32_t> next(arcOffsets.begin(), arcOffsets.end() - 1);
+    vector<int32_t> arcTargets(m);
+    vector<uint16_t> arcWeights(m);
+    vector<uint32_t> arcLengths(m);
+    for (int u = 0; u < n; ++u)
+    {
+        for (int arc = arcBegin(u); arc < arcEnd(u); ++arc)
+        {
+            uint32_t slot = next[targets[arc]]++;
+            arcTargets[slot] = u;
+            arcWeights[slot] = weights[arc];
+            arcLengths[slot] = lengths[arc];
+        }
+    }
+
+    CsrGraph graph;
+    graph.offsets = FlatArray<uint32_t>(move(arcOffsets));
+    graph.targets = FlatArray<int32_t>(move(arcTargets));
+    graph.weights = FlatArray<uint16_t>(move(arcWeights));
+    graph.lengths = FlatArray<uint32_t>(move(arcLengths));
+    return graph;
+}
+
+int CsrGraph::maxMinutes() const
+{
+    if (weights.empty())
+        return 0;
+    return *max_element(weights.begin(), weights.end());
+}
+
+/* FNV-1a over the raw bytes of an array */
+template <typename T>
+static void hashArray(uint64_t &hash, const FlatArray<T> &values)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(values.data());
+    size_t size = values.size() * sizeof(T);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+}
+
+uint64_t CsrGraph::fingerprint() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hashArray(hash, offsets);
+    hashArray(hash, targets);
+    hashArray(hash, weights);
+    hashArray(hash, lengths);
+    return hash;
+}
+
+size_t CsrGraph::memoryBytes() const
+{
+    return offsets.memoryBytes() + targets.memoryBytes() + weights.memoryBytes() + lengths.memoryBytes();
+}
@@ -0,0 +1,127 @@
+#ifndef CSRGRAPH_H
+#define CSRGRAPH_H
+
+#include "MetroData.h"
+#include "FlatArray.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+/**
+ * @brief Compressed sparse row (CSR) representation of the network
+ *
+ * All outgoing arcs of station u occupy the index range
+ * [arcBegin(u), arcEnd(u)) of a few flat arrays, so a relaxation loop walks
+ * contiguous memory instead of one heap block per station. Arc attributes are
+ * stored as separate packed arrays: the search only touches targets and
+ * minutes, while distances are read when a route is measured.
+ *
+ * Travel times are stored as 16-bit minutes and distances are quantized to
+ * whole metres in 32 bits, for 10 bytes per arc instead of 24 for Edge.
+ *
+ * The arc layout is fixed once built. The travel time and target of single
+ * arcs can still change in place: a closed arc points back at its own tail,
+ * which no search ever follows, so closures cost nothing in the search loops.
+ */
+class CsrGraph
+{
+public:
+    /**
+     * @brief Construct an empty graph
+     */
+    CsrGraph();
+
+    /**
+     * @brief Build the CSR arrays from an adjacency list
+     * @param adjacency Adjacency list as produced by initializeMetroNetwork()
+     */
+    explicit CsrGraph(const std::vector<std::vector<Edge>> &adjacency);
+
+    /** @brief Number of stations (nodes) in the graph */
+    int nodeCount() const { return static_cast<int>(offsets.size()) - 1; }
+
+    /** @brief Number of directed arcs in the graph */
+    int arcCount() const { return static_cast<int>(targets.size()); }
+
+    /** @brief Index of the first outgoing arc of a node */
+    int arcBegin(int node) const { return offsets[node]; }
+
+    /** @brief One past the index of the last outgoing arc of a node */
+    int arcEnd(int node) const { return offsets[node + 1]; }
+
+    /** @brief Destination station of an arc */
+    int target(int arc) const { return targets[arc]; }
+
+    /** @brief Travel time of an arc in minutes */
+    int minutes(int arc) const { return weights[arc]; }
+
+    /** @brief Length of an arc in whole metres */
+    uint32_t metres(int arc) const { return lengths[arc]; }
+
+    /** @brief Length of an arc in kilometers */
+    double distance(int arc) const { return lengths[arc] * 0.001; }
+
+    /**
+     * @brief Change the travel time of an arc
+     * @param arc Arc index
+     * @param minutes New travel time, clamped to the 16-bit range
+     */
+    void setMinutes(int arc, int minutes);
+
+    /**
+     * @brief Point an arc at another node, or back at its tail to close it
+     * @param arc Arc index
+     * @param node New destination node
+     */
+    void setTarget(int arc, int node);
+
+    /**
+     * @brief Find the fastest arc between two stations
+     * @param from Source station ID
+     * @param to Destination station ID
+     * @return Arc index, or -1 if the stations are not adjacent
+     */
+    int findArc(int from, int to) const;
+
+    /**
+     * @brief Graph with every arc turned around
+     *
+     * Arc attributes are copied unchanged, so a search over the result runs
+     * backwards from a target, as bidirectional queries need.
+     *
+     * @return Transposed graph over the same nodes
+     */
+    CsrGraph reversed() const;
+
+    /**
+     * @brief Largest arc travel time in the graph
+     * @return Maximum of minutes() over all arcs, 0 for an empty graph
+     */
+    int maxMinutes() const;
+
+    /**
+     * @brief Hash of the graph structure and arc attributes
+     *
+     * Precomputed indices store this value so they can detect that they were
+     * built for a different network.
+     *
+     * @return 64-bit FNV-1a hash of all CSR arrays
+     */
+    uint64_t fingerprint() const;
+
+    /**
+     * @brief Heap memory held by the graph arrays
+     * @return Size in bytes, 0 for a graph used in place from a snapshot
+     */
+    size_t memoryBytes() const;
+
+private:
+    friend class NetworkSnapshot;
+
+    FlatArray<uint32_t> offsets; /**< Arc range start per node, plus a final sentinel */
+    FlatArray<int32_t> targets;  /**< Destination station of each arc */
+    FlatArray<uint16_t> weights; /**< Travel time of each arc in minutes */
+    FlatArray<uint32_t> lengths; /**< Length of each arc in metres */
+};
+
+#endif // CSRGRAPH_H
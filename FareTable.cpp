@@ -0,0 +1,256 @@
+#include "FareTable.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define FARETABLE_SSE2 1
+#endif
+
+using namespace std;
+
+namespace
+{
+/* Fields of a comma-separated line, surrounding blanks removed */
+void splitFields(const string &line, vector<string> &fields)
+{
+    fields.clear();
+    size_t begin = 0;
+    for (;;)
+    {
+        size_t end = line.find(',', begin);
+        string field = line.substr(begin, end == string::npos ? string::npos : end - begin);
+        size_t first = field.find_first_not_of(" \t");
+        size_t last = field.find_last_not_of(" \t");
+        fields.push_back(first == string::npos ? string() : field.substr(first, last - first + 1));
+        if (end == string::npos)
+            return;
+        begin = end + 1;
+    }
+}
+
+bool parseCount(const string &field, int &value)
+{
+    char *end;
+    long parsed = strtol(field.c_str(), &end, 10);
+    if (field.empty() || *end != '\0' || parsed < 0 || parsed > 1000000)
+        return false;
+    value = static_cast<int>(parsed);
+    return true;
+}
+
+bool parseKilometres(const string &field, uint32_t &metres)
+{
+    char *end;
+    double parsed = strtod(field.c_str(), &end);
+    if (field.empty() || *end != '\0' || !(parsed > 0) || parsed >= 4e6)
+        return false;
+    metres = static_cast<uint32_t>(llround(parsed * 1000));
+    return true;
+}
+}
+
+FareTable::FareTable() : discount(10), cap(0)
+{
+    days.push_back("Weekday");
+    days.push_back("Holiday");
+
+    /* Delhi Metro fares; Sundays and national holidays are cheaper beyond 2 km */
+    static const int table[][3] = {{2, 10, 10}, {5, 20, 10}, {12, 30, 20}, {21, 40, 30}, {32, 50, 40}, {0, 60, 50}};
+    vector<Bracket> brackets;
+    for (const int *row : table)
+    {
+        Bracket bracket;
+        bracket.maxMetres = row[0] ? static_cast<uint32_t>(row[0]) * 1000 : UINT32_MAX;
+        bracket.fares.assign(row + 1, row + 3);
+        brackets.push_back(bracket);
+    }
+    compile(brackets);
+}
+
+const FareTable &FareTable::defaultTable()
+{
+    static const FareTable table;
+    return table;
+}
+
+bool FareTable::fail(const string &message)
+{
+    error = message;
+    return false;
+}
+
+bool FareTable::load(const string &fileName)
+{
+    ifstream file(fileName.c_str());
+    if (!file)
+        return fail("Cannot open " + fileName);
+
+    vector<string> names;
+    vector<Bracket> brackets;
+    int newDiscount = 0, newCap = 0;
+    string line;
+    vector<string> fields;
+    for (int lineNumber = 1; getline(file, line); ++lineNumber)
+    {
+        line = line.substr(0, line.find_first_of("#\r"));
+        if (line.find_first_not_of(" \t") == string::npos)
+            continue;
+        splitFields(line, fields);
+
+        string at = fileName + ":" + to_string(lineNumber) + ": ";
+        const string &keyword = fields[0];
+        if (keyword == "days")
+        {
+            if (!names.empty())
+                return fail(at + "day types given twice");
+            names.assign(fields.begin() + 1, fields.end());
+            if (names.empty() || find(names.begin(), names.end(), string()) != names.end())
+                return fail(at + "missing day type name");
+        }
+        else if (keyword == "bracket")
+        {
+            if (names.empty())
+                return fail(at + "bracket before the day types");
+            if (fields.size() != names.size() + 2)
+                return fail(at + "expected a distance and " + to_string(names.size()) + " fares");
+            if (!brackets.empty() && brackets.back().maxMetres == UINT32_MAX)
+                return fail(at + "bracket after the open bracket");
+
+            Bracket bracket;
+            bracket.maxMetres = UINT32_MAX;
+            if (!fields[1].empty() && !parseKilometres(fields[1], bracket.maxMetres))
+                return fail(at + "invalid distance");
+            if (!brackets.empty() && bracket.maxMetres <= brackets.back().maxMetres)
+                return fail(at + "distances must increase");
+            bracket.fares.resize(names.size());
+            for (size_t i = 0; i < names.size(); ++i)
+            {
+                if (!parseCount(fields[i + 2], bracket.fares[i]))
+                    return fail(at + "invalid fare");
+            }
+            brackets.push_back(bracket);
+        }
+        else if (keyword == "card_discount")
+        {
+            if (fields.size() != 2 || !parseCount(fields[1], newDiscount) || newDiscount > 100)
+                return fail(at + "invalid card discount");
+        }
+        else if (keyword == "cap")
+        {
+            if (fields.size() != 2 || !parseCount(fields[1], newCap))
+                return fail(at + "invalid fare cap");
+        }
+        else
+        {
+            return fail(at + "unknown record " + keyword);
+        }
+    }
+    if (file.bad())
+        return fail("Cannot read " + fileName);
+    if (brackets.empty())
+        return fail(fileName + ": no fare brackets");
+
+    days.swap(names);
+    discount = newDiscount;
+    cap = newCap;
+    compile(brackets);
+    return true;
+}
+
+void FareTable::compile(const vector<Bracket> &brackets)
+{
+    /* The last bracket's upper end is never compared: nothing longer pays anything else */
+    size_t stepCount = brackets.size() - 1;
+    limits.resize(stepCount);
+    for (size_t b = 0; b < stepCount; ++b)
+        limits[b] = brackets[b].maxMetres;
+
+    size_t columns = days.size() * 2;
+    bases.assign(columns, 0);
+    steps.assign(columns * stepCount, 0);
+    for (int day = 0; day < dayCount(); ++day)
+    {
+        for (int card = 0; card < 2; ++card)
+        {
+            int c = column(day, card != 0);
+            int previous = 0;
+            for (size_t b = 0; b < brackets.size(); ++b)
+            {
+                int charged = brackets[b].fares[day];
+                if (cap > 0)
+                    charged = min(charged, cap);
+                if (card)
+                    charged = (charged * (100 - discount) + 99) / 100;
+
+                if (b == 0)
+                    bases[c] = charged;
+                else
+                    steps[c * stepCount + b - 1] = charged - previous;
+                previous = charged;
+            }
+        }
+    }
+}
+
+int FareTable::maximumFare() const
+{
+    /* Every bracket is reached by some distance, so each running sum is a fare */
+    size_t stepCount = limits.size();
+    int highest = 0;
+    for (size_t c = 0; c < bases.size(); ++c)
+    {
+        int sum = bases[c];
+        highest = max(highest, sum);
+        for (size_t b = 0; b < stepCount; ++b)
+        {
+            sum += steps[c * stepCount + b];
+            highest = max(highest, sum);
+        }
+    }
+    return highest;
+}
+
+int FareTable::fare(double distance, int day, bool hasMetroCard) const
+{
+    uint32_t metres = static_cast<uint32_t>(llround(max(0.0, min(distance * 1000, 4294967295.0))));
+    int32_t result;
+    fares(&metres, 1, day, hasMetroCard, &result);
+    return result;
+}
+
+void FareTable::fares(const uint32_t *metres, size_t count, int day, bool hasMetroCard, int32_t *fares) const
+{
+    int c = column(day, hasMetroCard);
+    size_t stepCount = limits.size();
+    const int32_t base = bases[c];
+    const int32_t *step = steps.data() + c * stepCount;
+    const uint32_t *limit = limits.data();
+
+    size_t i = 0;
+#ifdef FARETABLE_SSE2
+    /* SSE2 compares signed integers only; flipping the top bit orders unsigned values the same way */
+    const __m128i bias = _mm_set1_epi32(INT32_MIN);
+    const __m128i baseFare = _mm_set1_epi32(base);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i distance = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(metres + i)), bias);
+        __m128i sum = baseFare;
+        for (size_t b = 0; b < stepCount; ++b)
+        {
+            __m128i beyond = _mm_cmpgt_epi32(distance, _mm_set1_epi32(static_cast<int32_t>(limit[b] ^ 0x80000000u)));
+            sum = _mm_add_epi32(sum, _mm_and_si128(beyond, _mm_set1_epi32(step[b])));
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(fares + i), sum);
+    }
+#endif
+    for (; i < count; ++i)
+    {
+        int32_t sum = base;
+        for (size_t b = 0; b < stepCount; ++b)
+            sum += step[b] & -static_cast<int32_t>(metres[i] > limit[b]);
+        fares[i] = sum;
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef FARETABLE_H
+#define FARETABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Fares by distance bracket and day type, with a card discount and a cap
+ *
+ * A default-constructed table holds the Delhi Metro fares. load() reads
+ * another table from a CSV file of keyword records; '#' starts a comment:
+ *
+ *     days,Weekday,Holiday
+ *     bracket,2,10,10
+ *     bracket,5,20,10
+ *     ...
+ *     bracket,,60,50
+ *     card_discount,10
+ *     cap,60
+ *
+ * "days" names the day types, one fare column each; the first is the regular
+ * fare and the second, if any, is charged on holidays. Every "bracket" gives
+ * the longest distance in kilometres it covers and its fare on each day type,
+ * in increasing order of distance; an empty distance covers everything beyond
+ * and may only end the list. Longer journeys than the last bracket covers pay
+ * its fare. "card_discount" is the percentage taken off for card holders,
+ * rounded up to a whole rupee, and "cap" the most any journey costs before
+ * the discount. Both are optional.
+ *
+ * The brackets are compiled into one base fare and one step per bracket
+ * boundary for every day type and payment, with the cap and the discount
+ * applied. A fare is the base plus the steps of all boundaries the distance
+ * exceeds, so evaluation has no branches, and fares() does it for four
+ * distances at a time with SSE2 where available.
+ */
+class FareTable
+{
+public:
+    /**
+     * @brief Construct the Delhi Metro fare table
+     */
+    FareTable();
+
+    /**
+     * @brief Table used by calculateFare() and wherever no other table is given
+     */
+    static const FareTable &defaultTable();
+
+    /**
+     * @brief Replace the table with one read from a file
+     * @param fileName Path of the fare table
+     * @return False on a missing file or malformed input, see errorString(); the table is then unchanged
+     */
+    bool load(const std::string &fileName);
+
+    /** @brief Number of day types */
+    int dayCount() const { return static_cast<int>(days.size()); }
+
+    /** @brief Name of a day type as given in the table */
+    const std::string &dayName(int day) const { return days[day]; }
+
+    /** @brief Day type charged on regular days or on holidays */
+    int dayType(bool isHoliday) const { return isHoliday && dayCount() > 1 ? 1 : 0; }
+
+    /** @brief Percentage taken off for card holders */
+    int cardDiscount() const { return discount; }
+
+    /** @brief Most a journey costs before the card discount, 0 if uncapped */
+    int fareCap() const { return cap; }
+
+    /** @brief Highest fare of any distance, day type and payment */
+    int maximumFare() const;
+
+    /**
+     * @brief Fare of one journey
+     * @param distance Journey length in kilometres, rounded to whole metres
+     * @param day Day type, see dayType()
+     * @param hasMetroCard Apply the card discount
+     * @return Fare in INR
+     */
+    int fare(double distance, int day, bool hasMetroCard) const;
+
+    /**
+     * @brief Fares of many journeys on the same day type
+     * @param metres Journey lengths in whole metres
+     * @param count Number of journeys
+     * @param day Day type, see dayType()
+     * @param hasMetroCard Apply the card discount
+     * @param fares Output fare of every journey in INR
+     */
+    void fares(const uint32_t *metres, size_t count, int day, bool hasMetroCard, int32_t *fares) const;
+
+    /** @brief Description of the last failure */
+    const std::string &errorString() const { return error; }
+
+private:
+    /* Distance bracket as read from a table */
+    struct Bracket
+    {
+        uint32_t maxMetres; /**< UINT32_MAX for the open bracket */
+        std::vector<int> fares;
+    };
+
+    /* Fill the compiled arrays from brackets of a table */
+    void compile(const std::vector<Bracket> &brackets);
+
+    /* Record a failure message and return false */
+    bool fail(const std::string &message);
+
+    /* Compiled column of a day type and payment */
+    int column(int day, bool hasMetroCard) const { return day * 2 + (hasMetroCard ? 1 : 0); }
+
+    std::vector<std::string> days;
+    int discount;
+    int cap;
+    std::vector<uint32_t> limits; /**< Upper end of every bracket but the last, in metres */
+    std::vector<int32_t> bases;   /**< Fare of the first bracket per column */
+    std::vector<int32_t> steps;   /**< Fare change over every limit, limits.size() per column */
+    std::string error;
+};
+
+#endif // FARETABLE_H
@@ -0,0 +1,130 @@
+#ifndef FLATARRAY_H
+#define FLATARRAY_H
+
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <utility>
+
+/**
+ * @brief Read-only array that either owns its elements or refers to memory kept alive elsewhere
+ *
+ * Graph and index arrays are built into a std::vector, but they can also be
+ * used in place from a memory-mapped snapshot file. Both cases look the same
+ * to the code that reads them. A view holds a shared reference to whatever
+ * owns its memory, so the mapping stays valid as long as any array uses it.
+ *
+ * Single elements can be replaced with set(). A view first copies its
+ * elements into owned storage, so mapped files are never written.
+ */
+template <typename T>
+class FlatArray
+{
+public:
+    /**
+     * @brief Construct an empty array
+     */
+    FlatArray() : elements(nullptr), count(0) {}
+
+    /**
+     * @brief Take ownership of the elements of a vector
+     * @param values Elements to store
+     */
+    explicit FlatArray(std::vector<T> values) : owned(std::move(values)) { attach(); }
+
+    FlatArray(const FlatArray &other) : owned(other.owned), owner(other.owner), elements(other.elements), count(other.count)
+    {
+        if (!owner)
+            attach();
+    }
+
+    FlatArray(FlatArray &&other) noexcept : owned(std::move(other.owned)), owner(std::move(other.owner)), elements(other.elements), count(other.count)
+    {
+        if (!owner)
+            attach();
+        other.clear();
+    }
+
+    FlatArray &operator=(FlatArray other)
+    {
+        owned.swap(other.owned);
+        owner.swap(other.owner);
+        elements = other.elements;
+        count = other.count;
+        if (!owner)
+            attach();
+        return *this;
+    }
+
+    /**
+     * @brief Refer to elements stored elsewhere without copying them
+     * @param data First element
+     * @param size Number of elements
+     * @param keeper Object that keeps the memory valid, shared by all views into it
+     * @return Array viewing the given memory
+     */
+    static FlatArray view(const T *data, size_t size, std::shared_ptr<const void> keeper)
+    {
+        FlatArray array;
+        array.owner = std::move(keeper);
+        array.elements = data;
+        array.count = size;
+        return array;
+    }
+
+    /** @brief Number of elements */
+    size_t size() const { return count; }
+
+    /** @brief True if the array has no elements */
+    bool empty() const { return count == 0; }
+
+    /** @brief Element at an index; no bounds check */
+    const T &operator[](size_t index) const { return elements[index]; }
+
+    /** @brief First element, may be nullptr when empty */
+    const T *data() const { return elements; }
+
+    const T *begin() const { return elements; }
+    const T *end() const { return elements + count; }
+
+    /**
+     * @brief Replace one element, copying viewed elements into owned storage first
+     * @param index Position of the element; no bounds check
+     * @param value New value
+     */
+    void set(size_t index, const T &value)
+    {
+        if (owner)
+        {
+            owned.assign(elements, elements + count);
+            owner.reset();
+            attach();
+        }
+        owned[index] = value;
+    }
+
+    /** @brief Heap memory owned by the array; views report 0 */
+    size_t memoryBytes() const { return owned.capacity() * sizeof(T); }
+
+private:
+    void attach()
+    {
+        elements = owned.data();
+        count = owned.size();
+    }
+
+    void clear()
+    {
+        owned.clear();
+        owner.reset();
+        elements = nullptr;
+        count = 0;
+    }
+
+    std::vector<T> owned;               /**< Elements when the array owns them */
+    std::shared_ptr<const void> owner;  /**< Keeps viewed memory alive, empty when owning */
+    const T *elements;
+    size_t count;
+};
+
+#endif // FLATARRAY_H
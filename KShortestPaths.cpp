@@ -0,0 +1,182 @@
+#include "KShortestPaths.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+const int KShortestPaths::DefaultPathCount;
+
+int KShortestPaths::findPaths(const MetroNetwork &network, const CsrGraph &reverse, int from, int to, int k,
+                              vector<vector<int>> &paths, vector<int> &minutes)
+{
+    paths.clear();
+    minutes.clear();
+    candidates.clear();
+    seen.clear();
+    known.clear();
+    if (k <= 0)
+        return 0;
+
+    const CsrGraph &graph = network.graph;
+    int n = graph.nodeCount();
+    if (static_cast<int>(stateBan.size()) != n)
+    {
+        stateBan.assign(n, 0);
+        arcBan.assign(n, 0);
+        distances.assign(n, INT_MAX);
+        previous.assign(n, -1);
+        touched.clear();
+        stamp = 0;
+    }
+    if (stationBan.size() != network.stations.size())
+        stationBan.assign(network.stations.size(), 0);
+
+    /* Times to the destination from everywhere; on the reversed graph the tree points towards it */
+    engine.run(to, reverse, toTarget, successor);
+    if (toTarget[from] == INT_MAX)
+        return 0;
+
+    Candidate first;
+    first.minutes = toTarget[from];
+    for (int state = from; state != -1; state = state == to ? -1 : successor[state])
+        first.states.push_back(state);
+    seen.insert(first.states);
+    candidates.push_back(first);
+
+    /* Fastest candidate on top of the heap, the one with fewer states among equals */
+    auto heapOrder = [](const Candidate &a, const Candidate &b)
+    {
+        if (a.minutes != b.minutes)
+            return a.minutes > b.minutes;
+        return a.states.size() > b.states.size();
+    };
+    while (static_cast<int>(paths.size()) < k && !candidates.empty())
+    {
+        pop_heap(candidates.begin(), candidates.end(), heapOrder);
+        Candidate best;
+        best.minutes = candidates.back().minutes;
+        best.states.swap(candidates.back().states);
+        candidates.pop_back();
+
+        /* The same stations on the same lines is no alternative */
+        signature(network, best.states, key);
+        if (!known.insert(key).second)
+            continue;
+        paths.push_back(best.states);
+        minutes.push_back(best.minutes);
+        if (static_cast<int>(paths.size()) == k)
+            break;
+
+        const vector<int> &path = paths.back();
+        int rootMinutes = 0;
+        for (size_t i = 0; i + 1 < path.size(); ++i)
+        {
+            /* Avoid the root before the spur, and the next ride of every route sharing this root */
+            ++stamp;
+            spurState = path[i];
+            spurStation = network.stateStation[spurState];
+            for (size_t j = 0; j < i; ++j)
+            {
+                stateBan[path[j]] = stamp;
+                if (network.stateStation[path[j]] != spurStation)
+                    stationBan[network.stateStation[path[j]]] = stamp;
+            }
+            for (const vector<int> &accepted : paths)
+            {
+                if (accepted.size() > i + 1 && equal(path.begin(), path.begin() + i + 1, accepted.begin()))
+                    arcBan[accepted[i + 1]] = stamp;
+            }
+
+            int spurMinutes = findSpur(network, spurState, to, spurPath);
+            if (spurMinutes >= 0)
+            {
+                Candidate candidate;
+                candidate.minutes = rootMinutes + spurMinutes;
+                candidate.states.assign(path.begin(), path.begin() + i);
+                candidate.states.insert(candidate.states.end(), spurPath.begin(), spurPath.end());
+                if (seen.insert(candidate.states).second)
+                {
+                    candidates.push_back(candidate);
+                    push_heap(candidates.begin(), candidates.end(), heapOrder);
+                }
+            }
+            rootMinutes += graph.minutes(graph.findArc(path[i], path[i + 1]));
+        }
+    }
+    return static_cast<int>(paths.size());
+}
+
+int KShortestPaths::findSpur(const MetroNetwork &network, int spur, int target, vector<int> &path)
+{
+    /* The tree way is the fastest one whenever it steers clear of everything avoided */
+    path.assign(1, spur);
+    bool clear = true;
+    for (int state = spur; state != target && clear; state = successor[state])
+    {
+        clear = successor[state] >= 0 && allowed(network, state, successor[state]);
+        if (clear)
+            path.push_back(successor[state]);
+    }
+    if (clear)
+        return toTarget[spur];
+
+    /* Otherwise A*: times to the target ignore the bans, so they stay a lower bound */
+    for (int state : touched)
+    {
+        distances[state] = INT_MAX;
+        previous[state] = -1;
+    }
+    touched.clear();
+    path.clear();
+
+    const CsrGraph &graph = network.graph;
+    queue.reset(graph.nodeCount());
+    distances[spur] = 0;
+    touched.push_back(spur);
+    queue.push(spur, toTarget[spur]);
+    while (!queue.empty())
+    {
+        int queued;
+        int current = queue.pop(queued);
+        int distance = distances[current];
+        if (queued > distance + toTarget[current])
+            continue;
+        ++settled;
+
+        if (current == target)
+        {
+            for (int state = target; state != -1; state = previous[state])
+                path.push_back(state);
+            reverse(path.begin(), path.end());
+            return distance;
+        }
+
+        for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+        {
+            int next = graph.target(arc);
+            int newDistance = distance + graph.minutes(arc);
+            if (newDistance >= distances[next] || toTarget[next] == INT_MAX || !allowed(network, current, next))
+                continue;
+            if (distances[next] == INT_MAX)
+                touched.push_back(next);
+            distances[next] = newDistance;
+            previous[next] = current;
+            queue.push(next, newDistance + toTarget[next]);
+        }
+    }
+    return -1;
+}
+
+void KShortestPaths::signature(const MetroNetwork &network, const vector<int> &states, vector<int> &key) const
+{
+    const CsrGraph &graph = network.graph;
+    key.assign(1, network.stateStation[states.front()]);
+    for (size_t i = 1; i < states.size(); ++i)
+    {
+        int station = network.stateStation[states[i]];
+        if (station == network.stateStation[states[i - 1]])
+            continue;
+        key.push_back(network.arcLine[graph.findArc(states[i - 1], states[i])]);
+        key.push_back(station);
+    }
+}
@@ -0,0 +1,98 @@
+#ifndef KSHORTESTPATHS_H
+#define KSHORTESTPATHS_H
+
+#include "MetroNetwork.h"
+#include "PriorityQueues.h"
+#include "RouteEngine.h"
+#include <set>
+#include <vector>
+
+/**
+ * @brief Fastest loopless alternatives between two stations (Yen's algorithm)
+ *
+ * The fastest route comes first; each further one leaves an earlier route
+ * at some station (the spur) and takes the fastest way on that avoids the
+ * stations before the spur and the rides the earlier routes took from it.
+ *
+ * One backward search from the destination gives the travel time from every
+ * state to the destination and a tree of fastest ways there. Most spurs just
+ * follow that tree; where it runs into an avoided station or ride, an A*
+ * search steered by the same times fills in, which is exact on everything
+ * the spur leaves untouched. Both share this object's buffers, so k
+ * alternatives cost little more than k point-to-point queries.
+ *
+ * Routes are over the states of MetroNetwork::graph. Two state paths that
+ * visit the same stations on the same lines, such as one that leaves and
+ * reboards a train, count as one route. As in PointToPointDijkstra, a spur
+ * search resets only the states the previous one touched.
+ */
+class KShortestPaths
+{
+public:
+    /** @brief Routes returned unless asked otherwise */
+    static const int DefaultPathCount = 3;
+
+    /**
+     * @brief Up to k fastest routes that visit no station twice
+     * @param network Canonical network
+     * @param reverse network.graph.reversed(), kept in step with any segment changes
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param k Number of routes wanted
+     * @param paths Output state paths from the origin to the destination station, fastest first
+     * @param minutes Output travel time of every path on network.graph
+     * @return Number of routes found, 0 if the destination is unreachable
+     */
+    int findPaths(const MetroNetwork &network, const CsrGraph &reverse, int from, int to, int k,
+                  std::vector<std::vector<int>> &paths, std::vector<int> &minutes);
+
+    /** @brief States settled by spur searches so far; spurs that follow the tree settle none */
+    uint64_t settledCount() const { return settled; }
+
+private:
+    /* Route waiting to be accepted */
+    struct Candidate
+    {
+        int minutes;
+        std::vector<int> states;
+    };
+
+    /* Fastest way from a spur state to the target around the avoided stations and states */
+    int findSpur(const MetroNetwork &network, int spur, int target, std::vector<int> &path);
+
+    /* True if the search may move from one state to the next */
+    bool allowed(const MetroNetwork &network, int current, int next) const
+    {
+        return stateBan[next] != stamp && stationBan[network.stateStation[next]] != stamp &&
+               (network.stateStation[next] != spurStation || network.stateStation[current] == spurStation) &&
+               (current != spurState || arcBan[next] != stamp);
+    }
+
+    /* Stations and lines a state path visits, to recognise the same route */
+    void signature(const MetroNetwork &network, const std::vector<int> &states, std::vector<int> &key) const;
+
+    BucketDijkstra engine;
+    std::vector<int> toTarget;   /**< Travel time from every state to the target */
+    std::vector<int> successor;  /**< Next state of the fastest way to the target */
+
+    std::vector<int> stateBan;   /**< States of the root path, marked with the current stamp */
+    std::vector<int> stationBan; /**< Stations of the root path before the spur */
+    std::vector<int> arcBan;     /**< States earlier routes moved to from the spur */
+    int stamp = 0;
+    int spurState = -1;
+    int spurStation = -1;
+
+    std::vector<int> distances;
+    std::vector<int> previous;
+    std::vector<int> touched;
+    BucketQueue queue;
+
+    std::vector<Candidate> candidates;
+    std::set<std::vector<int>> seen;  /**< State paths accepted or waiting */
+    std::set<std::vector<int>> known; /**< Signatures of accepted routes */
+    std::vector<int> spurPath;
+    std::vector<int> key;
+    uint64_t settled = 0;
+};
+
+#endif // KSHORTESTPATHS_H
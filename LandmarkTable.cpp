@@ -0,0 +1,128 @@
+#include "LandmarkTable.h"
+#include "RouteEngine.h"
+#include <atomic>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int LandmarkTable::DefaultLandmarkCount;
+const uint16_t LandmarkTable::Unreachable;
+
+LandmarkTable::LandmarkTable() : nodeCount(0), count(0), graphFingerprint(0)
+{
+}
+
+bool LandmarkTable::build(const CsrGraph &graph, int landmarkCount, int threadCount)
+{
+    int n = graph.nodeCount();
+    int k = min(landmarkCount, n);
+    if (k <= 0)
+        return false;
+
+    if (threadCount <= 0)
+        threadCount = max(1u, thread::hardware_concurrency());
+
+    vector<int32_t> chosen(k);
+    vector<uint16_t> fromTable(static_cast<size_t>(n) * k);
+    vector<uint16_t> toTable(static_cast<size_t>(n) * k);
+    atomic<bool> overflow(false);
+
+    /* Copy one search into column i of a node-major table */
+    auto store = [&](vector<uint16_t> &table, int i, const vector<int> &distances)
+    {
+        for (int node = 0; node < n; ++node)
+        {
+            int minutes = distances[node];
+            if (minutes != INT_MAX && minutes >= Unreachable)
+                overflow = true;
+            table[static_cast<size_t>(node) * k + i] = minutes == INT_MAX ? Unreachable : static_cast<uint16_t>(minutes);
+        }
+    };
+
+    /* Backward searches start as soon as the selection below publishes their landmark */
+    CsrGraph reverse = graph.reversed();
+    mutex lock;
+    condition_variable published;
+    int selected = 0;
+    atomic<int> nextBackward(0);
+
+    auto backwardWorker = [&]()
+    {
+        BucketDijkstra engine;
+        vector<int> distances, previous;
+        for (int i = nextBackward++; i < k; i = nextBackward++)
+        {
+            {
+                unique_lock<mutex> guard(lock);
+                published.wait(guard, [&]() { return selected > i; });
+            }
+            engine.run(chosen[i], reverse, distances, previous);
+            store(toTable, i, distances);
+        }
+    };
+
+    vector<thread> workers;
+    for (int i = 1; i < threadCount; ++i)
+        workers.emplace_back(backwardWorker);
+
+    /*
+     * Farthest-point selection: start from the node farthest from node 0,
+     * then repeatedly take the node farthest from every landmark so far.
+     * Nodes no landmark reaches count as infinitely far, so every part of a
+     * disconnected network gets a landmark while any are left.
+     */
+    BucketDijkstra engine;
+    vector<int> distances, previous;
+    vector<int> nearest(n, INT_MAX);
+    engine.run(0, graph, distances, previous);
+    int next = 0;
+    for (int node = 0; node < n; ++node)
+    {
+        if (distances[node] != INT_MAX && distances[node] > distances[next])
+            next = node;
+    }
+
+    for (int i = 0; i < k; ++i)
+    {
+        engine.run(next, graph, distances, previous);
+        store(fromTable, i, distances);
+        {
+            lock_guard<mutex> guard(lock);
+            chosen[i] = next;
+            selected = i + 1;
+        }
+        published.notify_all();
+
+        nearest[next] = 0;
+        for (int node = 0; node < n; ++node)
+        {
+            nearest[node] = min(nearest[node], distances[node]);
+            if (nearest[node] > nearest[next])
+                next = node;
+        }
+    }
+
+    backwardWorker();
+    for (thread &t : workers)
+        t.join();
+
+    if (overflow)
+        return false;
+
+    nodeCount = n;
+    count = k;
+    graphFingerprint = graph.fingerprint();
+    landmarks = FlatArray<int32_t>(move(chosen));
+    fromLandmark = FlatArray<uint16_t>(move(fromTable));
+    toLandmark = FlatArray<uint16_t>(move(toTable));
+    return true;
+}
+
+size_t LandmarkTable::memoryBytes() const
+{
+    return landmarks.memoryBytes() + fromLandmark.memoryBytes() + toLandmark.memoryBytes();
+}
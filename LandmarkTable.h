@@ -0,0 +1,108 @@
+#ifndef LANDMARKTABLE_H
+#define LANDMARKTABLE_H
+
+#include "CsrGraph.h"
+#include "FlatArray.h"
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Landmark distance tables for goal-directed (ALT) searches
+ *
+ * A handful of landmark nodes are spread over the network by farthest-point
+ * selection: each new landmark is the node farthest from all landmarks
+ * chosen so far. For every landmark the table stores the travel time from
+ * it to every node and from every node to it. The triangle inequality then
+ * gives a lower bound on the travel time between any two nodes, which
+ * AStarSearch uses as its heuristic.
+ *
+ * Selection needs one forward search per landmark and runs on the calling
+ * thread; the backward searches over the reversed graph run in parallel as
+ * soon as their landmark is chosen. Times are stored as 16-bit minutes, with
+ * the landmarks of a node next to each other so one estimate reads two
+ * short rows.
+ */
+class LandmarkTable
+{
+public:
+    /** @brief Number of landmarks used unless set otherwise */
+    static const int DefaultLandmarkCount = 16;
+
+    /** @brief Marks a node that cannot be reached from or cannot reach a landmark */
+    static const uint16_t Unreachable = 0xFFFF;
+
+    /**
+     * @brief Construct an empty table; isBuilt() is false until build()
+     */
+    LandmarkTable();
+
+    /**
+     * @brief Select landmarks and compute their distance tables
+     * @param graph CSR representation of the network
+     * @param landmarkCount Number of landmarks, at most the number of nodes
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     * @return False if the graph is empty or a travel time does not fit 16 bits
+     */
+    bool build(const CsrGraph &graph, int landmarkCount = DefaultLandmarkCount, int threadCount = 0);
+
+    /** @brief True once the tables hold data */
+    bool isBuilt() const { return count > 0; }
+
+    /** @brief Number of landmarks */
+    int landmarkCount() const { return count; }
+
+    /** @brief Node of a landmark */
+    int landmark(int index) const { return landmarks[index]; }
+
+    /**
+     * @brief Lower bound on the travel time between two nodes
+     * @param node Node the bound starts from
+     * @param target Node the bound leads to
+     * @return Minutes the route takes at least, or -1 if target cannot be reached from node
+     */
+    int estimate(int node, int target) const
+    {
+        const uint16_t *fromNode = fromLandmark.data() + static_cast<size_t>(node) * count;
+        const uint16_t *fromTarget = fromLandmark.data() + static_cast<size_t>(target) * count;
+        const uint16_t *toNode = toLandmark.data() + static_cast<size_t>(node) * count;
+        const uint16_t *toTarget = toLandmark.data() + static_cast<size_t>(target) * count;
+
+        int bound = 0;
+        for (int i = 0; i < count; ++i)
+        {
+            /* A landmark that reaches the node also reaches everything the node reaches */
+            if (fromNode[i] != Unreachable)
+            {
+                if (fromTarget[i] == Unreachable)
+                    return -1;
+                bound = std::max(bound, fromTarget[i] - fromNode[i]);
+            }
+            /* A node that reaches the target also reaches every landmark the target reaches */
+            if (toTarget[i] != Unreachable)
+            {
+                if (toNode[i] == Unreachable)
+                    return -1;
+                bound = std::max(bound, toNode[i] - toTarget[i]);
+            }
+        }
+        return bound;
+    }
+
+    /**
+     * @brief Heap memory held by the tables
+     * @return Size in bytes, 0 for tables used in place from a snapshot
+     */
+    size_t memoryBytes() const;
+
+private:
+    friend class NetworkSnapshot;
+
+    int nodeCount;
+    int count;
+    uint64_t graphFingerprint;        /**< CsrGraph::fingerprint() of the source network */
+    FlatArray<int32_t> landmarks;     /**< Node of every landmark */
+    FlatArray<uint16_t> fromLandmark; /**< Minutes from each landmark, count entries per node */
+    FlatArray<uint16_t> toLandmark;   /**< Minutes to each landmark, count entries per node */
+};
+
+#endif // LANDMARKTABLE_H
@@ -0,0 +1,155 @@
+#ifndef LRUCACHE_H
+#define LRUCACHE_H
+
+#include <list>
+#include <unordered_map>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @brief Bounded map that evicts the least recently used entry
+ *
+ * Lookups and insertions are O(1). When the cache is full, insert() reuses
+ * the evicted entry's storage, so values holding vectors or strings keep
+ * their capacity and a warm cache stops allocating. Hits and misses are
+ * counted for every find() while the cache is enabled.
+ *
+ * A capacity of 0 disables the cache: find() always fails and nothing is
+ * counted.
+ */
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class LruCache
+{
+public:
+    /**
+     * @brief Construct a cache
+     * @param entryCount Number of entries kept, 0 to disable the cache
+     */
+    explicit LruCache(size_t entryCount = 0) : maxEntries(entryCount), hitCount(0), missCount(0) {}
+
+    LruCache(const LruCache &) = delete;
+    LruCache &operator=(const LruCache &) = delete;
+
+    /**
+     * @brief Change the number of entries kept, evicting the oldest ones if needed
+     * @param value New capacity, 0 to disable the cache
+     */
+    void setCapacity(size_t value)
+    {
+        maxEntries = value;
+        while (entries.size() > maxEntries)
+        {
+            index.erase(entries.back().first);
+            entries.pop_back();
+        }
+    }
+
+    /** @brief Number of entries kept at most */
+    size_t capacity() const { return maxEntries; }
+
+    /** @brief Number of entries currently cached */
+    size_t size() const { return entries.size(); }
+
+    /**
+     * @brief Look up an entry and mark it as most recently used
+     * @param key Key to look up
+     * @return The cached value, or nullptr on a miss
+     */
+    Value *find(const Key &key)
+    {
+        if (maxEntries == 0)
+            return nullptr;
+
+        auto found = index.find(key);
+        if (found == index.end())
+        {
+            ++missCount;
+            return nullptr;
+        }
+
+        ++hitCount;
+        entries.splice(entries.begin(), entries, found->second);
+        return &found->second->second;
+    }
+
+    /**
+     * @brief Add or replace an entry and mark it as most recently used
+     *
+     * The returned value holds whatever the reused slot held before; the
+     * caller overwrites it. Must not be called while the cache is disabled.
+     *
+     * @param key Key of the entry
+     * @return Value slot to fill in
+     */
+    Value &insert(const Key &key)
+    {
+        auto found = index.find(key);
+        if (found != index.end())
+        {
+            entries.splice(entries.begin(), entries, found->second);
+            return found->second->second;
+        }
+
+        if (entries.size() < maxEntries)
+            entries.emplace_front(key, Value());
+        else
+        {
+            /* Recycle the oldest entry in place of a new allocation */
+            index.erase(entries.back().first);
+            entries.splice(entries.begin(), entries, std::prev(entries.end()));
+            entries.front().first = key;
+        }
+
+        index[key] = entries.begin();
+        return entries.front().second;
+    }
+
+    /**
+     * @brief Call a function for every entry, most recently used first
+     *
+     * The order of the entries and the statistics are left unchanged.
+     *
+     * @param visit Called with the key and a modifiable value of each entry
+     */
+    template <typename Function>
+    void forEach(Function visit)
+    {
+        for (Entry &entry : entries)
+            visit(static_cast<const Key &>(entry.first), entry.second);
+    }
+
+    /**
+     * @brief Remove all entries; statistics are kept
+     */
+    void clear()
+    {
+        entries.clear();
+        index.clear();
+    }
+
+    /** @brief Number of find() calls that returned a value */
+    uint64_t hits() const { return hitCount; }
+
+    /** @brief Number of find() calls that failed */
+    uint64_t misses() const { return missCount; }
+
+    /** @brief Reset the hit and miss counters */
+    void resetStatistics()
+    {
+        hitCount = 0;
+        missCount = 0;
+    }
+
+private:
+    typedef std::pair<Key, Value> Entry;
+
+    std::list<Entry> entries; /**< Most recently used first */
+    std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> index;
+    size_t maxEntries;
+    uint64_t hitCount;
+    uint64_t missCount;
+};
+
+#endif // LRUCACHE_H
@@ -0,0 +1,332 @@
+#include "MapTileCache.h"
+#include "NetworkMapItem.h"
+#include <QCryptographicHash>
+#include <QDir>
+#include <QFont>
+#include <QTransform>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+const int MapTileCache::TileSize;
+const int MapTileCache::LevelsPerOctave;
+const int MapTileCache::LevelCount;
+
+namespace
+{
+/* Changed whenever tiles of the same network would be drawn differently */
+const int TileFormat = 1;
+
+const size_t DefaultMemoryBytes = 64 << 20;
+const size_t TileBytes = MapTileCache::TileSize * MapTileCache::TileSize * 4;
+
+/* Oldest jobs are dropped beyond this many, as a fast pan leaves them off screen */
+const size_t MaxQueuedTiles = 256;
+
+/* Relative difference below which a scale counts as a level's */
+const double ScaleTolerance = 1e-6;
+
+/* Version of what a network's tiles show, for the name of their folder */
+QString networkVersion(const MetroNetwork &network)
+{
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    auto add = [&hash](const void *data, size_t size)
+    {
+        hash.addData(static_cast<const char *>(data), static_cast<int>(size));
+    };
+
+    int format[] = {TileFormat, MapTileCache::TileSize, MapTileCache::LevelsPerOctave};
+    add(format, sizeof(format));
+    uint64_t fingerprint = network.graph.fingerprint();
+    add(&fingerprint, sizeof(fingerprint));
+    for (const Station &station : network.stations)
+    {
+        double position[] = {station.x, station.y};
+        add(position, sizeof(position));
+        add(station.name.c_str(), station.name.size() + 1);
+        add(station.line.c_str(), station.line.size() + 1);
+    }
+    for (const string &name : network.lineNames)
+        add(name.c_str(), name.size() + 1);
+
+    /* Labels are rendered with the default font */
+    hash.addData(QFont().toString().toUtf8());
+    return QString::fromLatin1(hash.result().toHex());
+}
+}
+
+MapTileCache::MapTileCache(QObject *parent)
+    : QObject(parent), source(nullptr), baseScale(1), tiles(DefaultMemoryBytes / TileBytes), placements(LevelCount),
+      busy(0), stopping(false)
+{
+    /* One thread is left to the GUI */
+    int threadCount = max(1, min(4, static_cast<int>(thread::hardware_concurrency()) - 1));
+    for (int i = 0; i < threadCount; ++i)
+        workers.push_back(thread(&MapTileCache::work, this));
+}
+
+MapTileCache::~MapTileCache()
+{
+    {
+        lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        queue.clear();
+    }
+    wake.notify_all();
+    for (thread &worker : workers)
+        worker.join();
+}
+
+uint64_t MapTileCache::tileKey(int level, int column, int row)
+{
+    /* Columns and rows may be negative; 28 bits each cover far more than the top level */
+    const int64_t Bias = int64_t(1) << 27;
+    return (static_cast<uint64_t>(level) << 56) | (static_cast<uint64_t>(column + Bias) << 28) |
+           static_cast<uint64_t>(row + Bias);
+}
+
+void MapTileCache::drain()
+{
+    unique_lock<std::mutex> lock(mutex);
+    queue.clear();
+    idle.wait(lock, [this] { return busy == 0; });
+    finished.clear();
+}
+
+void MapTileCache::clear()
+{
+    drain();
+    source = nullptr;
+    networkFolder.clear();
+    tiles.clear();
+    pending.clear();
+    fill(placements.begin(), placements.end(), shared_ptr<const vector<char>>());
+}
+
+void MapTileCache::setSource(const NetworkMapItem &item, const MetroNetwork &network)
+{
+    clear();
+    QRectF area = item.networkRect();
+    if (area.isNull())
+        return;
+
+    /* Level 0 holds the whole network in about one tile */
+    lock_guard<std::mutex> lock(mutex);
+    source = &item;
+    baseScale = TileSize / max(area.width(), area.height());
+    if (!diskDirectory.isEmpty())
+    {
+        QString folder = diskDirectory + "/tiles-" + networkVersion(network);
+        if (QDir().mkpath(folder))
+            networkFolder = folder;
+    }
+}
+
+void MapTileCache::setMemoryBudget(size_t bytes)
+{
+    tiles.setCapacity(bytes / TileBytes);
+}
+
+void MapTileCache::setDiskDirectory(const QString &directory)
+{
+    /* Takes effect with the next source */
+    lock_guard<std::mutex> lock(mutex);
+    diskDirectory = directory;
+}
+
+double MapTileCache::levelScale(int level) const
+{
+    return baseScale * pow(2.0, static_cast<double>(level) / LevelsPerOctave);
+}
+
+int MapTileCache::levelAtMost(double scale) const
+{
+    /* The tolerance keeps a scale that is a level's from rounding below it */
+    double level = log2(scale * (1 + ScaleTolerance) / baseScale) * LevelsPerOctave;
+    return static_cast<int>(floor(level));
+}
+
+int MapTileCache::levelOf(double scale) const
+{
+    if (!source || tiles.capacity() == 0)
+        return -1;
+
+    int level = levelAtMost(scale);
+    if (level < 0 || level >= LevelCount || fabs(scale - levelScale(level)) > scale * ScaleTolerance)
+        return -1;
+    return level;
+}
+
+QRectF MapTileCache::tileArea(int level, int column, int row) const
+{
+    double side = TileSize / levelScale(level);
+    return QRectF(column * side, row * side, side, side);
+}
+
+void MapTileCache::tileRange(int level, const QRectF &area, int &left, int &right, int &top, int &bottom) const
+{
+    double side = TileSize / levelScale(level);
+    left = static_cast<int>(floor(area.left() / side));
+    right = static_cast<int>(ceil(area.right() / side)) - 1;
+    top = static_cast<int>(floor(area.top() / side));
+    bottom = static_cast<int>(ceil(area.bottom() / side)) - 1;
+}
+
+const shared_ptr<const vector<char>> &MapTileCache::placement(int level)
+{
+    if (!placements[level])
+    {
+        auto shown = make_shared<vector<char>>();
+        source->placeLabels(levelScale(level), *shown);
+        placements[level] = shown;
+    }
+    return placements[level];
+}
+
+void MapTileCache::request(int level, int column, int row)
+{
+    uint64_t key = tileKey(level, column, row);
+    if (!pending.insert(key).second)
+        return;
+
+    Job job = {key, level, column, row, placement(level)};
+    {
+        lock_guard<std::mutex> lock(mutex);
+        queue.push_back(job);
+        if (queue.size() > MaxQueuedTiles)
+        {
+            pending.erase(queue.front().key);
+            queue.erase(queue.begin());
+        }
+    }
+    wake.notify_one();
+}
+
+void MapTileCache::paint(QPainter *painter, const QRectF &exposed, int level)
+{
+    QRectF area = exposed & source->boundingRect();
+    if (area.isEmpty())
+        return;
+
+    /* Neighbouring levels first: the newest jobs are taken first, so the visible tiles come before them */
+    int left, right, top, bottom;
+    for (int neighbour = level - 1; neighbour <= level + 1; neighbour += 2)
+    {
+        if (neighbour < 0 || neighbour >= LevelCount)
+            continue;
+        tileRange(neighbour, area, left, right, top, bottom);
+        for (int row = top; row <= bottom; ++row)
+        {
+            for (int column = left; column <= right; ++column)
+            {
+                if (!tiles.find(tileKey(neighbour, column, row)))
+                    request(neighbour, column, row);
+            }
+        }
+    }
+
+    /* Tiles are drawn untransformed at whole device pixels, so they are copied rather than resampled */
+    tileRange(level, area, left, right, top, bottom);
+    vector<QRectF> missing;
+    QTransform world = painter->worldTransform();
+    painter->setWorldTransform(QTransform());
+    for (int row = top; row <= bottom; ++row)
+    {
+        for (int column = left; column <= right; ++column)
+        {
+            QRectF tile = tileArea(level, column, row);
+            const QImage *image = tiles.find(tileKey(level, column, row));
+            if (!image)
+            {
+                request(level, column, row);
+                missing.push_back(tile);
+                continue;
+            }
+            QPointF corner = world.map(tile.topLeft());
+            painter->drawImage(QPoint(qRound(corner.x()), qRound(corner.y())), *image);
+        }
+    }
+    painter->setWorldTransform(world);
+
+    double scale = levelScale(level);
+    for (const QRectF &tile : missing)
+    {
+        painter->save();
+        painter->setClipRect(tile, Qt::IntersectClip);
+        source->render(painter, tile & area, scale, *placement(level));
+        painter->restore();
+    }
+}
+
+void MapTileCache::work()
+{
+    unique_lock<std::mutex> lock(mutex);
+    for (;;)
+    {
+        wake.wait(lock, [this] { return stopping || !queue.empty(); });
+        if (stopping)
+            return;
+
+        Job job = queue.back();
+        queue.pop_back();
+        const NetworkMapItem *item = source;
+        double scale = levelScale(job.level);
+        QString path;
+        if (!networkFolder.isEmpty())
+            path = QString("%1/%2-%3-%4.png")
+                       .arg(networkFolder, QString::number(job.level), QString::number(job.column),
+                            QString::number(job.row));
+        ++busy;
+        lock.unlock();
+
+        QImage image;
+        if (path.isEmpty() || !image.load(path) || image.size() != QSize(TileSize, TileSize))
+        {
+            image = QImage(TileSize, TileSize, QImage::Format_ARGB32_Premultiplied);
+            image.fill(Qt::transparent);
+            QPainter painter(&image);
+            painter.translate(-job.column * TileSize, -job.row * TileSize);
+            painter.scale(scale, scale);
+            item->render(&painter, tileArea(job.level, job.column, job.row), scale, *job.labels);
+            painter.end();
+
+            /* A tile that cannot be stored is rendered again next time */
+            if (!path.isEmpty())
+                image.save(path, "PNG");
+        }
+        else
+            image = image.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+
+        lock.lock();
+        --busy;
+        finished.push_back(make_pair(job.key, image));
+        idle.notify_all();
+        QMetaObject::invokeMethod(this, "collectTiles", Qt::QueuedConnection);
+    }
+}
+
+void MapTileCache::collectTiles()
+{
+    vector<pair<uint64_t, QImage>> ready;
+    {
+        lock_guard<std::mutex> lock(mutex);
+        ready.swap(finished);
+    }
+
+    const int64_t Bias = int64_t(1) << 27;
+    const uint64_t Mask = (uint64_t(1) << 28) - 1;
+    for (auto &tile : ready)
+    {
+        /* Tiles of a dropped source were discarded by drain(), so every key is still wanted */
+        pending.erase(tile.first);
+        if (tiles.capacity() == 0)
+            continue;
+        tiles.insert(tile.first) = tile.second;
+
+        int level = static_cast<int>(tile.first >> 56);
+        int column = static_cast<int>(static_cast<int64_t>((tile.first >> 28) & Mask) - Bias);
+        int row = static_cast<int>(static_cast<int64_t>(tile.first & Mask) - Bias);
+        emit tileReady(tileArea(level, column, row));
+    }
+}
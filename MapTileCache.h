@@ -0,0 +1,190 @@
+#ifndef MAPTILECACHE_H
+#define MAPTILECACHE_H
+
+#include "LruCache.h"
+#include "MetroNetwork.h"
+#include <QImage>
+#include <QObject>
+#include <QPainter>
+#include <QRectF>
+#include <QString>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+class NetworkMapItem;
+
+/**
+ * @brief Pyramid of pre-rendered tiles of the network map
+ *
+ * The map is rasterized at a ladder of scales, LevelsPerOctave to every
+ * doubling, starting from the whole network in about one tile. Each level is
+ * cut into square tiles on a grid anchored at the scene origin.
+ *
+ * Background threads render the tiles paint() asks for, the visible ones
+ * first and those of the levels next to it after them. Finished tiles go
+ * into a least recently used cache bounded in bytes. With a disk directory
+ * set, tiles are also kept as PNG files in a folder named after the network
+ * version, so later runs with the same network load them instead.
+ *
+ * paint() blits the cached tiles of a level and paints the rest live from
+ * the source item until they arrive, then tileReady() reports the area to
+ * repaint. The functions are for the GUI thread.
+ */
+class MapTileCache : public QObject
+{
+    Q_OBJECT
+public:
+    /** @brief Side of a tile in pixels */
+    static const int TileSize = 256;
+
+    /** @brief Levels to every doubling of the scale */
+    static const int LevelsPerOctave = 4;
+
+    /** @brief Levels of the pyramid; higher ones are painted live */
+    static const int LevelCount = 32;
+
+    /**
+     * @brief Construct a cache without a source and start its render threads
+     * @param parent Optional parent object
+     */
+    explicit MapTileCache(QObject *parent = nullptr);
+
+    /** @brief Stop the render threads */
+    ~MapTileCache() override;
+
+    /**
+     * @brief Start the pyramid of a network
+     *
+     * Drops the tiles of the previous source, after waiting for the ones
+     * being rendered.
+     *
+     * @param item Item painting the network; not changed until clear()
+     * @param network Network the item was built from, to name its tiles on disk
+     */
+    void setSource(const NetworkMapItem &item, const MetroNetwork &network);
+
+    /**
+     * @brief Drop the source and all tiles in memory
+     *
+     * Waits for the tiles being rendered, so the source item may change
+     * once it returns.
+     */
+    void clear();
+
+    /**
+     * @brief Bound the memory the tiles take
+     * @param bytes Bytes of tiles kept, 0 to paint everything live
+     */
+    void setMemoryBudget(size_t bytes);
+
+    /**
+     * @brief Keep tiles on disk as well
+     * @param directory Directory the folders of the networks go in, empty to keep tiles in memory only
+     */
+    void setDiskDirectory(const QString &directory);
+
+    /**
+     * @brief Level that renders at a scale
+     * @param scale Device pixels per scene unit
+     * @return Level of the pyramid at exactly that scale, -1 if there is none or the cache is off
+     */
+    int levelOf(double scale) const;
+
+    /**
+     * @brief Level of the ladder at or below a scale
+     * @param scale Device pixels per scene unit
+     * @return Level, possibly outside the pyramid
+     */
+    int levelAtMost(double scale) const;
+
+    /**
+     * @brief Scale of a level of the ladder
+     * @param level Level, possibly outside the pyramid
+     * @return Device pixels per scene unit
+     */
+    double levelScale(int level) const;
+
+    /**
+     * @brief Paint part of the map at a level
+     *
+     * Cached tiles are blitted; the areas of the others are painted live
+     * and their tiles queued, together with those of the levels above and
+     * below.
+     *
+     * @param painter Painter whose world transform scales by levelScale(level)
+     * @param exposed Scene area to paint
+     * @param level Level returned by levelOf()
+     */
+    void paint(QPainter *painter, const QRectF &exposed, int level);
+
+    /** @brief Number of tiles held in memory */
+    size_t tileCount() const { return tiles.size(); }
+
+signals:
+    /**
+     * @brief A queued tile was rendered or loaded
+     * @param area Scene area of the tile
+     */
+    void tileReady(const QRectF &area);
+
+private slots:
+    /* Move finished tiles into the cache */
+    void collectTiles();
+
+private:
+    /* Tile waiting for a render thread */
+    struct Job
+    {
+        uint64_t key;
+        int level;
+        int column;
+        int row;
+        std::shared_ptr<const std::vector<char>> labels; /**< Label placement of the level */
+    };
+
+    /* Render thread: take the newest job, load or render its tile */
+    void work();
+
+    /* Empty the queue and wait for the jobs being run */
+    void drain();
+
+    /* Queue a tile unless it is cached or queued already */
+    void request(int level, int column, int row);
+
+    /* Scene area of a tile */
+    QRectF tileArea(int level, int column, int row) const;
+
+    /* Tiles of a level that meet a scene area, as [left, right] x [top, bottom] */
+    void tileRange(int level, const QRectF &area, int &left, int &right, int &top, int &bottom) const;
+
+    /* Label placement of a level, computed on first use */
+    const std::shared_ptr<const std::vector<char>> &placement(int level);
+
+    static uint64_t tileKey(int level, int column, int row);
+
+    const NetworkMapItem *source;
+    double baseScale;               /**< Scale of level 0 */
+    QString diskDirectory;          /**< Where network folders go, empty for none */
+    QString networkFolder;          /**< Folder of the source's tiles, empty for none */
+    LruCache<uint64_t, QImage> tiles;
+    std::unordered_set<uint64_t> pending; /**< Tiles queued or being rendered */
+    std::vector<std::shared_ptr<const std::vector<char>>> placements;
+
+    /* Shared with the render threads */
+    std::mutex mutex;
+    std::condition_variable wake;   /**< Signalled on new jobs and on stop */
+    std::condition_variable idle;   /**< Signalled when a job finishes */
+    std::vector<Job> queue;         /**< Newest last, taken first */
+    std::vector<std::pair<uint64_t, QImage>> finished;
+    int busy;
+    bool stopping;
+    std::vector<std::thread> workers;
+};
+
+#endif // MAPTILECACHE_H
@@ -0,0 +1,130 @@
+#include "MappedFile.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+#ifdef _WIN32
+
+MappedFile::MappedFile()
+    : bytes(nullptr), length(0), opened(false), fileHandle(INVALID_HANDLE_VALUE), mappingHandle(nullptr)
+{
+}
+
+bool MappedFile::open(const string &fileName)
+{
+    close();
+
+    HANDLE file = CreateFileA(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    fileHandle = file;
+    length = static_cast<size_t>(fileSize.QuadPart);
+    opened = true;
+
+    /* Windows cannot map an empty file */
+    if (length == 0)
+        return true;
+
+    mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mappingHandle)
+        bytes = static_cast<const char *>(MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0));
+    if (!bytes)
+    {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        UnmapViewOfFile(bytes);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle != INVALID_HANDLE_VALUE)
+        CloseHandle(fileHandle);
+
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+    fileHandle = INVALID_HANDLE_VALUE;
+    mappingHandle = nullptr;
+}
+
+#else
+
+MappedFile::MappedFile() : bytes(nullptr), length(0), opened(false)
+{
+}
+
+bool MappedFile::open(const string &fileName)
+{
+    close();
+
+    int descriptor = ::open(fileName.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return false;
+
+    struct stat status;
+    if (fstat(descriptor, &status) != 0 || !S_ISREG(status.st_mode))
+    {
+        ::close(descriptor);
+        return false;
+    }
+
+    length = static_cast<size_t>(status.st_size);
+    if (length > 0)
+    {
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED)
+        {
+            ::close(descriptor);
+            length = 0;
+            return false;
+        }
+
+        /* Parsers read the file front to back exactly once */
+        madvise(address, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const char *>(address);
+    }
+
+    /* The mapping stays valid after the descriptor is closed */
+    ::close(descriptor);
+    opened = true;
+    return true;
+}
+
+void MappedFile::close()
+{
+    if (bytes)
+        munmap(const_cast<char *>(bytes), length);
+
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+}
+
+#endif
+
+MappedFile::~MappedFile()
+{
+    close();
+}
@@ -0,0 +1,58 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <string>
+#include <cstddef>
+
+/**
+ * @brief Read-only memory mapping of a whole file
+ *
+ * Lets parsers work directly on the page cache instead of copying the file
+ * into a buffer first. The mapping is released when the object is destroyed
+ * or another file is opened. Empty files open successfully with size() 0.
+ */
+class MappedFile
+{
+public:
+    /**
+     * @brief Construct an object without a mapping
+     */
+    MappedFile();
+
+    ~MappedFile();
+
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    /**
+     * @brief Map a file into memory, replacing any previous mapping
+     * @param fileName Path of the file to map
+     * @return False if the file cannot be opened or mapped
+     */
+    bool open(const std::string &fileName);
+
+    /**
+     * @brief Release the mapping
+     */
+    void close();
+
+    /** @brief True while a file is mapped */
+    bool isOpen() const { return opened; }
+
+    /** @brief First byte of the file, nullptr for empty or unopened files */
+    const char *data() const { return bytes; }
+
+    /** @brief Size of the file in bytes */
+    size_t size() const { return length; }
+
+private:
+    const char *bytes;
+    size_t length;
+    bool opened;
+#ifdef _WIN32
+    void *fileHandle;    /**< HANDLE of the open file */
+    void *mappingHandle; /**< HANDLE of the file mapping object */
+#endif
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,365 @@
+#include "BatchRouter.h"
+#include "FareTable.h"
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include "NetworkGenerator.h"
+#include "NetworkLoader.h"
+#include "OdMatrix.h"
+#include "RoutePlanner.h"
+#include "Timetable.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Service day of timetables generated for networks without one */
+static const int ServiceStart = 5 * 3600;
+static const int ServiceEnd = 24 * 3600;
+
+static void printUsage()
+{
+    fputs("Usage: MetroBatch [options] [network files]\n"
+          "\n"
+          "Reads origin,destination pairs (station names or node IDs as loaded,\n"
+          "before interchanges are merged), one per line,\n"
+          "and writes the fastest route for each in the same order.\n"
+          "Without network files the built-in Delhi Metro network is used;\n"
+          "otherwise pass a GTFS directory or a stations and an edges CSV file.\n"
+          "\n"
+          "Options:\n"
+          "  -i, --input FILE     Read queries from FILE instead of standard input\n"
+          "  -o, --output FILE    Write results to FILE instead of standard output\n"
+          "  -f, --format FORMAT  csv (default), json with one object per line, or\n"
+          "                       directions with every station and line change\n"
+          "  -t, --threads N      Worker threads, default all hardware threads\n"
+          "      --holiday        Charge holiday fares\n"
+          "      --fares FILE     Charge fares from a fare table file instead of the\n"
+          "                       Delhi Metro fares\n"
+          "      --matrix         Ignore queries and write the full origin-destination\n"
+          "                       matrix as CSV with regular and holiday fares\n"
+          "      --snapshot FILE  Load the network from FILE if it was saved for the\n"
+          "                       same network files or settings and is current,\n"
+          "                       otherwise build it and save it there\n"
+          "      --generate N     Use a synthetic network of about N stations\n"
+          "      --layout LAYOUT  radial (default) or grid synthetic lines\n"
+          "      --lines N        Number of synthetic lines, default from N\n"
+          "      --density D      Share of line crossings that become interchanges,\n"
+          "                       default 0.5\n"
+          "      --seed N         Seed of the synthetic network, default 1\n"
+          "      --export PREFIX  Write the network to PREFIX_stations.csv and\n"
+          "                       PREFIX_edges.csv and exit\n"
+          "      --index INDEX    auto (default), table, hierarchy, landmarks or none;\n"
+          "                       auto picks the table for small networks and the\n"
+          "                       hierarchy for large ones\n"
+          "      --depart TIME    Find the earliest arrival when leaving at TIME (HH:MM)\n"
+          "                       by the timetable of a GTFS feed, or by trains every\n"
+          "                       --headway minutes from 05:00 to midnight otherwise\n"
+          "      --headway N      Minutes between trains of a generated timetable,\n"
+          "                       default 5\n"
+          "  -h, --help           Show this help\n",
+          stdout);
+}
+
+/* Append a CSV field, quoted only when it has to be */
+static void appendField(string &text, const string &value)
+{
+    if (value.find_first_of(",\"\n\r") == string::npos)
+    {
+        text += value;
+        return;
+    }
+    text += '"';
+    for (char c : value)
+    {
+        if (c == '"')
+            text += '"';
+        text += c;
+    }
+    text += '"';
+}
+
+/* Write every reachable pair of the matrix as one CSV line */
+static bool writeMatrix(const OdMatrix &matrix, const MetroNetwork &network, FILE *output)
+{
+    const vector<Station> &stations = network.stations;
+    string text = "from,to,minutes,distance_km,fare,holiday_fare\n";
+    char number[64];
+    for (int from = 0; from < matrix.size(); from++)
+    {
+        for (int to = 0; to < matrix.size(); to++)
+        {
+            if (!matrix.reachable(from, to))
+                continue;
+            appendField(text, stations[from].name);
+            text += ',';
+            appendField(text, stations[to].name);
+            snprintf(number, sizeof(number), ",%d,%.3f,%d,%d\n", matrix.travelTime(from, to),
+                     matrix.distance(from, to), matrix.fare(from, to, false), matrix.fare(from, to, true));
+            text += number;
+        }
+        if (fwrite(text.data(), 1, text.size(), output) != text.size())
+            return false;
+        text.clear();
+    }
+    return fflush(output) == 0;
+}
+
+int main(int argc, char *argv[])
+{
+    string inputFile, outputFile, snapshotFile, exportPrefix;
+    vector<string> paths;
+    BatchRouter::Format format = BatchRouter::Csv;
+    bool holiday = false, matrix = false;
+    int threads = 0;
+    int generate = 0;
+    int departure = -1;
+    int headway = Timetable::DefaultHeadwayMinutes;
+    string index = "auto";
+    NetworkGenerator generator;
+    FareTable fares;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "-h" || argument == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        else if ((argument == "-i" || argument == "--input") && hasValue)
+            inputFile = argv[++i];
+        else if ((argument == "-o" || argument == "--output") && hasValue)
+            outputFile = argv[++i];
+        else if ((argument == "-t" || argument == "--threads") && hasValue)
+            threads = atoi(argv[++i]);
+        else if (argument == "--snapshot" && hasValue)
+            snapshotFile = argv[++i];
+        else if (argument == "--generate" && hasValue)
+            generate = atoi(argv[++i]);
+        else if (argument == "--lines" && hasValue)
+            generator.setLineCount(atoi(argv[++i]));
+        else if (argument == "--density" && hasValue)
+            generator.setInterchangeDensity(atof(argv[++i]));
+        else if (argument == "--seed" && hasValue)
+            generator.setSeed(static_cast<uint32_t>(strtoul(argv[++i], nullptr, 10)));
+        else if (argument == "--export" && hasValue)
+            exportPrefix = argv[++i];
+        else if (argument == "--index" && hasValue)
+        {
+            index = argv[++i];
+            if (index != "auto" && index != "table" && index != "hierarchy" && index != "landmarks" && index != "none")
+            {
+                fprintf(stderr, "Unknown index: %s\n", index.c_str());
+                return 2;
+            }
+        }
+        else if (argument == "--depart" && hasValue)
+        {
+            if (!parseTimeOfDay(argv[++i], departure))
+            {
+                fprintf(stderr, "Invalid time: %s\n", argv[i]);
+                return 2;
+            }
+        }
+        else if (argument == "--headway" && hasValue)
+            headway = atoi(argv[++i]);
+        else if (argument == "--layout" && hasValue)
+        {
+            string value = argv[++i];
+            if (value == "radial")
+                generator.setLayout(NetworkGenerator::Radial);
+            else if (value == "grid")
+                generator.setLayout(NetworkGenerator::Grid);
+            else
+            {
+                fprintf(stderr, "Unknown layout: %s\n", value.c_str());
+                return 2;
+            }
+        }
+        else if (argument == "--holiday")
+            holiday = true;
+        else if (argument == "--fares" && hasValue)
+        {
+            if (!fares.load(argv[++i]))
+            {
+                fprintf(stderr, "%s\n", fares.errorString().c_str());
+                return 1;
+            }
+        }
+        else if (argument == "--matrix")
+            matrix = true;
+        else if ((argument == "-f" || argument == "--format") && hasValue)
+        {
+            string value = argv[++i];
+            if (value == "csv")
+                format = BatchRouter::Csv;
+            else if (value == "json")
+                format = BatchRouter::JsonLines;
+            else if (value == "directions")
+                format = BatchRouter::Directions;
+            else
+            {
+                fprintf(stderr, "Unknown format: %s\n", value.c_str());
+                return 2;
+            }
+        }
+        else if (!argument.empty() && argument[0] == '-')
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", argument.c_str());
+            printUsage();
+            return 2;
+        }
+        else
+            paths.push_back(argument);
+    }
+
+    /* A snapshot is only reused for the network requested now */
+    string inputs = "builtin";
+    if (generate > 0)
+    {
+        generator.setStationCount(generate);
+        inputs = "generated " + generator.settings();
+    }
+    else if (!paths.empty())
+    {
+        inputs = "files";
+        for (const string &path : paths)
+            inputs += '\n' + path;
+    }
+
+    /* Build the network and its index unless a current snapshot has them */
+    RoutePlanner planner;
+    vector<ScheduledTrip> trips;
+    bool timetabled = departure >= 0 && generate == 0 && paths.size() == 1;
+    if (!exportPrefix.empty() || snapshotFile.empty() || !planner.loadSnapshot(snapshotFile, inputs))
+    {
+        vector<Station> stations;
+        vector<vector<Edge>> graph;
+        NetworkLoader loader;
+        if (generate > 0)
+            generator.generate(stations, graph);
+        else if (paths.empty())
+            initializeMetroNetwork(stations, graph);
+        else if (!loader.load(paths, stations, graph, timetabled ? &trips : nullptr))
+        {
+            fprintf(stderr, "Cannot load network: %s\n", loader.errorString().c_str());
+            return 1;
+        }
+
+        if (!exportPrefix.empty())
+        {
+            if (!loader.saveCsv(exportPrefix + "_stations.csv", exportPrefix + "_edges.csv", stations, graph))
+            {
+                fprintf(stderr, "%s\n", loader.errorString().c_str());
+                return 1;
+            }
+            return 0;
+        }
+
+        MetroNetwork network;
+        buildMetroNetwork(stations, graph, network);
+        planner.setNetwork(network);
+        if (index == "auto")
+            index = planner.network().graph.nodeCount() <= RoutePlanner::DefaultAllPairsLimit ? "table" : "hierarchy";
+        if (index == "table")
+            planner.enableAllPairs(threads);
+        else if (index == "hierarchy")
+            planner.enableContractionHierarchy(threads);
+        else if (index == "landmarks" && !planner.enableLandmarks(LandmarkTable::DefaultLandmarkCount, threads))
+            fputs("Cannot build landmark tables, falling back to plain searches\n", stderr);
+
+        if (!snapshotFile.empty() && !planner.saveSnapshot(snapshotFile, inputs, loader.sourceFiles()))
+            fprintf(stderr, "Cannot write snapshot %s\n", snapshotFile.c_str());
+    }
+
+    /* A snapshot holds no trips; the feed it was built from still numbers its nodes the same way */
+    Timetable timetable;
+    if (departure >= 0)
+    {
+        if (timetabled && trips.empty())
+        {
+            vector<Station> stations;
+            vector<vector<Edge>> graph;
+            NetworkLoader loader;
+            if (!loader.loadGtfs(paths[0], stations, graph, &trips))
+            {
+                fprintf(stderr, "Cannot load timetable: %s\n", loader.errorString().c_str());
+                return 1;
+            }
+        }
+
+        bool built = timetabled ? timetable.build(planner.network(), trips)
+                                : timetable.generate(planner.network(), ServiceStart, ServiceEnd, headway * 60);
+        if (!built)
+        {
+            fputs("The network has no train services to route by\n", stderr);
+            return 1;
+        }
+    }
+
+    FILE *input = stdin;
+    FILE *output = stdout;
+    if (!inputFile.empty() && !(input = fopen(inputFile.c_str(), "rb")))
+    {
+        fprintf(stderr, "Cannot open %s\n", inputFile.c_str());
+        return 1;
+    }
+    if (!outputFile.empty() && !(output = fopen(outputFile.c_str(), "wb")))
+    {
+        fprintf(stderr, "Cannot create %s\n", outputFile.c_str());
+        return 1;
+    }
+
+    if (matrix)
+    {
+        OdMatrix od;
+        od.setThreadCount(threads);
+        if (!od.setFareTable(&fares))
+        {
+            fprintf(stderr, "Fares above %d do not fit the matrix\n", OdMatrix::MaxFare);
+            return 1;
+        }
+        od.setProgressCallback([](int completed, int total) {
+            fprintf(stderr, "\r%d of %d origins", completed, total);
+            return true;
+        });
+        od.compute(planner.network());
+        fputc('\n', stderr);
+
+        bool ok = writeMatrix(od, planner.network(), output);
+        if (input != stdin)
+            fclose(input);
+        if (output != stdout && fclose(output) != 0)
+            ok = false;
+        if (!ok)
+        {
+            fprintf(stderr, "Cannot write the results\n");
+            return 1;
+        }
+        return 0;
+    }
+
+    BatchRouter router(planner);
+    router.setFormat(format);
+    router.setHoliday(holiday);
+    router.setFareTable(&fares);
+    router.setThreadCount(threads);
+    if (timetable.isBuilt())
+        router.setTimetable(&timetable, departure);
+    bool ok = router.run(input, output);
+
+    if (input != stdin)
+        fclose(input);
+    if (output != stdout && fclose(output) != 0)
+        ok = false;
+    if (!ok)
+    {
+        fprintf(stderr, "%s\n", router.errorString().empty() ? "Cannot write the results" : router.errorString().c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,13 @@
+TARGET = MetroBatch
+TEMPLATE = app
+CONFIG += console
+CONFIG -= qt app_bundle
+
+include(MetroCore.pri)
+
+SOURCES += \
+    MetroBatch.cpp \
+    BatchRouter.cpp
+
+HEADERS += \
+    BatchRouter.h
@@ -0,0 +1,674 @@
+#include "AStarSearch.h"
+#include "ConnectionScan.h"
+#include "FareTable.h"
+#include "LandmarkTable.h"
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include "NetworkGenerator.h"
+#include "Raptor.h"
+#include "RouteCalculator.h"
+#include "RouteEngine.h"
+#include "RouteRenderer.h"
+#include "RoutePlanner.h"
+#include "Timetable.h"
+#include "Visualization.h"
+#include <QString>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/* Every allocation of the process is counted, so a benchmark can report allocations per operation */
+static atomic<uint64_t> allocationCount(0);
+static atomic<uint64_t> allocationBytes(0);
+
+#if defined(__GLIBC__)
+/*
+ * With glibc the C allocator itself is wrapped, so memory Qt and other C code
+ * take with malloc() and realloc() is counted as well as operator new, which
+ * allocates through malloc().
+ */
+static const char *const AllocationsCounted = "malloc";
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *memory, size_t size);
+extern "C" void __libc_free(void *memory);
+
+extern "C" void *malloc(size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocationBytes.fetch_add(size, memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocationBytes.fetch_add(count * size, memory_order_relaxed);
+    return __libc_calloc(count, size);
+}
+
+/* A resize counts as one allocation of the new size */
+extern "C" void *realloc(void *memory, size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocationBytes.fetch_add(size, memory_order_relaxed);
+    return __libc_realloc(memory, size);
+}
+
+extern "C" void free(void *memory)
+{
+    __libc_free(memory);
+}
+#else
+/* Elsewhere only operator new is counted; allocations of C code such as Qt's containers are missed */
+static const char *const AllocationsCounted = "operator new";
+
+void *operator new(size_t size)
+{
+    allocationCount.fetch_add(1, memory_order_relaxed);
+    allocationBytes.fetch_add(size, memory_order_relaxed);
+    if (void *memory = malloc(size ? size : 1))
+        return memory;
+    throw bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+void operator delete[](void *memory, size_t) noexcept
+{
+    free(memory);
+}
+#endif
+
+namespace
+{
+/* Results are folded into this so the compiler cannot drop the measured work */
+volatile uint64_t sink;
+
+struct Result
+{
+    string name;
+    string network;
+    int stations;
+    int samples;
+    int opsPerSample;
+    double meanNs;
+    double p50Ns;
+    double p90Ns;
+    double p99Ns;
+    double allocationsPerOp;
+    double bytesPerOp;
+};
+
+struct Options
+{
+    double minSeconds = 0.2;
+    int maxSamples = 100000;
+    string filter;
+    FILE *table = stdout; /**< Receives the human-readable results */
+};
+
+/* Network under test with query pairs and precomputed search results */
+struct Workload
+{
+    string name;
+    vector<Station> stations;
+    vector<vector<Edge>> graph;
+    CsrGraph csr;
+    MetroNetwork network;
+    RoutePlanner planner;
+    vector<pair<int, int>> pairs;     /**< Random node pairs, reachable from each other */
+    vector<vector<int>> previous;     /**< Search tree of the first node of every pair */
+    vector<vector<int>> paths;        /**< Node path of every pair */
+    vector<RouteResult> routes;       /**< Canonical route of every pair */
+};
+
+/*
+ * Run op(i) in samples of opsPerSample calls until both the time budget and
+ * a minimum sample count are reached. Percentiles are over per-sample
+ * averages, so cheap operations are batched to stay above timer resolution.
+ */
+template <typename Op>
+Result measure(const Options &options, const string &name, const Workload &workload, int opsPerSample, Op op)
+{
+    typedef chrono::steady_clock Clock;
+    for (int i = 0; i < opsPerSample; ++i)
+        op(i);
+
+    vector<double> samples;
+    uint64_t allocationsBefore = allocationCount.load();
+    uint64_t bytesBefore = allocationBytes.load();
+    Clock::time_point start = Clock::now();
+    int index = 0;
+    for (;;)
+    {
+        Clock::time_point sampleStart = Clock::now();
+        for (int i = 0; i < opsPerSample; ++i)
+            op(index++);
+        Clock::time_point sampleEnd = Clock::now();
+        samples.push_back(chrono::duration<double, nano>(sampleEnd - sampleStart).count() / opsPerSample);
+
+        double elapsed = chrono::duration<double>(sampleEnd - start).count();
+        if ((elapsed >= options.minSeconds && samples.size() >= 5) || static_cast<int>(samples.size()) >= options.maxSamples)
+            break;
+    }
+    /* The sample vector itself allocates while growing; those few calls are not worth excluding */
+    uint64_t allocations = allocationCount.load() - allocationsBefore;
+    uint64_t bytes = allocationBytes.load() - bytesBefore;
+
+    Result result;
+    result.name = name;
+    result.network = workload.name;
+    result.stations = static_cast<int>(workload.network.stations.size());
+    result.samples = static_cast<int>(samples.size());
+    result.opsPerSample = opsPerSample;
+
+    double total = 0;
+    for (double sample : samples)
+        total += sample;
+    result.meanNs = total / samples.size();
+
+    sort(samples.begin(), samples.end());
+    auto percentile = [&](double p) { return samples[min(samples.size() - 1, static_cast<size_t>(p * samples.size()))]; };
+    result.p50Ns = percentile(0.50);
+    result.p90Ns = percentile(0.90);
+    result.p99Ns = percentile(0.99);
+
+    double ops = static_cast<double>(samples.size()) * opsPerSample;
+    result.allocationsPerOp = allocations / ops;
+    result.bytesPerOp = bytes / ops;
+    return result;
+}
+
+/* Minutes of the ride between two neighbouring stations, leaving the station state or a platform; -1 if none */
+int rideMinutes(const MetroNetwork &network, int from, int to)
+{
+    const CsrGraph &graph = network.graph;
+    vector<int> tails(1, from);
+    for (int arc = graph.arcBegin(from); arc < graph.arcEnd(from); ++arc)
+    {
+        if (network.stateStation[graph.target(arc)] == from)
+            tails.push_back(graph.target(arc));
+    }
+    for (int tail : tails)
+    {
+        for (int arc = graph.arcBegin(tail); arc < graph.arcEnd(tail); ++arc)
+        {
+            if (network.stateStation[graph.target(arc)] == to)
+                return graph.minutes(arc);
+        }
+    }
+    return -1;
+}
+
+void prepare(Workload &workload, int pairCount)
+{
+    workload.csr = CsrGraph(workload.graph);
+    buildMetroNetwork(workload.stations, workload.graph, workload.network);
+    workload.planner.setNetwork(workload.network);
+    if (workload.network.graph.nodeCount() <= RoutePlanner::DefaultAllPairsLimit)
+        workload.planner.enableAllPairs();
+    else
+        workload.planner.enableContractionHierarchy();
+
+    /* Fixed seed so every run and every release measures the same queries */
+    mt19937 random(12345);
+    int nodes = static_cast<int>(workload.stations.size());
+    BucketDijkstra engine;
+    vector<int> distances, previous;
+    while (static_cast<int>(workload.pairs.size()) < pairCount)
+    {
+        int from = random() % nodes;
+        int to = random() % nodes;
+        engine.run(from, workload.csr, distances, previous);
+        if (distances[to] == INT_MAX || from == to)
+            continue;
+
+        RouteResult route;
+        if (!workload.planner.findRoute(workload.network.nodeStation[from], workload.network.nodeStation[to], route))
+            continue;
+
+        workload.pairs.push_back(make_pair(from, to));
+        workload.previous.push_back(previous);
+        workload.paths.push_back(reconstructPath(from, to, previous, workload.stations));
+        workload.routes.push_back(route);
+    }
+}
+
+void run(const Options &options, const Workload &workload, vector<Result> &results)
+{
+    auto enabled = [&](const string &name) { return options.filter.empty() || name.find(options.filter) != string::npos; };
+    auto report = [&](const Result &result) {
+        fprintf(options.table, "%-26s %-12s %11.0f ns/op  p50 %11.0f  p90 %11.0f  p99 %11.0f  %8.2f allocs/op  %9.0f B/op\n",
+                result.name.c_str(), result.network.c_str(), result.meanNs, result.p50Ns, result.p90Ns,
+                result.p99Ns, result.allocationsPerOp, result.bytesPerOp);
+        fflush(options.table);
+        results.push_back(result);
+    };
+
+    const size_t count = workload.pairs.size();
+    vector<int> distances, previous;
+
+    if (enabled("dijkstra"))
+    {
+        report(measure(options, "dijkstra", workload, 1, [&](int i) {
+            dijkstra(workload.pairs[i % count].first, workload.graph, distances, previous);
+            sink += distances[workload.pairs[i % count].second];
+        }));
+    }
+    if (enabled("dijkstra_csr"))
+    {
+        report(measure(options, "dijkstra_csr", workload, 1, [&](int i) {
+            dijkstra(workload.pairs[i % count].first, workload.csr, distances, previous);
+            sink += distances[workload.pairs[i % count].second];
+        }));
+    }
+    if (enabled("engine_binary_heap"))
+    {
+        BinaryHeapDijkstra engine;
+        report(measure(options, "engine_binary_heap", workload, 1, [&](int i) {
+            engine.run(workload.pairs[i % count].first, workload.csr, distances, previous);
+            sink += distances[workload.pairs[i % count].second];
+        }));
+    }
+    if (enabled("engine_quaternary_heap"))
+    {
+        QuaternaryHeapDijkstra engine;
+        report(measure(options, "engine_quaternary_heap", workload, 1, [&](int i) {
+            engine.run(workload.pairs[i % count].first, workload.csr, distances, previous);
+            sink += distances[workload.pairs[i % count].second];
+        }));
+    }
+    if (enabled("engine_bucket"))
+    {
+        BucketDijkstra engine;
+        report(measure(options, "engine_bucket", workload, 1, [&](int i) {
+            engine.run(workload.pairs[i % count].first, workload.csr, distances, previous);
+            sink += distances[workload.pairs[i % count].second];
+        }));
+    }
+    if (enabled("engine_point_to_point"))
+    {
+        BucketPointToPoint engine;
+        vector<int> path;
+        report(measure(options, "engine_point_to_point", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            sink += engine.findRoute(query.first, query.second, workload.csr, path);
+        }));
+    }
+    if (enabled("engine_bidirectional"))
+    {
+        BucketPointToPoint engine;
+        CsrGraph reverse = workload.csr.reversed();
+        vector<int> path;
+        report(measure(options, "engine_bidirectional", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            sink += engine.findRoute(query.first, query.second, workload.csr, reverse, path);
+        }));
+    }
+    if (enabled("astar_geometric"))
+    {
+        BucketAStar engine;
+        GeometricHeuristic heuristic(workload.csr, workload.stations);
+        vector<int> path;
+        report(measure(options, "astar_geometric", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            sink += engine.findRoute(query.first, query.second, workload.csr, heuristic, path);
+        }));
+    }
+    if (enabled("astar_landmarks"))
+    {
+        BucketAStar engine;
+        LandmarkTable landmarks;
+        landmarks.build(workload.csr);
+        vector<int> path;
+        report(measure(options, "astar_landmarks", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            sink += engine.findRoute(query.first, query.second, workload.csr, landmarks, path);
+        }));
+    }
+    if (enabled("reconstructPath"))
+    {
+        report(measure(options, "reconstructPath", workload, 16, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            sink += reconstructPath(query.first, query.second, workload.previous[i % count], workload.stations).size();
+        }));
+    }
+    if (enabled("calculatePathDistance"))
+    {
+        report(measure(options, "calculatePathDistance", workload, 16, [&](int i) {
+            sink += static_cast<uint64_t>(calculatePathDistance(workload.paths[i % count], workload.graph));
+        }));
+    }
+    if (enabled("calculatePathDistance_csr"))
+    {
+        report(measure(options, "calculatePathDistance_csr", workload, 16, [&](int i) {
+            sink += static_cast<uint64_t>(calculatePathDistance(workload.paths[i % count], workload.csr));
+        }));
+    }
+    if (enabled("calculateFare"))
+    {
+        report(measure(options, "calculateFare", workload, 1024, [&](int i) {
+            sink += calculateFare(workload.routes[i % count].distance, (i & 1) != 0);
+        }));
+    }
+    if (enabled("fare_table"))
+    {
+        const FareTable &fares = FareTable::defaultTable();
+        report(measure(options, "fare_table", workload, 1024, [&](int i) {
+            sink += fares.fare(workload.routes[i % count].distance, i & 1, (i & 2) != 0);
+        }));
+    }
+    if (enabled("fare_table_batch"))
+    {
+        /* One operation charges a block of route lengths, as an OD matrix row would */
+        const FareTable &fares = FareTable::defaultTable();
+        const size_t blockSize = 1024;
+        vector<uint32_t> metres(2 * blockSize);
+        for (size_t i = 0; i < metres.size(); ++i)
+            metres[i] = static_cast<uint32_t>(lround(workload.routes[i % count].distance * 1000));
+        vector<int32_t> charged(blockSize);
+        report(measure(options, "fare_table_batch", workload, 16, [&](int i) {
+            size_t offset = static_cast<size_t>(i) * 61 % (metres.size() - blockSize);
+            fares.fares(metres.data() + offset, blockSize, i & 1, (i & 2) != 0, charged.data());
+            sink += charged[i % blockSize];
+        }));
+    }
+    /* Station and line fragments are built once per network, as the application and MetroBatch do */
+    RouteRenderer renderer(workload.network);
+    if (enabled("getRouteHTML"))
+    {
+        report(measure(options, "getRouteHTML", workload, 4, [&](int i) {
+            const RouteResult &route = workload.routes[i % count];
+            QString html = getRouteHTML(route, renderer, FareTable::defaultTable(), (i & 1) != 0, (i & 2) != 0);
+            sink += html.size();
+        }));
+    }
+    const RouteRenderer::Format formats[] = {RouteRenderer::Html, RouteRenderer::Text, RouteRenderer::Json};
+    const char *formatNames[] = {"render_html", "render_text", "render_json"};
+    for (int f = 0; f < RouteRenderer::FormatCount; ++f)
+    {
+        if (!enabled(formatNames[f]))
+            continue;
+        string output;
+        report(measure(options, formatNames[f], workload, 16, [&](int i) {
+            output.clear();
+            renderer.render(workload.routes[i % count], FareTable::defaultTable(), (i & 1) != 0, (i & 2) != 0, formats[f],
+                            output);
+            sink += output.size();
+        }));
+    }
+    if (enabled("planner_findRoute"))
+    {
+        RoutePlanner planner(workload.planner);
+        RouteResult route;
+        report(measure(options, "planner_findRoute", workload, 16, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            planner.findRoute(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second], route);
+            sink += route.travelTime;
+        }));
+    }
+    /* Trains every 5 minutes from 05:00 to midnight, generated once for all timetable benchmarks */
+    Timetable timetable;
+    auto service = [&]() -> const Timetable & {
+        if (!timetable.isBuilt())
+            timetable.generate(workload.network, 5 * 3600, 24 * 3600);
+        return timetable;
+    };
+    if (enabled("connection_scan"))
+    {
+        ConnectionScan scan(service());
+        Journey journey;
+        report(measure(options, "connection_scan", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            scan.findJourney(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second],
+                             8 * 3600, journey);
+            sink += journey.arrival;
+        }));
+    }
+    if (enabled("connection_scan_profile"))
+    {
+        ConnectionScan scan(service());
+        vector<Journey> journeys;
+        report(measure(options, "connection_scan_profile", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            scan.findProfile(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second],
+                             8 * 3600, 9 * 3600, journeys);
+            sink += journeys.size();
+        }));
+    }
+    if (enabled("raptor_pareto"))
+    {
+        RaptorRoutes routes;
+        routes.build(service());
+        RaptorQuery raptor(routes);
+        vector<Journey> journeys;
+        report(measure(options, "raptor_pareto", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            raptor.findJourneys(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second],
+                                8 * 3600, false, journeys);
+            sink += journeys.size();
+        }));
+    }
+    if (enabled("planner_alternatives"))
+    {
+        RoutePlanner planner(workload.planner);
+        vector<RouteResult> alternatives;
+        report(measure(options, "planner_alternatives", workload, 1, [&](int i) {
+            const pair<int, int> &query = workload.pairs[i % count];
+            planner.findAlternatives(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second],
+                                     KShortestPaths::DefaultPathCount, alternatives);
+            sink += alternatives.size();
+        }));
+    }
+    if (enabled("planner_segment_delay"))
+    {
+        /* Delay and restore a segment of a cached route, repairing a warm cache of every pair and a few trees */
+        RoutePlanner planner(workload.planner);
+        planner.setCacheCapacity(count, 4);
+        RouteResult route;
+        for (size_t i = 0; i < count; ++i)
+        {
+            const pair<int, int> &query = workload.pairs[i];
+            planner.findRoute(workload.network.nodeStation[query.first], workload.network.nodeStation[query.second], route);
+        }
+
+        /* The middle ride of every route with one, timed before the delay so it can be restored */
+        struct Segment
+        {
+            int from;
+            int to;
+            int minutes;
+        };
+        vector<Segment> segments;
+        for (const RouteResult &cached : workload.routes)
+        {
+            const vector<int> &path = cached.path;
+            if (path.size() < 2)
+                continue;
+            Segment segment = {path[path.size() / 2 - 1], path[path.size() / 2], 0};
+            segment.minutes = rideMinutes(workload.network, segment.from, segment.to);
+            if (segment.minutes >= 0)
+                segments.push_back(segment);
+        }
+
+        vector<RouteChange> changes;
+        if (!segments.empty())
+        {
+            report(measure(options, "planner_segment_delay", workload, 1, [&](int i) {
+                const Segment &segment = segments[i % segments.size()];
+                planner.setSegmentMinutes(segment.from, segment.to, segment.minutes + 5, &changes);
+                sink += changes.size();
+                planner.setSegmentMinutes(segment.from, segment.to, segment.minutes, &changes);
+                sink += changes.size();
+            }));
+        }
+    }
+}
+
+/* Escape a string for a JSON literal; names here are plain ASCII */
+string jsonString(const string &value)
+{
+    string out = "\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+            out += '\\';
+        out += c;
+    }
+    return out + "\"";
+}
+
+bool writeJson(const string &fileName, const vector<Result> &results)
+{
+    FILE *file = fileName == "-" ? stdout : fopen(fileName.c_str(), "w");
+    if (!file)
+        return false;
+
+    fprintf(file, "{\n  \"version\": 1,\n  \"allocations_counted\": %s,\n  \"results\": [\n",
+            jsonString(AllocationsCounted).c_str());
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const Result &r = results[i];
+        fprintf(file,
+                "    {\"name\": %s, \"network\": %s, \"stations\": %d, \"samples\": %d, \"ops_per_sample\": %d, "
+                "\"ns_per_op\": %.1f, \"p50_ns\": %.1f, \"p90_ns\": %.1f, \"p99_ns\": %.1f, "
+                "\"allocs_per_op\": %.3f, \"bytes_per_op\": %.1f}%s\n",
+                jsonString(r.name).c_str(), jsonString(r.network).c_str(), r.stations, r.samples, r.opsPerSample,
+                r.meanNs, r.p50Ns, r.p90Ns, r.p99Ns, r.allocationsPerOp, r.bytesPerOp,
+                i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    bool ok = !ferror(file);
+    if (file != stdout)
+        ok = fclose(file) == 0 && ok;
+    return ok;
+}
+
+void printUsage()
+{
+    fputs("Usage: MetroBench [options]\n"
+          "\n"
+          "Benchmarks routing, path, fare and rendering functions on the built-in\n"
+          "Delhi Metro network and on generated synthetic networks.\n"
+          "\n"
+          "Options:\n"
+          "  --sizes N,N,...    Synthetic network sizes in stations (default 1000,10000)\n"
+          "  --layout LAYOUT    radial (default) or grid synthetic networks\n"
+          "  --filter TEXT      Only run benchmarks whose name contains TEXT\n"
+          "  --min-time SEC     Minimum time per benchmark (default 0.2)\n"
+          "  --json FILE        Write results as JSON to FILE, - for standard output\n"
+          "  -h, --help         Show this help\n",
+          stdout);
+}
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    vector<int> sizes = {1000, 10000};
+    NetworkGenerator::Layout layout = NetworkGenerator::Radial;
+    string jsonFile;
+
+    for (int i = 1; i < argc; i++)
+    {
+        string argument = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (argument == "-h" || argument == "--help")
+        {
+            printUsage();
+            return 0;
+        }
+        else if (argument == "--sizes" && hasValue)
+        {
+            sizes.clear();
+            string list = argv[++i];
+            for (size_t start = 0; start <= list.size();)
+            {
+                size_t end = list.find(',', start);
+                if (end == string::npos)
+                    end = list.size();
+                int size = atoi(list.substr(start, end - start).c_str());
+                if (size > 0)
+                    sizes.push_back(size);
+                start = end + 1;
+            }
+        }
+        else if (argument == "--layout" && hasValue && (string(argv[i + 1]) == "radial" || string(argv[i + 1]) == "grid"))
+            layout = string(argv[++i]) == "grid" ? NetworkGenerator::Grid : NetworkGenerator::Radial;
+        else if (argument == "--filter" && hasValue)
+            options.filter = argv[++i];
+        else if (argument == "--min-time" && hasValue)
+            options.minSeconds = atof(argv[++i]);
+        else if (argument == "--json" && hasValue)
+            jsonFile = argv[++i];
+        else
+        {
+            fprintf(stderr, "Unknown or incomplete option: %s\n", argument.c_str());
+            printUsage();
+            return 2;
+        }
+    }
+
+    /* With JSON on standard output the table goes to standard error */
+    if (jsonFile == "-")
+        options.table = stderr;
+    fprintf(options.table, "Allocations counted through %s\n", AllocationsCounted);
+
+    vector<Result> results;
+    {
+        Workload delhi;
+        delhi.name = "delhi";
+        initializeMetroNetwork(delhi.stations, delhi.graph);
+        prepare(delhi, 64);
+        run(options, delhi, results);
+    }
+    for (int size : sizes)
+    {
+        NetworkGenerator generator;
+        generator.setStationCount(size);
+        generator.setLayout(layout);
+
+        Workload synthetic;
+        synthetic.name = (layout == NetworkGenerator::Grid ? "grid-" : "radial-") + to_string(size);
+        generator.generate(synthetic.stations, synthetic.graph);
+        prepare(synthetic, 64);
+        run(options, synthetic, results);
+    }
+
+    if (!jsonFile.empty() && !writeJson(jsonFile, results))
+    {
+        fprintf(stderr, "Cannot write %s\n", jsonFile.c_str());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+QT = core
+TARGET = MetroBench
+TEMPLATE = app
+CONFIG += console
+CONFIG -= app_bundle
+
+include(MetroCore.pri)
+
+# getRouteHTML() is benchmarked too; it needs only QString from Qt Core
+SOURCES += \
+    MetroBench.cpp \
+    Visualization.cpp
+
+HEADERS += \
+    Visualization.h
@@ -0,0 +1,57 @@
+# Routing core shared by the application and the command line tools.
+# Plain C++ without Qt, so console targets can drop the Qt libraries.
+CONFIG += c++11 thread
+
+# Targets share the source directory, keep their object files apart
+OBJECTS_DIR = build/$$TARGET
+MOC_DIR = build/$$TARGET
+
+SOURCES += \
+    MetroData.cpp \
+    MetroNetwork.cpp \
+    MappedFile.cpp \
+    NetworkLoader.cpp \
+    NetworkGenerator.cpp \
+    NetworkSnapshot.cpp \
+    RouteCalculator.cpp \
+    FareTable.cpp \
+    RouteRenderer.cpp \
+    CsrGraph.cpp \
+    AllPairsRouteTable.cpp \
+    ContractionHierarchy.cpp \
+    LandmarkTable.cpp \
+    AStarSearch.cpp \
+    KShortestPaths.cpp \
+    ShortestPathRepair.cpp \
+    Timetable.cpp \
+    ConnectionScan.cpp \
+    Raptor.cpp \
+    RoutePlanner.cpp \
+    OdMatrix.cpp
+
+HEADERS += \
+    MetroData.h \
+    MetroNetwork.h \
+    MappedFile.h \
+    NetworkLoader.h \
+    NetworkGenerator.h \
+    NetworkSnapshot.h \
+    RouteCalculator.h \
+    FareTable.h \
+    RouteRenderer.h \
+    RouteEngine.h \
+    CsrGraph.h \
+    FlatArray.h \
+    AllPairsRouteTable.h \
+    ContractionHierarchy.h \
+    LandmarkTable.h \
+    AStarSearch.h \
+    KShortestPaths.h \
+    ShortestPathRepair.h \
+    Timetable.h \
+    ConnectionScan.h \
+    Raptor.h \
+    RoutePlanner.h \
+    LruCache.h \
+    OdMatrix.h \
+    PriorityQueues.h
@@ -23,50 +23,50 @@ vector<string> splitLines(const string &lines)
 
 void initializeMetroNetwork(vector<Station> &stations, vector<vector<Edge>> &graph)
 {
-    /* Define Delhi Metro stations with default visualization coordinates */
+    /* Define Delhi Metro stations with their map coordinates */
     stations = {
         /* Blue Line (Major stations) */
-        {0, "Dwarka Sec-21", "Blue", 0.0, 0.0},
-        {1, "Janakpuri West", "Blue/Magenta", 0.0, 0.0},
-        {2, "Rajouri Garden", "Blue/Pink", 0.0, 0.0},
-        {3, "Rajiv Chowk", "Blue/Yellow", 0.0, 0.0},
-        {4, "Mandi House", "Blue/Violet", 0.0, 0.0},
-        {5, "Yamuna Bank", "Blue", 0.0, 0.0},
-        {6, "Mayur Vihar Phase-1", "Blue/Pink", 0.0, 0.0},
-        {7, "Noida City Centre", "Blue", 0.0, 0.0},
-        {8, "Vaishali", "Blue", 0.0, 0.0},
+        {0, "Dwarka Sec-21", "Blue", 50.0, 300.0},
+        {1, "Janakpuri West", "Blue/Magenta", 150.0, 300.0},
+        {2, "Rajouri Garden", "Blue/Pink", 250.0, 300.0},
+        {3, "Rajiv Chowk", "Blue/Yellow", 400.0, 300.0},
+        {4, "Mandi House", "Blue/Violet", 500.0, 300.0},
+        {5, "Yamuna Bank", "Blue", 600.0, 300.0},
+        {6, "Mayur Vihar Phase-1", "Blue/Pink", 700.0, 300.0},
+        {7, "Noida City Centre", "Blue", 820.0, 300.0},
+        {8, "Vaishali", "Blue", 850.0, 250.0},
 
         /* Yellow Line (Major stations) */
-        {9, "Samaypur Badli", "Yellow", 0.0, 0.0},
-        {10, "Azadpur", "Yellow/Pink", 0.0, 0.0},
-        {11, "Kashmere Gate", "Yellow/Red/Violet", 0.0, 0.0},
-        {12, "Chandni Chowk", "Yellow", 0.0, 0.0},
-        {13, "Rajiv Chowk", "Yellow/Blue", 0.0, 0.0},
-        {14, "Central Secretariat", "Yellow/Violet", 0.0, 0.0},
-        {15, "INA", "Yellow/Pink", 0.0, 0.0},
-        {16, "AIIMS", "Yellow", 0.0, 0.0},
-        {17, "Hauz Khas", "Yellow/Magenta", 0.0, 0.0},
-        {18, "HUDA City Centre", "Yellow", 0.0, 0.0},
+        {9, "Samaypur Badli", "Yellow", 400.0, 50.0},
+        {10, "Azadpur", "Yellow/Pink", 400.0, 100.0},
+        {11, "Kashmere Gate", "Yellow/Red/Violet", 400.0, 150.0},
+        {12, "Chandni Chowk", "Yellow", 400.0, 200.0},
+        {13, "Rajiv Chowk", "Yellow/Blue", 400.0, 300.0},
+        {14, "Central Secretariat", "Yellow/Violet", 400.0, 400.0},
+        {15, "INA", "Yellow/Pink", 400.0, 440.0},
+        {16, "AIIMS", "Yellow", 400.0, 480.0},
+        {17, "Hauz Khas", "Yellow/Magenta", 400.0, 520.0},
+        {18, "HUDA City Centre", "Yellow", 400.0, 600.0},
 
         /* Red Line (Major stations) */
-        {19, "Rithala", "Red", 0.0, 0.0},
-        {20, "Netaji Subhash Place", "Red/Pink", 0.0, 0.0},
-        {21, "Kashmere Gate", "Red/Yellow/Violet", 0.0, 0.0},
-        {22, "Welcome", "Red/Pink", 0.0, 0.0},
+        {19, "Rithala", "Red", 220.0, 150.0},
+        {20, "Netaji Subhash Place", "Red/Pink", 300.0, 150.0},
+        {21, "Kashmere Gate", "Red/Yellow/Violet", 400.0, 150.0},
+        {22, "Welcome", "Red/Pink", 500.0, 150.0},
 
         /* Pink Line (Major stations) */
-        {23, "Majlis Park", "Pink", 0.0, 0.0},
-        {24, "Azadpur", "Pink/Yellow", 0.0, 0.0},
-        {25, "Netaji Subhash Place", "Pink/Red", 0.0, 0.0},
-        {26, "Rajouri Garden", "Pink/Blue", 0.0, 0.0},
-        {27, "INA", "Pink/Yellow", 0.0, 0.0},
-        {28, "Mayur Vihar Phase-1", "Pink/Blue", 0.0, 0.0},
+        {23, "Majlis Park", "Pink", 300.0, 100.0},
+        {24, "Azadpur", "Pink/Yellow", 400.0, 100.0},
+        {25, "Netaji Subhash Place", "Pink/Red", 300.0, 150.0},
+        {26, "Rajouri Garden", "Pink/Blue", 250.0, 300.0},
+        {27, "INA", "Pink/Yellow", 400.0, 440.0},
+        {28, "Mayur Vihar Phase-1", "Pink/Blue", 700.0, 300.0},
 
         /* Magenta Line (Major stations) */
-        {29, "Janakpuri West", "Magenta/Blue", 0.0, 0.0},
-        {30, "Terminal 1 IGI Airport", "Magenta", 0.0, 0.0},
-        {31, "Hauz Khas", "Magenta/Yellow", 0.0, 0.0},
-        {32, "Botanical Garden", "Magenta/Blue", 0.0, 0.0}};
+        {29, "Janakpuri West", "Magenta/Blue", 150.0, 300.0},
+        {30, "Terminal 1 IGI Airport", "Magenta", 200.0, 400.0},
+        {31, "Hauz Khas", "Magenta/Yellow", 400.0, 520.0},
+        {32, "Botanical Garden", "Magenta/Blue", 750.0, 350.0}};
 
     int n = stations.size();
     graph.resize(n);
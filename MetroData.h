@@ -32,6 +32,28 @@ struct Edge
     double distance; /**< Physical distance in kilometers */
 };
 
+/**
+ * @brief Call of a scheduled train at one station node
+ *
+ * Times are seconds after midnight of the service day and may exceed 24
+ * hours for trains running past midnight, as in GTFS.
+ */
+struct ScheduledStop
+{
+    int node;      /**< ID of the station node */
+    int arrival;   /**< Time the train arrives */
+    int departure; /**< Time the train leaves */
+};
+
+/**
+ * @brief One run of a train along its line, as read from a timetable feed
+ */
+struct ScheduledTrip
+{
+    std::string line;                 /**< Name of the line the train runs on */
+    std::vector<ScheduledStop> stops; /**< Calls in travel order */
+};
+
 /**
  * @brief Splits a string of metro lines separated by slashes
  *
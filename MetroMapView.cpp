@@ -1,126 +1,198 @@
 #include "MetroMapView.h"
+#include "MapTileCache.h"
 #include <QGraphicsScene>
-#include <QGraphicsEllipseItem>
-#include <QGraphicsLineItem>
-#include <QGraphicsTextItem>
+#include <QGraphicsPathItem>
+#include <QPainterPath>
 #include <QPen>
 #include <QBrush>
 #include <QColor>
 #include <QResizeEvent>
+#include <algorithm>
 
-MetroMapView::MetroMapView(QWidget *parent) : QGraphicsView(parent)
+namespace
+{
+/* Zoom range in tile levels from the one that fits the network: half to 64 times its scale */
+const int ZoomOutLevels = MapTileCache::LevelsPerOctave;
+const int ZoomInLevels = 6 * MapTileCache::LevelsPerOctave;
+
+/* Wheel rotation of one zoom step, in eighths of a degree */
+const int WheelStep = 120;
+}
+
+MetroMapView::MetroMapView(QWidget *parent) : QGraphicsView(parent), fitLevel(0), zoomed(false), wheelDelta(0)
 {
     setScene(new QGraphicsScene(this));
     setRenderHint(QPainter::Antialiasing);
-    setViewportUpdateMode(QGraphicsView::FullViewportUpdate);
+    setViewportUpdateMode(QGraphicsView::SmartViewportUpdate);
     setHorizontalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
     setVerticalScrollBarPolicy(Qt::ScrollBarAlwaysOff);
+    setTransformationAnchor(QGraphicsView::AnchorUnderMouse);
+    setResizeAnchor(QGraphicsView::AnchorViewCenter);
+    setDragMode(QGraphicsView::ScrollHandDrag);
     setMinimumSize(800, 600);
+
+    /* Both layers stay in the scene for the lifetime of the view */
+    networkItem = new NetworkMapItem;
+    routeLayer = new Layer;
+    routeLayer->setZValue(1);
+    scene()->addItem(networkItem);
+    scene()->addItem(routeLayer);
+
+    tiles = new MapTileCache(this);
+    networkItem->setTileCache(tiles);
+    connect(tiles, &MapTileCache::tileReady, this, [this](const QRectF &area) { networkItem->update(area); });
 }
 
-void MetroMapView::drawStation(const QString &name, double x, double y, const QString &line)
+MetroMapView::~MetroMapView()
 {
-    QColor color;
-    if (line.contains("Blue"))
-        color = QColor(0x4169E1);
-    else if (line.contains("Yellow"))
-        color = QColor(0xFFDF00);
-    else if (line.contains("Red"))
-        color = QColor(0xFF4040);
-    else if (line.contains("Pink"))
-        color = QColor(0xFC8EAC);
-    else if (line.contains("Magenta"))
-        color = QColor(0xCC338B);
-    else if (line.contains("Violet"))
-        color = QColor(0x8b5cf6);
-
-    scene()->addEllipse(x - 5, y - 5, 10, 10,
-                        QPen(color, 2), QBrush(Qt::white));
-
-    auto *text = scene()->addText(name);
-    text->setDefaultTextColor(QColor(0xffffff));
-    text->setPos(x - text->boundingRect().width() / 2, y + 10);
+    /* The render threads read the network item, which goes with the scene */
+    tiles->clear();
 }
 
-void MetroMapView::drawLine(double x1, double y1, double x2, double y2, const QString &line)
+void MetroMapView::setTileDirectory(const QString &directory)
 {
-    QColor color;
-    if (line == "Blue")
-        color = QColor(0x4169E1);
-    else if (line == "Yellow")
-        color = QColor(0xFFDF00);
-    else if (line == "Red")
-        color = QColor(0xFF4040);
-    else if (line == "Pink")
-        color = QColor(0xFC8EAC);
-    else if (line == "Magenta")
-        color = QColor(0xCC338B);
-    else if (line == "Violet")
-        color = QColor(0x8b5cf6);
-
-    scene()->addLine(x1, y1, x2, y2, QPen(color, 3));
+    tiles->setDiskDirectory(directory);
+}
+
+void MetroMapView::setNetwork(const MetroNetwork &network)
+{
+    clearRoute();
+    tiles->clear();
+    networkItem->setNetwork(network);
+    tiles->setSource(*networkItem, network);
+    zoomed = false;
+    fitNetwork();
 }
 
 void MetroMapView::highlightPath(const std::vector<int> &path, const std::vector<Station> &stations)
 {
-    /* Draw glow effect under the path lines first */
-    for (size_t i = 0; i < path.size() - 1; i++)
+    clearRoute();
+    if (path.empty())
+        return;
+
+    /* One path for all segments, so the translucent glow does not brighten where segments meet */
+    QPainterPath segments(QPointF(stations[path[0]].x, stations[path[0]].y));
+    for (size_t i = 1; i < path.size(); i++)
+        segments.lineTo(stations[path[i]].x, stations[path[i]].y);
+
+    /* Glow effect under the path line, widest first */
+    QColor glowColor = QColor(0x00FF66);
+    glowColor.setAlpha(50);
+    for (int glow = 14; glow > 4; glow -= 2)
     {
-        double x1 = stations[path[i]].x;
-        double y1 = stations[path[i]].y;
-        double x2 = stations[path[i + 1]].x;
-        double y2 = stations[path[i + 1]].y;
-
-        /* Create a glow effect with gradually fading opacity */
-        for (int glow = 14; glow > 4; glow -= 2)
-        {
-            QColor glowColor = QColor(0x00FF66);
-            glowColor.setAlpha(50);
-            scene()->addLine(x1, y1, x2, y2,
-                             QPen(glowColor, glow, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
-        }
-
-        /* Draw the main path line - brighter and more vibrant */
-        scene()->addLine(x1, y1, x2, y2,
-                         QPen(QColor(0x00FF99), 6, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+        auto *item = new QGraphicsPathItem(segments, routeLayer);
+        item->setPen(QPen(glowColor, glow, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
     }
 
-    /* Highlight the stations in the path with a nice glow effect */
+    /* Main path line - brighter and more vibrant */
+    auto *line = new QGraphicsPathItem(segments, routeLayer);
+    line->setPen(QPen(QColor(0x00FF99), 6, Qt::SolidLine, Qt::RoundCap, Qt::RoundJoin));
+
+    /* Station highlights: outer glow and main ring, plus an outer ring and dot at the start and end */
+    QPainterPath glows, rings, ends, dots;
+    glows.setFillRule(Qt::WindingFill);
+    dots.setFillRule(Qt::WindingFill);
     for (size_t i = 0; i < path.size(); i++)
     {
-        int stationId = path[i];
-        double x = stations[stationId].x;
-        double y = stations[stationId].y;
-
-        /* Outer glow for stations */
-        scene()->addEllipse(x - 12, y - 12, 24, 24,
-                            QPen(QColor(0, 255, 102, 70), 2), QBrush(QColor(0, 255, 102, 15)));
-
-        /* Main station highlight */
-        scene()->addEllipse(x - 8, y - 8, 16, 16,
-                            QPen(QColor(0x00FF66), 4), QBrush(Qt::transparent));
-
-        /* Emphasize start and end stations with an extra highlight */
+        QPointF centre(stations[path[i]].x, stations[path[i]].y);
+        glows.addEllipse(centre, 12, 12);
+        rings.addEllipse(centre, 8, 8);
         if (i == 0 || i == path.size() - 1)
         {
-            /* Pulsating outer ring for start/end */
-            scene()->addEllipse(x - 16, y - 16, 32, 32,
-                                QPen(QColor(0x00FFCC), 2, Qt::DotLine), QBrush(Qt::transparent));
-
-            /* Inner dot to mark it special */
-            scene()->addEllipse(x - 3, y - 3, 6, 6,
-                                QPen(Qt::transparent), QBrush(QColor(0x00FF66)));
+            ends.addEllipse(centre, 16, 16);
+            dots.addEllipse(centre, 3, 3);
         }
     }
+
+    auto *glowItem = new QGraphicsPathItem(glows, routeLayer);
+    glowItem->setPen(QPen(QColor(0, 255, 102, 70), 2));
+    glowItem->setBrush(QBrush(QColor(0, 255, 102, 15)));
+
+    auto *ringItem = new QGraphicsPathItem(rings, routeLayer);
+    ringItem->setPen(QPen(QColor(0x00FF66), 4));
+
+    auto *endItem = new QGraphicsPathItem(ends, routeLayer);
+    endItem->setPen(QPen(QColor(0x00FFCC), 2, Qt::DotLine));
+
+    auto *dotItem = new QGraphicsPathItem(dots, routeLayer);
+    dotItem->setPen(Qt::NoPen);
+    dotItem->setBrush(QBrush(QColor(0x00FF66)));
 }
 
 void MetroMapView::clearRoute()
 {
-    scene()->clear();
+    qDeleteAll(routeLayer->childItems());
+}
+
+int MetroMapView::fittingLevel() const
+{
+    QRectF area = networkItem->networkRect();
+    double fitted = std::min(viewport()->width() / area.width(), viewport()->height() / area.height());
+    return tiles->levelAtMost(fitted);
+}
+
+void MetroMapView::updateBounds()
+{
+    networkItem->setMinimumScale(std::min(tiles->levelScale(fitLevel - ZoomOutLevels), transform().m11()));
+    scene()->setSceneRect(networkItem->boundingRect());
+}
+
+void MetroMapView::fitNetwork()
+{
+    QRectF area = networkItem->networkRect();
+    if (area.isNull() || viewport()->width() <= 0 || viewport()->height() <= 0)
+        return;
+
+    /* The largest scale of the tile pyramid that fits, so the fitted map is blitted from tiles */
+    fitLevel = fittingLevel();
+    double scale = tiles->levelScale(fitLevel);
+    setTransform(QTransform::fromScale(scale, scale));
+    updateBounds();
+    centerOn(area.center());
 }
 
 void MetroMapView::resizeEvent(QResizeEvent *event)
 {
     QGraphicsView::resizeEvent(event);
-    fitInView(scene()->sceneRect(), Qt::KeepAspectRatio);
+    if (!zoomed)
+    {
+        fitNetwork();
+        return;
+    }
+
+    /* Keep the user's scale, only bound zooming by the new fit */
+    if (networkItem->networkRect().isNull() || viewport()->width() <= 0 || viewport()->height() <= 0)
+        return;
+    fitLevel = fittingLevel();
+    updateBounds();
+}
+
+void MetroMapView::wheelEvent(QWheelEvent *event)
+{
+    event->accept();
+    if (networkItem->networkRect().isNull())
+        return;
+
+    /* Whole steps only, so the scale stays on a level of the tile pyramid */
+    wheelDelta += event->angleDelta().y();
+    int steps = wheelDelta / WheelStep;
+    wheelDelta -= steps * WheelStep;
+
+    double current = transform().m11();
+    int level = tiles->levelAtMost(current);
+    int target = std::max(fitLevel - ZoomOutLevels, std::min(fitLevel + ZoomInLevels, level + steps));
+    if (target == level)
+        return;
+
+    zoomed = true;
+    double factor = tiles->levelScale(target) / current;
+    scale(factor, factor);
+}
+
+void MetroMapView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    zoomed = false;
+    wheelDelta = 0;
+    fitNetwork();
+    event->accept();
 }
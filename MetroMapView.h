@@ -2,14 +2,34 @@
 #define METROMAPVIEW_H
 
 #include <QGraphicsView>
+#include <QGraphicsItem>
 #include <QResizeEvent>
+#include <QMouseEvent>
+#include <QWheelEvent>
 #include "MetroData.h"
+#include "NetworkMapItem.h"
+
+class MapTileCache;
 
 /**
  * @brief Visual representation of the metro network
  *
  * This class provides a graphical view of the metro network with
  * stations and lines, and supports highlighting routes.
+ *
+ * The scene holds two layers. The network is one NetworkMapItem, built
+ * once when the network changes; a highlighted route goes into an overlay
+ * above it of a few path items, so showing another route replaces only the
+ * overlay and costs time in the length of the route, not the size of the
+ * network.
+ *
+ * The wheel zooms about the cursor, dragging pans and a double click fits
+ * the whole network again. Until the user zooms, resizing keeps the network
+ * fitted. Only the changed parts of the viewport are repainted; a pan
+ * scrolls what is already on screen and paints the strip it uncovers.
+ *
+ * Zoom steps follow the levels of a MapTileCache, so the network is blitted
+ * from pre-rendered tiles and only the route overlay is painted live.
  */
 class MetroMapView : public QGraphicsView
 {
@@ -21,32 +41,26 @@ public:
      */
     MetroMapView(QWidget *parent = nullptr);
 
+    /** @brief Wait for the map tiles being rendered */
+    ~MetroMapView() override;
+
     /**
-     * @brief Draw a station on the map
-     *
-     * @param name Name of the station
-     * @param x X-coordinate on the map
-     * @param y Y-coordinate on the map
-     * @param line Metro line(s) passing through this station
+     * @brief Keep map tiles on disk between runs
+     * @param directory Directory for the tiles, empty to keep them in memory only; used from the next network on
      */
-    void drawStation(const QString &name, double x, double y, const QString &line);
+    void setTileDirectory(const QString &directory);
 
     /**
-     * @brief Draw a metro line between two points
-     *
-     * @param x1 Starting X-coordinate
-     * @param y1 Starting Y-coordinate
-     * @param x2 Ending X-coordinate
-     * @param y2 Ending Y-coordinate
-     * @param line Name of the metro line to determine color
+     * @brief Draw a network, replacing the one drawn before and any highlighted route
+     * @param network Canonical network; not referenced afterwards
      */
-    void drawLine(double x1, double y1, double x2, double y2, const QString &line);
+    void setNetwork(const MetroNetwork &network);
 
     /**
      * @brief Highlight a path on the map
      *
      * Creates a visual highlight effect for stations and connections
-     * along the specified path.
+     * along the specified path, replacing the route highlighted before.
      *
      * @param path Vector of station IDs representing the route
      * @param stations Vector of all metro stations
@@ -54,7 +68,7 @@ public:
     void highlightPath(const std::vector<int> &path, const std::vector<Station> &stations);
 
     /**
-     * @brief Clear all routes and highlights from the map
+     * @brief Clear the highlighted route, keeping the network
      */
     void clearRoute();
 
@@ -64,6 +78,44 @@ protected:
      * @param event The resize event
      */
     void resizeEvent(QResizeEvent *event) override;
+
+    /**
+     * @brief Zoom about the cursor
+     * @param event The wheel event
+     */
+    void wheelEvent(QWheelEvent *event) override;
+
+    /**
+     * @brief Fit the whole network again
+     * @param event The mouse event
+     */
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+
+private:
+    /* Item that only holds the items of one layer; deleting it deletes them */
+    class Layer : public QGraphicsItem
+    {
+    public:
+        Layer() { setFlag(ItemHasNoContents); }
+        QRectF boundingRect() const override { return QRectF(); }
+        void paint(QPainter *, const QStyleOptionGraphicsItem *, QWidget *) override {}
+    };
+
+    /* Fit the network into the viewport and bound zooming and panning by it */
+    void fitNetwork();
+
+    /* Largest tile level at which the network fits the viewport */
+    int fittingLevel() const;
+
+    /* Bound panning by the network at the smallest scale zooming allows */
+    void updateBounds();
+
+    NetworkMapItem *networkItem; /**< Lines and stations of the network */
+    Layer *routeLayer;           /**< Highlighted route, drawn above the network */
+    MapTileCache *tiles;         /**< Pre-rendered network at the zoom levels */
+    int fitLevel;                /**< Tile level at which the whole network fits */
+    bool zoomed;                 /**< Whether the user zoomed since the network was last fitted */
+    int wheelDelta;              /**< Wheel rotation short of a whole zoom step */
 };
 
 #endif // METROMAPVIEW_H
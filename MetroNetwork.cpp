@@ -0,0 +1,286 @@
+#include "MetroNetwork.h"
+#include <algorithm>
+#include <unordered_map>
+
+using namespace std;
+
+namespace
+{
+/* A train connection between two different stations */
+struct RideArc
+{
+    int from;
+    int to;
+    int minutes;
+    double distance;
+    int line; /* Index among all lines of the source, -1 for none */
+};
+
+/* Line of an arc as stored in the network; only lines with a bit in the masks have an index there */
+uint8_t storedLine(int line)
+{
+    return line >= 0 && line < MaxLines ? static_cast<uint8_t>(line) : NoLine;
+}
+
+int findRoot(vector<int> &parent, int node)
+{
+    while (parent[node] != node)
+    {
+        parent[node] = parent[parent[node]];
+        node = parent[node];
+    }
+    return node;
+}
+}
+
+void buildMetroNetwork(const vector<Station> &nodes, const vector<vector<Edge>> &graph,
+                       MetroNetwork &network)
+{
+    int n = nodes.size();
+
+    /* Merge nodes that share a name and are directly connected */
+    vector<int> parent(n);
+    for (int i = 0; i < n; ++i)
+        parent[i] = i;
+    for (int u = 0; u < n; ++u)
+    {
+        for (const Edge &edge : graph[u])
+        {
+            if (nodes[u].name == nodes[edge.destination].name)
+                parent[findRoot(parent, u)] = findRoot(parent, edge.destination);
+        }
+    }
+
+    /* Number stations in the order of their first node */
+    network.stations.clear();
+    vector<uint32_t> lineMasks;
+    vector<int32_t> nodeStation(n, -1);
+    vector<int> rootStation(n, -1);
+    for (int u = 0; u < n; ++u)
+    {
+        int root = findRoot(parent, u);
+        if (rootStation[root] == -1)
+        {
+            rootStation[root] = static_cast<int>(network.stations.size());
+            Station station = {rootStation[root], nodes[u].name, "", nodes[u].x, nodes[u].y};
+            network.stations.push_back(station);
+            lineMasks.push_back(0);
+        }
+        nodeStation[u] = rootStation[root];
+    }
+
+    /* Register lines in order of first appearance and fill the station masks */
+    network.lineNames.clear();
+    unordered_map<string, int> lineIndex;
+    vector<vector<int>> nodeLines(n);
+    for (int u = 0; u < n; ++u)
+    {
+        Station &station = network.stations[nodeStation[u]];
+        uint32_t &mask = lineMasks[station.id];
+        for (const string &name : splitLines(nodes[u].line))
+        {
+            if (name.empty())
+                continue;
+
+            auto found = lineIndex.find(name);
+            if (found == lineIndex.end())
+            {
+                int index = static_cast<int>(lineIndex.size());
+                found = lineIndex.insert(make_pair(name, index)).first;
+                if (index < MaxLines)
+                    network.lineNames.push_back(name);
+            }
+
+            /* Lines beyond the bitmask width still get platforms, but no name or mask bit */
+            int index = found->second;
+            nodeLines[u].push_back(index);
+            if (index >= MaxLines)
+                continue;
+
+            uint32_t bit = 1u << index;
+            if (!(mask & bit))
+            {
+                mask |= bit;
+                station.line += station.line.empty() ? name : "/" + name;
+            }
+        }
+    }
+
+    /* Split edges into transfers inside a station and rides between stations */
+    int stationCount = network.stations.size();
+    vector<int32_t> transferMinutes(stationCount, 0);
+    vector<char> hasTransfer(stationCount, 0);
+    vector<RideArc> rides;
+    for (int u = 0; u < n; ++u)
+    {
+        int from = nodeStation[u];
+        for (const Edge &edge : graph[u])
+        {
+            int to = nodeStation[edge.destination];
+            if (from == to)
+            {
+                if (u != edge.destination && (!hasTransfer[from] || edge.weight < transferMinutes[from]))
+                {
+                    transferMinutes[from] = edge.weight;
+                    hasTransfer[from] = 1;
+                }
+                continue;
+            }
+
+            /* The ride uses the first line of the departing node that also serves the arriving node */
+            int line = -1;
+            const vector<int> &arriving = nodeLines[edge.destination];
+            for (int candidate : nodeLines[u])
+            {
+                if (find(arriving.begin(), arriving.end(), candidate) != arriving.end())
+                {
+                    line = candidate;
+                    break;
+                }
+            }
+
+            RideArc ride = {from, to, edge.weight, edge.distance, line};
+            rides.push_back(ride);
+        }
+    }
+
+    /* Drop duplicate rides, keeping the fastest one per station pair and line */
+    auto rideOrder = [](const RideArc &a, const RideArc &b)
+    {
+        if (a.from != b.from)
+            return a.from < b.from;
+        if (a.to != b.to)
+            return a.to < b.to;
+        if (a.line != b.line)
+            return a.line < b.line;
+        return a.minutes != b.minutes ? a.minutes < b.minutes : a.distance < b.distance;
+    };
+    sort(rides.begin(), rides.end(), rideOrder);
+    auto sameRide = [](const RideArc &a, const RideArc &b)
+    {
+        return a.from == b.from && a.to == b.to && a.line == b.line;
+    };
+    rides.erase(unique(rides.begin(), rides.end(), sameRide), rides.end());
+
+    /* Interchanges with a transfer time get one platform state per line */
+    vector<vector<int>> stationLines(stationCount);
+    for (const RideArc &ride : rides)
+    {
+        stationLines[ride.from].push_back(ride.line);
+        stationLines[ride.to].push_back(ride.line);
+    }
+
+    vector<int32_t> stateStation(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+        stateStation[s] = s;
+
+    vector<vector<pair<int, int>>> platforms(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+    {
+        vector<int> &lines = stationLines[s];
+        sort(lines.begin(), lines.end());
+        lines.erase(unique(lines.begin(), lines.end()), lines.end());
+        if (lines.size() < 2 || transferMinutes[s] <= 0)
+            continue;
+
+        for (int line : lines)
+        {
+            platforms[s].push_back(make_pair(line, static_cast<int>(stateStation.size())));
+            stateStation.push_back(s);
+        }
+    }
+
+    auto stateOf = [&](int station, int line)
+    {
+        for (const pair<int, int> &platform : platforms[station])
+        {
+            if (platform.first == line)
+                return platform.second;
+        }
+        return station;
+    };
+
+    /* Assemble the routing graph over stations and platforms */
+    int stateCount = stateStation.size();
+    vector<vector<Edge>> adjacency(stateCount);
+    vector<vector<uint8_t>> adjacencyLines(stateCount);
+    for (int s = 0; s < stationCount; ++s)
+    {
+        for (const pair<int, int> &platform : platforms[s])
+        {
+            adjacency[s].push_back({platform.second, transferMinutes[s], 0.0});
+            adjacencyLines[s].push_back(NoLine);
+            adjacency[platform.second].push_back({s, 0, 0.0});
+            adjacencyLines[platform.second].push_back(NoLine);
+        }
+    }
+    for (const RideArc &ride : rides)
+    {
+        int from = stateOf(ride.from, ride.line);
+        adjacency[from].push_back({stateOf(ride.to, ride.line), ride.minutes, ride.distance});
+        adjacencyLines[from].push_back(storedLine(ride.line));
+    }
+
+    vector<uint8_t> arcLine;
+    arcLine.reserve(rides.size() + 2 * (stateCount - stationCount));
+    for (const vector<uint8_t> &lines : adjacencyLines)
+        arcLine.insert(arcLine.end(), lines.begin(), lines.end());
+
+    network.graph = CsrGraph(adjacency);
+    network.lineMasks = FlatArray<uint32_t>(move(lineMasks));
+    network.transferMinutes = FlatArray<int32_t>(move(transferMinutes));
+    network.arcLine = FlatArray<uint8_t>(move(arcLine));
+    network.stateStation = FlatArray<int32_t>(move(stateStation));
+    network.nodeStation = FlatArray<int32_t>(move(nodeStation));
+}
+
+int boardingMinutes(const MetroNetwork &network, int station)
+{
+    /* Stations with platforms only have boarding arcs leaving the concourse */
+    const CsrGraph &graph = network.graph;
+    int arc = graph.arcBegin(station);
+    if (arc < graph.arcEnd(station) && network.stateStation[graph.target(arc)] == station)
+        return network.transferMinutes[station];
+    return 0;
+}
+
+void describeStatePath(const MetroNetwork &network, const vector<int> &states, RouteResult &route)
+{
+    const CsrGraph &graph = network.graph;
+    route.path.clear();
+    route.legs.clear();
+    uint32_t metres = 0;
+    int arrived = -1; /* State the previous ride ended at */
+
+    for (size_t i = 0; i < states.size(); ++i)
+    {
+        int station = network.stateStation[states[i]];
+        if (route.path.empty() || route.path.back() != station)
+            route.path.push_back(station);
+        if (i == 0)
+            continue;
+
+        int arc = graph.findArc(states[i - 1], states[i]);
+        metres += graph.metres(arc);
+
+        /* Boarding and alighting stay inside a station and belong to no leg */
+        if (network.stateStation[states[i - 1]] == station)
+            continue;
+
+        /* Lines beyond MaxLines all read NoLine, so a change of platform also starts a leg */
+        int last = static_cast<int>(route.path.size()) - 1;
+        uint8_t line = network.arcLine[arc];
+        bool changed = states[i - 1] != arrived;
+        arrived = states[i];
+        if (route.legs.empty() || route.legs.back().line != line || changed)
+        {
+            RouteLeg leg = {line, last - 1, last};
+            route.legs.push_back(leg);
+        }
+        else
+            route.legs.back().last = last;
+    }
+
+    route.distance = metres * 0.001;
+    route.transfers = route.legs.empty() ? 0 : static_cast<int>(route.legs.size()) - 1;
+}
@@ -0,0 +1,109 @@
+#ifndef METRONETWORK_H
+#define METRONETWORK_H
+
+#include "MetroData.h"
+#include "CsrGraph.h"
+#include "FlatArray.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/** @brief Maximum number of lines that can be tracked in a station's line mask */
+const int MaxLines = 32;
+
+/** @brief Line index used for arcs and states that do not belong to a line */
+const uint8_t NoLine = 0xFF;
+
+/**
+ * @brief Canonical metro network with one entry per physical station
+ *
+ * The source data models an interchange as several nodes with the same name
+ * (one per line) joined by short transfer edges. This structure merges them
+ * into a single station with a line bitmask and an explicit transfer time, so
+ * routes never visit a station twice and no names are compared at query time.
+ *
+ * Routing still has to know which line a rider is on to charge transfers.
+ * That state lives only inside graph: states [0, stations.size()) are the
+ * stations themselves (the concourse) and every interchange additionally gets
+ * one platform state per line. Trains run between platforms; moving from a
+ * platform to the concourse is free and boarding from the concourse costs the
+ * station's transfer time. Lines beyond MaxLines have no name or mask bit but
+ * still get platforms of their own. Other stations have no platforms and trains stop
+ * at the station state directly. A route between two
+ * stations is therefore a path between their station states; its travel
+ * time includes one boarding at the origin, see boardingMinutes().
+ */
+struct MetroNetwork
+{
+    std::vector<Station> stations;      /**< Physical stations; id is the index */
+    FlatArray<uint32_t> lineMasks;      /**< Bit i set when lineNames[i] serves the station */
+    std::vector<std::string> lineNames; /**< Line behind each bit of the line masks */
+    FlatArray<int32_t> transferMinutes; /**< Time to change lines at each station */
+    CsrGraph graph;                     /**< Routing graph over stations and platforms */
+    FlatArray<uint8_t> arcLine;         /**< Line of every arc of graph, NoLine for boarding, alighting and lines beyond MaxLines */
+    FlatArray<int32_t> stateStation;    /**< Station of every state of graph */
+    FlatArray<int32_t> nodeStation;     /**< Station of every node of the source adjacency list */
+};
+
+/**
+ * @brief Builds the canonical network from node-level station data
+ *
+ * Nodes are merged into one station when they share a name and are joined by
+ * an edge. The fastest such edge becomes the station's transfer time.
+ *
+ * @param nodes Station nodes as produced by initializeMetroNetwork()
+ * @param graph Adjacency list between the nodes
+ * @param network Output canonical network
+ */
+void buildMetroNetwork(const std::vector<Station> &nodes, const std::vector<std::vector<Edge>> &graph,
+                       MetroNetwork &network);
+
+/**
+ * @brief Extra time included in every route that starts at a station
+ *
+ * Equal to the transfer time at interchanges (the rider boards a platform
+ * from the concourse) and zero elsewhere.
+ *
+ * @param network Canonical network
+ * @param station Station ID
+ * @return Minutes to subtract from a state-graph travel time
+ */
+int boardingMinutes(const MetroNetwork &network, int station);
+
+/**
+ * @brief Part of a route ridden on one line
+ */
+struct RouteLeg
+{
+    uint8_t line; /**< Index into MetroNetwork::lineNames, NoLine if the line is not tracked */
+    int first;    /**< Index into RouteResult::path of the boarding station */
+    int last;     /**< Index into RouteResult::path of the alighting station */
+};
+
+/**
+ * @brief Result of a route query
+ */
+struct RouteResult
+{
+    std::vector<int> path;      /**< Station IDs from origin to destination, each station once */
+    int travelTime;             /**< Total travel time in minutes */
+    double distance;            /**< Total distance in kilometers */
+    int transfers;              /**< Number of line changes */
+    std::vector<RouteLeg> legs; /**< Legs in travel order, none when origin and destination are equal */
+};
+
+/**
+ * @brief Converts a path over routing states into a station route
+ *
+ * Walks the path once, reading every hop's arc for its length and line, and
+ * fills in the stations, distance, legs and transfers of the route. A new
+ * leg starts wherever the line of consecutive rides or the platform changes.
+ * The travel time is left to the caller, who has it from the search.
+ *
+ * @param network Canonical network
+ * @param states Path over the states of network.graph
+ * @param route Output route
+ */
+void describeStatePath(const MetroNetwork &network, const std::vector<int> &states, RouteResult &route);
+
+#endif // METRONETWORK_H
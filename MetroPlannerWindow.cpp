@@ -3,6 +3,7 @@
 #include "RouteCalculator.h"
 #include "MetroData.h"
 #include "Visualization.h"
+#include "NetworkLoader.h"
 #include <QVBoxLayout>
 #include <QHBoxLayout>
 #include <QGroupBox>
@@ -11,14 +12,55 @@
 #include <QMessageBox>
 #include <QPainter>
 #include <QPixmap>
+#include <QFileInfo>
+#include <QDir>
+#include <QStandardPaths>
+#include <QCryptographicHash>
+#include <QStatusBar>
 #include <algorithm> /* Needed for std::find */
 #include <cmath>
 #include <climits>
 
 using namespace std;
 
+/* Scale and move station coordinates uniformly into the area the map is drawn in */
+static void fitStationsToMap(vector<Station> &stations)
+{
+    if (stations.empty())
+        return;
+
+    double minX = stations[0].x, maxX = minX, minY = stations[0].y, maxY = minY;
+    for (const auto &station : stations)
+    {
+        minX = min(minX, station.x);
+        maxX = max(maxX, station.x);
+        minY = min(minY, station.y);
+        maxY = max(maxY, station.y);
+    }
+
+    /* Same extent as the built-in Delhi map */
+    const double width = 800.0, height = 550.0, margin = 50.0;
+    double spanX = maxX - minX, spanY = maxY - minY;
+    double scale = (spanX > 0 || spanY > 0) ? min(spanX > 0 ? width / spanX : HUGE_VAL,
+                                                  spanY > 0 ? height / spanY : HUGE_VAL)
+                                            : 1.0;
+    for (auto &station : stations)
+    {
+        station.x = margin + (station.x - minX) * scale;
+        station.y = margin + (station.y - minY) * scale;
+    }
+}
+
 /* Implementation of MetroPlannerWindow members */
-MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent)
+/* Routes and rendered details kept for repeated queries, e.g. popular pairs at a kiosk */
+static const size_t RouteCacheSize = 1024;
+static const size_t TreeCacheSize = 8;
+static const size_t RenderCacheSize = 256;
+
+/* Routes offered for a pair, the fastest included */
+static const int AlternativeCount = 3;
+
+MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent), renderCache(RenderCacheSize)
 {
     setWindowTitle("Metro Route Optimizer");
     setMinimumSize(1200, 800);
@@ -40,7 +82,6 @@ MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent)
     fromStation = new QComboBox;
     toStation = new QComboBox;
     initializeStations();
-    populateStationCombos();
 
     auto *fromLayout = new QHBoxLayout;
     fromLayout->addWidget(new QLabel("From:"));
@@ -76,7 +117,7 @@ MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent)
     connect(swapBtn, &QPushButton::clicked, this, &MetroPlannerWindow::swapStations);
 
     holidayCheck = new QCheckBox("Holiday/Sunday");
-    metroCardCheck = new QCheckBox("Metro Card (10% discount)");
+    metroCardCheck = new QCheckBox(QString("Metro Card (%1% discount)").arg(fares.cardDiscount()));
 
     stationLayout->addLayout(fromLayout);
     stationLayout->addWidget(swapBtn);
@@ -90,6 +131,11 @@ MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent)
     routeDetails->setMinimumHeight(250);
     routeDetails->setStyleSheet("QTextEdit { border: 1px solid #ddd; border-radius: 4px; }");
 
+    /* Alternatives for riders who would rather avoid a crowded line */
+    alternativeList = new QListWidget;
+    alternativeList->setMaximumHeight(90);
+    connect(alternativeList, &QListWidget::currentRowChanged, this, &MetroPlannerWindow::showAlternative);
+
     /* Find route button */
     findRouteBtn = new QPushButton("Find Route");
     findRouteBtn->setStyleSheet("background-color: #3b82f6; color: white; padding: 10px;");
@@ -97,18 +143,93 @@ MetroPlannerWindow::MetroPlannerWindow(QWidget *parent) : QMainWindow(parent)
 
     controlsLayout->addWidget(stationGroup);
     controlsLayout->addWidget(routeDetails);
+    controlsLayout->addWidget(new QLabel("Alternatives:"));
+    controlsLayout->addWidget(alternativeList);
     controlsLayout->addWidget(findRouteBtn);
     controlsLayout->addStretch();
 
     /* Map view */
     mapView = new MetroMapView;
 
+    /* Tiles of the map are kept between runs next to the network snapshots */
+    QString cacheDirectory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (!cacheDirectory.isEmpty())
+        mapView->setTileDirectory(cacheDirectory + "/map-tiles");
+
     mainLayout->addWidget(controlsPanel);
     mainLayout->addWidget(mapView);
 
     /* Initialize the map */
     initializeGraph();
-    drawMetroMap();
+    applyNetwork();
+}
+
+/* Absolute source paths of a network, one per line; names its snapshot and is recorded in it */
+static QString snapshotInputs(const vector<string> &paths)
+{
+    QString key;
+    for (const auto &path : paths)
+        key += QFileInfo(QString::fromStdString(path)).absoluteFilePath() + '\n';
+    return key;
+}
+
+/* Cache file for the snapshot of a network, named after its inputs */
+static QString snapshotPath(const QString &key)
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (directory.isEmpty() || !QDir().mkpath(directory))
+        return QString();
+
+    QByteArray hash = QCryptographicHash::hash(key.toUtf8(), QCryptographicHash::Sha1).toHex();
+    return directory + "/network-" + QString::fromLatin1(hash) + ".snapshot";
+}
+
+bool MetroPlannerWindow::loadNetwork(const vector<string> &paths)
+{
+    /* A snapshot that is still current skips parsing and preprocessing altogether */
+    QString key = snapshotInputs(paths);
+    QString snapshot = snapshotPath(key);
+    string inputs = key.toStdString();
+    if (!snapshot.isEmpty() && planner.loadSnapshot(snapshot.toStdString(), inputs))
+    {
+        stations.clear();
+        graph.clear();
+        showNetwork();
+        return true;
+    }
+
+    vector<Station> loadedStations;
+    vector<vector<Edge>> loadedGraph;
+    NetworkLoader loader;
+    if (!loader.load(paths, loadedStations, loadedGraph))
+    {
+        QMessageBox::warning(this, "Cannot Load Network", QString::fromStdString(loader.errorString()));
+        return false;
+    }
+
+    stations.swap(loadedStations);
+    graph.swap(loadedGraph);
+    fitStationsToMap(stations);
+    applyNetwork();
+
+    /* Failing to cache is harmless, the next start just loads the files again */
+    if (!snapshot.isEmpty())
+        planner.saveSnapshot(snapshot.toStdString(), inputs, loader.sourceFiles());
+    return true;
+}
+
+bool MetroPlannerWindow::loadFareTable(const string &fileName)
+{
+    if (!fares.load(fileName))
+    {
+        QMessageBox::warning(this, "Cannot Load Fares", QString::fromStdString(fares.errorString()));
+        return false;
+    }
+
+    /* Rendered details quote the old fares */
+    metroCardCheck->setText(QString("Metro Card (%1% discount)").arg(fares.cardDiscount()));
+    renderCache.clear();
+    return true;
 }
 
 void MetroPlannerWindow::swapStations()
@@ -134,138 +255,127 @@ void MetroPlannerWindow::findRoute()
     int startId = stationMap[fromStation->currentText().toStdString()].id;
     int endId = stationMap[toStation->currentText().toStdString()].id;
 
-    /* Compute the shortest path */
-    vector<int> distances, previous;
-    dijkstra(startId, graph, distances, previous);
-
-    if (distances[endId] == INT_MAX)
+    /* Compute the shortest path; repeated pairs come from the planner's cache */
+    RouteResult route;
+    bool found = planner.findRoute(startId, endId, route);
+    showCacheStatistics();
+    if (!found)
     {
         routeDetails->setText("No route found between these stations.");
+        alternatives.clear();
+        alternativeList->clear();
+        mapView->clearRoute();
         return;
     }
 
-    /* Reconstruct the path */
-    vector<int> path = reconstructPath(startId, endId, previous, stations);
-
-    /* Calculate distance and fare */
-    double totalDistance = calculatePathDistance(path, graph);
-    int baseFare = calculateFare(totalDistance, holidayCheck->isChecked());
+    const vector<int> &path = route.path;
+    bool isHoliday = holidayCheck->isChecked();
+    bool hasMetroCard = metroCardCheck->isChecked();
 
-    /* Generate HTML route information using the Visualization module */
-    QString routeInfoHTML = getRouteHTML(
-        path, stations, distances[endId], totalDistance, baseFare,
-        holidayCheck->isChecked(), metroCardCheck->isChecked());
+    /* Generate HTML route information using the Visualization module, unless it was rendered before */
+    uint64_t key = (static_cast<uint64_t>(startId) << 32) | (static_cast<uint64_t>(endId) << 2) |
+                   (isHoliday ? 2 : 0) | (hasMetroCard ? 1 : 0);
+    QString *routeInfoHTML = renderCache.find(key);
+    if (!routeInfoHTML)
+    {
+        routeInfoHTML = &renderCache.insert(key);
+        *routeInfoHTML = getRouteHTML(route, renderer, fares, isHoliday, hasMetroCard);
+    }
 
-    routeDetails->setHtml(routeInfoHTML);
+    routeDetails->setHtml(*routeInfoHTML);
 
-    /* Extract unique path for highlighting (same logic as in getRouteHTML) */
-    vector<vector<string>> path_lines;
-    vector<string> station_names;
-    vector<int> unique_path;
+    /* The network stays drawn; only the highlighted path is replaced */
+    mapView->highlightPath(path, planner.network().stations);
 
-    /* Create a unique path without duplicate station names */
-    for (int idx : path)
+    /* The route above heads the list, whichever of several equally fast ones the search found first */
+    planner.findAlternatives(startId, endId, AlternativeCount, alternatives);
+    if (!alternatives.empty())
+        alternatives[0] = route;
+    for (size_t i = 1; i < alternatives.size(); ++i)
     {
-        if (station_names.empty() || stations[idx].name != station_names.back())
+        if (alternatives[i].path == route.path && alternatives[i].transfers == route.transfers)
         {
-            station_names.push_back(stations[idx].name);
-            unique_path.push_back(idx);
-            path_lines.push_back(splitLines(stations[idx].line));
+            alternatives.erase(alternatives.begin() + i);
+            break;
         }
     }
 
-    /* Redraw the map with the highlighted path */
-    drawMetroMap();
-    mapView->highlightPath(unique_path, stations);
+    int day = fares.dayType(isHoliday);
+    alternativeList->blockSignals(true);
+    alternativeList->clear();
+    for (const RouteResult &alternative : alternatives)
+    {
+        alternativeList->addItem(QString("%1 min, %2 transfer(s), Rs %3")
+                                     .arg(alternative.travelTime)
+                                     .arg(alternative.transfers)
+                                     .arg(fares.fare(alternative.distance, day, hasMetroCard)));
+    }
+    alternativeList->setCurrentRow(0);
+    alternativeList->blockSignals(false);
+}
+
+void MetroPlannerWindow::showAlternative(int row)
+{
+    if (row < 0 || row >= static_cast<int>(alternatives.size()))
+        return;
+
+    /* Only the fastest route's details are cached; alternatives are rendered when picked */
+    const RouteResult &route = alternatives[row];
+    routeDetails->setHtml(getRouteHTML(route, renderer, fares, holidayCheck->isChecked(), metroCardCheck->isChecked()));
+    mapView->highlightPath(route.path, planner.network().stations);
 }
 
 void MetroPlannerWindow::initializeStations()
 {
     /* Use the centralized function from MetroData to initialize stations and graph */
     initializeMetroNetwork(stations, graph);
+}
 
-    /* Set visualization coordinates for each station */
-    /* Blue Line (Major stations) */
-    stations[0].x = 50;
-    stations[0].y = 300; /* Dwarka Sec-21 */
-    stations[1].x = 150;
-    stations[1].y = 300; /* Janakpuri West */
-    stations[2].x = 250;
-    stations[2].y = 300; /* Rajouri Garden */
-    stations[3].x = 400;
-    stations[3].y = 300; /* Rajiv Chowk */
-    stations[4].x = 500;
-    stations[4].y = 300; /* Mandi House */
-    stations[5].x = 600;
-    stations[5].y = 300; /* Yamuna Bank */
-    stations[6].x = 700;
-    stations[6].y = 300; /* Mayur Vihar Phase-1 */
-    stations[7].x = 820;
-    stations[7].y = 300; /* Noida City Centre */
-    stations[8].x = 850;
-    stations[8].y = 250; /* Vaishali */
-
-    /* Yellow Line (Major stations) */
-    stations[9].x = 400;
-    stations[9].y = 50; /* Samaypur Badli */
-    stations[10].x = 400;
-    stations[10].y = 100; /* Azadpur */
-    stations[11].x = 400;
-    stations[11].y = 150; /* Kashmere Gate */
-    stations[12].x = 400;
-    stations[12].y = 200; /* Chandni Chowk */
-    stations[13].x = 400;
-    stations[13].y = 300; /* Rajiv Chowk */
-    stations[14].x = 400;
-    stations[14].y = 400; /* Central Secretariat */
-    stations[15].x = 400;
-    stations[15].y = 440; /* INA */
-    stations[16].x = 400;
-    stations[16].y = 480; /* AIIMS */
-    stations[17].x = 400;
-    stations[17].y = 520; /* Hauz Khas */
-    stations[18].x = 400;
-    stations[18].y = 600; /* HUDA City Centre */
-
-    /* Red Line (Major stations) */
-    stations[19].x = 220;
-    stations[19].y = 150; /* Rithala */
-    stations[20].x = 300;
-    stations[20].y = 150; /* Netaji Subhash Place */
-    stations[21].x = 400;
-    stations[21].y = 150; /* Kashmere Gate */
-    stations[22].x = 500;
-    stations[22].y = 150; /* Welcome */
-
-    /* Pink Line (Major stations) */
-    stations[23].x = 300;
-    stations[23].y = 100; /* Majlis Park */
-    stations[24].x = 400;
-    stations[24].y = 100; /* Azadpur */
-    stations[25].x = 300;
-    stations[25].y = 150; /* Netaji Subhash Place */
-    stations[26].x = 250;
-    stations[26].y = 300; /* Rajouri Garden */
-    stations[27].x = 400;
-    stations[27].y = 440; /* INA */
-    stations[28].x = 700;
-    stations[28].y = 300; /* Mayur Vihar Phase-1 */
-
-    /* Magenta Line (Major stations) */
-    stations[29].x = 150;
-    stations[29].y = 300; /* Janakpuri West */
-    stations[30].x = 200;
-    stations[30].y = 400; /* Terminal 1 IGI Airport */
-    stations[31].x = 400;
-    stations[31].y = 520; /* Hauz Khas */
-    stations[32].x = 750;
-    stations[32].y = 350; /* Botanical Garden */
+void MetroPlannerWindow::applyNetwork()
+{
+    /* Merge interchange nodes into one station each for routing */
+    MetroNetwork network;
+    buildMetroNetwork(stations, graph, network);
+    planner.setNetwork(network);
+
+    /* Precompute every route up front when the network is small enough, otherwise contract it */
+    if (planner.network().graph.nodeCount() <= RoutePlanner::DefaultAllPairsLimit)
+        planner.enableAllPairs();
+    else
+        planner.enableContractionHierarchy();
+
+    showNetwork();
+}
+
+void MetroPlannerWindow::showCacheStatistics()
+{
+    RouteCacheStatistics statistics = planner.cacheStatistics();
+    statusBar()->showMessage(QString("Route cache: %1 hits, %2 misses; details cache: %3 hits, %4 misses")
+                                 .arg(statistics.routeHits)
+                                 .arg(statistics.routeMisses)
+                                 .arg(renderCache.hits())
+                                 .arg(renderCache.misses()));
+}
+
+void MetroPlannerWindow::showNetwork()
+{
+    /* The planner drops cached routes when its network changes; rendered details must go too */
+    planner.setCacheCapacity(RouteCacheSize, TreeCacheSize);
+    renderCache.clear();
+    renderer.setNetwork(planner.network());
 
     /* Build station map for quick lookup */
-    for (const auto &station : stations)
+    stationMap.clear();
+    for (const auto &station : planner.network().stations)
     {
         stationMap[station.name] = station;
     }
+
+    populateStationCombos();
+    routeDetails->clear();
+    alternatives.clear();
+    alternativeList->clear();
+    drawMetroMap();
 }
 
 void MetroPlannerWindow::populateStationCombos()
@@ -279,6 +389,8 @@ void MetroPlannerWindow::populateStationCombos()
     sort(stationNames.begin(), stationNames.end());
 
     /* Populate comboboxes */
+    fromStation->clear();
+    toStation->clear();
     for (const auto &name : stationNames)
     {
         fromStation->addItem(QString::fromStdString(name));
@@ -293,59 +405,5 @@ void MetroPlannerWindow::initializeGraph()
 
 void MetroPlannerWindow::drawMetroMap()
 {
-    mapView->clearRoute();
-
-    /* Draw Blue Line */
-    for (int i = 0; i < 8; i++)
-    {
-        mapView->drawLine(
-            stations[i].x, stations[i].y,
-            stations[i + 1].x, stations[i + 1].y,
-            "Blue");
-    }
-
-    /* Draw Yellow Line */
-    for (int i = 9; i < 18; i++)
-    {
-        mapView->drawLine(
-            stations[i].x, stations[i].y,
-            stations[i + 1].x, stations[i + 1].y,
-            "Yellow");
-    }
-
-    /* Draw Red Line */
-    for (int i = 19; i < 22; i++)
-    {
-        mapView->drawLine(
-            stations[i].x, stations[i].y,
-            stations[i + 1].x, stations[i + 1].y,
-            "Red");
-    }
-
-    /* Draw Pink Line */
-    for (int i = 23; i < 28; i++)
-    {
-        mapView->drawLine(
-            stations[i].x, stations[i].y,
-            stations[i + 1].x, stations[i + 1].y,
-            "Pink");
-    }
-
-    /* Draw Magenta Line */
-    for (int i = 29; i < 32; i++)
-    {
-        mapView->drawLine(
-            stations[i].x, stations[i].y,
-            stations[i + 1].x, stations[i + 1].y,
-            "Magenta");
-    }
-
-    /* Draw all stations */
-    for (const auto &station : stations)
-    {
-        mapView->drawStation(
-            QString::fromStdString(station.name),
-            station.x, station.y,
-            QString::fromStdString(station.line));
-    }
+    mapView->setNetwork(planner.network());
 }
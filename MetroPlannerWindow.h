@@ -6,10 +6,15 @@
 #include <QCheckBox>
 #include <QTextEdit>
 #include <QPushButton>
+#include <QListWidget>
 #include <vector>
 #include <unordered_map>
 #include <string>
 #include "MetroData.h"
+#include "RoutePlanner.h"
+#include "FareTable.h"
+#include "RouteRenderer.h"
+#include "LruCache.h"
 
 class MetroMapView;
 
@@ -29,6 +34,30 @@ public:
      */
     MetroPlannerWindow(QWidget *parent = nullptr);
 
+    /**
+     * @brief Replace the built-in network with one loaded from files
+     *
+     * Accepts the same arguments as NetworkLoader::load(). Station
+     * coordinates are scaled to fit the map. The network and its index are
+     * cached as a snapshot, which later runs map directly while the files
+     * stay unchanged. On failure a warning is shown and the current network
+     * is kept.
+     *
+     * @param paths One GTFS directory, or a stations file followed by an edges file
+     * @return True if the network was loaded
+     */
+    bool loadNetwork(const std::vector<std::string> &paths);
+
+    /**
+     * @brief Charge fares from a table file instead of the built-in Delhi Metro fares
+     *
+     * On failure a warning is shown and the current fares are kept.
+     *
+     * @param fileName Fare table as read by FareTable::load()
+     * @return True if the table was loaded
+     */
+    bool loadFareTable(const std::string &fileName);
+
 private slots:
     /**
      * @brief Swap the source and destination stations
@@ -40,12 +69,33 @@ private slots:
      */
     void findRoute();
 
+    /**
+     * @brief Show the details of one alternative and highlight it on the map
+     * @param row Row of the alternative in the list, -1 for none
+     */
+    void showAlternative(int row);
+
 private:
     /**
      * @brief Initialize the metro station data
      */
     void initializeStations();
 
+    /**
+     * @brief Rebuild routing, station lists and the map after the network changed
+     */
+    void applyNetwork();
+
+    /**
+     * @brief Refresh station lists and the map from the planner's network
+     */
+    void showNetwork();
+
+    /**
+     * @brief Show the hit and miss counts of the route caches in the status bar
+     */
+    void showCacheStatistics();
+
     /**
      * @brief Fill the station selection dropdown menus
      */
@@ -57,7 +107,7 @@ private:
     void initializeGraph();
 
     /**
-     * @brief Draw the metro map in the map view
+     * @brief Draw the network into the map view's base layer, once per network
      */
     void drawMetroMap();
 
@@ -73,11 +123,17 @@ private:
     QCheckBox *metroCardCheck;          /**< Metro card discount checkbox */
     QPushButton *findRouteBtn;          /**< Route finding button */
     QTextEdit *routeDetails;            /**< Text area for displaying route details */
+    QListWidget *alternativeList;       /**< Fastest route and its alternatives */
     MetroMapView *mapView;              /**< Visual map of the metro network */
 
-    std::vector<Station> stations;                       /**< Collection of all metro stations */
-    std::unordered_map<std::string, Station> stationMap; /**< Map for quick station lookup by name */
+    std::vector<Station> stations;                       /**< Station nodes of the source data, used for drawing */
+    std::unordered_map<std::string, Station> stationMap; /**< Canonical stations by name for quick lookup */
     std::vector<std::vector<Edge>> graph;                /**< Network graph representation */
+    RoutePlanner planner;                                /**< Route queries over the compact network graph */
+    FareTable fares;                                     /**< Fares charged for displayed routes */
+    RouteRenderer renderer;                              /**< Station and line fragments of the planner's network */
+    LruCache<uint64_t, QString> renderCache;             /**< Route details by stations, day type and card */
+    std::vector<RouteResult> alternatives;               /**< Routes listed in alternativeList */
 };
 
 #endif // METROPLANNERWINDOW_H
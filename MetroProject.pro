@@ -1,19 +1,10 @@
-QT += core gui widgets
-TARGET = MetroRoute
-TEMPLATE = app
-CONFIG += c++11
+TEMPLATE = subdirs
 
-SOURCES += \
-    main.cpp \
-    MetroData.cpp \
-    RouteCalculator.cpp \
-    MetroMapView.cpp \
-    MetroPlannerWindow.cpp \
-    Visualization.cpp
-
-HEADERS += \
-    MetroData.h \
-    RouteCalculator.h \
-    MetroMapView.h \
-    MetroPlannerWindow.h \
-    Visualization.h
+# Desktop application, headless batch router, benchmarks and checks, built from the same sources
+SUBDIRS += \
+    MetroRoute.pro \
+    MetroBatch.pro \
+    MetroBench.pro \
+    ConnectionScanTest.pro \
+    RaptorTest.pro \
+    RouteRendererTest.pro
@@ -0,0 +1,20 @@
+QT += core gui widgets
+TARGET = MetroRoute
+TEMPLATE = app
+
+include(MetroCore.pri)
+
+SOURCES += \
+    main.cpp \
+    MapTileCache.cpp \
+    MetroMapView.cpp \
+    MetroPlannerWindow.cpp \
+    NetworkMapItem.cpp \
+    Visualization.cpp
+
+HEADERS += \
+    MapTileCache.h \
+    MetroMapView.h \
+    MetroPlannerWindow.h \
+    NetworkMapItem.h \
+    Visualization.h
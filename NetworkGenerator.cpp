@@ -0,0 +1,367 @@
+#include "NetworkGenerator.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <string>
+
+using namespace std;
+
+namespace
+{
+const double Pi = 3.14159265358979323846;
+const double MinutesPerKilometre = 1.5; /* About 40 km/h between stations */
+const double DwellMinutes = 0.5;
+
+/* Uniform numbers straight from mt19937, whose output the standard fixes, unlike the distributions */
+class Random
+{
+public:
+    explicit Random(uint32_t seed) : engine(seed) {}
+
+    double uniform() { return engine() / 4294967296.0; }
+    double range(double low, double high) { return low + (high - low) * uniform(); }
+    size_t below(size_t count) { return static_cast<size_t>(uniform() * count); }
+
+private:
+    mt19937 engine;
+};
+
+/* Track of one line: a straight segment or a circle, measured by arc length t */
+struct Shape
+{
+    bool ring;
+    double x0, y0, x1, y1; /* Segment ends */
+    double cx, cy, radius; /* Circle */
+    double length;
+
+    void point(double t, double &x, double &y) const
+    {
+        if (ring)
+        {
+            x = cx + radius * cos(t / radius);
+            y = cy + radius * sin(t / radius);
+        }
+        else
+        {
+            double s = length > 0 ? t / length : 0;
+            x = x0 + (x1 - x0) * s;
+            y = y0 + (y1 - y0) * s;
+        }
+    }
+
+    void scale(double factor)
+    {
+        x0 *= factor;
+        y0 *= factor;
+        x1 *= factor;
+        y1 *= factor;
+        cx *= factor;
+        cy *= factor;
+        radius *= factor;
+        length *= factor;
+    }
+};
+
+Shape segment(double x0, double y0, double x1, double y1)
+{
+    Shape shape = {false, x0, y0, x1, y1, 0, 0, 0, hypot(x1 - x0, y1 - y0)};
+    return shape;
+}
+
+Shape circle(double radius)
+{
+    Shape shape = {true, 0, 0, 0, 0, 0, 0, radius, 2 * Pi * radius};
+    return shape;
+}
+
+/* Point where two lines cross, with its position along each of them */
+struct Crossing
+{
+    int a, b;
+    double ta, tb;
+    double x, y;
+};
+
+/* Lines spanning the unit square, split between both directions */
+vector<Shape> gridShapes(int lines, Random &random)
+{
+    vector<Shape> shapes;
+    int horizontal = (lines + 1) / 2;
+    int vertical = lines - horizontal;
+    for (int k = 0; k < horizontal; ++k)
+    {
+        double y = -1 + 2 * (k + 0.5) / horizontal + random.range(-0.3, 0.3) / horizontal;
+        shapes.push_back(segment(-1 + random.range(0, 0.3), y, 1 - random.range(0, 0.3), y));
+    }
+    for (int k = 0; k < vertical; ++k)
+    {
+        double x = -1 + 2 * (k + 0.5) / vertical + random.range(-0.3, 0.3) / vertical;
+        shapes.push_back(segment(x, -1 + random.range(0, 0.3), x, 1 - random.range(0, 0.3)));
+    }
+    return shapes;
+}
+
+/* Diameters of the unit circle through points near the centre, plus concentric rings */
+vector<Shape> radialShapes(int lines, Random &random)
+{
+    vector<Shape> shapes;
+    int rings = lines >= 6 ? lines / 6 : 0;
+    int diameters = lines - rings;
+    for (int k = 0; k < diameters; ++k)
+    {
+        double angle = Pi * (k + random.range(-0.3, 0.3)) / diameters;
+        double dx = cos(angle), dy = sin(angle);
+        double ox = random.range(-0.15, 0.15), oy = random.range(-0.15, 0.15);
+
+        /* Where the line through the offset centre leaves the unit circle, pulled in a little */
+        double along = ox * dx + oy * dy;
+        double root = sqrt(along * along - (ox * ox + oy * oy - 1));
+        double back = (-along - root) * (1 - random.range(0, 0.25));
+        double ahead = (-along + root) * (1 - random.range(0, 0.25));
+        shapes.push_back(segment(ox + back * dx, oy + back * dy, ox + ahead * dx, oy + ahead * dy));
+    }
+    for (int m = 0; m < rings; ++m)
+        shapes.push_back(circle(0.85 * (m + 1) / (rings + 1) + random.range(-0.05, 0.05) / (rings + 1)));
+    return shapes;
+}
+
+/* Arc length of a point on a circle */
+double ringPosition(const Shape &ring, double x, double y)
+{
+    double angle = atan2(y - ring.cy, x - ring.cx);
+    if (angle < 0)
+        angle += 2 * Pi;
+    return angle * ring.radius;
+}
+
+void findCrossings(const vector<Shape> &shapes, int a, int b, vector<Crossing> &crossings)
+{
+    const Shape &first = shapes[a];
+    const Shape &second = shapes[b];
+    if (first.ring && second.ring)
+        return; /* Rings are concentric */
+
+    if (!first.ring && !second.ring)
+    {
+        double dx1 = first.x1 - first.x0, dy1 = first.y1 - first.y0;
+        double dx2 = second.x1 - second.x0, dy2 = second.y1 - second.y0;
+        double denominator = dx1 * dy2 - dy1 * dx2;
+        if (fabs(denominator) < 1e-12)
+            return;
+
+        double wx = second.x0 - first.x0, wy = second.y0 - first.y0;
+        double u = (wx * dy2 - wy * dx2) / denominator;
+        double v = (wx * dy1 - wy * dx1) / denominator;
+        if (u < 0 || u > 1 || v < 0 || v > 1)
+            return;
+
+        Crossing crossing = {a, b, u * first.length, v * second.length, first.x0 + u * dx1, first.y0 + u * dy1};
+        crossings.push_back(crossing);
+        return;
+    }
+
+    /* A segment against a circle: up to two points */
+    bool firstIsRing = first.ring;
+    const Shape &line = firstIsRing ? second : first;
+    const Shape &ring = firstIsRing ? first : second;
+    double dx = line.x1 - line.x0, dy = line.y1 - line.y0;
+    double fx = line.x0 - ring.cx, fy = line.y0 - ring.cy;
+    double qa = dx * dx + dy * dy;
+    double qb = 2 * (fx * dx + fy * dy);
+    double qc = fx * fx + fy * fy - ring.radius * ring.radius;
+    double discriminant = qb * qb - 4 * qa * qc;
+    if (qa <= 0 || discriminant <= 0)
+        return;
+
+    double root = sqrt(discriminant);
+    for (double s : {(-qb - root) / (2 * qa), (-qb + root) / (2 * qa)})
+    {
+        if (s < 0 || s > 1)
+            continue;
+        double x = line.x0 + s * dx, y = line.y0 + s * dy;
+        double tLine = s * line.length, tRing = ringPosition(ring, x, y);
+        Crossing crossing = {a, b, firstIsRing ? tRing : tLine, firstIsRing ? tLine : tRing, x, y};
+        crossings.push_back(crossing);
+    }
+}
+
+/* Stop on a line; interchanges share their name with a stop on another line */
+struct Stop
+{
+    double t;
+    int name;
+    double x, y;
+
+    bool operator<(const Stop &other) const { return t < other.t; }
+};
+
+/* Distance along a line, the short way round for rings */
+double gap(const Shape &shape, double t1, double t2)
+{
+    double distance = fabs(t1 - t2);
+    return shape.ring ? min(distance, shape.length - distance) : distance;
+}
+
+bool nearStop(const Shape &shape, const vector<Stop> &stops, double t, double limit)
+{
+    for (const Stop &stop : stops)
+    {
+        if (gap(shape, stop.t, t) < limit)
+            return true;
+    }
+    return false;
+}
+
+int findRoot(vector<int> &parent, int line)
+{
+    while (parent[line] != line)
+        line = parent[line] = parent[parent[line]];
+    return line;
+}
+}
+
+NetworkGenerator::NetworkGenerator()
+    : seed(1), stationCount(1000), lineCount(0), layout(Radial), interchangeDensity(0.5), stationSpacing(1.2),
+      transferMinutes(3)
+{
+}
+
+string NetworkGenerator::settings() const
+{
+    char text[256];
+    snprintf(text, sizeof(text), "seed %u stations %d lines %d layout %d density %.17g spacing %.17g transfer %d",
+             static_cast<unsigned>(seed), stationCount, lineCount, static_cast<int>(layout), interchangeDensity,
+             stationSpacing, transferMinutes);
+    return text;
+}
+
+void NetworkGenerator::generate(vector<Station> &stations, vector<vector<Edge>> &graph) const
+{
+    stations.clear();
+    graph.clear();
+
+    Random random(seed);
+    int targetStations = max(stationCount, 2);
+    int lines = lineCount > 0 ? lineCount : max(2, static_cast<int>(lround(sqrt(static_cast<double>(targetStations)) / 3)));
+    double spacing = stationSpacing > 0 ? stationSpacing : 1.2;
+
+    vector<Shape> shapes = layout == Grid ? gridShapes(lines, random) : radialShapes(lines, random);
+
+    /* Scale the city so the tracks hold about the requested number of stations */
+    double totalLength = 0;
+    for (const Shape &shape : shapes)
+        totalLength += shape.length;
+    double factor = targetStations * spacing / max(totalLength, 1e-9);
+    for (Shape &shape : shapes)
+        shape.scale(factor);
+
+    vector<Crossing> crossings;
+    for (int a = 0; a < lines; ++a)
+    {
+        for (int b = a + 1; b < lines; ++b)
+            findCrossings(shapes, a, b, crossings);
+    }
+
+    /* Visit crossings in random order so the interchanges forced for connectivity are spread out */
+    for (size_t i = crossings.size(); i > 1; --i)
+        swap(crossings[i - 1], crossings[random.below(i)]);
+
+    vector<vector<Stop>> stops(lines);
+    vector<int> parent(lines);
+    for (int line = 0; line < lines; ++line)
+        parent[line] = line;
+    int nameCount = 0;
+
+    for (const Crossing &crossing : crossings)
+    {
+        int rootA = findRoot(parent, crossing.a);
+        int rootB = findRoot(parent, crossing.b);
+        bool needed = rootA != rootB;
+        bool wanted = random.uniform() < interchangeDensity &&
+                      !nearStop(shapes[crossing.a], stops[crossing.a], crossing.ta, spacing * 0.5) &&
+                      !nearStop(shapes[crossing.b], stops[crossing.b], crossing.tb, spacing * 0.5);
+        if (!needed && !wanted)
+            continue;
+
+        parent[rootA] = rootB;
+        Stop first = {crossing.ta, nameCount, crossing.x, crossing.y};
+        Stop second = {crossing.tb, nameCount, crossing.x, crossing.y};
+        stops[crossing.a].push_back(first);
+        stops[crossing.b].push_back(second);
+        ++nameCount;
+    }
+
+    /* Fill the lines with ordinary stations, keeping clear of the interchanges */
+    for (int line = 0; line < lines; ++line)
+    {
+        const Shape &shape = shapes[line];
+        vector<Stop> interchanges = stops[line];
+
+        vector<double> positions;
+        if (shape.ring)
+        {
+            for (double t = random.range(0, spacing); t < shape.length - spacing * 0.5; t += spacing * random.range(0.8, 1.2))
+                positions.push_back(t);
+        }
+        else
+        {
+            double t = 0;
+            for (; t < shape.length - spacing * 0.6; t += spacing * random.range(0.8, 1.2))
+                positions.push_back(t);
+            positions.push_back(shape.length);
+        }
+
+        for (double t : positions)
+        {
+            if (nearStop(shape, interchanges, t, spacing * 0.5))
+                continue;
+            Stop stop = {t, nameCount++, 0, 0};
+            shape.point(t, stop.x, stop.y);
+            stops[line].push_back(stop);
+        }
+        sort(stops[line].begin(), stops[line].end());
+    }
+
+    /* One node per stop; nodes sharing a name are joined by transfer edges */
+    vector<int> firstNode(nameCount, -1);
+    for (int line = 0; line < lines; ++line)
+    {
+        const Shape &shape = shapes[line];
+        const vector<Stop> &lineStops = stops[line];
+        string lineName = "Line " + to_string(line + 1);
+
+        auto connect = [&](int from, int to, double distance)
+        {
+            int minutes = max(1, static_cast<int>(lround(distance * MinutesPerKilometre + DwellMinutes)));
+            graph[from].push_back({to, minutes, distance});
+            graph[to].push_back({from, minutes, distance});
+        };
+
+        int lineStart = static_cast<int>(stations.size());
+        for (size_t i = 0; i < lineStops.size(); ++i)
+        {
+            const Stop &stop = lineStops[i];
+            int node = static_cast<int>(stations.size());
+            stations.push_back({node, "Station " + to_string(stop.name + 1), lineName, stop.x, stop.y});
+            graph.emplace_back();
+
+            if (i > 0)
+                connect(node - 1, node, stop.t - lineStops[i - 1].t);
+
+            if (firstNode[stop.name] < 0)
+                firstNode[stop.name] = node;
+            else
+            {
+                graph[firstNode[stop.name]].push_back({node, transferMinutes, 0.0});
+                graph[node].push_back({firstNode[stop.name], transferMinutes, 0.0});
+            }
+        }
+
+        if (shape.ring && lineStops.size() > 2)
+        {
+            int lineEnd = static_cast<int>(stations.size()) - 1;
+            connect(lineEnd, lineStart, shape.length - lineStops.back().t + lineStops.front().t);
+        }
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef NETWORKGENERATOR_H
+#define NETWORKGENERATOR_H
+
+#include "MetroData.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Generates synthetic metro-like networks for scaling tests
+ *
+ * Lines are laid out either radially (diameters through the city centre
+ * plus ring lines) or as a grid of horizontal and vertical lines. Stations
+ * are placed along every line at roughly the configured spacing, and the
+ * city is scaled so the network ends up with about the requested number of
+ * stations. Where two lines cross, the crossing becomes an interchange with
+ * the probability given by the interchange density; crossings needed to
+ * keep all lines connected always become interchanges.
+ *
+ * The output has the same shape as initializeMetroNetwork(): one node per
+ * station and line, nodes of an interchange share a name and are joined by
+ * transfer edges, coordinates are in kilometres. The same seed and settings
+ * always produce the same network: random numbers come straight from
+ * std::mt19937, whose output the standard fixes.
+ */
+class NetworkGenerator
+{
+public:
+    /** @brief Arrangement of the lines */
+    enum Layout
+    {
+        Radial, /**< Diameters through the centre and concentric rings */
+        Grid    /**< Horizontal and vertical lines */
+    };
+
+    /**
+     * @brief Construct a generator for about 1000 stations with a radial layout
+     */
+    NetworkGenerator();
+
+    /** @brief Seed of the random number generator */
+    void setSeed(uint32_t value) { seed = value; }
+
+    /** @brief Approximate number of physical stations to generate */
+    void setStationCount(int value) { stationCount = value; }
+
+    /** @brief Number of lines, 0 to derive it from the station count */
+    void setLineCount(int value) { lineCount = value; }
+
+    /** @brief Arrangement of the lines */
+    void setLayout(Layout value) { layout = value; }
+
+    /**
+     * @brief Share of line crossings that become interchanges
+     * @param value 0 for only the interchanges needed to connect all lines, 1 for every crossing
+     */
+    void setInterchangeDensity(double value) { interchangeDensity = value; }
+
+    /** @brief Average distance between neighbouring stations of a line in kilometres */
+    void setStationSpacing(double kilometres) { stationSpacing = kilometres; }
+
+    /** @brief Time to change lines at an interchange in minutes */
+    void setTransferMinutes(int minutes) { transferMinutes = minutes; }
+
+    /**
+     * @brief Generate a network
+     * @param stations Output vector of station nodes, id equal to the index
+     * @param graph Output adjacency list between the nodes
+     */
+    void generate(std::vector<Station> &stations, std::vector<std::vector<Edge>> &graph) const;
+
+    /**
+     * @brief Every setting as one line of text
+     * @return Text that is equal for generators producing the same network
+     */
+    std::string settings() const;
+
+private:
+    uint32_t seed;
+    int stationCount;
+    int lineCount;
+    Layout layout;
+    double interchangeDensity;
+    double stationSpacing;
+    int transferMinutes;
+};
+
+#endif // NETWORKGENERATOR_H
@@ -0,0 +1,1047 @@
+#include "NetworkLoader.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+const int NetworkLoader::DefaultTransferMinutes;
+
+namespace
+{
+/* Average speed used to time GTFS hops that have no stop times */
+const double EstimatedSpeedKmh = 30.0;
+
+/* A field of a mapped file, referenced in place */
+struct Field
+{
+    const char *begin;
+    const char *end;
+    bool escaped; /* Quoted field that contains doubled quotes */
+};
+
+/* Splits a mapped CSV file into records without copying any field */
+class CsvReader
+{
+public:
+    explicit CsvReader(const MappedFile &file)
+        : position(file.data()), end(file.data() + file.size()), line(0)
+    {
+        /* Skip a UTF-8 byte order mark, common in GTFS feeds */
+        if (end - position >= 3 && memcmp(position, "\xEF\xBB\xBF", 3) == 0)
+            position += 3;
+    }
+
+    /* Read the next non-empty record, false at the end of the file */
+    bool next(vector<Field> &fields)
+    {
+        /* Scan with local pointers; stores through the member pointers would
+           have to be repeated after every byte read */
+        const char *at = position;
+        const char *stop = end;
+        fields.clear();
+        while (at < stop)
+        {
+            ++line;
+
+            /* memchr finds the line end much faster than a byte loop */
+            const char *lineEnd = findLineEnd(at, stop);
+            const char *textEnd = lineEnd > at && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+            if (at == textEnd)
+            {
+                at = lineEnd < stop ? lineEnd + 1 : stop;
+                continue;
+            }
+
+            for (;;)
+            {
+                Field field = {at, at, false};
+                if (at < textEnd && *at == '"')
+                {
+                    field.begin = ++at;
+                    while (at < stop)
+                    {
+                        if (*at == '"')
+                        {
+                            if (at + 1 < stop && at[1] == '"')
+                            {
+                                field.escaped = true;
+                                at += 2;
+                                continue;
+                            }
+                            break;
+                        }
+                        if (*at == '\n')
+                            ++line;
+                        ++at;
+                    }
+                    field.end = at;
+                    if (at < stop)
+                        ++at;
+
+                    /* The quoted text spanned a line break */
+                    if (at > textEnd)
+                    {
+                        lineEnd = findLineEnd(at, stop);
+                        textEnd = lineEnd > at && lineEnd[-1] == '\r' ? lineEnd - 1 : lineEnd;
+                    }
+
+                    /* Text between a closing quote and the separator is dropped */
+                    while (at < textEnd && *at != ',')
+                        ++at;
+                }
+                else
+                {
+                    while (at < textEnd && *at != ',')
+                        ++at;
+                    field.end = at;
+                }
+                fields.push_back(field);
+
+                if (at == textEnd)
+                    break;
+                ++at;
+            }
+            position = lineEnd < stop ? lineEnd + 1 : stop;
+            return true;
+        }
+        position = at;
+        return false;
+    }
+
+    /* Line number of the last record returned by next() */
+    int lineNumber() const { return line; }
+
+private:
+    static const char *findLineEnd(const char *at, const char *stop)
+    {
+        const void *found = memchr(at, '\n', stop - at);
+        return found ? static_cast<const char *>(found) : stop;
+    }
+
+    const char *position;
+    const char *end;
+    int line;
+};
+
+/* Open-addressing hash table from fields of mapped files to integers */
+class KeyIndex
+{
+public:
+    KeyIndex() : used(0)
+    {
+        Slot empty = {nullptr, 0, -1};
+        slots.assign(1024, empty);
+    }
+
+    /* Value stored for a key, -1 if the key is unknown */
+    int find(Field key) const
+    {
+        size_t length = key.end - key.begin;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key.begin, length) & mask;; i = (i + 1) & mask)
+        {
+            const Slot &slot = slots[i];
+            if (slot.value < 0)
+                return -1;
+            if (slot.length == length && memcmp(slot.key, key.begin, length) == 0)
+                return slot.value;
+        }
+    }
+
+    /* Value stored for a key, storing value first if the key is new */
+    int insert(Field key, int value)
+    {
+        if ((used + 1) * 2 > slots.size())
+            grow();
+
+        size_t length = key.end - key.begin;
+        size_t mask = slots.size() - 1;
+        for (size_t i = hash(key.begin, length) & mask;; i = (i + 1) & mask)
+        {
+            Slot &slot = slots[i];
+            if (slot.value < 0)
+            {
+                slot.key = key.begin;
+                slot.length = static_cast<uint32_t>(length);
+                slot.value = value;
+                ++used;
+                return value;
+            }
+            if (slot.length == length && memcmp(slot.key, key.begin, length) == 0)
+                return slot.value;
+        }
+    }
+
+private:
+    struct Slot
+    {
+        const char *key;
+        uint32_t length;
+        int value;
+    };
+
+    static size_t hash(const char *key, size_t length)
+    {
+        uint64_t value = 1469598103934665603ull;
+        for (size_t i = 0; i < length; ++i)
+            value = (value ^ static_cast<unsigned char>(key[i])) * 1099511628211ull;
+        return static_cast<size_t>(value ^ (value >> 32));
+    }
+
+    void grow()
+    {
+        vector<Slot> old;
+        old.swap(slots);
+        Slot empty = {nullptr, 0, -1};
+        slots.assign(old.size() * 2, empty);
+
+        size_t mask = slots.size() - 1;
+        for (const Slot &slot : old)
+        {
+            if (slot.value < 0)
+                continue;
+            size_t i = hash(slot.key, slot.length) & mask;
+            while (slots[i].value >= 0)
+                i = (i + 1) & mask;
+            slots[i] = slot;
+        }
+    }
+
+    vector<Slot> slots;
+    size_t used;
+};
+
+Field trim(Field field)
+{
+    while (field.begin < field.end && (*field.begin == ' ' || *field.begin == '\t'))
+        ++field.begin;
+    while (field.end > field.begin && (field.end[-1] == ' ' || field.end[-1] == '\t'))
+        --field.end;
+    return field;
+}
+
+Field column(const vector<Field> &fields, int index)
+{
+    if (index < 0 || index >= static_cast<int>(fields.size()))
+    {
+        Field missing = {nullptr, nullptr, false};
+        return missing;
+    }
+    return trim(fields[index]);
+}
+
+bool isEmpty(Field field)
+{
+    return field.begin == field.end;
+}
+
+bool sameText(Field a, Field b)
+{
+    return a.end - a.begin == b.end - b.begin && memcmp(a.begin, b.begin, a.end - a.begin) == 0;
+}
+
+string toString(Field field)
+{
+    if (!field.escaped)
+        return string(field.begin, field.end);
+
+    string text;
+    text.reserve(field.end - field.begin);
+    for (const char *at = field.begin; at < field.end; ++at)
+    {
+        text += *at;
+        if (*at == '"' && at + 1 < field.end && at[1] == '"')
+            ++at;
+    }
+    return text;
+}
+
+int findColumn(const vector<Field> &header, const char *name)
+{
+    size_t length = strlen(name);
+    for (size_t i = 0; i < header.size(); ++i)
+    {
+        Field field = trim(header[i]);
+        if (static_cast<size_t>(field.end - field.begin) == length && memcmp(field.begin, name, length) == 0)
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool parseInteger(Field field, long long &value)
+{
+    const char *at = field.begin;
+    bool negative = at < field.end && *at == '-';
+    if (negative || (at < field.end && *at == '+'))
+        ++at;
+    if (at == field.end)
+        return false;
+
+    long long result = 0;
+    for (; at < field.end; ++at)
+    {
+        if (*at < '0' || *at > '9' || result > 99999999999999999ll)
+            return false;
+        result = result * 10 + (*at - '0');
+    }
+    value = negative ? -result : result;
+    return true;
+}
+
+/* Parses a decimal number with optional fraction and exponent without strtod,
+   which would need a terminated string */
+bool parseNumber(Field field, double &value)
+{
+    static const double powers[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+    const char *at = field.begin;
+    bool negative = at < field.end && *at == '-';
+    if (negative || (at < field.end && *at == '+'))
+        ++at;
+
+    uint64_t mantissa = 0;
+    int exponent = 0;
+    int digits = 0;
+    bool fraction = false;
+    for (; at < field.end; ++at)
+    {
+        if (*at == '.' && !fraction)
+        {
+            fraction = true;
+            continue;
+        }
+        if (*at < '0' || *at > '9')
+            break;
+
+        ++digits;
+        if (mantissa < 1000000000000000000ull)
+        {
+            mantissa = mantissa * 10 + (*at - '0');
+            if (fraction)
+                --exponent;
+        }
+        else if (!fraction)
+        {
+            ++exponent;
+        }
+    }
+    if (digits == 0)
+        return false;
+
+    if (at < field.end && (*at == 'e' || *at == 'E'))
+    {
+        Field rest = {at + 1, field.end, false};
+        long long power;
+        if (!parseInteger(rest, power) || power > 400 || power < -400)
+            return false;
+        exponent += static_cast<int>(power);
+        at = field.end;
+    }
+    if (at != field.end)
+        return false;
+
+    double result = static_cast<double>(mantissa);
+    if (exponent < 0)
+        result /= -exponent <= 22 ? powers[-exponent] : pow(10.0, -exponent);
+    else if (exponent > 0)
+        result *= exponent <= 22 ? powers[exponent] : pow(10.0, exponent);
+    value = negative ? -result : result;
+    return true;
+}
+
+/* Parses a GTFS time of day (H:MM:SS, hours may exceed 24) into seconds */
+bool parseTime(Field field, int &seconds)
+{
+    /* Fast path for the usual HH:MM:SS */
+    const char *at = field.begin;
+    if (field.end - at == 8 && at[2] == ':' && at[5] == ':')
+    {
+        unsigned d[6];
+        const int offsets[6] = {0, 1, 3, 4, 6, 7};
+        bool digits = true;
+        for (int i = 0; i < 6; ++i)
+        {
+            d[i] = static_cast<unsigned>(at[offsets[i]] - '0');
+            digits = digits && d[i] < 10;
+        }
+        if (digits)
+        {
+            seconds = (d[0] * 10 + d[1]) * 3600 + (d[2] * 10 + d[3]) * 60 + d[4] * 10 + d[5];
+            return true;
+        }
+    }
+
+    int parts[3] = {0, 0, 0};
+    int part = 0;
+    int digits = 0;
+    for (const char *at = field.begin; at < field.end; ++at)
+    {
+        if (*at == ':')
+        {
+            if (digits == 0 || ++part > 2)
+                return false;
+            digits = 0;
+        }
+        else if (*at >= '0' && *at <= '9' && digits < 4)
+        {
+            parts[part] = parts[part] * 10 + (*at - '0');
+            ++digits;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    if (part != 2 || digits == 0)
+        return false;
+
+    seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+    return true;
+}
+
+string location(const string &fileName, int line)
+{
+    return fileName + ":" + to_string(line) + ": ";
+}
+
+/* Great-circle distance in kilometers */
+double haversine(double lat1, double lon1, double lat2, double lon2)
+{
+    const double radians = 3.14159265358979323846 / 180.0;
+    double dLat = (lat2 - lat1) * radians;
+    double dLon = (lon2 - lon1) * radians;
+    double a = sin(dLat / 2) * sin(dLat / 2) +
+               cos(lat1 * radians) * cos(lat2 * radians) * sin(dLon / 2) * sin(dLon / 2);
+    return 2.0 * 6371.0088 * asin(min(1.0, sqrt(a)));
+}
+
+/* Append a CSV field, quoted only when it has to be */
+void appendField(string &text, const string &value)
+{
+    if (value.find_first_of(",\"\n\r") == string::npos)
+    {
+        text += value;
+        return;
+    }
+    text += '"';
+    for (char c : value)
+    {
+        if (c == '"')
+            text += '"';
+        text += c;
+    }
+    text += '"';
+}
+
+bool writeFile(const string &fileName, const string &text)
+{
+    FILE *file = fopen(fileName.c_str(), "wb");
+    if (!file)
+        return false;
+    bool ok = fwrite(text.data(), 1, text.size(), file) == text.size();
+    return fclose(file) == 0 && ok;
+}
+
+/* True if the node has an arc back with the same time and distance */
+bool hasReverse(const vector<Edge> &edges, int destination, const Edge &edge)
+{
+    for (const Edge &other : edges)
+    {
+        if (other.destination == destination && other.weight == edge.weight && other.distance == edge.distance)
+            return true;
+    }
+    return false;
+}
+
+/* Arc to a node, nullptr if there is none */
+Edge *findEdge(vector<Edge> &edges, int destination)
+{
+    for (Edge &edge : edges)
+    {
+        if (edge.destination == destination)
+            return &edge;
+    }
+    return nullptr;
+}
+
+/* Fill in the stop times a trip leaves out, evenly between the known ones, and drop untimed ends */
+void interpolateTimes(vector<ScheduledStop> &stops)
+{
+    size_t first = 0;
+    while (first < stops.size() && stops[first].departure < 0)
+        ++first;
+    size_t last = stops.size();
+    while (last > first && stops[last - 1].arrival < 0)
+        --last;
+
+    size_t known = first;
+    for (size_t i = first + 1; i < last; ++i)
+    {
+        if (stops[i].arrival < 0)
+            continue;
+        int leaving = stops[known].departure;
+        int span = stops[i].arrival - leaving;
+        for (size_t k = known + 1; k < i; ++k)
+        {
+            int time = leaving + static_cast<int>(static_cast<long long>(span) * (k - known) / (i - known));
+            stops[k].arrival = time;
+            stops[k].departure = time;
+        }
+        known = i;
+    }
+
+    stops.erase(stops.begin() + last, stops.end());
+    stops.erase(stops.begin(), stops.begin() + first);
+}
+
+struct GtfsStop
+{
+    Field name;
+    Field parent;
+    double latitude;
+    double longitude;
+    bool located; /* True if the coordinates were given */
+    int group;    /* Stop that represents the whole station */
+};
+
+struct GtfsStopTime
+{
+    int trip;
+    int sequence;
+    int stop;
+    int arrival;   /* Seconds after midnight, -1 if not given */
+    int departure; /* Seconds after midnight, -1 if not given */
+};
+}
+
+NetworkLoader::NetworkLoader() : transferMinutes(DefaultTransferMinutes)
+{
+}
+
+bool NetworkLoader::fail(const string &message)
+{
+    error = message;
+    return false;
+}
+
+bool NetworkLoader::load(const vector<string> &paths, vector<Station> &stations, vector<vector<Edge>> &graph,
+                         vector<ScheduledTrip> *trips)
+{
+    if (trips)
+        trips->clear();
+    if (paths.size() == 1)
+        return loadGtfs(paths[0], stations, graph, trips);
+    if (paths.size() == 2)
+        return loadCsv(paths[0], paths[1], stations, graph);
+    return fail("Expected a GTFS directory, or a stations file and an edges file");
+}
+
+bool NetworkLoader::loadCsv(const string &stationsFile, const string &edgesFile,
+                            vector<Station> &stations, vector<vector<Edge>> &graph)
+{
+    sources.clear();
+    sources.push_back(stationsFile);
+    sources.push_back(edgesFile);
+
+    MappedFile stationData, edgeData;
+    if (!stationData.open(stationsFile))
+        return fail("Cannot open " + stationsFile);
+    if (!edgeData.open(edgesFile))
+        return fail("Cannot open " + edgesFile);
+
+    stations.clear();
+    graph.clear();
+    vector<Field> fields;
+
+    /* Stations */
+    CsvReader stationReader(stationData);
+    if (!stationReader.next(fields))
+        return fail(stationsFile + ": file is empty");
+
+    int idColumn = findColumn(fields, "id");
+    int nameColumn = findColumn(fields, "name");
+    int lineColumn = findColumn(fields, "line");
+    int xColumn = findColumn(fields, "x");
+    int yColumn = findColumn(fields, "y");
+    if (nameColumn < 0)
+        return fail(stationsFile + ": missing column name");
+
+    /* Locations are only formatted for an error, so rows are read without allocating for them */
+    auto stationAt = [&]() { return location(stationsFile, stationReader.lineNumber()); };
+    unordered_map<long long, int> idIndex;
+    while (stationReader.next(fields))
+    {
+        int index = static_cast<int>(stations.size());
+        Station station = {index, toString(column(fields, nameColumn)), "", 0.0, 0.0};
+        if (station.name.empty())
+            return fail(stationAt() + "missing station name");
+
+        long long id;
+        if (idColumn >= 0)
+        {
+            if (!parseInteger(column(fields, idColumn), id))
+                return fail(stationAt() + "invalid station id");
+            if (!idIndex.insert(make_pair(id, index)).second)
+                return fail(stationAt() + "duplicate station id " + to_string(id));
+        }
+        if (lineColumn >= 0)
+            station.line = toString(column(fields, lineColumn));
+        if (xColumn >= 0 && !isEmpty(column(fields, xColumn)) && !parseNumber(column(fields, xColumn), station.x))
+            return fail(stationAt() + "invalid x coordinate");
+        if (yColumn >= 0 && !isEmpty(column(fields, yColumn)) && !parseNumber(column(fields, yColumn), station.y))
+            return fail(stationAt() + "invalid y coordinate");
+
+        stations.push_back(station);
+    }
+    graph.resize(stations.size());
+
+    /* Without an id column edges refer to stations by row, starting at 0 */
+    auto stationIndex = [&](Field field)
+    {
+        long long id;
+        if (!parseInteger(field, id))
+            return -1;
+        if (idColumn >= 0)
+        {
+            auto found = idIndex.find(id);
+            return found == idIndex.end() ? -1 : found->second;
+        }
+        return id >= 0 && id < static_cast<long long>(stations.size()) ? static_cast<int>(id) : -1;
+    };
+
+    /* Edges */
+    CsvReader edgeReader(edgeData);
+    if (!edgeReader.next(fields))
+        return fail(edgesFile + ": file is empty");
+
+    int fromColumn = findColumn(fields, "from");
+    int toColumn = findColumn(fields, "to");
+    int minutesColumn = findColumn(fields, "minutes");
+    int distanceColumn = findColumn(fields, "distance");
+    int directedColumn = findColumn(fields, "directed");
+    if (fromColumn < 0 || toColumn < 0 || minutesColumn < 0)
+        return fail(edgesFile + ": missing column from, to or minutes");
+
+    auto edgeAt = [&]() { return location(edgesFile, edgeReader.lineNumber()); };
+    while (edgeReader.next(fields))
+    {
+        int from = stationIndex(column(fields, fromColumn));
+        int to = stationIndex(column(fields, toColumn));
+        if (from < 0 || to < 0)
+            return fail(edgeAt() + "unknown station");
+
+        double minutes;
+        if (!parseNumber(column(fields, minutesColumn), minutes) || minutes < 0 || minutes > 0xFFFF)
+            return fail(edgeAt() + "invalid travel time");
+
+        double distance = 0.0;
+        Field distanceField = column(fields, distanceColumn);
+        if (!isEmpty(distanceField) && (!parseNumber(distanceField, distance) || distance < 0))
+            return fail(edgeAt() + "invalid distance");
+
+        long long directed = 0;
+        Field directedField = column(fields, directedColumn);
+        if (!isEmpty(directedField) && !parseInteger(directedField, directed))
+            return fail(edgeAt() + "invalid directed flag");
+
+        int weight = static_cast<int>(lround(minutes));
+        graph[from].push_back({to, weight, distance});
+        if (!directed)
+            graph[to].push_back({from, weight, distance});
+    }
+    return true;
+}
+
+bool NetworkLoader::saveCsv(const string &stationsFile, const string &edgesFile,
+                            const vector<Station> &stations, const vector<vector<Edge>> &graph)
+{
+    char number[96];
+    string text = "id,name,line,x,y\n";
+    for (size_t i = 0; i < stations.size(); ++i)
+    {
+        text += to_string(i);
+        text += ',';
+        appendField(text, stations[i].name);
+        text += ',';
+        appendField(text, stations[i].line);
+        snprintf(number, sizeof(number), ",%.6f,%.6f\n", stations[i].x, stations[i].y);
+        text += number;
+    }
+    if (!writeFile(stationsFile, text))
+        return fail("Cannot write " + stationsFile);
+
+    /* Bidirectional pairs are written once, from the lower id */
+    text = "from,to,minutes,distance,directed\n";
+    for (size_t from = 0; from < graph.size(); ++from)
+    {
+        for (const Edge &edge : graph[from])
+        {
+            bool paired = edge.destination != static_cast<int>(from) && edge.destination >= 0 &&
+                          edge.destination < static_cast<int>(graph.size()) &&
+                          hasReverse(graph[edge.destination], static_cast<int>(from), edge);
+            if (paired && edge.destination < static_cast<int>(from))
+                continue;
+            snprintf(number, sizeof(number), "%zu,%d,%d,%.6f,%d\n", from, edge.destination, edge.weight,
+                     edge.distance, paired ? 0 : 1);
+            text += number;
+        }
+    }
+    if (!writeFile(edgesFile, text))
+        return fail("Cannot write " + edgesFile);
+    return true;
+}
+
+bool NetworkLoader::loadGtfs(const string &directory, vector<Station> &stations, vector<vector<Edge>> &graph,
+                            vector<ScheduledTrip> *trips)
+{
+    string prefix = directory;
+    if (!prefix.empty() && prefix[prefix.size() - 1] != '/' && prefix[prefix.size() - 1] != '\\')
+        prefix += '/';
+
+    string stopsFile = prefix + "stops.txt";
+    string stopTimesFile = prefix + "stop_times.txt";
+    string tripsFile = prefix + "trips.txt";
+    string routesFile = prefix + "routes.txt";
+
+    sources.clear();
+    sources.push_back(stopsFile);
+    sources.push_back(stopTimesFile);
+    sources.push_back(tripsFile);
+    sources.push_back(routesFile);
+
+    /* All files stay mapped until the end, the hash tables point into them */
+    MappedFile stopData, stopTimeData, tripData, routeData;
+    if (!stopData.open(stopsFile))
+        return fail("Cannot open " + stopsFile);
+    if (!stopTimeData.open(stopTimesFile))
+        return fail("Cannot open " + stopTimesFile);
+    bool hasTrips = tripData.open(tripsFile);
+    bool hasRoutes = hasTrips && routeData.open(routesFile);
+
+    stations.clear();
+    graph.clear();
+    if (trips)
+        trips->clear();
+    vector<Field> fields;
+
+    /* Stops */
+    CsvReader stopReader(stopData);
+    if (!stopReader.next(fields))
+        return fail(stopsFile + ": file is empty");
+
+    int stopIdColumn = findColumn(fields, "stop_id");
+    int stopNameColumn = findColumn(fields, "stop_name");
+    int latColumn = findColumn(fields, "stop_lat");
+    int lonColumn = findColumn(fields, "stop_lon");
+    int parentColumn = findColumn(fields, "parent_station");
+    if (stopIdColumn < 0 || stopNameColumn < 0)
+        return fail(stopsFile + ": missing column stop_id or stop_name");
+
+    vector<GtfsStop> stops;
+    KeyIndex stopIndex;
+    while (stopReader.next(fields))
+    {
+        Field id = column(fields, stopIdColumn);
+        if (isEmpty(id))
+            return fail(location(stopsFile, stopReader.lineNumber()) + "missing stop_id");
+
+        int index = static_cast<int>(stops.size());
+        if (stopIndex.insert(id, index) != index)
+            return fail(location(stopsFile, stopReader.lineNumber()) + "duplicate stop_id");
+
+        GtfsStop stop = {column(fields, stopNameColumn), column(fields, parentColumn), 0.0, 0.0, false, index};
+        stop.located = parseNumber(column(fields, latColumn), stop.latitude) &&
+                       parseNumber(column(fields, lonColumn), stop.longitude);
+        stops.push_back(stop);
+    }
+
+    /* Platforms and boarding areas belong to their outermost parent station */
+    for (GtfsStop &stop : stops)
+    {
+        for (int depth = 0; depth < 4 && !isEmpty(stops[stop.group].parent); ++depth)
+        {
+            int parent = stopIndex.find(stops[stop.group].parent);
+            if (parent < 0)
+                break;
+            stop.group = parent;
+        }
+    }
+
+    /* Lines, one per distinct route name */
+    vector<string> lineNames;
+    unordered_map<string, int> lineIndex;
+    auto lineOf = [&](const string &name)
+    {
+        auto found = lineIndex.find(name);
+        if (found != lineIndex.end())
+            return found->second;
+        lineIndex.insert(make_pair(name, static_cast<int>(lineNames.size())));
+        lineNames.push_back(name);
+        return static_cast<int>(lineNames.size()) - 1;
+    };
+
+    KeyIndex routeLines;
+    if (hasRoutes)
+    {
+        CsvReader routeReader(routeData);
+        if (routeReader.next(fields))
+        {
+            int routeIdColumn = findColumn(fields, "route_id");
+            int shortNameColumn = findColumn(fields, "route_short_name");
+            int longNameColumn = findColumn(fields, "route_long_name");
+            if (routeIdColumn < 0)
+                return fail(routesFile + ": missing column route_id");
+
+            while (routeReader.next(fields))
+            {
+                Field id = column(fields, routeIdColumn);
+                Field name = column(fields, shortNameColumn);
+                if (isEmpty(name))
+                    name = column(fields, longNameColumn);
+                if (isEmpty(name))
+                    name = id;
+                routeLines.insert(id, lineOf(toString(name)));
+            }
+        }
+    }
+
+    /* Trips, numbered in file order, with the line of their route */
+    KeyIndex tripIndex;
+    vector<int> tripLine;
+    if (hasTrips)
+    {
+        CsvReader tripReader(tripData);
+        if (tripReader.next(fields))
+        {
+            int tripIdColumn = findColumn(fields, "trip_id");
+            int routeIdColumn = findColumn(fields, "route_id");
+            if (tripIdColumn < 0 || routeIdColumn < 0)
+                return fail(tripsFile + ": missing column trip_id or route_id");
+
+            while (tripReader.next(fields))
+            {
+                Field route = column(fields, routeIdColumn);
+                int line = routeLines.find(route);
+                if (line < 0)
+                    line = lineOf(toString(route));
+
+                int trip = static_cast<int>(tripLine.size());
+                if (tripIndex.insert(column(fields, tripIdColumn), trip) == trip)
+                    tripLine.push_back(line);
+            }
+        }
+    }
+
+    /* Stop times */
+    CsvReader stopTimeReader(stopTimeData);
+    if (!stopTimeReader.next(fields))
+        return fail(stopTimesFile + ": file is empty");
+
+    int tripColumn = findColumn(fields, "trip_id");
+    int arrivalColumn = findColumn(fields, "arrival_time");
+    int departureColumn = findColumn(fields, "departure_time");
+    int stopColumn = findColumn(fields, "stop_id");
+    int sequenceColumn = findColumn(fields, "stop_sequence");
+    if (tripColumn < 0 || stopColumn < 0 || sequenceColumn < 0)
+        return fail(stopTimesFile + ": missing column trip_id, stop_id or stop_sequence");
+
+    vector<GtfsStopTime> stopTimes;
+    stopTimes.reserve(stopTimeData.size() / 32);
+    Field lastTripId = {nullptr, nullptr, false};
+    int lastTrip = -1;
+    bool ordered = true;
+    while (stopTimeReader.next(fields))
+    {
+        Field tripId = column(fields, tripColumn);
+
+        /* Rows of one trip are normally adjacent, so most rows skip the lookup */
+        if (lastTrip < 0 || !sameText(tripId, lastTripId))
+        {
+            if (hasTrips)
+            {
+                lastTrip = tripIndex.find(tripId);
+            }
+            else
+            {
+                lastTrip = tripIndex.insert(tripId, static_cast<int>(tripLine.size()));
+                if (lastTrip == static_cast<int>(tripLine.size()))
+                    tripLine.push_back(-1);
+            }
+            lastTripId = tripId;
+        }
+
+        /* Trips missing from trips.txt are ignored */
+        if (lastTrip < 0)
+            continue;
+
+        GtfsStopTime stopTime = {lastTrip, 0, stopIndex.find(column(fields, stopColumn)), -1, -1};
+        if (stopTime.stop < 0)
+            return fail(location(stopTimesFile, stopTimeReader.lineNumber()) + "unknown stop_id");
+
+        long long sequence;
+        if (!parseInteger(column(fields, sequenceColumn), sequence) || sequence < 0 || sequence > INT32_MAX)
+            return fail(location(stopTimesFile, stopTimeReader.lineNumber()) + "invalid stop_sequence");
+        stopTime.sequence = static_cast<int>(sequence);
+
+        if (!parseTime(column(fields, arrivalColumn), stopTime.arrival))
+            stopTime.arrival = -1;
+        if (!parseTime(column(fields, departureColumn), stopTime.departure))
+            stopTime.departure = stopTime.arrival;
+        if (stopTime.arrival < 0)
+            stopTime.arrival = stopTime.departure;
+
+        if (!stopTimes.empty())
+        {
+            const GtfsStopTime &previous = stopTimes.back();
+            if (previous.trip > stopTime.trip ||
+                (previous.trip == stopTime.trip && previous.sequence >= stopTime.sequence))
+                ordered = false;
+        }
+        stopTimes.push_back(stopTime);
+    }
+
+    if (!ordered)
+    {
+        auto tripOrder = [](const GtfsStopTime &a, const GtfsStopTime &b)
+        {
+            return a.trip != b.trip ? a.trip < b.trip : a.sequence < b.sequence;
+        };
+        stable_sort(stopTimes.begin(), stopTimes.end(), tripOrder);
+    }
+
+    /* One node per station and line, created when first used */
+    vector<vector<pair<int, int>>> groupNodes(stops.size());
+    vector<int> nodeGroup;
+    auto nodeOf = [&](int group, int line)
+    {
+        for (const pair<int, int> &node : groupNodes[group])
+        {
+            if (node.first == line)
+                return node.second;
+        }
+
+        int id = static_cast<int>(stations.size());
+        Station station = {id, toString(stops[group].name), line >= 0 ? lineNames[line] : "", 0.0, 0.0};
+        stations.push_back(station);
+        graph.emplace_back();
+        nodeGroup.push_back(group);
+        groupNodes[group].push_back(make_pair(line, id));
+        return id;
+    };
+
+    for (size_t i = 0; i < stopTimes.size(); ++i)
+    {
+        const GtfsStopTime &arriving = stopTimes[i];
+        GtfsStop &station = stops[stops[arriving.stop].group];
+
+        /* Stations without coordinates take those of a platform */
+        if (!station.located && stops[arriving.stop].located)
+        {
+            station.latitude = stops[arriving.stop].latitude;
+            station.longitude = stops[arriving.stop].longitude;
+            station.located = true;
+        }
+
+        int line = tripLine[arriving.trip];
+        int to = nodeOf(stops[arriving.stop].group, line);
+        bool firstStop = i == 0 || stopTimes[i - 1].trip != arriving.trip;
+        if (trips)
+        {
+            if (firstStop)
+            {
+                trips->emplace_back();
+                trips->back().line = line >= 0 ? lineNames[line] : string();
+            }
+            ScheduledStop call = {to, arriving.arrival, arriving.departure};
+            trips->back().stops.push_back(call);
+        }
+        if (firstStop)
+            continue;
+
+        const GtfsStopTime &departing = stopTimes[i - 1];
+        int fromGroup = stops[departing.stop].group;
+        if (fromGroup == stops[arriving.stop].group)
+            continue;
+
+        /* Most hops repeat one already seen; those only need their time */
+        int minutes = -1;
+        if (departing.departure >= 0 && arriving.arrival >= departing.departure)
+            minutes = min(max((arriving.arrival - departing.departure + 30) / 60, 1), 0xFFFF);
+
+        vector<Edge> &edges = graph[nodeOf(fromGroup, line)];
+        Edge *edge = findEdge(edges, to);
+        if (edge && (minutes < 0 || minutes >= edge->weight))
+            continue;
+
+        const GtfsStop &origin = stops[fromGroup];
+        double distance = 0.0;
+        if (origin.located && station.located)
+            distance = haversine(origin.latitude, origin.longitude, station.latitude, station.longitude);
+        if (minutes < 0)
+            minutes = min(max(static_cast<int>(lround(distance / EstimatedSpeedKmh * 60.0)), 1), 0xFFFF);
+
+        if (edge)
+            edge->weight = minutes;
+        else
+            edges.push_back({to, minutes, distance});
+    }
+
+    if (trips)
+    {
+        for (ScheduledTrip &trip : *trips)
+            interpolateTimes(trip.stops);
+    }
+
+    /* Transfers between the lines of a station */
+    for (const vector<pair<int, int>> &nodes : groupNodes)
+    {
+        for (size_t a = 0; a < nodes.size(); ++a)
+        {
+            for (size_t b = 0; b < nodes.size(); ++b)
+            {
+                if (a != b)
+                    graph[nodes[a].second].push_back({nodes[b].second, transferMinutes, 0.0});
+            }
+        }
+    }
+
+    /* Project coordinates to kilometers around the centre of the network */
+    double centreLatitude = 0.0, centreLongitude = 0.0;
+    int located = 0;
+    for (int group : nodeGroup)
+    {
+        if (stops[group].located)
+        {
+            centreLatitude += stops[group].latitude;
+            centreLongitude += stops[group].longitude;
+            ++located;
+        }
+    }
+    if (located > 0)
+    {
+        centreLatitude /= located;
+        centreLongitude /= located;
+    }
+
+    const double kmPerDegree = 6371.0088 * 3.14159265358979323846 / 180.0;
+    double kmPerLongitude = kmPerDegree * cos(centreLatitude * 3.14159265358979323846 / 180.0);
+    for (Station &station : stations)
+    {
+        const GtfsStop &stop = stops[nodeGroup[station.id]];
+        if (!stop.located)
+            continue;
+        station.x = (stop.longitude - centreLongitude) * kmPerLongitude;
+        station.y = (centreLatitude - stop.latitude) * kmPerDegree;
+    }
+
+    if (stations.empty())
+        return fail(stopTimesFile + ": no usable stop times");
+    return true;
+}
@@ -0,0 +1,125 @@
+#ifndef NETWORKLOADER_H
+#define NETWORKLOADER_H
+
+#include "MetroData.h"
+#include <string>
+#include <vector>
+
+/**
+ * @brief Loads metro networks from external files
+ *
+ * Produces the same node-level stations and adjacency list as
+ * initializeMetroNetwork(), so the result can be passed to
+ * buildMetroNetwork() or any routing function unchanged. Input files are
+ * memory-mapped and parsed in a single pass; fields are referenced in place
+ * and only station and line names are copied into strings.
+ *
+ * Two formats are supported:
+ * - A pair of CSV files. The stations file has the columns name, and
+ *   optionally id, line (slash-separated) and x, y for drawing. The edges
+ *   file has the columns from, to, minutes and optionally distance (km) and
+ *   directed (1 for one-way). Columns may appear in any order and edges are
+ *   bidirectional unless marked as directed.
+ * - A GTFS feed directory with stops.txt and stop_times.txt. When trips.txt
+ *   is present, every (station, route) pair becomes its own node with the
+ *   route as its line, and the nodes of a station are joined by transfer
+ *   edges; routes.txt supplies line names. Platforms are merged into their
+ *   parent station.
+ */
+class NetworkLoader
+{
+public:
+    /** @brief Transfer time between the routes of a GTFS station unless set otherwise */
+    static const int DefaultTransferMinutes = 2;
+
+    /**
+     * @brief Construct a loader with default settings
+     */
+    NetworkLoader();
+
+    /**
+     * @brief Set the time charged for changing routes inside a GTFS station
+     * @param minutes Transfer time in minutes
+     */
+    void setTransferMinutes(int minutes) { transferMinutes = minutes; }
+
+    /**
+     * @brief Load stations and edges from a pair of CSV files
+     * @param stationsFile Path of the stations file
+     * @param edgesFile Path of the edges file
+     * @param stations Output vector of stations, id equal to the index
+     * @param graph Output adjacency list between the stations
+     * @return False on a missing file or malformed input, see errorString()
+     */
+    bool loadCsv(const std::string &stationsFile, const std::string &edgesFile,
+                 std::vector<Station> &stations, std::vector<std::vector<Edge>> &graph);
+
+    /**
+     * @brief Load a network from a GTFS feed
+     *
+     * Travel times come from consecutive stop times of each trip, keeping the
+     * fastest run between two nodes. Hops without times are estimated from
+     * their length. Station coordinates are projected to kilometers around
+     * the centre of the feed, with y pointing south.
+     *
+     * The trips themselves can be kept for a Timetable. Stop times the feed
+     * leaves out are interpolated between the known ones of the trip, and
+     * calls before the first or after the last known time are dropped.
+     * Service calendars are not read, so every trip runs every day.
+     *
+     * @param directory Directory containing the feed's text files
+     * @param stations Output vector of nodes, id equal to the index
+     * @param graph Output adjacency list between the nodes
+     * @param trips Optional output of every trip in node IDs
+     * @return False on a missing file or malformed input, see errorString()
+     */
+    bool loadGtfs(const std::string &directory, std::vector<Station> &stations,
+                  std::vector<std::vector<Edge>> &graph, std::vector<ScheduledTrip> *trips = nullptr);
+
+    /**
+     * @brief Write stations and edges as a pair of CSV files that loadCsv() reads back
+     *
+     * An edge and its exact reverse are written as one bidirectional row,
+     * every other edge as a directed one.
+     *
+     * @param stationsFile Path of the stations file
+     * @param edgesFile Path of the edges file
+     * @param stations Stations, id equal to the index
+     * @param graph Adjacency list between the stations
+     * @return False if a file cannot be written, see errorString()
+     */
+    bool saveCsv(const std::string &stationsFile, const std::string &edgesFile,
+                 const std::vector<Station> &stations, const std::vector<std::vector<Edge>> &graph);
+
+    /**
+     * @brief Load a network from command line style arguments
+     * @param paths One GTFS directory, or a stations file followed by an edges file
+     * @param stations Output vector of stations
+     * @param graph Output adjacency list
+     * @param trips Optional output of the scheduled trips, empty for CSV files
+     * @return False if the arguments or the files are invalid, see errorString()
+     */
+    bool load(const std::vector<std::string> &paths, std::vector<Station> &stations,
+              std::vector<std::vector<Edge>> &graph, std::vector<ScheduledTrip> *trips = nullptr);
+
+    /** @brief Description of the last failure */
+    const std::string &errorString() const { return error; }
+
+    /**
+     * @brief Files the last load read or looked for, including optional ones that were missing
+     *
+     * Passed to RoutePlanner::saveSnapshot() so a snapshot can tell when it
+     * no longer matches its sources.
+     */
+    const std::vector<std::string> &sourceFiles() const { return sources; }
+
+private:
+    /* Record a failure message and return false */
+    bool fail(const std::string &message);
+
+    int transferMinutes;
+    std::string error;
+    std::vector<std::string> sources;
+};
+
+#endif // NETWORKLOADER_H
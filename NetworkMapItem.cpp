@@ -0,0 +1,469 @@
+#include "NetworkMapItem.h"
+#include "MapTileCache.h"
+#include <QFontMetricsF>
+#include <QHash>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <algorithm>
+#include <cmath>
+#include <unordered_set>
+
+using namespace std;
+
+namespace
+{
+/* Stations per grid cell the grid is sized for */
+const int StationsPerCell = 16;
+const int MaxGridSide = 256;
+
+const double LineWidth = 3;
+const double StationRadius = 5;
+const double StationPenWidth = 2;
+
+/* Offset of a label's top edge below its station, in device pixels */
+const double LabelOffset = 14;
+
+/* Typical spacing on screen, in device pixels, from which stations that are not major are drawn */
+const double MinorStationSpacing = 12;
+
+/* Colour of a station: the first of the known lines it serves, in a fixed order */
+QColor stationColor(const QString &line)
+{
+    static const char *const known[] = {"Blue", "Yellow", "Red", "Pink", "Magenta", "Violet"};
+    for (const char *name : known)
+    {
+        if (line.contains(name))
+            return NetworkMapItem::lineColor(name);
+    }
+    return NetworkMapItem::lineColor(line.section('/', 0, 0));
+}
+
+/* Painted element waiting to be sorted into its cell */
+struct Placed
+{
+    uint64_t key; /**< Cell and colour */
+    int index;
+
+    bool operator<(const Placed &other) const { return key < other.key || (key == other.key && index < other.index); }
+};
+}
+
+NetworkMapItem::NetworkMapItem(QGraphicsItem *parent)
+    : QGraphicsItem(parent), columns(1), rows(1), minimumScale(1), typicalSpacing(0), labelAscent(0),
+      placedScale(0), tiles(nullptr)
+{
+    /* paint() needs the exposed rectangle to skip cells */
+    setFlag(ItemUsesExtendedStyleOption);
+}
+
+QColor NetworkMapItem::lineColor(const QString &line)
+{
+    if (line == "Blue")
+        return QColor(0x4169E1);
+    if (line == "Yellow")
+        return QColor(0xFFDF00);
+    if (line == "Red")
+        return QColor(0xFF4040);
+    if (line == "Pink")
+        return QColor(0xFC8EAC);
+    if (line == "Magenta")
+        return QColor(0xCC338B);
+    if (line == "Violet")
+        return QColor(0x8b5cf6);
+
+    /* Stable color for lines of loaded networks that have no assigned color */
+    if (line.isEmpty())
+        return QColor(0x9ca3af);
+    return QColor::fromHsv(qHash(line) % 360, 170, 230);
+}
+
+int NetworkMapItem::cellOf(const QPointF &point) const
+{
+    int column = extent.width() > 0 ? static_cast<int>((point.x() - extent.left()) / extent.width() * columns) : 0;
+    int row = extent.height() > 0 ? static_cast<int>((point.y() - extent.top()) / extent.height() * rows) : 0;
+    return min(max(row, 0), rows - 1) * columns + min(max(column, 0), columns - 1);
+}
+
+void NetworkMapItem::setNetwork(const MetroNetwork &network)
+{
+    prepareGeometryChange();
+    segments.clear();
+    segmentColours.clear();
+    stations.clear();
+    stationColours.clear();
+    majorStations.clear();
+    labels.clear();
+    labelOffsets.clear();
+    labelOrder.clear();
+    labelShown.clear();
+    linePens.clear();
+    stationPens.clear();
+    cells.clear();
+    geometry = bounds = QRectF();
+    largestLabel = QSizeF();
+    typicalSpacing = 0;
+    placedScale = 0;
+    labelAscent = 0;
+
+    const vector<Station> &source = network.stations;
+    int stationCount = static_cast<int>(source.size());
+    if (stationCount == 0)
+    {
+        extent = QRectF();
+        columns = rows = 1;
+        cells.resize(2);
+        return;
+    }
+
+    double minX = source[0].x, maxX = minX, minY = source[0].y, maxY = minY;
+    for (const Station &station : source)
+    {
+        minX = min(minX, station.x);
+        maxX = max(maxX, station.x);
+        minY = min(minY, station.y);
+        maxY = max(maxY, station.y);
+    }
+    extent = QRectF(minX, minY, maxX - minX, maxY - minY);
+    int side = min(MaxGridSide, max(1, static_cast<int>(sqrt(static_cast<double>(stationCount) / StationsPerCell))));
+    columns = rows = side;
+
+    /* Every distinct colour gets one index and its pens */
+    vector<QColor> palette;
+    QHash<QRgb, int> paletteIndex;
+    auto colourIndex = [&](const QColor &colour) -> int
+    {
+        auto found = paletteIndex.constFind(colour.rgba());
+        if (found != paletteIndex.constEnd())
+            return found.value();
+        palette.push_back(colour);
+        paletteIndex.insert(colour.rgba(), static_cast<int>(palette.size()) - 1);
+        return static_cast<int>(palette.size()) - 1;
+    };
+    vector<int> lineColours;
+    for (const string &name : network.lineNames)
+        lineColours.push_back(colourIndex(lineColor(QString::fromStdString(name))));
+    int unnamedColour = colourIndex(lineColor(QString()));
+
+    /* Each connection once per station pair and line; neighbours once per station pair */
+    vector<QLineF> lines;
+    vector<int> colours;
+    unordered_set<uint64_t> drawn;
+    unordered_set<uint64_t> adjacent;
+    vector<int> neighbours(stationCount, 0);
+    const CsrGraph &graph = network.graph;
+    for (int state = 0; state < graph.nodeCount(); state++)
+    {
+        int from = network.stateStation[state];
+        for (int arc = graph.arcBegin(state); arc < graph.arcEnd(state); arc++)
+        {
+            int to = network.stateStation[graph.target(arc)];
+            uint8_t line = network.arcLine[arc];
+            uint64_t key = (static_cast<uint64_t>(min(from, to)) * stationCount + max(from, to)) * 256 + line;
+            if (from == to || !drawn.insert(key).second)
+                continue;
+
+            lines.push_back(QLineF(source[from].x, source[from].y, source[to].x, source[to].y));
+            colours.push_back(line == NoLine ? unnamedColour : lineColours[line]);
+            if (adjacent.insert(key / 256).second)
+            {
+                neighbours[from]++;
+                neighbours[to]++;
+            }
+        }
+    }
+
+    if (!lines.empty())
+    {
+        vector<double> lengths;
+        lengths.reserve(lines.size());
+        for (const QLineF &line : lines)
+            lengths.push_back(line.length());
+        nth_element(lengths.begin(), lengths.begin() + lengths.size() / 2, lengths.end());
+        typicalSpacing = lengths[lengths.size() / 2];
+    }
+
+    vector<int> circleColours(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+        circleColours[s] = colourIndex(stationColor(QString::fromStdString(source[s].line)));
+
+    /* Sort both kinds into cells, by colour within a cell, so one pass paints a cell with few pen changes */
+    uint64_t paletteSize = palette.size();
+    vector<Placed> placedLines(lines.size());
+    for (size_t i = 0; i < lines.size(); ++i)
+    {
+        placedLines[i].key = cellOf((lines[i].p1() + lines[i].p2()) / 2) * paletteSize + colours[i];
+        placedLines[i].index = static_cast<int>(i);
+    }
+    sort(placedLines.begin(), placedLines.end());
+    vector<Placed> placedStations(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+    {
+        placedStations[s].key = cellOf(QPointF(source[s].x, source[s].y)) * paletteSize + circleColours[s];
+        placedStations[s].index = s;
+    }
+    sort(placedStations.begin(), placedStations.end());
+
+    int cellCount = columns * rows;
+    cells.assign(cellCount + 1, Cell());
+    for (Cell &cell : cells)
+    {
+        cell.firstSegment = -1;
+        cell.firstStation = -1;
+    }
+
+    segments.reserve(lines.size());
+    segmentColours.reserve(lines.size());
+    for (const Placed &placed : placedLines)
+    {
+        int cell = static_cast<int>(placed.key / paletteSize);
+        if (cells[cell].firstSegment < 0)
+            cells[cell].firstSegment = static_cast<int>(segments.size());
+        const QLineF &line = lines[placed.index];
+        segments.push_back(line);
+        segmentColours.push_back(colours[placed.index]);
+
+        QRectF area = QRectF(line.p1(), line.p2()).normalized();
+        double margin = LineWidth / 2;
+        cells[cell].bounds |= area.adjusted(-margin, -margin, margin, margin);
+    }
+
+    labelFont = QFont();
+    labelAscent = QFontMetricsF(labelFont).ascent();
+    stations.reserve(stationCount);
+    stationColours.reserve(stationCount);
+    majorStations.reserve(stationCount);
+    labels.reserve(stationCount);
+    labelOffsets.reserve(stationCount);
+    for (const Placed &placed : placedStations)
+    {
+        int cell = static_cast<int>(placed.key / paletteSize);
+        if (cells[cell].firstStation < 0)
+            cells[cell].firstStation = static_cast<int>(stations.size());
+        const Station &station = source[placed.index];
+        QPointF centre(station.x, station.y);
+        stations.push_back(centre);
+        stationColours.push_back(circleColours[placed.index]);
+        uint32_t mask = network.lineMasks[placed.index];
+        majorStations.push_back((mask & (mask - 1)) != 0 || neighbours[placed.index] <= 1);
+
+        /* Labels are drawn untransformed, so they are laid out for the identity */
+        QStaticText label(QString::fromStdString(station.name));
+        label.setTextFormat(Qt::PlainText);
+        label.setPerformanceHint(QStaticText::AggressiveCaching);
+        label.prepare(QTransform(), labelFont);
+        QSizeF size = label.size();
+        labels.push_back(label);
+        labelOffsets.push_back(QPointF(-size.width() / 2, LabelOffset));
+        largestLabel = largestLabel.expandedTo(size);
+
+        double reach = StationRadius + StationPenWidth / 2;
+        cells[cell].bounds |= QRectF(centre.x() - reach, centre.y() - reach, 2 * reach, 2 * reach);
+    }
+
+    /* Major stations claim label space first, the rest in grid order */
+    labelOrder.reserve(stationCount);
+    for (int pass = 1; pass >= 0; --pass)
+    {
+        for (int i = 0; i < stationCount; ++i)
+        {
+            if (majorStations[i] == pass)
+                labelOrder.push_back(i);
+        }
+    }
+    labelShown.assign(stationCount, 0);
+
+    /* Empty cells start where the next non-empty one does, so every cell is a range up to the next */
+    cells[cellCount].firstSegment = static_cast<int>(segments.size());
+    cells[cellCount].firstStation = static_cast<int>(stations.size());
+    for (int cell = cellCount - 1; cell >= 0; --cell)
+    {
+        if (cells[cell].firstSegment < 0)
+            cells[cell].firstSegment = cells[cell + 1].firstSegment;
+        if (cells[cell].firstStation < 0)
+            cells[cell].firstStation = cells[cell + 1].firstStation;
+        geometry |= cells[cell].bounds;
+    }
+    setMinimumScale(minimumScale);
+
+    for (const QColor &colour : palette)
+    {
+        linePens.push_back(QPen(colour, LineWidth));
+        stationPens.push_back(QPen(colour, StationPenWidth));
+    }
+    batches.assign(palette.size(), QVector<QLineF>());
+}
+
+void NetworkMapItem::setTileCache(MapTileCache *cache)
+{
+    tiles = cache;
+    update();
+}
+
+void NetworkMapItem::setMinimumScale(double scale)
+{
+    prepareGeometryChange();
+    minimumScale = scale;
+    if (geometry.isNull())
+    {
+        bounds = QRectF();
+        return;
+    }
+
+    /* Half the widest label either side, the tallest below its offset */
+    double across = largestLabel.width() / 2 / scale;
+    double below = (LabelOffset + largestLabel.height()) / scale;
+    bounds = geometry.adjusted(-across, 0, across, below);
+}
+
+bool NetworkMapItem::showsMinorStations(double scale) const
+{
+    return typicalSpacing * scale >= MinorStationSpacing;
+}
+
+void NetworkMapItem::placeLabels(double scale, vector<char> &shown) const
+{
+    shown.assign(stations.size(), 0);
+    if (largestLabel.isEmpty())
+        return;
+
+    /* Labels are placed in device pixels relative to the scene origin, so a pan keeps the placement */
+    unordered_set<uint64_t> occupied;
+    bool minor = showsMinorStations(scale);
+    double cellSize = largestLabel.height();
+    for (int i : labelOrder)
+    {
+        if (!majorStations[i] && !minor)
+            break;
+
+        QPointF origin = stations[i] * scale + labelOffsets[i];
+        QSizeF size = labels[i].size();
+        int64_t left = static_cast<int64_t>(floor(origin.x() / cellSize));
+        int64_t right = static_cast<int64_t>(floor((origin.x() + size.width()) / cellSize));
+        int64_t top = static_cast<int64_t>(floor(origin.y() / cellSize));
+        int64_t bottom = static_cast<int64_t>(floor((origin.y() + size.height()) / cellSize));
+        auto key = [](int64_t column, int64_t row)
+        {
+            return (static_cast<uint64_t>(column) << 32) ^ static_cast<uint32_t>(row);
+        };
+
+        bool free = true;
+        for (int64_t row = top; row <= bottom && free; ++row)
+        {
+            for (int64_t column = left; column <= right && free; ++column)
+                free = occupied.count(key(column, row)) == 0;
+        }
+        if (!free)
+            continue;
+        for (int64_t row = top; row <= bottom; ++row)
+        {
+            for (int64_t column = left; column <= right; ++column)
+                occupied.insert(key(column, row));
+        }
+        shown[i] = 1;
+    }
+}
+
+QRectF NetworkMapItem::boundingRect() const
+{
+    return bounds;
+}
+
+void NetworkMapItem::paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *)
+{
+    double scale = QStyleOptionGraphicsItem::levelOfDetailFromTransform(painter->worldTransform());
+    if (scale <= 0)
+        return;
+
+    /* Scales of the pyramid are blitted; the others, and tiles still being rendered, are painted here */
+    int level = tiles ? tiles->levelOf(scale) : -1;
+    if (level >= 0)
+    {
+        tiles->paint(painter, option->exposedRect, level);
+        return;
+    }
+
+    if (scale != placedScale)
+    {
+        placeLabels(scale, labelShown);
+        placedScale = scale;
+    }
+    draw(painter, option->exposedRect, scale, labelShown, batches, true);
+}
+
+void NetworkMapItem::render(QPainter *painter, const QRectF &area, double scale, const vector<char> &shown) const
+{
+    vector<QVector<QLineF>> scratch(linePens.size());
+    draw(painter, area, scale, shown, scratch, false);
+}
+
+void NetworkMapItem::draw(QPainter *painter, const QRectF &area, double scale, const vector<char> &shown,
+                          vector<QVector<QLineF>> &visible, bool staticLabels) const
+{
+    int cellCount = static_cast<int>(cells.size()) - 1;
+    bool minor = showsMinorStations(scale);
+
+    /* Antialiasing is not worth its cost while the map is too small to show every station */
+    painter->setRenderHint(QPainter::Antialiasing, minor);
+
+    /* Connections: gather the visible ones by colour, then one call per colour */
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        if (!cells[cell].bounds.intersects(area))
+            continue;
+        for (int i = cells[cell].firstSegment; i < cells[cell + 1].firstSegment; ++i)
+            visible[segmentColours[i]].append(segments[i]);
+    }
+    for (size_t colour = 0; colour < visible.size(); ++colour)
+    {
+        if (visible[colour].isEmpty())
+            continue;
+        painter->setPen(linePens[colour]);
+        painter->drawLines(visible[colour]);
+        visible[colour].clear();
+    }
+
+    /* Stations, then their names above everything else */
+    painter->setBrush(Qt::white);
+    int currentColour = -1;
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        if (!cells[cell].bounds.intersects(area))
+            continue;
+        for (int i = cells[cell].firstStation; i < cells[cell + 1].firstStation; ++i)
+        {
+            if (!minor && !majorStations[i])
+                continue;
+            if (stationColours[i] != currentColour)
+            {
+                currentColour = stationColours[i];
+                painter->setPen(stationPens[currentColour]);
+            }
+            painter->drawEllipse(stations[i], StationRadius, StationRadius);
+        }
+    }
+
+    /* Labels keep their size on screen: drawn untransformed at their station's device position */
+    double across = largestLabel.width() / 2 / scale;
+    double below = (LabelOffset + largestLabel.height()) / scale;
+    QRectF labelArea = area.adjusted(-across, -below, across, 0);
+    QTransform world = painter->worldTransform();
+    painter->setWorldTransform(QTransform());
+    painter->setPen(QColor(0xffffff));
+    painter->setFont(labelFont);
+    for (int cell = 0; cell < cellCount; ++cell)
+    {
+        if (!cells[cell].bounds.intersects(labelArea))
+            continue;
+        for (int i = cells[cell].firstStation; i < cells[cell + 1].firstStation; ++i)
+        {
+            if (!shown[i])
+                continue;
+            QPointF origin = world.map(stations[i]) + labelOffsets[i];
+            if (staticLabels)
+                painter->drawStaticText(origin, labels[i]);
+            else
+                painter->drawText(origin + QPointF(0, labelAscent), labels[i].text());
+        }
+    }
+    painter->setWorldTransform(world);
+}
@@ -0,0 +1,163 @@
+#ifndef NETWORKMAPITEM_H
+#define NETWORKMAPITEM_H
+
+#include "MetroNetwork.h"
+#include <QGraphicsItem>
+#include <QColor>
+#include <QFont>
+#include <QLineF>
+#include <QPen>
+#include <QPointF>
+#include <QRectF>
+#include <QStaticText>
+#include <QSizeF>
+#include <QVector>
+#include <cstdint>
+#include <vector>
+
+class MapTileCache;
+
+/**
+ * @brief Scene item that paints a whole metro network
+ *
+ * Replaces one scene item per line segment, station and label. Geometry is
+ * kept in flat arrays and sorted into the cells of a uniform grid, and by
+ * colour inside each cell. paint() gathers the segments of the cells that
+ * meet the exposed rectangle and draws each colour with a single
+ * drawLines() call, then the stations and labels of those cells with one
+ * pen per colour. Pens and label layouts are built once in setNetwork().
+ *
+ * What is drawn depends on the view scale. Interchanges and termini are
+ * major stations and always drawn; the others only once their typical
+ * spacing on screen leaves room for them. Labels keep their size on screen
+ * and are placed major stations first, each only where no label placed
+ * before it took the space, so zooming out thins them instead of piling
+ * them up. Placement is kept per scale, so panning reuses it.
+ *
+ * With a MapTileCache set, scales of its pyramid are blitted from tiles and
+ * only the others are painted from the arrays.
+ */
+class NetworkMapItem : public QGraphicsItem
+{
+public:
+    /**
+     * @brief Construct an empty item
+     * @param parent Optional parent item
+     */
+    explicit NetworkMapItem(QGraphicsItem *parent = nullptr);
+
+    /**
+     * @brief Replace the drawn network
+     *
+     * Connections are drawn once per station pair and line, stations at
+     * their coordinates with their name below.
+     *
+     * @param network Canonical network; not referenced afterwards
+     */
+    void setNetwork(const MetroNetwork &network);
+
+    /**
+     * @brief Display colour of a line
+     * @param line Name of the line, empty for connections without one
+     * @return Colour of a known line, otherwise a stable colour derived from the name
+     */
+    static QColor lineColor(const QString &line);
+
+    /** @brief Area of the connections and stations, labels not included */
+    QRectF networkRect() const { return geometry; }
+
+    /**
+     * @brief Set the smallest scale the item is viewed at
+     *
+     * Labels reach further in scene units the smaller the scale, so the
+     * bounding rectangle covers them down to this scale.
+     *
+     * @param scale Device pixels per scene unit
+     */
+    void setMinimumScale(double scale);
+
+    /**
+     * @brief Paint the scales of a tile pyramid from its tiles
+     * @param cache Tiles of this item, nullptr to paint everything from the arrays
+     */
+    void setTileCache(MapTileCache *cache);
+
+    /**
+     * @brief Choose the labels shown at a scale
+     *
+     * Major stations are placed first, each other one only while the
+     * cells of the grid spatial hash under its label are free.
+     *
+     * @param scale Device pixels per scene unit
+     * @param shown Set to whether the label of every station is drawn
+     */
+    void placeLabels(double scale, std::vector<char> &shown) const;
+
+    /**
+     * @brief Paint part of the network at a scale
+     *
+     * Does not change the item, so several threads may render at once,
+     * each into its own painter. Labels are drawn from their text, as
+     * their cached layouts are not shared between threads.
+     *
+     * @param painter Painter whose world transform scales by scale
+     * @param area Scene area to paint; whatever touches it is drawn
+     * @param scale Device pixels per scene unit
+     * @param shown Labels placed by placeLabels() for the same scale
+     */
+    void render(QPainter *painter, const QRectF &area, double scale, const std::vector<char> &shown) const;
+
+    QRectF boundingRect() const override;
+    void paint(QPainter *painter, const QStyleOptionGraphicsItem *option, QWidget *widget = nullptr) override;
+
+private:
+    /* Geometry of one grid cell; segments and stations are ranges sorted by colour */
+    struct Cell
+    {
+        QRectF bounds;              /**< Connections and stations of the cell, pens included */
+        int firstSegment;
+        int firstStation;
+    };
+
+    /* Grid cell of a point */
+    int cellOf(const QPointF &point) const;
+
+    /* Whether the stations that are not major are drawn at a scale */
+    bool showsMinorStations(double scale) const;
+
+    /* Paint what touches an area; visible is scratch space of one vector per colour */
+    void draw(QPainter *painter, const QRectF &area, double scale, const std::vector<char> &shown,
+              std::vector<QVector<QLineF>> &visible, bool staticLabels) const;
+
+    std::vector<Cell> cells;          /**< Grid cells row by row, plus one end marker */
+    int columns;
+    int rows;
+    QRectF extent;                    /**< Area the grid covers */
+    QRectF geometry;                  /**< Connections and stations */
+    QRectF bounds;                    /**< Everything the item paints down to the minimum scale */
+    double minimumScale;
+
+    std::vector<QLineF> segments;     /**< Connections, by cell and colour within the cell */
+    std::vector<int> segmentColours;  /**< Colour of every segment */
+    std::vector<QPointF> stations;    /**< Station centres, by cell and colour within the cell */
+    std::vector<int> stationColours;  /**< Colour of every station */
+    std::vector<char> majorStations;  /**< Whether every station is an interchange or terminus */
+    std::vector<QStaticText> labels;  /**< Station names laid out once */
+    std::vector<QPointF> labelOffsets;/**< Top-left corner of every label from its station, in device pixels */
+    QSizeF largestLabel;              /**< Width of the widest label and height of the tallest */
+    double typicalSpacing;            /**< Median connection length */
+    double labelAscent;               /**< Height of the label font above its baseline */
+
+    std::vector<int> labelOrder;      /**< Stations in the order their labels are placed */
+    std::vector<char> labelShown;     /**< Whether every station's label is drawn at the placed scale */
+    double placedScale;               /**< Scale labelShown was placed for, 0 for none */
+    MapTileCache *tiles;              /**< Tiles painted in place of the arrays, if any */
+
+    std::vector<QPen> linePens;       /**< Pen of every colour for connections */
+    std::vector<QPen> stationPens;    /**< Pen of every colour for station circles */
+    QFont labelFont;
+
+    std::vector<QVector<QLineF>> batches; /**< Visible segments of every colour, reused between paints */
+};
+
+#endif // NETWORKMAPITEM_H
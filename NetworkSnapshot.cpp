@@ -0,0 +1,548 @@
+#include "NetworkSnapshot.h"
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unordered_map>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+const uint32_t NetworkSnapshot::Version;
+
+struct NetworkSnapshot::Section
+{
+    uint32_t id;
+    uint32_t elementSize; /* sizeof the element type, guards against layout changes */
+    uint64_t offset;      /* From the start of the file, a multiple of SectionAlignment */
+    uint64_t count;       /* Number of elements */
+    uint64_t checksum;    /* Over the section's bytes, checked by verify() */
+};
+
+namespace
+{
+const char FileMagic[4] = {'M', 'R', 'S', 'N'};
+const uint32_t ByteOrderMark = 0x01020304;
+const uint64_t SectionAlignment = 64;
+
+struct FileHeader
+{
+    char magic[4];
+    uint32_t version;
+    uint32_t byteOrder;      /* ByteOrderMark as written, rejects files from other architectures */
+    uint32_t sectionCount;
+    uint64_t fileSize;
+    uint64_t tableChecksum;  /* Over this header and the section table, computed with this field zero */
+    uint64_t reserved[4];
+};
+
+enum SectionId
+{
+    SourceList = 1,
+    StringPool,
+    StationRecords,
+    LineNameOffsets,
+    LineMasks,
+    TransferMinutes,
+    GraphOffsets,
+    GraphTargets,
+    GraphMinutes,
+    GraphMetres,
+    ArcLines,
+    StateStations,
+    NodeStations,
+    TableInfo,
+    TableMinutes,
+    TableMetres,
+    TableNext,
+    HierarchyInfo,
+    HierarchyUpOffsets,
+    HierarchyUpArcs,
+    HierarchyDownOffsets,
+    HierarchyDownArcs,
+    LandmarkInfo,
+    LandmarkNodes,
+    LandmarkFrom,
+    LandmarkTo,
+    InputDescription
+};
+
+/* Station with its names replaced by offsets into the string pool */
+struct StationRecord
+{
+    uint32_t name;
+    uint32_t line;
+    double x;
+    double y;
+};
+
+/* Section contents before they are written */
+struct PendingSection
+{
+    uint32_t id;
+    uint32_t elementSize;
+    const void *data;
+    uint64_t count;
+};
+
+template <typename T>
+PendingSection pending(uint32_t id, const T *data, size_t count)
+{
+    PendingSection section = {id, static_cast<uint32_t>(sizeof(T)), data, count};
+    return section;
+}
+
+template <typename T>
+PendingSection pending(uint32_t id, const FlatArray<T> &array)
+{
+    return pending(id, array.data(), array.size());
+}
+
+template <typename T>
+PendingSection pending(uint32_t id, const vector<T> &values)
+{
+    return pending(id, values.data(), values.size());
+}
+
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+/* Four-lane multiply-rotate hash; reads eight bytes at a time so checking a
+   large snapshot is bound by memory bandwidth rather than the hash */
+uint64_t checksum(const char *data, size_t size)
+{
+    const uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+    const uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+
+    uint64_t lanes[4] = {prime1 + prime2, prime2, 0, ~prime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32)
+    {
+        for (int lane = 0; lane < 4; ++lane)
+        {
+            uint64_t word;
+            memcpy(&word, data + i + lane * 8, sizeof(word));
+            lanes[lane] = rotateLeft(lanes[lane] + word * prime2, 31) * prime1;
+        }
+    }
+
+    uint64_t hash = size;
+    for (int lane = 0; lane < 4; ++lane)
+        hash = rotateLeft(hash ^ (lanes[lane] * prime2), 27) * prime1;
+    for (; i < size; ++i)
+        hash = rotateLeft(hash ^ static_cast<unsigned char>(data[i]) * prime1, 11) * prime2;
+
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+/* Size and modification time of a file, false if it does not exist */
+bool fileStamp(const string &fileName, int64_t &size, int64_t &modified)
+{
+#ifdef _WIN32
+    struct _stat64 status;
+    if (_stat64(fileName.c_str(), &status) != 0)
+        return false;
+#else
+    struct stat status;
+    if (stat(fileName.c_str(), &status) != 0)
+        return false;
+#endif
+    size = static_cast<int64_t>(status.st_size);
+    modified = static_cast<int64_t>(status.st_mtime);
+    return true;
+}
+
+/* One line "size modified path" per source; size -1 records a file that did not exist */
+string describeSources(const vector<string> &sources)
+{
+    ostringstream out;
+    for (const string &source : sources)
+    {
+        int64_t size = -1, modified = 0;
+        fileStamp(source, size, modified);
+        out << size << ' ' << modified << ' ' << source << '\n';
+    }
+    return out.str();
+}
+
+uint64_t alignUp(uint64_t offset)
+{
+    return (offset + SectionAlignment - 1) / SectionAlignment * SectionAlignment;
+}
+}
+
+NetworkSnapshot::NetworkSnapshot() : sections(nullptr), sectionCount(0)
+{
+}
+
+bool NetworkSnapshot::write(const string &fileName, const MetroNetwork &network, const AllPairsRouteTable *table,
+                            const ContractionHierarchy *hierarchy, const LandmarkTable *landmarks,
+                            const string &inputs, const vector<string> &sources)
+{
+    /* Intern station and line names so repeated strings are stored once */
+    vector<char> pool;
+    unordered_map<string, uint32_t> interned;
+    auto intern = [&](const string &text)
+    {
+        auto found = interned.find(text);
+        if (found != interned.end())
+            return found->second;
+        uint32_t offset = static_cast<uint32_t>(pool.size());
+        pool.insert(pool.end(), text.begin(), text.end());
+        pool.push_back('\0');
+        interned.insert(make_pair(text, offset));
+        return offset;
+    };
+
+    vector<StationRecord> stations;
+    stations.reserve(network.stations.size());
+    for (const Station &station : network.stations)
+    {
+        StationRecord record = {intern(station.name), intern(station.line), station.x, station.y};
+        stations.push_back(record);
+    }
+
+    vector<uint32_t> lineNames;
+    for (const string &name : network.lineNames)
+        lineNames.push_back(intern(name));
+
+    string sourceList = describeSources(sources);
+    const CsrGraph &graph = network.graph;
+
+    vector<PendingSection> pendingSections;
+    pendingSections.push_back(pending(InputDescription, inputs.data(), inputs.size()));
+    pendingSections.push_back(pending(SourceList, sourceList.data(), sourceList.size()));
+    pendingSections.push_back(pending(StringPool, pool));
+    pendingSections.push_back(pending(StationRecords, stations));
+    pendingSections.push_back(pending(LineNameOffsets, lineNames));
+    pendingSections.push_back(pending(LineMasks, network.lineMasks));
+    pendingSections.push_back(pending(TransferMinutes, network.transferMinutes));
+    pendingSections.push_back(pending(GraphOffsets, graph.offsets));
+    pendingSections.push_back(pending(GraphTargets, graph.targets));
+    pendingSections.push_back(pending(GraphMinutes, graph.weights));
+    pendingSections.push_back(pending(GraphMetres, graph.lengths));
+    pendingSections.push_back(pending(ArcLines, network.arcLine));
+    pendingSections.push_back(pending(StateStations, network.stateStation));
+    pendingSections.push_back(pending(NodeStations, network.nodeStation));
+
+    uint64_t tableInfo[2] = {0, 0};
+    if (table && table->isBuilt())
+    {
+        tableInfo[0] = static_cast<uint64_t>(table->stationCount);
+        tableInfo[1] = table->graphFingerprint;
+        pendingSections.push_back(pending(TableInfo, tableInfo, 2));
+        pendingSections.push_back(pending(TableMinutes, table->minuteTable));
+        pendingSections.push_back(pending(TableMetres, table->metreTable));
+        pendingSections.push_back(pending(TableNext, table->nextTable));
+    }
+
+    uint64_t hierarchyInfo = 0;
+    if (hierarchy && hierarchy->isBuilt())
+    {
+        hierarchyInfo = hierarchy->graphFingerprint;
+        pendingSections.push_back(pending(HierarchyInfo, &hierarchyInfo, 1));
+        pendingSections.push_back(pending(HierarchyUpOffsets, hierarchy->upOffsets));
+        pendingSections.push_back(pending(HierarchyUpArcs, hierarchy->upArcs));
+        pendingSections.push_back(pending(HierarchyDownOffsets, hierarchy->downOffsets));
+        pendingSections.push_back(pending(HierarchyDownArcs, hierarchy->downArcs));
+    }
+
+    uint64_t landmarkInfo[3] = {0, 0, 0};
+    if (landmarks && landmarks->isBuilt())
+    {
+        landmarkInfo[0] = static_cast<uint64_t>(landmarks->nodeCount);
+        landmarkInfo[1] = static_cast<uint64_t>(landmarks->count);
+        landmarkInfo[2] = landmarks->graphFingerprint;
+        pendingSections.push_back(pending(LandmarkInfo, landmarkInfo, 3));
+        pendingSections.push_back(pending(LandmarkNodes, landmarks->landmarks));
+        pendingSections.push_back(pending(LandmarkFrom, landmarks->fromLandmark));
+        pendingSections.push_back(pending(LandmarkTo, landmarks->toLandmark));
+    }
+
+    /* Lay out the sections and checksum their contents */
+    vector<Section> entries(pendingSections.size());
+    uint64_t offset = alignUp(sizeof(FileHeader) + entries.size() * sizeof(Section));
+    uint64_t fileSize = offset;
+    for (size_t i = 0; i < pendingSections.size(); ++i)
+    {
+        const PendingSection &section = pendingSections[i];
+        uint64_t bytes = section.count * section.elementSize;
+        Section entry = {section.id, section.elementSize, offset, section.count,
+                         checksum(static_cast<const char *>(section.data), bytes)};
+        entries[i] = entry;
+        fileSize = offset + bytes;
+        offset = alignUp(fileSize);
+    }
+
+    FileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, FileMagic, sizeof(FileMagic));
+    header.version = Version;
+    header.byteOrder = ByteOrderMark;
+    header.sectionCount = static_cast<uint32_t>(entries.size());
+    header.fileSize = fileSize;
+
+    vector<char> head(sizeof(FileHeader) + entries.size() * sizeof(Section));
+    memcpy(head.data(), &header, sizeof(header));
+    memcpy(head.data() + sizeof(header), entries.data(), entries.size() * sizeof(Section));
+    header.tableChecksum = checksum(head.data(), head.size());
+    memcpy(head.data(), &header, sizeof(header));
+
+    /* Write under a temporary name so a crash never leaves a partial snapshot */
+    string temporary = fileName + ".tmp";
+    {
+        ofstream out(temporary, ios::binary | ios::trunc);
+        if (!out)
+            return false;
+
+        out.write(head.data(), head.size());
+        uint64_t written = head.size();
+        const char padding[SectionAlignment] = {};
+        for (size_t i = 0; i < pendingSections.size(); ++i)
+        {
+            out.write(padding, entries[i].offset - written);
+            uint64_t bytes = entries[i].count * entries[i].elementSize;
+            out.write(static_cast<const char *>(pendingSections[i].data), bytes);
+            written = entries[i].offset + bytes;
+        }
+        if (!out.flush())
+        {
+            out.close();
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+
+    /* rename() replaces the old file atomically on POSIX; Windows needs it removed first */
+    if (rename(temporary.c_str(), fileName.c_str()) != 0)
+    {
+        remove(fileName.c_str());
+        if (rename(temporary.c_str(), fileName.c_str()) != 0)
+        {
+            remove(temporary.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+bool NetworkSnapshot::open(const string &fileName)
+{
+    file.reset();
+    sections = nullptr;
+    sectionCount = 0;
+
+    shared_ptr<MappedFile> mapped = make_shared<MappedFile>();
+    if (!mapped->open(fileName) || mapped->size() < sizeof(FileHeader))
+        return false;
+
+    FileHeader header;
+    memcpy(&header, mapped->data(), sizeof(header));
+    if (memcmp(header.magic, FileMagic, sizeof(FileMagic)) != 0 || header.version != Version ||
+        header.byteOrder != ByteOrderMark || header.fileSize != mapped->size())
+        return false;
+
+    size_t headSize = sizeof(FileHeader) + static_cast<size_t>(header.sectionCount) * sizeof(Section);
+    if (header.sectionCount > 1024 || headSize > mapped->size())
+        return false;
+
+    /* The stored checksum was computed with its own field zero */
+    vector<char> head(mapped->data(), mapped->data() + headSize);
+    FileHeader zeroed = header;
+    zeroed.tableChecksum = 0;
+    memcpy(head.data(), &zeroed, sizeof(zeroed));
+    if (checksum(head.data(), head.size()) != header.tableChecksum)
+        return false;
+
+    const Section *table = reinterpret_cast<const Section *>(mapped->data() + sizeof(FileHeader));
+    for (uint32_t i = 0; i < header.sectionCount; ++i)
+    {
+        const Section &section = table[i];
+        if (section.offset % SectionAlignment != 0 || section.offset > header.fileSize ||
+            section.elementSize == 0 || section.count > (header.fileSize - section.offset) / section.elementSize)
+            return false;
+    }
+
+    file = mapped;
+    sections = table;
+    sectionCount = header.sectionCount;
+    return true;
+}
+
+bool NetworkSnapshot::verify() const
+{
+    if (!isOpen())
+        return false;
+
+    for (uint32_t i = 0; i < sectionCount; ++i)
+    {
+        const Section &section = sections[i];
+        if (checksum(file->data() + section.offset, section.count * section.elementSize) != section.checksum)
+            return false;
+    }
+    return true;
+}
+
+bool NetworkSnapshot::hasInputs(const string &inputs) const
+{
+    const Section *section = findSection(InputDescription);
+    return section && section->elementSize == 1 && section->count == inputs.size() &&
+           memcmp(file->data() + section->offset, inputs.data(), inputs.size()) == 0;
+}
+
+bool NetworkSnapshot::isStale() const
+{
+    const Section *section = findSection(SourceList);
+    if (!section || section->elementSize != 1)
+        return true;
+
+    istringstream in(string(file->data() + section->offset, section->count));
+    int64_t size, modified;
+    string source;
+    while (in >> size >> modified && in.get() == ' ' && getline(in, source))
+    {
+        int64_t currentSize = -1, currentModified = 0;
+        fileStamp(source, currentSize, currentModified);
+        if (currentSize != size || currentModified != modified)
+            return true;
+    }
+    return !in.eof();
+}
+
+const NetworkSnapshot::Section *NetworkSnapshot::findSection(uint32_t id) const
+{
+    for (uint32_t i = 0; i < sectionCount; ++i)
+    {
+        if (sections[i].id == id)
+            return &sections[i];
+    }
+    return nullptr;
+}
+
+template <typename T>
+bool NetworkSnapshot::readSection(uint32_t id, FlatArray<T> &array) const
+{
+    const Section *section = findSection(id);
+    if (!section || section->elementSize != sizeof(T))
+        return false;
+
+    const T *data = reinterpret_cast<const T *>(file->data() + section->offset);
+    array = FlatArray<T>::view(data, static_cast<size_t>(section->count), file);
+    return true;
+}
+
+bool NetworkSnapshot::readNetwork(MetroNetwork &network) const
+{
+    if (!isOpen())
+        return false;
+
+    FlatArray<char> pool;
+    FlatArray<StationRecord> stations;
+    FlatArray<uint32_t> lineNames;
+    MetroNetwork loaded;
+    CsrGraph &graph = loaded.graph;
+    if (!readSection(StringPool, pool) || !readSection(StationRecords, stations) ||
+        !readSection(LineNameOffsets, lineNames) || !readSection(LineMasks, loaded.lineMasks) ||
+        !readSection(TransferMinutes, loaded.transferMinutes) || !readSection(GraphOffsets, graph.offsets) ||
+        !readSection(GraphTargets, graph.targets) || !readSection(GraphMinutes, graph.weights) ||
+        !readSection(GraphMetres, graph.lengths) || !readSection(ArcLines, loaded.arcLine) ||
+        !readSection(StateStations, loaded.stateStation) || !readSection(NodeStations, loaded.nodeStation))
+        return false;
+
+    /* Check that the arrays agree in size; contents are covered by verify() */
+    size_t arcs = graph.targets.size();
+    if (graph.offsets.empty() || graph.offsets[graph.offsets.size() - 1] != arcs ||
+        graph.weights.size() != arcs || graph.lengths.size() != arcs || loaded.arcLine.size() != arcs ||
+        loaded.stateStation.size() != graph.offsets.size() - 1 ||
+        loaded.lineMasks.size() != stations.size() || loaded.transferMinutes.size() != stations.size() ||
+        (pool.size() > 0 && pool[pool.size() - 1] != '\0'))
+        return false;
+
+    /* Names are the only data copied out of the mapping */
+    auto text = [&](uint32_t offset)
+    {
+        return offset < pool.size() ? string(pool.data() + offset) : string();
+    };
+
+    loaded.stations.reserve(stations.size());
+    for (size_t i = 0; i < stations.size(); ++i)
+    {
+        const StationRecord &record = stations[i];
+        Station station = {static_cast<int>(i), text(record.name), text(record.line), record.x, record.y};
+        loaded.stations.push_back(station);
+    }
+    for (uint32_t offset : lineNames)
+        loaded.lineNames.push_back(text(offset));
+
+    network = loaded;
+    return true;
+}
+
+bool NetworkSnapshot::readAllPairs(AllPairsRouteTable &table) const
+{
+    FlatArray<uint64_t> info;
+    AllPairsRouteTable loaded;
+    if (!isOpen() || !readSection(TableInfo, info) || info.size() != 2 ||
+        !readSection(TableMinutes, loaded.minuteTable) || !readSection(TableMetres, loaded.metreTable) ||
+        !readSection(TableNext, loaded.nextTable))
+        return false;
+
+    uint64_t cells = info[0] * info[0];
+    if (info[0] == 0 || info[0] >= static_cast<uint64_t>(AllPairsRouteTable::MaxStations) ||
+        loaded.minuteTable.size() != cells || loaded.metreTable.size() != cells ||
+        loaded.nextTable.size() != cells)
+        return false;
+
+    loaded.stationCount = static_cast<int>(info[0]);
+    loaded.graphFingerprint = info[1];
+    table = loaded;
+    return true;
+}
+
+bool NetworkSnapshot::readContractionHierarchy(ContractionHierarchy &hierarchy) const
+{
+    FlatArray<uint64_t> info;
+    ContractionHierarchy loaded;
+    if (!isOpen() || !readSection(HierarchyInfo, info) || info.size() != 1 ||
+        !readSection(HierarchyUpOffsets, loaded.upOffsets) || !readSection(HierarchyUpArcs, loaded.upArcs) ||
+        !readSection(HierarchyDownOffsets, loaded.downOffsets) || !readSection(HierarchyDownArcs, loaded.downArcs))
+        return false;
+
+    if (loaded.upOffsets.size() < 2 || loaded.downOffsets.size() != loaded.upOffsets.size() ||
+        loaded.upOffsets[loaded.upOffsets.size() - 1] != loaded.upArcs.size() ||
+        loaded.downOffsets[loaded.downOffsets.size() - 1] != loaded.downArcs.size())
+        return false;
+
+    loaded.graphFingerprint = info[0];
+    hierarchy = loaded;
+    return true;
+}
+
+bool NetworkSnapshot::readLandmarks(LandmarkTable &landmarks) const
+{
+    FlatArray<uint64_t> info;
+    LandmarkTable loaded;
+    if (!isOpen() || !readSection(LandmarkInfo, info) || info.size() != 3 ||
+        !readSection(LandmarkNodes, loaded.landmarks) || !readSection(LandmarkFrom, loaded.fromLandmark) ||
+        !readSection(LandmarkTo, loaded.toLandmark))
+        return false;
+
+    uint64_t cells = info[0] * info[1];
+    if (info[1] == 0 || info[1] > info[0] || info[0] > static_cast<uint64_t>(INT_MAX) ||
+        loaded.landmarks.size() != info[1] || loaded.fromLandmark.size() != cells ||
+        loaded.toLandmark.size() != cells)
+        return false;
+
+    loaded.nodeCount = static_cast<int>(info[0]);
+    loaded.count = static_cast<int>(info[1]);
+    loaded.graphFingerprint = info[2];
+    landmarks = loaded;
+    return true;
+}
@@ -0,0 +1,135 @@
+#ifndef NETWORKSNAPSHOT_H
+#define NETWORKSNAPSHOT_H
+
+#include "MetroNetwork.h"
+#include "AllPairsRouteTable.h"
+#include "ContractionHierarchy.h"
+#include "LandmarkTable.h"
+#include "MappedFile.h"
+#include <memory>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Binary snapshot of a network and its routing indices for instant startup
+ *
+ * The file starts with a fixed header and a section table, followed by one
+ * 64-byte aligned section per array: station records over a pool of interned
+ * names, the routing graph, the network's per-station and per-arc arrays and
+ * optionally an all-pairs table, a Contraction Hierarchy and landmark tables. Arrays are stored
+ * in the in-memory layout, so after the file is mapped they are used in place
+ * through FlatArray views and only the station names are copied into strings.
+ *
+ * open() checks the header, the section table and its checksum, which costs
+ * the same for every network size. The checksum over the section contents is
+ * only checked by verify(), which reads the whole file.
+ *
+ * The snapshot also records a description of the inputs the network was
+ * requested from, so hasInputs() can tell a snapshot of another network, and
+ * the size and modification time of the files it was loaded from, so
+ * isStale() can tell when it must be rebuilt.
+ */
+class NetworkSnapshot
+{
+public:
+    /** @brief Format version; files with any other version are rejected */
+    static const uint32_t Version = 2;
+
+    /**
+     * @brief Write a snapshot
+     *
+     * The file is written under a temporary name and renamed when complete,
+     * so readers never see a partial snapshot.
+     *
+     * @param fileName Path of the file to create
+     * @param network Canonical network
+     * @param table All-pairs table built for network.graph, or nullptr
+     * @param hierarchy Contraction Hierarchy built for network.graph, or nullptr
+     * @param landmarks Landmark tables built for network.graph, or nullptr
+     * @param inputs Description of the requested network, checked by hasInputs()
+     * @param sources Files the network was loaded from, checked by isStale()
+     * @return True on success
+     */
+    static bool write(const std::string &fileName, const MetroNetwork &network, const AllPairsRouteTable *table,
+                      const ContractionHierarchy *hierarchy, const LandmarkTable *landmarks,
+                      const std::string &inputs, const std::vector<std::string> &sources);
+
+    /**
+     * @brief Construct an object without a snapshot
+     */
+    NetworkSnapshot();
+
+    /**
+     * @brief Map a snapshot file and check its header
+     * @param fileName Path of a file written by write()
+     * @return False if the file is missing, truncated, from another version or damaged
+     */
+    bool open(const std::string &fileName);
+
+    /** @brief True while a snapshot is open */
+    bool isOpen() const { return file && file->isOpen(); }
+
+    /**
+     * @brief Check the checksum over all section contents
+     * @return False if any byte of the snapshot changed since it was written
+     */
+    bool verify() const;
+
+    /**
+     * @brief Compare the recorded description of the inputs with another
+     * @param inputs Description of the network now requested, as passed to write()
+     * @return True if the snapshot was written for exactly these inputs
+     */
+    bool hasInputs(const std::string &inputs) const;
+
+    /**
+     * @brief Compare the recorded source files with the file system
+     * @return True if a source file is missing or its size or modification time changed
+     */
+    bool isStale() const;
+
+    /**
+     * @brief Fill a network whose arrays refer to the mapped file
+     * @param network Output network; stays valid after this object is destroyed
+     * @return False if the snapshot is not open or lacks a network section
+     */
+    bool readNetwork(MetroNetwork &network) const;
+
+    /**
+     * @brief Fill an all-pairs table whose arrays refer to the mapped file
+     * @param table Output table
+     * @return False if the snapshot holds no table
+     */
+    bool readAllPairs(AllPairsRouteTable &table) const;
+
+    /**
+     * @brief Fill a Contraction Hierarchy whose arrays refer to the mapped file
+     * @param hierarchy Output hierarchy
+     * @return False if the snapshot holds no hierarchy
+     */
+    bool readContractionHierarchy(ContractionHierarchy &hierarchy) const;
+
+    /**
+     * @brief Fill landmark tables whose arrays refer to the mapped file
+     * @param landmarks Output tables
+     * @return False if the snapshot holds no landmarks
+     */
+    bool readLandmarks(LandmarkTable &landmarks) const;
+
+private:
+    struct Section; /* Entry of the section table, defined in the source file */
+
+    /* Section table entry with the given id, nullptr if absent */
+    const Section *findSection(uint32_t id) const;
+
+    /* View of a section as an array of T, false if absent or malformed */
+    template <typename T>
+    bool readSection(uint32_t id, FlatArray<T> &array) const;
+
+    std::shared_ptr<MappedFile> file; /**< Shared with every array viewing the snapshot */
+    const Section *sections;
+    uint32_t sectionCount;
+};
+
+#endif // NETWORKSNAPSHOT_H
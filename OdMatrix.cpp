@@ -0,0 +1,234 @@
+#include "OdMatrix.h"
+#include "PriorityQueues.h"
+#include <algorithm>
+#include <atomic>
+#include <climits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+const int OdMatrix::TileSize;
+const uint16_t OdMatrix::Unreachable;
+const int OdMatrix::MaxFare;
+
+namespace
+{
+const size_t CacheLine = 64;
+
+size_t alignUp(size_t bytes)
+{
+    return (bytes + CacheLine - 1) / CacheLine * CacheLine;
+}
+
+/*
+ * Origins left to one worker. The owner takes from the front, thieves take
+ * the back half, both under the range's own lock. Padding keeps the ranges
+ * of different workers on different cache lines.
+ */
+struct WorkRange
+{
+    mutex lock;
+    int begin = 0;
+    int end = 0;
+    char padding[CacheLine];
+};
+
+/* Take the next origin of a worker's own range */
+bool takeOwn(WorkRange &range, int &origin)
+{
+    lock_guard<mutex> guard(range.lock);
+    if (range.begin >= range.end)
+        return false;
+    origin = range.begin++;
+    return true;
+}
+
+/* Move the back half of the first non-empty range of another worker into self */
+bool steal(vector<WorkRange> &ranges, int self, int &origin)
+{
+    int count = static_cast<int>(ranges.size());
+    for (int i = 1; i < count; ++i)
+    {
+        WorkRange &victim = ranges[(self + i) % count];
+        int begin, end;
+        {
+            lock_guard<mutex> guard(victim.lock);
+            if (victim.begin >= victim.end)
+                continue;
+            end = victim.end;
+            begin = victim.begin + (victim.end - victim.begin) / 2;
+            victim.end = begin;
+        }
+
+        /* The own range is empty, so no thief can be working on it */
+        lock_guard<mutex> guard(ranges[self].lock);
+        ranges[self].begin = begin + 1;
+        ranges[self].end = end;
+        origin = begin;
+        return true;
+    }
+    return false;
+}
+}
+
+OdMatrix::OdMatrix()
+    : stationCount(0), tilesPerRow(0), threadCount(0), fareTable(nullptr), storageBytes(0),
+      minuteCells(nullptr), metreCells(nullptr), fareCells(nullptr)
+{
+}
+
+bool OdMatrix::setFareTable(const FareTable *table)
+{
+    if (table && table->maximumFare() > MaxFare)
+        return false;
+    fareTable = table;
+    return true;
+}
+
+bool OdMatrix::compute(const MetroNetwork &network)
+{
+    const CsrGraph &graph = network.graph;
+    const FareTable &fares = fareTable ? *fareTable : FareTable::defaultTable();
+    int n = static_cast<int>(network.stations.size());
+    int states = graph.nodeCount();
+
+    /* Pad to whole tiles so every tile has the same layout */
+    size_t tiles = (static_cast<size_t>(n) + TileSize - 1) / TileSize;
+    size_t cells = tiles * tiles * TileSize * TileSize;
+    size_t minuteBytes = alignUp(cells * sizeof(uint16_t));
+    size_t metreBytes = alignUp(cells * sizeof(uint32_t));
+    size_t fareBytes = alignUp(cells * 2 * sizeof(uint16_t));
+
+    /* Left uninitialised: each page is first touched by the worker filling it */
+    storageBytes = minuteBytes + metreBytes + fareBytes + CacheLine;
+    storage.reset(new unsigned char[storageBytes]);
+    unsigned char *base = storage.get();
+    base += (CacheLine - reinterpret_cast<uintptr_t>(base) % CacheLine) % CacheLine;
+    minuteCells = reinterpret_cast<uint16_t *>(base);
+    metreCells = reinterpret_cast<uint32_t *>(base + minuteBytes);
+    fareCells = reinterpret_cast<uint16_t *>(base + minuteBytes + metreBytes);
+    stationCount = n;
+    tilesPerRow = tiles;
+    if (n == 0)
+        return true;
+
+    int workers = threadCount > 0 ? threadCount : static_cast<int>(thread::hardware_concurrency());
+    workers = max(1, min(workers, n));
+
+    /* Contiguous starting ranges keep each worker inside its own tile rows */
+    vector<WorkRange> ranges(workers);
+    for (int w = 0; w < workers; ++w)
+    {
+        ranges[w].begin = static_cast<int>(static_cast<int64_t>(n) * w / workers);
+        ranges[w].end = static_cast<int>(static_cast<int64_t>(n) * (w + 1) / workers);
+    }
+
+    atomic<int> completed(0);
+    atomic<bool> cancelled(false);
+    mutex progressLock;
+    int reported = 0;
+    int step = max(1, n / 100);
+
+    auto worker = [&](int self)
+    {
+        /*
+         * Dial's buckets order states by minutes. Ties are broken by metres:
+         * a state reached again in the same minute over a shorter route is
+         * queued again, so zero-minute arcs pass the shorter length on.
+         */
+        BucketQueue queue;
+        vector<int> minutes(states);
+        vector<uint32_t> length(states);
+        vector<int32_t> regularFares(n), holidayFares(n);
+
+        int origin;
+        while (!cancelled && (takeOwn(ranges[self], origin) || steal(ranges, self, origin)))
+        {
+            fill(minutes.begin(), minutes.end(), INT_MAX);
+            minutes[origin] = 0;
+            length[origin] = 0;
+            queue.reset(states);
+            queue.push(origin, 0);
+
+            while (!queue.empty())
+            {
+                int key;
+                int current = queue.pop(key);
+                if (key > minutes[current])
+                    continue;
+
+                for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+                {
+                    int next = graph.target(arc);
+                    int newMinutes = key + graph.minutes(arc);
+                    uint32_t newLength = length[current] + graph.metres(arc);
+                    if (newMinutes < minutes[next] || (newMinutes == minutes[next] && newLength < length[next]))
+                    {
+                        minutes[next] = newMinutes;
+                        length[next] = newLength;
+                        queue.push(next, newMinutes);
+                    }
+                }
+            }
+
+            /* Station states come first in the graph, so row entries are states [0, n); fares are charged a row at a time */
+            fares.fares(length.data(), n, fares.dayType(false), false, regularFares.data());
+            fares.fares(length.data(), n, fares.dayType(true), false, holidayFares.data());
+            int boarding = boardingMinutes(network, origin);
+            size_t rowBase = static_cast<size_t>(origin / TileSize) * tilesPerRow * TileSize * TileSize +
+                             static_cast<size_t>(origin % TileSize) * TileSize;
+            for (int target = 0; target < n; ++target)
+            {
+                size_t at = rowBase + static_cast<size_t>(target / TileSize) * TileSize * TileSize + target % TileSize;
+                int time = target == origin ? 0 : minutes[target] - boarding;
+                if (minutes[target] == INT_MAX || time >= Unreachable)
+                {
+                    minuteCells[at] = Unreachable;
+                    metreCells[at] = 0;
+                    fareCells[at * 2] = 0;
+                    fareCells[at * 2 + 1] = 0;
+                    continue;
+                }
+
+                minuteCells[at] = static_cast<uint16_t>(time);
+                metreCells[at] = length[target];
+                fareCells[at * 2] = static_cast<uint16_t>(regularFares[target]);
+                fareCells[at * 2 + 1] = static_cast<uint16_t>(holidayFares[target]);
+            }
+
+            int done = ++completed;
+            if (progress && (done % step == 0 || done == n))
+            {
+                lock_guard<mutex> guard(progressLock);
+                if (done > reported)
+                {
+                    reported = done;
+                    if (!progress(done, n))
+                        cancelled = true;
+                }
+            }
+        }
+    };
+
+    vector<thread> pool;
+    for (int w = 1; w < workers; ++w)
+        pool.emplace_back(worker, w);
+    worker(0);
+    for (thread &t : pool)
+        t.join();
+
+    if (cancelled)
+    {
+        storage.reset();
+        storageBytes = 0;
+        minuteCells = nullptr;
+        metreCells = nullptr;
+        fareCells = nullptr;
+        stationCount = 0;
+        tilesPerRow = 0;
+        return false;
+    }
+    return true;
+}
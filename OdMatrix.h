@@ -0,0 +1,130 @@
+#ifndef ODMATRIX_H
+#define ODMATRIX_H
+
+#include "FareTable.h"
+#include "MetroNetwork.h"
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+
+/**
+ * @brief Full origin-destination matrix of travel time, distance and fare
+ *
+ * compute() runs one single-source search per origin station on every
+ * hardware thread. Origins are split into one contiguous range per worker;
+ * a worker that runs out of origins steals the back half of another
+ * worker's remaining range, so uneven search costs balance out without a
+ * shared queue. Each worker keeps its own search buffers for the whole run.
+ *
+ * Results are stored in square tiles of TileSize x TileSize cells, one array
+ * per quantity, each starting on a cache line. A worker writing a row never
+ * shares a cache line with another worker's row, and blocks of nearby
+ * origins and destinations stay close together in memory.
+ *
+ * Times match RoutePlanner::findRoute(): the boarding time at the origin is
+ * not counted. Among routes of equal time the matrix keeps the shortest,
+ * while findRoute() returns whichever its index finds first, so distances
+ * and fares may differ from it for such pairs.
+ * Memory is 10 bytes per station pair.
+ */
+class OdMatrix
+{
+public:
+    /** @brief Edge length of a tile in cells */
+    static const int TileSize = 64;
+
+    /** @brief Marks an unreachable pair in the minute matrix */
+    static const uint16_t Unreachable = 0xFFFF;
+
+    /** @brief Highest fare the matrix stores */
+    static const int MaxFare = 0xFFFF;
+
+    /**
+     * @brief Called as origins complete, one call at a time, from worker threads
+     *
+     * Receives the number of completed origins and the total; returning false
+     * cancels the computation.
+     */
+    typedef std::function<bool(int completed, int total)> ProgressCallback;
+
+    /**
+     * @brief Construct an empty matrix; size() is 0 until compute()
+     */
+    OdMatrix();
+
+    /**
+     * @brief Set the number of worker threads
+     * @param count Number of threads, 0 to use all hardware threads
+     */
+    void setThreadCount(int count) { threadCount = count; }
+
+    /**
+     * @brief Set the function receiving progress reports
+     * @param callback Called about once per percent of completed origins
+     */
+    void setProgressCallback(const ProgressCallback &callback) { progress = callback; }
+
+    /**
+     * @brief Set the fares stored by compute()
+     * @param table Fare table, must outlive compute(); nullptr for FareTable::defaultTable()
+     * @return False if a fare of the table exceeds MaxFare; the previous table is then kept
+     */
+    bool setFareTable(const FareTable *table);
+
+    /**
+     * @brief Compute the matrix for every pair of stations
+     * @param network Canonical network
+     * @return False if the progress callback cancelled the computation
+     */
+    bool compute(const MetroNetwork &network);
+
+    /** @brief Number of stations covered by the matrix */
+    int size() const { return stationCount; }
+
+    /** @brief True if to can be reached from from */
+    bool reachable(int from, int to) const { return minuteCells[cell(from, to)] != Unreachable; }
+
+    /** @brief Shortest travel time in minutes */
+    int travelTime(int from, int to) const { return minuteCells[cell(from, to)]; }
+
+    /** @brief Length of the fastest route in whole metres */
+    uint32_t metres(int from, int to) const { return metreCells[cell(from, to)]; }
+
+    /** @brief Length of the fastest route in kilometers */
+    double distance(int from, int to) const { return metreCells[cell(from, to)] * 0.001; }
+
+    /**
+     * @brief Cash fare of the fastest route from the fare table
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param isHoliday Boolean indicating if it's a holiday/Sunday
+     * @return Fare in INR
+     */
+    int fare(int from, int to, bool isHoliday) const { return fareCells[cell(from, to) * 2 + (isHoliday ? 1 : 0)]; }
+
+    /** @brief Bytes allocated for the matrix */
+    size_t memoryBytes() const { return storageBytes; }
+
+private:
+    /* Index of a pair: tiles in row-major order, cells row-major inside a tile */
+    size_t cell(int from, int to) const
+    {
+        size_t tile = static_cast<size_t>(from / TileSize) * tilesPerRow + to / TileSize;
+        return tile * (TileSize * TileSize) + (from % TileSize) * TileSize + to % TileSize;
+    }
+
+    int stationCount;
+    size_t tilesPerRow;
+    int threadCount;
+    ProgressCallback progress;
+    const FareTable *fareTable;
+
+    std::unique_ptr<unsigned char[]> storage; /**< One block holding all three arrays */
+    size_t storageBytes;
+    uint16_t *minuteCells; /**< Travel time per pair */
+    uint32_t *metreCells;  /**< Route length per pair in metres */
+    uint16_t *fareCells;   /**< Regular and holiday fare per pair, interleaved */
+};
+
+#endif // ODMATRIX_H
@@ -0,0 +1,268 @@
+#ifndef PRIORITYQUEUES_H
+#define PRIORITYQUEUES_H
+
+#include <vector>
+#include <algorithm>
+#include <climits>
+
+/*
+ * Priority queue policies for the routing engines.
+ *
+ * Every policy exposes the same minimal interface so that an engine can be
+ * instantiated with any of them:
+ *
+ *   void reset(int nodeCount);        prepare for a new search over nodeCount nodes
+ *   bool empty() const;               true when no entries are left
+ *   void push(int node, int key);     insert node or lower its key
+ *   int pop(int &key);                remove the entry with the smallest key
+ *
+ * Policies with lazy deletion may return a node more than once; the caller
+ * recognises outdated entries because their key is larger than the node's
+ * current tentative distance.
+ */
+
+/**
+ * @brief Binary min-heap with lazy deletion
+ *
+ * Decrease-key pushes a fresh entry and leaves the old one in the heap, which
+ * keeps every operation a plain sift on a contiguous array.
+ */
+class BinaryHeapQueue
+{
+public:
+    void reset(int nodeCount)
+    {
+        (void)nodeCount;
+        heap.clear();
+    }
+
+    bool empty() const { return heap.empty(); }
+
+    void push(int node, int key)
+    {
+        heap.push_back({key, node});
+        std::push_heap(heap.begin(), heap.end(), Greater());
+    }
+
+    int pop(int &key)
+    {
+        std::pop_heap(heap.begin(), heap.end(), Greater());
+        Entry top = heap.back();
+        heap.pop_back();
+        key = top.key;
+        return top.node;
+    }
+
+private:
+    struct Entry
+    {
+        int key;
+        int node;
+    };
+
+    struct Greater
+    {
+        bool operator()(const Entry &a, const Entry &b) const { return a.key > b.key; }
+    };
+
+    std::vector<Entry> heap;
+};
+
+/**
+ * @brief Indexed 4-ary min-heap with true decrease-key
+ *
+ * Each node appears at most once; its heap slot is tracked so a key can be
+ * lowered in place. The wider fan-out halves the tree height compared to a
+ * binary heap and keeps the children of a slot on one cache line.
+ */
+class QuaternaryHeapQueue
+{
+public:
+    void reset(int nodeCount)
+    {
+        if (static_cast<int>(position.size()) != nodeCount)
+        {
+            position.assign(nodeCount, -1);
+        }
+        else
+        {
+            /* Only entries left over from an early-terminated search need clearing */
+            for (const Entry &entry : heap)
+                position[entry.node] = -1;
+        }
+        heap.clear();
+    }
+
+    bool empty() const { return heap.empty(); }
+
+    void push(int node, int key)
+    {
+        int slot = position[node];
+        if (slot == -1)
+        {
+            heap.push_back({key, node});
+            siftUp(static_cast<int>(heap.size()) - 1);
+        }
+        else if (key < heap[slot].key)
+        {
+            heap[slot].key = key;
+            siftUp(slot);
+        }
+    }
+
+    int pop(int &key)
+    {
+        Entry top = heap[0];
+        position[top.node] = -1;
+
+        Entry last = heap.back();
+        heap.pop_back();
+        if (!heap.empty())
+        {
+            heap[0] = last;
+            position[last.node] = 0;
+            siftDown(0);
+        }
+
+        key = top.key;
+        return top.node;
+    }
+
+private:
+    struct Entry
+    {
+        int key;
+        int node;
+    };
+
+    void siftUp(int slot)
+    {
+        Entry entry = heap[slot];
+        while (slot > 0)
+        {
+            int parent = (slot - 1) / 4;
+            if (heap[parent].key <= entry.key)
+                break;
+            heap[slot] = heap[parent];
+            position[heap[slot].node] = slot;
+            slot = parent;
+        }
+        heap[slot] = entry;
+        position[entry.node] = slot;
+    }
+
+    void siftDown(int slot)
+    {
+        Entry entry = heap[slot];
+        int size = static_cast<int>(heap.size());
+        for (;;)
+        {
+            int first = slot * 4 + 1;
+            if (first >= size)
+                break;
+
+            /* Pick the smallest of up to four children */
+            int best = first;
+            int last = std::min(first + 4, size);
+            for (int child = first + 1; child < last; ++child)
+            {
+                if (heap[child].key < heap[best].key)
+                    best = child;
+            }
+
+            if (heap[best].key >= entry.key)
+                break;
+            heap[slot] = heap[best];
+            position[heap[slot].node] = slot;
+            slot = best;
+        }
+        heap[slot] = entry;
+        position[entry.node] = slot;
+    }
+
+    std::vector<Entry> heap;
+    std::vector<int> position; /**< Heap slot of every node, -1 when not queued */
+};
+
+/**
+ * @brief Dial's bucket queue for small non-negative integer keys
+ *
+ * Travel times are whole minutes and every arc is short, so all live keys
+ * fall inside a window [current, current + maxArcWeight]. Entries are kept in
+ * a circular array of buckets indexed by key, which makes push O(1) and pop
+ * amortised O(1). The window grows automatically if a longer arc shows up.
+ * Outdated entries are deleted lazily, like in BinaryHeapQueue.
+ */
+class BucketQueue
+{
+public:
+    void reset(int nodeCount)
+    {
+        (void)nodeCount;
+        for (std::vector<Entry> &bucket : buckets)
+            bucket.clear();
+        count = 0;
+        current = INT_MAX;
+        if (buckets.empty())
+            buckets.resize(16);
+    }
+
+    bool empty() const { return count == 0; }
+
+    void push(int node, int key)
+    {
+        /* Keep the last popped key while pushes arrive in any order after a pop */
+        if (count == 0 && key < current)
+            current = key;
+        if (key - current >= static_cast<int>(buckets.size()))
+            grow(key - current + 1);
+
+        buckets[key & mask()].push_back({key, node});
+        ++count;
+    }
+
+    int pop(int &key)
+    {
+        while (buckets[current & mask()].empty())
+            ++current;
+
+        std::vector<Entry> &bucket = buckets[current & mask()];
+        Entry entry = bucket.back();
+        bucket.pop_back();
+        --count;
+
+        key = entry.key;
+        return entry.node;
+    }
+
+private:
+    struct Entry
+    {
+        int key;
+        int node;
+    };
+
+    int mask() const { return static_cast<int>(buckets.size()) - 1; }
+
+    /* Enlarge the window to a power of two covering span keys and re-bucket */
+    void grow(int span)
+    {
+        size_t size = buckets.size();
+        while (size < static_cast<size_t>(span))
+            size *= 2;
+
+        std::vector<std::vector<Entry>> old(size);
+        old.swap(buckets);
+        for (std::vector<Entry> &bucket : old)
+        {
+            for (const Entry &entry : bucket)
+                buckets[entry.key & mask()].push_back(entry);
+        }
+    }
+
+    std::vector<std::vector<Entry>> buckets;
+    int count = 0;   /**< Number of queued entries, including outdated ones */
+    int current = INT_MAX; /**< Smallest key that may still be queued, INT_MAX before the first push */
+};
+
+#endif // PRIORITYQUEUES_H
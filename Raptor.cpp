@@ -0,0 +1,452 @@
+#include "Raptor.h"
+#include "RouteCalculator.h"
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+const int RaptorQuery::DefaultMaxTransfers;
+
+RaptorRoutes::RaptorRoutes()
+{
+}
+
+bool RaptorRoutes::build(const Timetable &timetable)
+{
+    routeList.clear();
+    stops.clear();
+    stopMetres.clear();
+    times.clear();
+    calls.clear();
+
+    int stationCount = timetable.stationCount();
+    transfers.resize(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+        transfers[s] = timetable.transferSeconds(s);
+
+    /* A ride no other ride of its trip links to starts the trip */
+    const vector<Connection> &connections = timetable.connections();
+    int count = static_cast<int>(connections.size());
+    vector<char> hasPrevious(count, 0);
+    for (int i = 0; i < count; ++i)
+    {
+        int next = timetable.nextInTrip(i);
+        if (next >= 0)
+            hasPrevious[next] = 1;
+    }
+    vector<int32_t> firstRide(timetable.tripCount(), -1);
+    for (int i = 0; i < count; ++i)
+    {
+        if (!hasPrevious[i])
+            firstRide[connections[i].trip] = i;
+    }
+
+    /* Trips over the same stations on the same line, keyed by the line and then the stations */
+    map<vector<int32_t>, vector<int32_t>> sequences;
+    vector<int32_t> key;
+    for (int trip = 0; trip < timetable.tripCount(); ++trip)
+    {
+        int ride = firstRide[trip];
+        if (ride < 0)
+            continue;
+        key.clear();
+        key.push_back(timetable.tripLine(trip));
+        key.push_back(connections[ride].from);
+        for (; ride >= 0; ride = timetable.nextInTrip(ride))
+            key.push_back(connections[ride].to);
+        sequences[key].push_back(trip);
+    }
+
+    vector<StopTime> tripTimes;
+    vector<vector<int32_t>> groups;
+    for (auto &sequence : sequences)
+    {
+        const vector<int32_t> &stations = sequence.first;
+        vector<int32_t> &trips = sequence.second;
+        int stopCount = static_cast<int>(stations.size()) - 1;
+        stable_sort(trips.begin(), trips.end(), [&](int32_t a, int32_t b)
+        {
+            return connections[firstRide[a]].departure < connections[firstRide[b]].departure;
+        });
+
+        /* Stop times of every trip of the sequence, in departure order */
+        tripTimes.clear();
+        for (int32_t trip : trips)
+        {
+            int ride = firstRide[trip];
+            StopTime first = {connections[ride].departure, connections[ride].departure};
+            tripTimes.push_back(first);
+            for (; ride >= 0; ride = timetable.nextInTrip(ride))
+            {
+                tripTimes.back().departure = connections[ride].departure;
+                StopTime next = {connections[ride].arrival, connections[ride].arrival};
+                tripTimes.push_back(next);
+            }
+        }
+
+        /* Each trip joins the first group it does not overtake at any stop */
+        groups.clear();
+        for (int t = 0; t < static_cast<int>(trips.size()); ++t)
+        {
+            const StopTime *current = &tripTimes[t * stopCount];
+            size_t g = 0;
+            for (; g < groups.size(); ++g)
+            {
+                const StopTime *last = &tripTimes[groups[g].back() * stopCount];
+                bool behind = true;
+                for (int i = 0; i < stopCount && behind; ++i)
+                    behind = last[i].arrival <= current[i].arrival && last[i].departure <= current[i].departure;
+                if (behind)
+                    break;
+            }
+            if (g == groups.size())
+                groups.push_back(vector<int32_t>());
+            groups[g].push_back(t);
+        }
+
+        for (const vector<int32_t> &group : groups)
+        {
+            Route route;
+            route.firstStop = static_cast<int32_t>(stops.size());
+            route.stopCount = stopCount;
+            route.firstTime = static_cast<int32_t>(times.size());
+            route.tripCount = static_cast<int32_t>(group.size());
+            route.line = static_cast<uint8_t>(stations[0]);
+            routeList.push_back(route);
+
+            stops.insert(stops.end(), stations.begin() + 1, stations.end());
+            uint32_t metres = 0;
+            stopMetres.push_back(metres);
+            for (int ride = firstRide[trips[group[0]]]; ride >= 0; ride = timetable.nextInTrip(ride))
+            {
+                metres += timetable.metres(ride);
+                stopMetres.push_back(metres);
+            }
+            for (int32_t t : group)
+                times.insert(times.end(), tripTimes.begin() + t * stopCount, tripTimes.begin() + (t + 1) * stopCount);
+        }
+    }
+
+    /* Calls grouped by station */
+    callOffsets.assign(stationCount + 1, 0);
+    for (int32_t station : stops)
+        ++callOffsets[station + 1];
+    for (int s = 0; s < stationCount; ++s)
+        callOffsets[s + 1] += callOffsets[s];
+    calls.resize(stops.size());
+    vector<uint32_t> fill(callOffsets.begin(), callOffsets.end() - 1);
+    for (int r = 0; r < static_cast<int>(routeList.size()); ++r)
+    {
+        const Route &route = routeList[r];
+        for (int position = 0; position < route.stopCount; ++position)
+        {
+            Call call = {r, position};
+            calls[fill[stops[route.firstStop + position]]++] = call;
+        }
+    }
+    return !routeList.empty();
+}
+
+size_t RaptorRoutes::memoryBytes() const
+{
+    return routeList.capacity() * sizeof(Route) + stops.capacity() * sizeof(int32_t) +
+           stopMetres.capacity() * sizeof(uint32_t) + times.capacity() * sizeof(StopTime) +
+           callOffsets.capacity() * sizeof(uint32_t) + calls.capacity() * sizeof(Call) +
+           transfers.capacity() * sizeof(int32_t);
+}
+
+RaptorQuery::RaptorQuery(const RaptorRoutes &routes) : routes(routes)
+{
+}
+
+void RaptorQuery::reset()
+{
+    int stations = routes.stationCount();
+    size_t words = (stations + 63) / 64;
+    if (static_cast<int>(bestHead.size()) != stations || static_cast<int>(routeStart.size()) != routes.routeCount())
+    {
+        bestHead.assign(stations, -1);
+        previousHead.assign(stations, -1);
+        currentHead.assign(stations, -1);
+        routeStart.assign(routes.routeCount(), -1);
+    }
+    else
+    {
+        for (int station : touchedStations)
+        {
+            bestHead[station] = -1;
+            previousHead[station] = -1;
+            currentHead[station] = -1;
+        }
+    }
+    previousMarked.assign(words, 0);
+    currentMarked.assign(words, 0);
+    touchedStations.clear();
+    labels.clear();
+    targets.clear();
+}
+
+int RaptorQuery::earliestTrip(const Route &route, int position, int time) const
+{
+    /* Trips of a route never overtake, so departures at every stop rise with the trip */
+    const RaptorRoutes::StopTime *column = &routes.times[route.firstTime + position];
+    int low = 0;
+    int high = route.tripCount;
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (column[middle * route.stopCount].departure < time)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low < route.tripCount ? low : -1;
+}
+
+void RaptorQuery::findJourneys(int from, int to, int departure, bool holiday, vector<Journey> &journeys,
+                               int maxTransfers)
+{
+    journeys.clear();
+    reset();
+    if (from == to)
+    {
+        journeys.resize(1);
+        Journey &journey = journeys[0];
+        journey.departure = departure;
+        journey.arrival = departure;
+        journey.route.path.assign(1, from);
+        journey.route.legs.clear();
+        journey.route.travelTime = 0;
+        journey.route.distance = 0;
+        journey.route.transfers = 0;
+        journey.legDepartures.clear();
+        journey.legArrivals.clear();
+        return;
+    }
+
+    destination = to;
+    holidayFares = holiday;
+    Label origin = {departure, 0, 0, -1, -1, -1, -1, -1, -1, -1, 0, false};
+    labels.push_back(origin);
+    bestHead[from] = 0;
+    previousHead[from] = 0;
+    previousMarked[from >> 6] |= uint64_t(1) << (from & 63);
+    touchedStations.push_back(from);
+
+    for (round = 1; round <= maxTransfers + 1; ++round)
+    {
+        /* Routes through the stations improved last round, from the first such stop of each */
+        routeQueue.clear();
+        for (size_t word = 0; word < previousMarked.size(); ++word)
+        {
+            uint64_t bits = previousMarked[word];
+            for (int bit = 0; bits; ++bit, bits >>= 1)
+            {
+                if (!(bits & 1))
+                    continue;
+                int station = static_cast<int>(word * 64) + bit;
+                for (uint32_t c = routes.callOffsets[station]; c < routes.callOffsets[station + 1]; ++c)
+                {
+                    const RaptorRoutes::Call &call = routes.calls[c];
+                    if (routeStart[call.route] < 0)
+                    {
+                        routeQueue.push_back(call.route);
+                        routeStart[call.route] = call.position;
+                    }
+                    else if (call.position < routeStart[call.route])
+                        routeStart[call.route] = call.position;
+                }
+            }
+        }
+        if (routeQueue.empty())
+            break;
+
+        for (int route : routeQueue)
+        {
+            scanRoute(route, routeStart[route]);
+            routeStart[route] = -1;
+        }
+
+        /* This round's labels are the ones the next round boards from */
+        for (size_t word = 0; word < previousMarked.size(); ++word)
+        {
+            uint64_t bits = previousMarked[word];
+            for (int bit = 0; bits; ++bit, bits >>= 1)
+            {
+                if (bits & 1)
+                    previousHead[word * 64 + bit] = -1;
+            }
+            previousMarked[word] = 0;
+        }
+        previousHead.swap(currentHead);
+        previousMarked.swap(currentMarked);
+    }
+
+    for (int target : targets)
+    {
+        if (labels[target].dominated)
+            continue;
+        journeys.push_back(Journey());
+        describe(target, journeys.back());
+    }
+    sort(journeys.begin(), journeys.end(), [](const Journey &a, const Journey &b)
+    {
+        if (a.route.transfers != b.route.transfers)
+            return a.route.transfers < b.route.transfers;
+        return a.arrival < b.arrival;
+    });
+}
+
+void RaptorQuery::scanRoute(int routeIndex, int start)
+{
+    const Route &route = routes.routeList[routeIndex];
+    const int32_t *stations = &routes.stops[route.firstStop];
+    const uint32_t *metres = &routes.stopMetres[route.firstStop];
+    const RaptorRoutes::StopTime *tripTimes = &routes.times[route.firstTime];
+
+    routeBag.clear();
+    for (int position = start; position < route.stopCount; ++position)
+    {
+        int station = stations[position];
+        ++scanned;
+
+        /* Alight from every trip carried this far */
+        for (const RouteLabel &carried : routeBag)
+        {
+            offer(station, tripTimes[carried.trip * route.stopCount + position].arrival,
+                  static_cast<uint32_t>(carried.base + metres[position]), carried.parent, routeIndex, carried.trip,
+                  carried.boardPosition, position);
+        }
+
+        /* Board from the labels the previous round left here */
+        if (position + 1 == route.stopCount || !(previousMarked[station >> 6] >> (station & 63) & 1))
+            continue;
+        for (int label = previousHead[station]; label >= 0; label = labels[label].nextRound)
+        {
+            const Label &waiting = labels[label];
+            if (waiting.dominated)
+                continue;
+            int ready = waiting.arrival + (waiting.route < 0 ? 0 : routes.transfers[station]);
+            int trip = earliestTrip(route, position, ready);
+            if (trip < 0)
+                continue;
+
+            RouteLabel boarding = {trip, static_cast<int64_t>(waiting.metres) - metres[position], label, position};
+            bool beaten = false;
+            for (const RouteLabel &other : routeBag)
+            {
+                if (other.trip <= boarding.trip && other.base <= boarding.base)
+                {
+                    beaten = true;
+                    break;
+                }
+            }
+            if (beaten)
+                continue;
+            routeBag.erase(remove_if(routeBag.begin(), routeBag.end(), [&](const RouteLabel &other)
+            {
+                return other.trip >= boarding.trip && other.base >= boarding.base;
+            }), routeBag.end());
+            routeBag.push_back(boarding);
+        }
+    }
+}
+
+void RaptorQuery::offer(int station, int arrival, uint32_t metres, int parent, int route, int trip, int board,
+                        int alight)
+{
+    Label label = {arrival, metres, 0, parent, route, trip, board, alight, -1, -1, static_cast<uint8_t>(round), false};
+
+    /* At the destination only the fare counts; elsewhere it can still rise, but never fall below this one */
+    int fare = calculateFare(metres * 0.001, holidayFares);
+    for (int target : targets)
+    {
+        const Label &other = labels[target];
+        if (!other.dominated && other.arrival <= arrival && other.fare <= fare)
+            return;
+    }
+
+    if (station == destination)
+    {
+        for (int target : targets)
+        {
+            Label &other = labels[target];
+            if (other.round == round && other.arrival >= arrival && other.fare >= fare)
+                other.dominated = true;
+        }
+        label.fare = fare;
+        targets.push_back(static_cast<int32_t>(labels.size()));
+        labels.push_back(label);
+        return;
+    }
+
+    bool first = bestHead[station] < 0;
+    for (int other = bestHead[station]; other >= 0; other = labels[other].nextBest)
+    {
+        if (labels[other].arrival <= arrival && labels[other].metres <= metres)
+            return;
+    }
+
+    /* Unlink every label of this round the new one beats; earlier rounds keep theirs for fewer transfers */
+    int32_t *link = &bestHead[station];
+    while (*link >= 0)
+    {
+        Label &other = labels[*link];
+        if (other.round == round && other.arrival >= arrival && other.metres >= metres)
+        {
+            other.dominated = true;
+            *link = other.nextBest;
+        }
+        else
+            link = &other.nextBest;
+    }
+
+    int32_t index = static_cast<int32_t>(labels.size());
+    label.nextBest = bestHead[station];
+    label.nextRound = currentHead[station];
+    labels.push_back(label);
+    bestHead[station] = index;
+    currentHead[station] = index;
+    currentMarked[station >> 6] |= uint64_t(1) << (station & 63);
+    if (first)
+        touchedStations.push_back(station);
+}
+
+void RaptorQuery::describe(int target, Journey &journey) const
+{
+    /* Labels from the destination back to the origin, one per train */
+    vector<int32_t> chain;
+    for (int label = target; label >= 0 && labels[label].route >= 0; label = labels[label].parent)
+        chain.push_back(label);
+    reverse(chain.begin(), chain.end());
+
+    RouteResult &route = journey.route;
+    route.path.clear();
+    route.legs.clear();
+    journey.legDepartures.clear();
+    journey.legArrivals.clear();
+    for (int32_t index : chain)
+    {
+        const Label &label = labels[index];
+        const Route &ridden = routes.routeList[label.route];
+        const int32_t *stations = &routes.stops[ridden.firstStop];
+        const RaptorRoutes::StopTime *tripTimes = &routes.times[ridden.firstTime + label.trip * ridden.stopCount];
+
+        if (route.path.empty() || route.path.back() != stations[label.boardPosition])
+            route.path.push_back(stations[label.boardPosition]);
+        int first = static_cast<int>(route.path.size()) - 1;
+        for (int position = label.boardPosition + 1; position <= label.alightPosition; ++position)
+            route.path.push_back(stations[position]);
+
+        RouteLeg leg = {ridden.line, first, static_cast<int>(route.path.size()) - 1};
+        route.legs.push_back(leg);
+        journey.legDepartures.push_back(tripTimes[label.boardPosition].departure);
+        journey.legArrivals.push_back(tripTimes[label.alightPosition].arrival);
+    }
+
+    journey.departure = chain.empty() ? 0 : journey.legDepartures.front();
+    journey.arrival = chain.empty() ? 0 : journey.legArrivals.back();
+    route.travelTime = (journey.arrival - journey.departure + 59) / 60;
+    route.distance = labels[target].metres * 0.001;
+    route.transfers = chain.empty() ? 0 : static_cast<int>(chain.size()) - 1;
+}
@@ -0,0 +1,193 @@
+#ifndef RAPTOR_H
+#define RAPTOR_H
+
+#include "ConnectionScan.h"
+#include "Timetable.h"
+#include <vector>
+#include <cstdint>
+
+/**
+ * @brief Trips of a Timetable grouped into routes for RAPTOR queries
+ *
+ * A route is a station sequence on one line whose trips never overtake each
+ * other, so the trips are ordered by departure at every stop alike. Stop
+ * times of all trips sit in one array, trip after trip, and every station
+ * lists the routes calling at it with its position on each.
+ *
+ * Immutable after build(); any number of RaptorQuery objects on different
+ * threads can share it.
+ */
+class RaptorRoutes
+{
+public:
+    /** @brief Arrival and departure of one trip at one stop, seconds after midnight */
+    struct StopTime
+    {
+        int32_t arrival;
+        int32_t departure;
+    };
+
+    /** @brief Station sequence with its trips */
+    struct Route
+    {
+        int32_t firstStop; /**< Index of the first station in the stop list */
+        int32_t stopCount; /**< Stations of the route */
+        int32_t firstTime; /**< Index of the first trip's first stop time */
+        int32_t tripCount; /**< Trips, ordered by departure */
+        uint8_t line;      /**< Index into MetroNetwork::lineNames or NoLine */
+    };
+
+    /** @brief Stop of a route at a station */
+    struct Call
+    {
+        int32_t route;
+        int32_t position;
+    };
+
+    /**
+     * @brief Construct empty routes; isBuilt() is false until build()
+     */
+    RaptorRoutes();
+
+    /**
+     * @brief Group the trips of a timetable into routes
+     *
+     * Trips of one line over the same stations share a route unless one
+     * would overtake the other; such a trip moves to another route over the
+     * same stations.
+     *
+     * @param timetable Built timetable
+     * @return False if the timetable is empty
+     */
+    bool build(const Timetable &timetable);
+
+    /** @brief True once the routes hold trips */
+    bool isBuilt() const { return !routeList.empty(); }
+
+    /** @brief Number of stations */
+    int stationCount() const { return static_cast<int>(transfers.size()); }
+
+    /** @brief Number of routes */
+    int routeCount() const { return static_cast<int>(routeList.size()); }
+
+    /** @brief Heap memory held by the routes in bytes */
+    size_t memoryBytes() const;
+
+private:
+    friend class RaptorQuery;
+
+    std::vector<Route> routeList;
+    std::vector<int32_t> stops;         /**< Stations of every route in order */
+    std::vector<uint32_t> stopMetres;   /**< Metres from the first station of the route to each stop */
+    std::vector<StopTime> times;        /**< Stop times of every trip of every route */
+    std::vector<uint32_t> callOffsets;  /**< Calls of station s at callOffsets[s]..callOffsets[s + 1] */
+    std::vector<Call> calls;
+    std::vector<int32_t> transfers;     /**< Seconds to change trains at every station */
+};
+
+/**
+ * @brief Pareto-optimal journeys by arrival, transfers and fare with McRAPTOR
+ *
+ * Round k finds every journey with k trains: each route calling at a station
+ * improved in the previous round is scanned once along its stops, boarding
+ * the earliest trip a label can catch and carrying it on. Stations keep a bag
+ * of labels that no other label beats on both arrival and distance; distance
+ * stands in for the fare, which only grows with it, until the destination,
+ * where calculateFare() decides. A journey is returned unless another one
+ * arrives no later with no more transfers and no higher fare.
+ *
+ * Labels of all rounds live in one flat pool; each station links its bag
+ * through the pool, and the stations improved in a round are a bitset that
+ * the next round walks word by word. Only what a query touched is reset, as
+ * in ChQuery.
+ */
+class RaptorQuery
+{
+public:
+    /** @brief Transfers searched unless set otherwise */
+    static const int DefaultMaxTransfers = 5;
+
+    /**
+     * @brief Construct a query object
+     * @param routes Routes to search; must outlive this object
+     */
+    explicit RaptorQuery(const RaptorRoutes &routes);
+
+    /**
+     * @brief Every journey not beaten on arrival, transfers and fare
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param departure Seconds after midnight the rider is ready at the origin
+     * @param holiday Compare holiday fares instead of weekday fares
+     * @param journeys Output journeys ordered by transfers and then arrival
+     * @param maxTransfers Most train changes of a journey
+     */
+    void findJourneys(int from, int to, int departure, bool holiday, std::vector<Journey> &journeys,
+                      int maxTransfers = DefaultMaxTransfers);
+
+    /** @brief Route stops visited by all queries so far */
+    uint64_t scannedCount() const { return scanned; }
+
+private:
+    typedef RaptorRoutes::Route Route;
+
+    /* Arrival at a station by some sequence of trains */
+    struct Label
+    {
+        int32_t arrival;
+        uint32_t metres;
+        int32_t fare;      /**< Destination labels only */
+        int32_t parent;    /**< Label the last train was boarded from, -1 at the origin */
+        int32_t route;
+        int32_t trip;
+        int32_t boardPosition;
+        int32_t alightPosition;
+        int32_t nextBest;  /**< Next label of the station's bag over all rounds */
+        int32_t nextRound; /**< Next label of the station's bag of this round */
+        uint8_t round;
+        bool dominated;
+    };
+
+    /* Trip boarded while scanning a route */
+    struct RouteLabel
+    {
+        int32_t trip;
+        int64_t base;      /**< Metres at a stop are base plus the route's metres up to it */
+        int32_t parent;
+        int32_t boardPosition;
+    };
+
+    /* Reset the labels a previous query touched */
+    void reset();
+
+    /* Scan one route from a position on in the current round */
+    void scanRoute(int route, int position);
+
+    /* Add a label to a station unless its bag or the destination beats it */
+    void offer(int station, int arrival, uint32_t metres, int parent, int route, int trip, int board, int alight);
+
+    /* First trip of a route leaving a position at or after a time, -1 if none */
+    int earliestTrip(const Route &route, int position, int time) const;
+
+    /* Fill a journey from a destination label */
+    void describe(int label, Journey &journey) const;
+
+    const RaptorRoutes &routes;
+    std::vector<Label> labels;
+    std::vector<int32_t> bestHead;      /**< Bag of every station over all rounds, -1 if empty */
+    std::vector<int32_t> previousHead;  /**< Labels of every station from the previous round */
+    std::vector<int32_t> currentHead;   /**< Labels of every station from this round */
+    std::vector<uint64_t> previousMarked;
+    std::vector<uint64_t> currentMarked;
+    std::vector<int32_t> routeStart;    /**< Earliest marked position of every route, -1 if unmarked */
+    std::vector<int32_t> routeQueue;
+    std::vector<RouteLabel> routeBag;
+    std::vector<int32_t> targets;       /**< Labels at the destination */
+    std::vector<int32_t> touchedStations;
+    int destination = -1;
+    int round = 0;
+    bool holidayFares = false;
+    uint64_t scanned = 0;
+};
+
+#endif // RAPTOR_H
@@ -0,0 +1,158 @@
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include "NetworkGenerator.h"
+#include "Raptor.h"
+#include "Timetable.h"
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Checks RaptorQuery::findJourneys() against earliest arrival by round: for
+ * every number of trains k, the earliest journey returned with at most k
+ * trains must arrive when a plain scan of the connections, boarding only
+ * from stations reached with fewer trains, first gets there. Exits with 1 on
+ * the first failing networks.
+ */
+
+namespace
+{
+int failures = 0;
+
+void fail(const char *network, int from, int to, int departure, int trains, int expected, int found)
+{
+    if (failures++ < 20)
+        printf("FAIL %s: %d -> %d at %d with %d train(s): arrival %d expected, %d found\n", network, from, to,
+               departure, trains, expected, found);
+}
+
+/* Earliest arrival at every station with at most k trains for k up to rounds, INT_MAX where unreached */
+void arrivalsByRound(const Timetable &timetable, int from, int departure, int rounds, vector<vector<int>> &arrivals)
+{
+    const vector<Connection> &connections = timetable.connections();
+    int stations = timetable.stationCount();
+    vector<int> previous(stations, INT_MAX);
+    previous[from] = departure;
+    vector<char> boarded;
+    arrivals.clear();
+    for (int round = 1; round <= rounds; ++round)
+    {
+        vector<int> current = previous;
+        boarded.assign(timetable.tripCount(), 0);
+        for (size_t c = timetable.firstDeparture(departure); c < connections.size(); ++c)
+        {
+            const Connection &connection = connections[c];
+            int arrived = previous[connection.from];
+            int ready = connection.from == from || arrived == INT_MAX
+                            ? arrived
+                            : arrived + timetable.transferSeconds(connection.from);
+            if (!boarded[connection.trip] && ready > connection.departure)
+                continue;
+            boarded[connection.trip] = 1;
+            current[connection.to] = min(current[connection.to], connection.arrival);
+        }
+        arrivals.push_back(current);
+        previous.swap(current);
+    }
+}
+
+void checkNetwork(const char *network, const vector<Station> &nodes, const vector<vector<Edge>> &graph, int headway,
+                  int queries)
+{
+    MetroNetwork metro;
+    buildMetroNetwork(nodes, graph, metro);
+    Timetable timetable;
+    RaptorRoutes routes;
+    if (!timetable.generate(metro, 5 * 3600, 24 * 3600, headway) || !routes.build(timetable))
+    {
+        printf("FAIL %s: cannot generate a timetable\n", network);
+        ++failures;
+        return;
+    }
+
+    RaptorQuery raptor(routes);
+    int rounds = RaptorQuery::DefaultMaxTransfers + 1;
+    int stations = static_cast<int>(metro.stations.size());
+    mt19937 random(17);
+    uniform_int_distribution<int> station(0, stations - 1);
+    uniform_int_distribution<int> start(5 * 3600, 23 * 3600);
+    vector<vector<int>> arrivals;
+    vector<Journey> journeys;
+    for (int i = 0; i < queries; ++i)
+    {
+        int from = station(random);
+        int departure = start(random);
+        arrivalsByRound(timetable, from, departure, rounds, arrivals);
+
+        /* Several destinations per origin, as the reference covers them all at once */
+        for (int j = 0; j < 8; ++j)
+        {
+            int to = station(random);
+            if (from == to)
+                continue;
+
+            raptor.findJourneys(from, to, departure, false, journeys);
+            for (int trains = 1; trains <= rounds; ++trains)
+            {
+                int found = INT_MAX;
+                for (const Journey &journey : journeys)
+                {
+                    if (static_cast<int>(journey.legArrivals.size()) <= trains)
+                        found = min(found, journey.arrival);
+                }
+                if (found != arrivals[trains - 1][to])
+                    fail(network, from, to, departure, trains, arrivals[trains - 1][to], found);
+            }
+        }
+    }
+}
+}
+
+int main()
+{
+    vector<Station> nodes;
+    vector<vector<Edge>> graph;
+    initializeMetroNetwork(nodes, graph);
+
+    /* A later round's label must not hide one with fewer trains from the next round */
+    {
+        MetroNetwork metro;
+        buildMetroNetwork(nodes, graph, metro);
+        Timetable timetable;
+        timetable.generate(metro, 5 * 3600, 24 * 3600, Timetable::DefaultHeadwayMinutes * 60);
+        RaptorRoutes routes;
+        routes.build(timetable);
+        RaptorQuery raptor(routes);
+        vector<vector<int>> arrivals;
+        vector<Journey> journeys;
+        arrivalsByRound(timetable, 22, 24739, 3, arrivals);
+        raptor.findJourneys(22, 20, 24739, false, journeys);
+        int found = INT_MAX;
+        for (const Journey &journey : journeys)
+        {
+            if (journey.legArrivals.size() <= 3)
+                found = min(found, journey.arrival);
+        }
+        if (found != arrivals[2][20])
+            fail("delhi", 22, 20, 24739, 3, arrivals[2][20], found);
+    }
+    checkNetwork("delhi", nodes, graph, 420, 200);
+    checkNetwork("delhi", nodes, graph, Timetable::DefaultHeadwayMinutes * 60, 200);
+
+    NetworkGenerator generator;
+    generator.setStationCount(500);
+    generator.generate(nodes, graph);
+    checkNetwork("radial-500", nodes, graph, 300, 100);
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All round checks passed\n");
+    return 0;
+}
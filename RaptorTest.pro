@@ -0,0 +1,10 @@
+TARGET = RaptorTest
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= qt app_bundle
+
+include(MetroCore.pri)
+
+# Run by "make check"
+SOURCES += \
+    RaptorTest.cpp
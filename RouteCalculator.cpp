@@ -1,4 +1,5 @@
 #include "RouteCalculator.h"
+#include "FareTable.h"
 #include <climits>
 #include <algorithm>
 #include <unordered_set>
@@ -50,6 +51,51 @@ void dijkstra(int start, const vector<vector<Edge>> &graph,
     }
 }
 
+void dijkstra(int start, const CsrGraph &graph,
+              vector<int> &distances, vector<int> &previous)
+{
+    int n = graph.nodeCount();
+    distances.assign(n, INT_MAX);
+    previous.assign(n, -1);
+    distances[start] = 0;
+
+    vector<bool> visited(n, false);
+
+    for (int i = 0; i < n; i++)
+    {
+        /* Find the unvisited node with minimum distance */
+        int minDist = INT_MAX;
+        int current = -1;
+
+        for (int j = 0; j < n; j++)
+        {
+            if (!visited[j] && distances[j] < minDist)
+            {
+                minDist = distances[j];
+                current = j;
+            }
+        }
+
+        if (current == -1)
+            break; /* No reachable unvisited nodes */
+
+        visited[current] = true;
+
+        /* Update distances to neighbors */
+        for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+        {
+            int next = graph.target(arc);
+            int newDist = distances[current] + graph.minutes(arc);
+
+            if (newDist < distances[next])
+            {
+                distances[next] = newDist;
+                previous[next] = current;
+            }
+        }
+    }
+}
+
 vector<int> reconstructPath(int start, int end, const vector<int> &previous,
                             const vector<Station> &stations)
 {
@@ -83,18 +129,8 @@ vector<int> reconstructPath(int start, int end, const vector<int> &previous,
 
 int calculateFare(double distance, bool isHoliday)
 {
-    /* Delhi Metro fare structure based on distance */
-    if (distance <= 2)
-        return 10;
-    if (distance <= 5)
-        return isHoliday ? 10 : 20;
-    if (distance <= 12)
-        return isHoliday ? 20 : 30;
-    if (distance <= 21)
-        return isHoliday ? 30 : 40;
-    if (distance <= 32)
-        return isHoliday ? 40 : 50;
-    return isHoliday ? 50 : 60;
+    const FareTable &table = FareTable::defaultTable();
+    return table.fare(distance, table.dayType(isHoliday), false);
 }
 
 double calculatePathDistance(const vector<int> &path, const vector<vector<Edge>> &graph)
@@ -113,3 +149,15 @@ double calculatePathDistance(const vector<int> &path, const vector<vector<Edge>>
     }
     return totalDist;
 }
+
+double calculatePathDistance(const vector<int> &path, const CsrGraph &graph)
+{
+    uint32_t totalMetres = 0;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        int arc = graph.findArc(path[i - 1], path[i]);
+        if (arc != -1)
+            totalMetres += graph.metres(arc);
+    }
+    return totalMetres * 0.001;
+}
@@ -2,10 +2,16 @@
 #define ROUTECALCULATOR_H
 
 #include "MetroData.h"
+#include "CsrGraph.h"
 #include <vector>
 
 /**
  * @brief Implements Dijkstra's algorithm for finding the shortest path
+ *
+ * Reference implementation that selects the next node by a linear scan, which
+ * makes a query O(V^2). It is kept for validating and benchmarking the
+ * heap-based engines in RouteEngine.h; the application uses those instead.
+ *
  * @param start Starting station ID
  * @param graph Adjacency list representation of the metro network
  * @param distances Output vector to store distances from start to all nodes
@@ -14,6 +20,16 @@
 void dijkstra(int start, const std::vector<std::vector<Edge>> &graph,
               std::vector<int> &distances, std::vector<int> &previous);
 
+/**
+ * @brief Reference Dijkstra over the CSR representation of the network
+ * @param start Starting station ID
+ * @param graph CSR representation of the metro network
+ * @param distances Output vector to store distances from start to all nodes
+ * @param previous Output vector to store the previous node in the optimal path
+ */
+void dijkstra(int start, const CsrGraph &graph,
+              std::vector<int> &distances, std::vector<int> &previous);
+
 /**
  * @brief Reconstructs the path from start to end using the previous nodes array
  * @param start Starting station ID
@@ -27,6 +43,9 @@ std::vector<int> reconstructPath(int start, int end, const std::vector<int> &pre
 
 /**
  * @brief Calculates the fare based on distance and holiday status
+ *
+ * Charges the cash fare of FareTable::defaultTable(), the Delhi Metro fares.
+ *
  * @param distance Total distance in kilometers
  * @param isHoliday Boolean indicating if it's a holiday/Sunday (affects fare)
  * @return Integer representing the fare in INR
@@ -41,4 +60,12 @@ int calculateFare(double distance, bool isHoliday);
  */
 double calculatePathDistance(const std::vector<int> &path, const std::vector<std::vector<Edge>> &graph);
 
+/**
+ * @brief Calculates the total distance of a path over the CSR representation
+ * @param path Vector of station IDs representing the path
+ * @param graph CSR representation of the metro network
+ * @return Total distance in kilometers
+ */
+double calculatePathDistance(const std::vector<int> &path, const CsrGraph &graph);
+
 #endif // ROUTECALCULATOR_H
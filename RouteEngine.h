@@ -0,0 +1,266 @@
+#ifndef ROUTEENGINE_H
+#define ROUTEENGINE_H
+
+#include "MetroData.h"
+#include "CsrGraph.h"
+#include "PriorityQueues.h"
+#include <vector>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+
+/**
+ * @brief Heap-based Dijkstra engine with a pluggable priority queue
+ *
+ * Drop-in replacement for dijkstra() from RouteCalculator.h: run() takes the
+ * same arguments and fills the same output vectors, but selects the next node
+ * through the Queue policy instead of scanning every node, so a query costs
+ * O((V + E) log V) with the heaps and O(V + E + maxWeight) with BucketQueue.
+ *
+ * The engine keeps its queue between queries, so reusing one instance avoids
+ * reallocating scratch memory on every search.
+ *
+ * @tparam Queue One of the policies from PriorityQueues.h
+ */
+template <typename Queue>
+class DijkstraEngine
+{
+public:
+    /**
+     * @brief Computes shortest travel times from a start station to all others
+     * @param start Starting station ID
+     * @param graph CSR representation of the metro network
+     * @param distances Output vector to store distances from start to all nodes
+     * @param previous Output vector to store the previous node in the optimal path
+     */
+    void run(int start, const CsrGraph &graph,
+             std::vector<int> &distances, std::vector<int> &previous)
+    {
+        int n = graph.nodeCount();
+        distances.assign(n, INT_MAX);
+        previous.assign(n, -1);
+        distances[start] = 0;
+
+        queue.reset(n);
+        queue.push(start, 0);
+
+        while (!queue.empty())
+        {
+            int key;
+            int current = queue.pop(key);
+
+            /* Skip entries made obsolete by a later, shorter relaxation */
+            if (key > distances[current])
+                continue;
+
+            for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+            {
+                int next = graph.target(arc);
+                int newDist = key + graph.minutes(arc);
+
+                if (newDist < distances[next])
+                {
+                    distances[next] = newDist;
+                    previous[next] = current;
+                    queue.push(next, newDist);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Convenience overload for the adjacency list representation
+     *
+     * Builds a temporary CsrGraph on every call; keep a CsrGraph around and use
+     * the overload above when running more than one query.
+     */
+    void run(int start, const std::vector<std::vector<Edge>> &graph,
+             std::vector<int> &distances, std::vector<int> &previous)
+    {
+        run(start, CsrGraph(graph), distances, previous);
+    }
+
+private:
+    Queue queue;
+};
+
+/**
+ * @brief Point-to-point Dijkstra that stops once the target is reached
+ *
+ * Unlike DijkstraEngine, which settles every reachable node, a query here
+ * ends as soon as the shortest route to its one target is known. The search
+ * state lives inside the engine and only the nodes a query touched are reset
+ * afterwards, so a short route in a large network costs time in proportion
+ * to the part of the network explored, not to the whole graph.
+ *
+ * The bidirectional variant additionally searches backwards from the target
+ * over the reversed graph (see CsrGraph::reversed()), always advancing the
+ * side with the smaller radius. The searches stop once the two radii add up
+ * to the best route through any node reached from both sides, so each only
+ * covers about half the distance. Neither variant needs preprocessing.
+ *
+ * @tparam Queue One of the policies from PriorityQueues.h
+ */
+template <typename Queue>
+class PointToPointDijkstra
+{
+public:
+    /**
+     * @brief Fastest route, searching forward from the start only
+     * @param start Starting node
+     * @param target Destination node
+     * @param graph CSR representation of the network
+     * @param path Output nodes from start to target, empty if unreachable
+     * @return Travel time in minutes, or -1 if the target is unreachable
+     */
+    int findRoute(int start, int target, const CsrGraph &graph, std::vector<int> &path)
+    {
+        prepare(forward, graph.nodeCount());
+        path.clear();
+
+        open(forward, start, 0, -1);
+        while (!forward.queue.empty())
+        {
+            int key;
+            int current = forward.queue.pop(key);
+            if (key > forward.distances[current])
+                continue;
+            ++settled;
+            if (current == target)
+            {
+                unwind(forward, target, path);
+                std::reverse(path.begin(), path.end());
+                return key;
+            }
+            for (int arc = graph.arcBegin(current); arc < graph.arcEnd(current); ++arc)
+                open(forward, graph.target(arc), key + graph.minutes(arc), current);
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Fastest route, searching from both ends until they meet
+     * @param start Starting node
+     * @param target Destination node
+     * @param graph CSR representation of the network
+     * @param reverse The same graph with every arc reversed
+     * @param path Output nodes from start to target, empty if unreachable
+     * @return Travel time in minutes, or -1 if the target is unreachable
+     */
+    int findRoute(int start, int target, const CsrGraph &graph, const CsrGraph &reverse, std::vector<int> &path)
+    {
+        prepare(forward, graph.nodeCount());
+        prepare(backward, graph.nodeCount());
+        path.clear();
+
+        int best = INT_MAX, meeting = -1;
+        if (start == target)
+        {
+            best = 0;
+            meeting = start;
+        }
+        open(forward, start, 0, -1);
+        open(backward, target, 0, -1);
+
+        /* Popped keys only grow, so the last one bounds everything still queued on that side */
+        int forwardRadius = 0, backwardRadius = 0;
+        while (!forward.queue.empty() || !backward.queue.empty())
+        {
+            bool forwardTurn = backward.queue.empty() || (!forward.queue.empty() && forwardRadius <= backwardRadius);
+            Side &side = forwardTurn ? forward : backward;
+            Side &other = forwardTurn ? backward : forward;
+            const CsrGraph &arcs = forwardTurn ? graph : reverse;
+
+            int key;
+            int current = side.queue.pop(key);
+            if (key > side.distances[current])
+                continue;
+            (forwardTurn ? forwardRadius : backwardRadius) = key;
+            if (best != INT_MAX && forwardRadius + backwardRadius >= best)
+                break;
+            ++settled;
+
+            for (int arc = arcs.arcBegin(current); arc < arcs.arcEnd(current); ++arc)
+            {
+                int next = arcs.target(arc);
+                int distance = key + arcs.minutes(arc);
+                open(side, next, distance, current);
+                if (other.distances[next] != INT_MAX && distance + other.distances[next] < best)
+                {
+                    best = distance + other.distances[next];
+                    meeting = next;
+                }
+            }
+        }
+        if (meeting < 0)
+            return -1;
+
+        /* Forward links lead back to the start, backward links on to the target */
+        unwind(forward, meeting, path);
+        std::reverse(path.begin(), path.end());
+        for (int at = backward.previous[meeting]; at != -1; at = backward.previous[at])
+            path.push_back(at);
+        return best;
+    }
+
+    /** @brief Nodes settled by all queries so far, on both sides */
+    uint64_t settledCount() const { return settled; }
+
+private:
+    struct Side
+    {
+        std::vector<int> distances;
+        std::vector<int> previous;
+        std::vector<int> touched; /**< Nodes whose entries the last query changed */
+        Queue queue;
+    };
+
+    void prepare(Side &side, int nodeCount)
+    {
+        if (static_cast<int>(side.distances.size()) != nodeCount)
+        {
+            side.distances.assign(nodeCount, INT_MAX);
+            side.previous.assign(nodeCount, -1);
+        }
+        else
+        {
+            for (int node : side.touched)
+            {
+                side.distances[node] = INT_MAX;
+                side.previous[node] = -1;
+            }
+        }
+        side.touched.clear();
+        side.queue.reset(nodeCount);
+    }
+
+    /* Queue a node if the new distance improves on its tentative one */
+    void open(Side &side, int node, int distance, int from)
+    {
+        if (distance >= side.distances[node])
+            return;
+        if (side.distances[node] == INT_MAX)
+            side.touched.push_back(node);
+        side.distances[node] = distance;
+        side.previous[node] = from;
+        side.queue.push(node, distance);
+    }
+
+    /* Collect the predecessor chain from a node, node first */
+    static void unwind(const Side &side, int node, std::vector<int> &path)
+    {
+        for (int at = node; at != -1; at = side.previous[at])
+            path.push_back(at);
+    }
+
+    Side forward;
+    Side backward; /**< Only used by bidirectional queries */
+    uint64_t settled = 0;
+};
+
+typedef DijkstraEngine<BinaryHeapQueue> BinaryHeapDijkstra;
+typedef DijkstraEngine<QuaternaryHeapQueue> QuaternaryHeapDijkstra;
+typedef DijkstraEngine<BucketQueue> BucketDijkstra;
+typedef PointToPointDijkstra<BucketQueue> BucketPointToPoint;
+
+#endif // ROUTEENGINE_H
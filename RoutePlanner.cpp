@@ -0,0 +1,583 @@
+#include "RoutePlanner.h"
+#include "NetworkSnapshot.h"
+#include <algorithm>
+#include <climits>
+
+using namespace std;
+
+const int RoutePlanner::DefaultAllPairsLimit;
+
+RoutePlanner::RoutePlanner() : metroNetwork(make_shared<MetroNetwork>()), fasterArcs(0), lastOrigin(-1)
+{
+}
+
+RoutePlanner::RoutePlanner(const MetroNetwork &network)
+    : metroNetwork(make_shared<MetroNetwork>(network)), fasterArcs(0), lastOrigin(-1)
+{
+}
+
+RoutePlanner::RoutePlanner(const RoutePlanner &other)
+    : metroNetwork(other.metroNetwork), baseNetwork(other.baseNetwork), fasterArcs(other.fasterArcs), table(other.table),
+      hierarchy(other.hierarchy), landmarks(other.landmarks), reverseGraph(other.reverseGraph), routeCache(other.routeCache.capacity()), treeCache(other.treeCache.capacity()),
+      alternativeCache(other.alternativeCache.capacity()), lastOrigin(-1)
+{
+}
+
+RoutePlanner &RoutePlanner::operator=(const RoutePlanner &other)
+{
+    if (this != &other)
+    {
+        metroNetwork = other.metroNetwork;
+        baseNetwork = other.baseNetwork;
+        fasterArcs = other.fasterArcs;
+        table = other.table;
+        hierarchy = other.hierarchy;
+        landmarks = other.landmarks;
+        reverseGraph = other.reverseGraph;
+        hierarchyQuery.reset();
+        clearCaches();
+        routeCache.setCapacity(other.routeCache.capacity());
+        treeCache.setCapacity(other.treeCache.capacity());
+        alternativeCache.setCapacity(other.alternativeCache.capacity());
+    }
+    return *this;
+}
+
+void RoutePlanner::setNetwork(const MetroNetwork &network)
+{
+    metroNetwork = make_shared<MetroNetwork>(network);
+    baseNetwork.reset();
+    fasterArcs = 0;
+    table.reset();
+    hierarchy.reset();
+    landmarks.reset();
+    hierarchyQuery.reset();
+    reverseGraph.reset();
+    clearCaches();
+}
+
+bool RoutePlanner::enableAllPairs(int threadCount)
+{
+    shared_ptr<AllPairsRouteTable> built = make_shared<AllPairsRouteTable>();
+    if (!built->build(originalNetwork().graph, threadCount))
+        return false;
+    table = built;
+    clearCaches();
+    return true;
+}
+
+bool RoutePlanner::loadAllPairs(const string &fileName)
+{
+    shared_ptr<AllPairsRouteTable> loaded = make_shared<AllPairsRouteTable>();
+    if (!loaded->load(fileName, originalNetwork().graph))
+        return false;
+    table = loaded;
+    clearCaches();
+    return true;
+}
+
+bool RoutePlanner::saveAllPairs(const string &fileName) const
+{
+    return hasAllPairs() && table->save(fileName);
+}
+
+void RoutePlanner::enableContractionHierarchy(int threadCount)
+{
+    shared_ptr<ContractionHierarchy> built = make_shared<ContractionHierarchy>();
+    built->build(originalNetwork().graph, threadCount);
+    hierarchy = built;
+    hierarchyQuery.reset();
+    clearCaches();
+}
+
+bool RoutePlanner::loadContractionHierarchy(const string &fileName)
+{
+    shared_ptr<ContractionHierarchy> loaded = make_shared<ContractionHierarchy>();
+    if (!loaded->load(fileName, originalNetwork().graph))
+        return false;
+    hierarchy = loaded;
+    hierarchyQuery.reset();
+    clearCaches();
+    return true;
+}
+
+bool RoutePlanner::saveContractionHierarchy(const string &fileName) const
+{
+    return hasContractionHierarchy() && hierarchy->save(fileName);
+}
+
+bool RoutePlanner::enableLandmarks(int landmarkCount, int threadCount)
+{
+    shared_ptr<LandmarkTable> built = make_shared<LandmarkTable>();
+    if (!built->build(originalNetwork().graph, landmarkCount, threadCount))
+        return false;
+    landmarks = built;
+    clearCaches();
+    return true;
+}
+
+bool RoutePlanner::saveSnapshot(const string &fileName, const string &inputs, const vector<string> &sources) const
+{
+    return NetworkSnapshot::write(fileName, originalNetwork(), hasAllPairs() ? table.get() : nullptr,
+                                  hasContractionHierarchy() ? hierarchy.get() : nullptr,
+                                  hasLandmarks() ? landmarks.get() : nullptr, inputs, sources);
+}
+
+bool RoutePlanner::loadSnapshot(const string &fileName, const string &inputs)
+{
+    /* Indices are trusted as written, so a damaged byte anywhere could crash a query; checking costs one pass over the file */
+    NetworkSnapshot snapshot;
+    if (!snapshot.open(fileName) || !snapshot.hasInputs(inputs) || snapshot.isStale() || !snapshot.verify())
+        return false;
+
+    shared_ptr<MetroNetwork> network = make_shared<MetroNetwork>();
+    if (!snapshot.readNetwork(*network))
+        return false;
+
+    /* Indices are optional; the snapshot may hold any of them or none */
+    shared_ptr<AllPairsRouteTable> loadedTable = make_shared<AllPairsRouteTable>();
+    shared_ptr<ContractionHierarchy> loadedHierarchy = make_shared<ContractionHierarchy>();
+    shared_ptr<LandmarkTable> loadedLandmarks = make_shared<LandmarkTable>();
+    bool hasTable = snapshot.readAllPairs(*loadedTable);
+    bool hasHierarchy = snapshot.readContractionHierarchy(*loadedHierarchy);
+    bool hasLandmarkTables = snapshot.readLandmarks(*loadedLandmarks);
+
+    metroNetwork = network;
+    baseNetwork.reset();
+    fasterArcs = 0;
+    table = hasTable ? loadedTable : nullptr;
+    hierarchy = hasHierarchy ? loadedHierarchy : nullptr;
+    landmarks = hasLandmarkTables ? loadedLandmarks : nullptr;
+    hierarchyQuery.reset();
+    reverseGraph.reset();
+    clearCaches();
+    return true;
+}
+
+void RoutePlanner::setCacheCapacity(size_t routes, size_t trees)
+{
+    routeCache.setCapacity(routes);
+    treeCache.setCapacity(trees);
+    alternativeCache.setCapacity(routes);
+}
+
+RouteCacheStatistics RoutePlanner::cacheStatistics() const
+{
+    RouteCacheStatistics statistics;
+    statistics.routeHits = routeCache.hits();
+    statistics.routeMisses = routeCache.misses();
+    statistics.treeHits = treeCache.hits();
+    statistics.treeMisses = treeCache.misses();
+    return statistics;
+}
+
+void RoutePlanner::resetCacheStatistics()
+{
+    routeCache.resetStatistics();
+    treeCache.resetStatistics();
+    alternativeCache.resetStatistics();
+}
+
+void RoutePlanner::clearCaches()
+{
+    routeCache.clear();
+    treeCache.clear();
+    alternativeCache.clear();
+    lastOrigin = -1;
+}
+
+/* Follow a search's predecessor links back from a target state */
+static bool treeRoute(const vector<int> &distances, const vector<int> &previous, int to, vector<int> &states,
+                      int &minutes)
+{
+    if (distances[to] == INT_MAX)
+        return false;
+
+    states.clear();
+    for (int at = to; at != -1; at = previous[at])
+        states.push_back(at);
+    reverse(states.begin(), states.end());
+
+    minutes = distances[to];
+    return true;
+}
+
+bool RoutePlanner::findRoute(int from, int to, RouteResult &route)
+{
+    if (from == to)
+    {
+        route.path.assign(1, from);
+        route.travelTime = 0;
+        route.distance = 0.0;
+        route.transfers = 0;
+        route.legs.clear();
+        return true;
+    }
+
+    /* Unreachable pairs are cached too, with an empty path */
+    uint64_t key = (static_cast<uint64_t>(from) << 32) | static_cast<uint32_t>(to);
+    if (const RouteResult *cached = routeCache.find(key))
+    {
+        route = *cached;
+        return !route.path.empty();
+    }
+
+    int minutes;
+    bool found = findStateRoute(from, to, statePath, minutes);
+    if (found)
+    {
+        describeStatePath(*metroNetwork, statePath, route);
+        route.travelTime = minutes - boardingMinutes(*metroNetwork, from);
+    }
+
+    if (routeCache.capacity() > 0)
+    {
+        RouteResult &entry = routeCache.insert(key);
+        if (found)
+            entry = route;
+        else
+            entry.path.clear();
+    }
+    return found;
+}
+
+bool RoutePlanner::findAlternatives(int from, int to, int count, vector<RouteResult> &routes)
+{
+    routes.clear();
+    if (from == to)
+    {
+        routes.resize(1);
+        return findRoute(from, to, routes[0]);
+    }
+
+    uint64_t key = (static_cast<uint64_t>(from) << 32) | static_cast<uint32_t>(to);
+    if (const AlternativeRoutes *cached = alternativeCache.find(key))
+    {
+        if (cached->count == count)
+        {
+            routes = cached->routes;
+            return !routes.empty();
+        }
+    }
+
+    if (!reverseGraph)
+        reverseGraph = make_shared<CsrGraph>(metroNetwork->graph.reversed());
+    int found = alternativeSearch.findPaths(*metroNetwork, *reverseGraph, from, to, count, alternativePaths,
+                                            alternativeMinutes);
+    routes.resize(found);
+    for (int i = 0; i < found; ++i)
+    {
+        describeStatePath(*metroNetwork, alternativePaths[i], routes[i]);
+        routes[i].travelTime = alternativeMinutes[i] - boardingMinutes(*metroNetwork, from);
+    }
+
+    if (alternativeCache.capacity() > 0)
+    {
+        AlternativeRoutes &entry = alternativeCache.insert(key);
+        entry.count = count;
+        entry.routes = routes;
+    }
+    return found > 0;
+}
+
+bool RoutePlanner::findStateRoute(int from, int to, vector<int> &states, int &minutes)
+{
+    /* A tree costs as much as many point-to-point queries, so only build one for a repeated origin */
+    if (!hasAllPairs())
+    {
+        const ShortestPathTree *tree = treeCache.find(from);
+        if (!tree && treeCache.capacity() > 0 && from == lastOrigin)
+        {
+            ShortestPathTree &built = treeCache.insert(from);
+            engine.run(from, metroNetwork->graph, built.distances, built.previous);
+            tree = &built;
+        }
+        lastOrigin = from;
+        if (tree)
+            return treeRoute(tree->distances, tree->previous, to, states, minutes);
+    }
+    return searchStateRoute(from, to, states, minutes);
+}
+
+bool RoutePlanner::searchStateRoute(int from, int to, vector<int> &states, int &minutes)
+{
+    const CsrGraph &graph = metroNetwork->graph;
+
+    /* Indices are only a lower bound on the changed network, and not even that once an arc got faster */
+    bool indexed = fasterArcs == 0;
+    if (hasAllPairs() && indexed)
+    {
+        if (!table->reachable(from, to))
+            return false;
+
+        table->path(from, to, states);
+        minutes = table->travelTime(from, to);
+        if (isCurrent(states, minutes))
+            return true;
+    }
+
+    if (hasContractionHierarchy() && indexed)
+    {
+        if (!hierarchyQuery)
+            hierarchyQuery.reset(new ChQuery(*hierarchy));
+
+        uint32_t metres;
+        minutes = hierarchyQuery->findRoute(from, to, states, metres);
+        if (minutes < 0)
+            return false;
+        if (isCurrent(states, minutes))
+            return true;
+    }
+
+    if (hasLandmarks() && indexed)
+    {
+        minutes = goalSearch.findRoute(from, to, graph, *landmarks, states);
+        return minutes >= 0;
+    }
+
+    if (!reverseGraph)
+        reverseGraph = make_shared<CsrGraph>(graph.reversed());
+    minutes = pointSearch.findRoute(from, to, graph, *reverseGraph, states);
+    return minutes >= 0;
+}
+
+bool RoutePlanner::isCurrent(const vector<int> &states, int minutes) const
+{
+    if (!baseNetwork)
+        return true;
+
+    const CsrGraph &graph = metroNetwork->graph;
+    int total = 0;
+    for (size_t i = 1; i < states.size(); ++i)
+    {
+        int arc = graph.findArc(states[i - 1], states[i]);
+        if (arc < 0)
+            return false;
+        total += graph.minutes(arc);
+    }
+    return total == minutes;
+}
+
+/* Combine the changes of several arcs into one entry per station pair, dropping pairs that ended up unchanged */
+static void mergeChanges(vector<RouteChange> &found, vector<RouteChange> *changes)
+{
+    if (!changes)
+        return;
+
+    stable_sort(found.begin(), found.end(), [](const RouteChange &a, const RouteChange &b) {
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+    changes->clear();
+    for (size_t i = 0; i < found.size();)
+    {
+        size_t last = i;
+        while (last + 1 < found.size() && found[last + 1].from == found[i].from && found[last + 1].to == found[i].to)
+            ++last;
+        RouteChange change = found[i];
+        change.newMinutes = found[last].newMinutes;
+        if (change.newMinutes != change.oldMinutes)
+            changes->push_back(change);
+        i = last + 1;
+    }
+}
+
+bool RoutePlanner::setSegmentMinutes(int from, int to, int minutes, vector<RouteChange> *changes)
+{
+    vector<pair<int, int>> arcs;
+    findSegment(from, to, arcs);
+    if (arcs.empty())
+        return false;
+
+    vector<RouteChange> found;
+    for (const pair<int, int> &ride : arcs)
+    {
+        bool closed = metroNetwork->graph.target(ride.second) != originalNetwork().graph.target(ride.second);
+        changeArc(ride.first, ride.second, minutes, closed, found);
+    }
+    mergeChanges(found, changes);
+    return true;
+}
+
+bool RoutePlanner::setSegmentClosed(int from, int to, bool closed, vector<RouteChange> *changes)
+{
+    vector<pair<int, int>> arcs;
+    findSegment(from, to, arcs);
+    if (arcs.empty())
+        return false;
+
+    vector<RouteChange> found;
+    for (const pair<int, int> &ride : arcs)
+        changeArc(ride.first, ride.second, metroNetwork->graph.minutes(ride.second), closed, found);
+    mergeChanges(found, changes);
+    return true;
+}
+
+void RoutePlanner::restoreNetwork()
+{
+    if (!baseNetwork)
+        return;
+
+    metroNetwork = baseNetwork;
+    baseNetwork.reset();
+    fasterArcs = 0;
+    reverseGraph.reset();
+    clearCaches();
+}
+
+void RoutePlanner::findSegment(int from, int to, vector<pair<int, int>> &arcs) const
+{
+    arcs.clear();
+    const MetroNetwork &network = originalNetwork();
+    int stationCount = network.stations.size();
+    if (from < 0 || to < 0 || from >= stationCount || to >= stationCount || from == to)
+        return;
+
+    /* Trains leave from the station itself or from its platforms; the unchanged graph still shows where closed arcs lead */
+    const CsrGraph &graph = network.graph;
+    vector<int> tails(1, from);
+    for (int arc = graph.arcBegin(from); arc < graph.arcEnd(from); ++arc)
+    {
+        int state = graph.target(arc);
+        if (state != from && network.stateStation[state] == from)
+            tails.push_back(state);
+    }
+    for (int tail : tails)
+    {
+        for (int arc = graph.arcBegin(tail); arc < graph.arcEnd(tail); ++arc)
+        {
+            if (network.stateStation[graph.target(arc)] == to)
+                arcs.push_back(make_pair(tail, arc));
+        }
+    }
+}
+
+void RoutePlanner::detachNetwork()
+{
+    /* Closed arcs must keep their slot at the head of the reverse graph, so build it before the first change */
+    if (!reverseGraph)
+        reverseGraph = make_shared<CsrGraph>(metroNetwork->graph.reversed());
+    if (!baseNetwork)
+        baseNetwork = metroNetwork;
+    if (metroNetwork.use_count() > 1)
+        metroNetwork = make_shared<MetroNetwork>(*metroNetwork);
+    if (reverseGraph.use_count() > 1)
+        reverseGraph = make_shared<CsrGraph>(*reverseGraph);
+}
+
+void RoutePlanner::changeArc(int tail, int arc, int minutes, bool closed, vector<RouteChange> &changes)
+{
+    detachNetwork();
+
+    /* detachNetwork() made both copies for this planner alone */
+    CsrGraph &graph = const_cast<MetroNetwork &>(*metroNetwork).graph;
+    CsrGraph &reverse = const_cast<CsrGraph &>(*reverseGraph);
+    const CsrGraph &base = baseNetwork->graph;
+
+    int head = base.target(arc);
+    minutes = min(max(minutes, 0), 0xFFFF);
+    bool wasClosed = graph.target(arc) != head;
+    if (wasClosed == closed && graph.minutes(arc) == minutes)
+        return;
+
+    /* The reverse arc is stored at the head; parallel arcs are told apart by their other end and attributes */
+    int reverseTail = wasClosed ? head : tail;
+    int reverseArc = reverse.arcBegin(head);
+    while (reverseArc < reverse.arcEnd(head) &&
+           (reverse.target(reverseArc) != reverseTail || reverse.minutes(reverseArc) != graph.minutes(arc) ||
+            reverse.metres(reverseArc) != graph.metres(arc)))
+        ++reverseArc;
+
+    int oldMinutes = wasClosed ? ShortestPathRepair::Closed : graph.minutes(arc);
+    int newMinutes = closed ? ShortestPathRepair::Closed : minutes;
+    graph.setMinutes(arc, minutes);
+    graph.setTarget(arc, closed ? tail : head);
+    reverse.setMinutes(reverseArc, minutes);
+    reverse.setTarget(reverseArc, closed ? head : tail);
+
+    int baseMinutes = base.minutes(arc);
+    fasterArcs += (newMinutes < baseMinutes ? 1 : 0) - (oldMinutes < baseMinutes ? 1 : 0);
+    if (newMinutes != oldMinutes)
+        repairCaches(tail, head, oldMinutes, newMinutes, changes);
+}
+
+void RoutePlanner::repairCaches(int tail, int head, int oldMinutes, int newMinutes, vector<RouteChange> &changes)
+{
+    const MetroNetwork &network = *metroNetwork;
+    const CsrGraph &graph = network.graph;
+    const CsrGraph &reverse = *reverseGraph;
+    int stationCount = network.stations.size();
+    auto stationMinutes = [&](int from, int minutes) {
+        return minutes == INT_MAX ? -1 : minutes - boardingMinutes(network, from);
+    };
+
+    /* Any changed arc can reorder the alternatives, and they are too costly to repair one by one */
+    alternativeCache.clear();
+
+    vector<ShortestPathRepair::Change> nodeChanges;
+    treeCache.forEach([&](int origin, ShortestPathTree &tree) {
+        nodeChanges.clear();
+        repair.repairTree(graph, reverse, tail, head, oldMinutes, newMinutes, tree.distances, tree.previous,
+                          nodeChanges);
+        for (const ShortestPathRepair::Change &change : nodeChanges)
+        {
+            if (change.node >= stationCount)
+                continue;
+            RouteChange route = {origin, change.node, stationMinutes(origin, change.oldMinutes),
+                                 stationMinutes(origin, tree.distances[change.node])};
+            changes.push_back(route);
+        }
+    });
+
+    if (routeCache.size() == 0)
+        return;
+
+    /* Only routes up to the longest cached one matter, unless a faster arc can connect an unreachable pair */
+    bool faster = newMinutes < oldMinutes;
+    int radius = 0;
+    routeCache.forEach([&](uint64_t key, const RouteResult &route) {
+        if (!route.path.empty())
+            radius = max(radius, route.travelTime + boardingMinutes(network, static_cast<int>(key >> 32)));
+        else if (faster)
+            radius = INT_MAX;
+    });
+    repair.searchAround(graph, reverse, tail, head, radius);
+
+    routeCache.forEach([&](uint64_t key, RouteResult &route) {
+        int from = static_cast<int>(key >> 32);
+        int to = static_cast<int>(key & 0xFFFFFFFFu);
+        int toTail = repair.minutesToTail(from);
+        int fromHead = repair.minutesFromHead(to);
+        if (toTail == INT_MAX || fromHead == INT_MAX)
+            return;
+
+        int boarding = boardingMinutes(network, from);
+        int oldTime = route.path.empty() ? INT_MAX : route.travelTime + boarding;
+        int minutes;
+        if (faster)
+        {
+            /* The new arc wins outright or not at all */
+            minutes = toTail + newMinutes + fromHead;
+            if (minutes >= oldTime)
+                return;
+            repair.pathThrough(from, to, statePath);
+        }
+        else
+        {
+            /* Only a route through the arc can be slower now; look for its replacement */
+            if (oldTime == INT_MAX || toTail + oldMinutes + fromHead != oldTime)
+                return;
+            if (!searchStateRoute(from, to, statePath, minutes))
+                minutes = INT_MAX;
+        }
+
+        RouteChange change = {from, to, stationMinutes(from, oldTime), stationMinutes(from, minutes)};
+        changes.push_back(change);
+        if (minutes == INT_MAX)
+        {
+            route.path.clear();
+            return;
+        }
+        describeStatePath(network, statePath, route);
+        route.travelTime = minutes - boarding;
+    });
+}
@@ -0,0 +1,334 @@
+#ifndef ROUTEPLANNER_H
+#define ROUTEPLANNER_H
+
+#include "MetroNetwork.h"
+#include "RouteEngine.h"
+#include "AllPairsRouteTable.h"
+#include "ContractionHierarchy.h"
+#include "LandmarkTable.h"
+#include "AStarSearch.h"
+#include "KShortestPaths.h"
+#include "LruCache.h"
+#include "ShortestPathRepair.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Hit and miss counts of a RoutePlanner's caches
+ */
+struct RouteCacheStatistics
+{
+    uint64_t routeHits;   /**< Queries answered from the route cache */
+    uint64_t routeMisses; /**< Queries that had to be computed */
+    uint64_t treeHits;    /**< Computed queries answered from a cached shortest path tree */
+    uint64_t treeMisses;  /**< Computed queries whose origin had no cached tree */
+};
+
+/**
+ * @brief Travel time between two stations before and after a network change
+ */
+struct RouteChange
+{
+    int from;       /**< Origin station ID */
+    int to;         /**< Destination station ID */
+    int oldMinutes; /**< Travel time before the change, -1 if unreachable */
+    int newMinutes; /**< Travel time after the change, -1 if unreachable */
+};
+
+/**
+ * @brief Answers route queries using the fastest available method
+ *
+ * Owns the canonical network and any precomputed indices, which are built
+ * over the network's routing states. Without an index every
+ * query runs a bidirectional Dijkstra search that stops where the two
+ * sides meet, so edited networks stay fast to query. Small networks can enable the
+ * all-pairs table, which turns a query into a table lookup plus a next-hop
+ * walk; large networks can enable a Contraction Hierarchy instead. When both
+ * are present the table is used. Landmark tables are a lighter alternative
+ * that only steer the search: with them, queries without the other indices
+ * run an A* search with landmark lower bounds.
+ *
+ * Queries take and return station IDs of MetroNetwork::stations; platform
+ * states stay internal.
+ *
+ * The network and indices can be stored in one snapshot file, which later
+ * runs map instead of parsing and preprocessing the network again.
+ *
+ * Optional caches keep recent routes and recent single-source shortest path
+ * trees. A cached tree answers every destination from its origin without a
+ * search; a tree is only built once an origin is queried twice in a row,
+ * since one tree costs as much as many point-to-point queries.
+ *
+ * Segments between stations can be delayed, closed and reopened while the
+ * planner is in use. Cached trees and routes are repaired in place rather
+ * than dropped, touching only the part of the network the change affects.
+ * Indices keep describing the network as it was set: as long as changes
+ * only slow trains down, an index route that avoids every changed segment is
+ * still the fastest one, so each index answer is checked against the
+ * current travel times and replaced by a search when it no longer holds.
+ * Once a segment becomes faster than it was, queries bypass the indices
+ * until restoreNetwork().
+ *
+ * Copies share the network and indices but have their own search buffers and
+ * caches, so each thread can work on its own copy. Changing a segment gives
+ * the planner its own copy of the network first.
+ */
+class RoutePlanner
+{
+public:
+    /** @brief Largest network for which the all-pairs table is used by default */
+    static const int DefaultAllPairsLimit = 2048;
+
+    /**
+     * @brief Construct a planner without a network
+     */
+    RoutePlanner();
+
+    /**
+     * @brief Construct a planner for a network
+     * @param network Canonical metro network
+     */
+    explicit RoutePlanner(const MetroNetwork &network);
+
+    /**
+     * @brief Copy a planner, sharing its graph and indices but not its search buffers
+     * @param other Planner to copy
+     */
+    RoutePlanner(const RoutePlanner &other);
+    RoutePlanner &operator=(const RoutePlanner &other);
+
+    /**
+     * @brief Replace the network and drop all indices built for the old one
+     * @param network Canonical metro network
+     */
+    void setNetwork(const MetroNetwork &network);
+
+    /** @brief The canonical network, including any segment changes */
+    const MetroNetwork &network() const { return *metroNetwork; }
+
+    /**
+     * @brief Build the all-pairs table for O(1) queries
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     * @return False if the network is too large for the table
+     */
+    bool enableAllPairs(int threadCount = 0);
+
+    /**
+     * @brief Load a previously saved all-pairs table
+     * @param fileName Path of a file written by saveAllPairs()
+     * @return False if the file is missing or was built for another network
+     */
+    bool loadAllPairs(const std::string &fileName);
+
+    /**
+     * @brief Save the all-pairs table so later runs can skip building it
+     * @param fileName Path of the file to create
+     * @return False if no table is enabled or the file cannot be written
+     */
+    bool saveAllPairs(const std::string &fileName) const;
+
+    /** @brief True if queries are answered from the all-pairs table */
+    bool hasAllPairs() const { return table && table->isBuilt(); }
+
+    /**
+     * @brief Contract the network into a hierarchy for fast point-to-point queries
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     */
+    void enableContractionHierarchy(int threadCount = 0);
+
+    /**
+     * @brief Load a previously saved Contraction Hierarchy
+     * @param fileName Path of a file written by saveContractionHierarchy()
+     * @return False if the file is missing or was built for another network
+     */
+    bool loadContractionHierarchy(const std::string &fileName);
+
+    /**
+     * @brief Save the Contraction Hierarchy so later runs can skip contraction
+     * @param fileName Path of the file to create
+     * @return False if no hierarchy is enabled or the file cannot be written
+     */
+    bool saveContractionHierarchy(const std::string &fileName) const;
+
+    /** @brief True if a Contraction Hierarchy is available for queries */
+    bool hasContractionHierarchy() const { return hierarchy && hierarchy->isBuilt(); }
+
+    /**
+     * @brief Select landmarks and build their tables for goal-directed queries
+     * @param landmarkCount Number of landmarks
+     * @param threadCount Number of worker threads, 0 to use all hardware threads
+     * @return False if the network is empty or too large for the table format
+     */
+    bool enableLandmarks(int landmarkCount = LandmarkTable::DefaultLandmarkCount, int threadCount = 0);
+
+    /** @brief True if landmark tables steer searches */
+    bool hasLandmarks() const { return landmarks && landmarks->isBuilt(); }
+
+    /**
+     * @brief Change the travel time of the direct rides from one station to the next
+     *
+     * Applies to rides on every line between the two stations, in this
+     * direction only. A closed segment keeps the new time for when it reopens.
+     *
+     * @param from Station the rides leave
+     * @param to Station the rides enter
+     * @param minutes New travel time
+     * @param changes Optional output of cached station pairs whose travel time changed
+     * @return False if no line runs directly from one station to the other
+     */
+    bool setSegmentMinutes(int from, int to, int minutes, std::vector<RouteChange> *changes = nullptr);
+
+    /**
+     * @brief Close or reopen the direct rides from one station to the next
+     * @param from Station the rides leave
+     * @param to Station the rides enter
+     * @param closed True to close the segment, false to reopen it
+     * @param changes Optional output of cached station pairs whose travel time changed
+     * @return False if no line runs directly from one station to the other
+     */
+    bool setSegmentClosed(int from, int to, bool closed, std::vector<RouteChange> *changes = nullptr);
+
+    /** @brief True if any segment was changed since the network was set */
+    bool hasNetworkChanges() const { return baseNetwork != nullptr; }
+
+    /**
+     * @brief Undo all segment changes and drop the caches
+     */
+    void restoreNetwork();
+
+    /**
+     * @brief Save the network and all enabled indices to one snapshot file
+     *
+     * Segment changes are not saved; the snapshot holds the network as set.
+     *
+     * @param fileName Path of the file to create
+     * @param inputs Description of what the network was built from, such as
+     *               its file paths or generator settings; loadSnapshot() must be given the same
+     * @param sources Files the network was loaded from, see NetworkLoader::sourceFiles()
+     * @return False if the file cannot be written
+     */
+    bool saveSnapshot(const std::string &fileName, const std::string &inputs,
+                      const std::vector<std::string> &sources = std::vector<std::string>()) const;
+
+    /**
+     * @brief Replace the network and indices with those of a snapshot
+     *
+     * The snapshot is memory-mapped and used in place, so loading takes one
+     * checksum pass over the file instead of parsing and preprocessing. The
+     * planner is unchanged on failure.
+     *
+     * @param fileName Path of a file written by saveSnapshot()
+     * @param inputs Description of the network wanted, as passed to saveSnapshot()
+     * @return False if the file is missing, damaged, of other inputs or older than its source files
+     */
+    bool loadSnapshot(const std::string &fileName, const std::string &inputs);
+
+    /**
+     * @brief Enable or resize the route and shortest path tree caches
+     * @param routes Number of station pairs to keep routes and alternatives of, 0 to disable
+     * @param trees Number of shortest path trees to keep, 0 to disable
+     */
+    void setCacheCapacity(size_t routes, size_t trees);
+
+    /** @brief Hit and miss counts since construction or the last resetCacheStatistics() */
+    RouteCacheStatistics cacheStatistics() const;
+
+    /** @brief Reset the hit and miss counts */
+    void resetCacheStatistics();
+
+    /**
+     * @brief Find the fastest route between two stations
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param route Output route; contents are unspecified when no route exists
+     * @return True if the destination is reachable
+     */
+    bool findRoute(int from, int to, RouteResult &route);
+
+    /**
+     * @brief Find the fastest routes that visit no station twice
+     *
+     * The first route is a fastest one, though among equally fast routes it
+     * may differ from findRoute(). Later routes are slower or equally fast
+     * and differ in a station or a line. Always searches the current
+     * network without indices; the results are cached per station pair and
+     * count alongside the routes, and dropped once any segment changes.
+     *
+     * @param from Origin station ID
+     * @param to Destination station ID
+     * @param count Number of routes wanted
+     * @param routes Output routes, fastest first
+     * @return True if the destination is reachable
+     */
+    bool findAlternatives(int from, int to, int count, std::vector<RouteResult> &routes);
+
+private:
+    /* Result of findAlternatives() for one station pair */
+    struct AlternativeRoutes
+    {
+        int count; /**< Number of routes asked for */
+        std::vector<RouteResult> routes;
+    };
+
+    /* Single-source search result from one origin state */
+    struct ShortestPathTree
+    {
+        std::vector<int> distances;
+        std::vector<int> previous;
+    };
+
+    /* Route between two routing states, as a state path plus its time */
+    bool findStateRoute(int from, int to, std::vector<int> &states, int &minutes);
+
+    /* Same as findStateRoute() without the tree cache */
+    bool searchStateRoute(int from, int to, std::vector<int> &states, int &minutes);
+
+    /* True if an index route still takes the given time on the current network */
+    bool isCurrent(const std::vector<int> &states, int minutes) const;
+
+    /* The network indices are built for: the one that was set, without changes */
+    const MetroNetwork &originalNetwork() const { return baseNetwork ? *baseNetwork : *metroNetwork; }
+
+    /* Rides from one station to another as pairs of routing state and arc */
+    void findSegment(int from, int to, std::vector<std::pair<int, int>> &arcs) const;
+
+    /* Change one ride arc and repair the caches; a negative time keeps the current one */
+    void changeArc(int tail, int arc, int minutes, bool closed, std::vector<RouteChange> &changes);
+
+    /* Bring cached trees and routes up to date after one arc changed */
+    void repairCaches(int tail, int head, int oldMinutes, int newMinutes, std::vector<RouteChange> &changes);
+
+    /* Give this planner its own copy of the network and reverse graph before changing them */
+    void detachNetwork();
+
+    /* Drop cached routes and trees after the network or an index changed */
+    void clearCaches();
+
+    std::shared_ptr<const MetroNetwork> metroNetwork;
+    std::shared_ptr<const MetroNetwork> baseNetwork; /**< Network as set, only kept once a segment changed */
+    int fasterArcs;                                  /**< Arcs now faster than in baseNetwork */
+    std::shared_ptr<const AllPairsRouteTable> table;
+    std::shared_ptr<const ContractionHierarchy> hierarchy;
+    std::shared_ptr<const LandmarkTable> landmarks;
+
+    std::unique_ptr<ChQuery> hierarchyQuery; /**< Created on first use, never shared between copies */
+
+    std::shared_ptr<const CsrGraph> reverseGraph; /**< Built on the first search without an index */
+
+    BucketDijkstra engine;                          /**< Builds shortest path trees */
+    BucketPointToPoint pointSearch;                 /**< Answers queries that no index or tree answers */
+    BucketAStar goalSearch;                         /**< Same, steered by the landmark tables */
+    KShortestPaths alternativeSearch;               /**< Answers findAlternatives() */
+    std::vector<int> statePath;                     /**< Route over routing states before conversion to stations */
+    std::vector<std::vector<int>> alternativePaths; /**< State paths of the last findAlternatives() */
+    std::vector<int> alternativeMinutes;
+    ShortestPathRepair repair;                      /**< Repairs cached trees and routes after segment changes */
+
+    LruCache<uint64_t, RouteResult> routeCache;             /**< Routes by origin and destination */
+    LruCache<int, ShortestPathTree> treeCache;              /**< Shortest path trees by origin */
+    LruCache<uint64_t, AlternativeRoutes> alternativeCache; /**< Alternatives by origin and destination */
+    int lastOrigin;                                         /**< Origin of the previous computed query */
+};
+
+#endif // ROUTEPLANNER_H
@@ -0,0 +1,508 @@
+#include "RouteRenderer.h"
+#include <cstdio>
+
+using namespace std;
+
+namespace
+{
+/* Room for the fixed text of one step and its number, per format */
+const size_t StepOverhead[RouteRenderer::FormatCount] = {96, 24, 32};
+
+/* Fixed text around the route summary, in output order; both fare variants are counted */
+const char HtmlTitle[] = "<html><body style='font-family: Arial;'>"
+                         "<div style='margin-bottom: 8px;'>"
+                         "<span style='font-size: 16px; font-weight: bold;'>Route from ";
+const char HtmlTo[] = " to ";
+const char HtmlTime[] = "</span></div>"
+                        "<div style='margin: 10px 0; padding: 5px;'>"
+                        "<div style='margin-bottom: 5px;'>"
+                        "<span style='font-weight: bold; color: #3b82f6;'>Time:</span> "
+                        "<span style='font-size: 15px;'>";
+const char HtmlDistance[] = " minutes</span></div>"
+                            "<div style='margin-bottom: 5px;'>"
+                            "<span style='font-weight: bold; color: #3b82f6;'>Distance:</span> "
+                            "<span style='font-size: 15px;'>";
+const char HtmlTransfers[] = " KM</span></div>"
+                             "<div style='margin-bottom: 5px;'>"
+                             "<span style='font-weight: bold; color: #3b82f6;'>Transfers:</span> "
+                             "<span style='font-size: 15px;'>";
+const char HtmlFare[] = "</span></div>"
+                        "<div style='margin: 8px 0;'>"
+                        "<span style='font-weight: bold; color: #10b981;'>Fare:</span> ";
+const char HtmlCashFare[] = "<span style='font-size: 15px; text-decoration: line-through; color: #666;'>₹";
+const char HtmlCardFare[] = "</span> <span style='font-size: 18px; font-weight: bold; color: #10b981;'>₹";
+const char HtmlDiscount[] = "</span> <span style='font-size: 12px; color: #10b981;'>(";
+const char HtmlDiscountEnd[] = "% card discount)</span>";
+const char HtmlFareOnly[] = "<span style='font-size: 18px; font-weight: bold; color: #10b981;'>₹";
+const char HtmlFareEnd[] = "</span>";
+const char HtmlDay[] = " <span style='font-size: 12px; color: #10b981;'>(";
+const char HtmlDayEnd[] = " rate)</span>";
+const char HtmlPath[] = "</div>"
+                        "<span style='font-size: 16px; font-weight: bold; color: #FF5500;'>Path:</span>"
+                        "<p style='margin: 8px 0;'><b>1. Start at</b> ";
+const char HtmlStartLines[] = " [";
+const char HtmlStartEnd[] = "]</p>";
+const char HtmlEnd[] = "</div></body></html>";
+
+const char TextTitle[] = "Route from ";
+const char TextTo[] = " to ";
+const char TextTime[] = "\nTime: ";
+const char TextDistance[] = " minutes\nDistance: ";
+const char TextTransfers[] = " km\nTransfers: ";
+const char TextFare[] = "\nFare: Rs ";
+const char TextCashFare[] = " (Rs ";
+const char TextDiscount[] = " without card, ";
+const char TextDiscountEnd[] = "% card discount)";
+const char TextDay[] = " (";
+const char TextDayEnd[] = " rate)";
+const char TextPath[] = "\nPath:\n1. Start at ";
+const char TextStartLines[] = " [";
+const char TextStartEnd[] = "]\n";
+
+const char JsonFrom[] = "{\"from\":";
+const char JsonTo[] = ",\"to\":";
+const char JsonMinutes[] = ",\"minutes\":";
+const char JsonDistance[] = ",\"distance\":";
+const char JsonTransfers[] = ",\"transfers\":";
+const char JsonDay[] = ",\"day\":";
+const char JsonFare[] = ",\"fare\":";
+const char JsonCardFare[] = ",\"card_fare\":";
+const char JsonSteps[] = ",\"steps\":[{\"station\":";
+const char JsonStartLines[] = ",\"lines\":";
+const char JsonStartEnd[] = "}";
+const char JsonEnd[] = "]}";
+
+template <size_t N>
+constexpr size_t length(const char (&)[N])
+{
+    return N - 1;
+}
+
+/* Room for the fixed text above */
+const size_t HeaderText[RouteRenderer::FormatCount] = {
+    length(HtmlTitle) + length(HtmlTo) + length(HtmlTime) + length(HtmlDistance) + length(HtmlTransfers) +
+        length(HtmlFare) + length(HtmlCashFare) + length(HtmlCardFare) + length(HtmlDiscount) +
+        length(HtmlDiscountEnd) + length(HtmlFareOnly) + length(HtmlFareEnd) + length(HtmlDay) + length(HtmlDayEnd) +
+        length(HtmlPath) + length(HtmlStartLines) + length(HtmlStartEnd) + length(HtmlEnd),
+    length(TextTitle) + length(TextTo) + length(TextTime) + length(TextDistance) + length(TextTransfers) +
+        length(TextFare) + length(TextCashFare) + length(TextDiscount) + length(TextDiscountEnd) + length(TextDay) +
+        length(TextDayEnd) + length(TextPath) + length(TextStartLines) + length(TextStartEnd),
+    length(JsonFrom) + length(JsonTo) + length(JsonMinutes) + length(JsonDistance) + length(JsonTransfers) +
+        length(JsonDay) + length(JsonFare) + length(JsonCardFare) + length(JsonSteps) + length(JsonStartLines) +
+        length(JsonStartEnd) + length(JsonEnd)};
+
+/* Numbers in the summary: time, distance, transfers, both fares and the discount, each under 10^20 */
+const size_t SummaryNumbers = 6;
+const size_t NumberRoom = 24;
+
+/* Escaping grows a character to at most six, as in "&quot;" or "\u001f", plus JSON's quotes */
+const size_t EscapeGrowth = 6;
+
+void appendEscapedHtml(string &output, const string &text)
+{
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '&': output += "&amp;"; break;
+        case '<': output += "&lt;"; break;
+        case '>': output += "&gt;"; break;
+        case '\'': output += "&#39;"; break;
+        case '"': output += "&quot;"; break;
+        default: output += c;
+        }
+    }
+}
+
+string escapeHtml(const string &text)
+{
+    string escaped;
+    appendEscapedHtml(escaped, text);
+    return escaped;
+}
+
+/* JSON string literal including the quotes */
+void appendQuotedJson(string &output, const string &text)
+{
+    output += '"';
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '"': output += "\\\""; break;
+        case '\\': output += "\\\\"; break;
+        case '\n': output += "\\n"; break;
+        case '\r': output += "\\r"; break;
+        case '\t': output += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                char escaped[8];
+                output.append(escaped, snprintf(escaped, sizeof(escaped), "\\u%04x", c));
+            }
+            else
+                output += c;
+        }
+    }
+    output += '"';
+}
+
+string quoteJson(const string &text)
+{
+    string quoted;
+    appendQuotedJson(quoted, text);
+    return quoted;
+}
+
+void appendInteger(string &output, long long value)
+{
+    char number[24];
+    output.append(number, snprintf(number, sizeof(number), "%lld", value));
+}
+
+void appendFixed(string &output, double value, int decimals)
+{
+    char number[48];
+    output.append(number, snprintf(number, sizeof(number), "%.*f", decimals, value));
+}
+}
+
+RouteRenderer::RouteRenderer()
+{
+}
+
+RouteRenderer::RouteRenderer(const MetroNetwork &network)
+{
+    setNetwork(network);
+}
+
+const char *RouteRenderer::lineColor(const string &line)
+{
+    if (line == "Blue")
+        return "#4169E1";
+    if (line == "Yellow")
+        return "#FFDF00";
+    if (line == "Red")
+        return "#FF4040";
+    if (line == "Pink")
+        return "#FC8EAC";
+    if (line == "Magenta")
+        return "#CC338B";
+    if (line == "Violet")
+        return "#8b5cf6";
+    return "#333333";
+}
+
+RouteRenderer::Fragment RouteRenderer::store(const string &text)
+{
+    Fragment fragment;
+    fragment.offset = static_cast<uint32_t>(pool.size());
+    fragment.length = static_cast<uint32_t>(text.size());
+    pool += text;
+    return fragment;
+}
+
+void RouteRenderer::setNetwork(const MetroNetwork &network)
+{
+    pool.clear();
+    stationNames.clear();
+    stationLines.clear();
+    lineNames.clear();
+
+    /* Each line once per format: coloured for HTML, as in a station's line list */
+    vector<string> lineHtml, lineText, lineJson;
+    for (const string &name : network.lineNames)
+    {
+        lineHtml.push_back(string("<span style='color: ") + lineColor(name) + "; font-weight: bold;'>" +
+                           escapeHtml(name));
+        lineText.push_back(name);
+        lineJson.push_back(quoteJson(name));
+
+        lineNames.push_back(store(lineHtml.back() + " Line</span>"));
+        lineNames.push_back(store(name));
+        lineNames.push_back(store(lineJson.back()));
+    }
+
+    for (size_t station = 0; station < network.stations.size(); ++station)
+    {
+        const string &name = network.stations[station].name;
+        stationNames.push_back(store(escapeHtml(name)));
+        stationNames.push_back(store(name));
+        stationNames.push_back(store(quoteJson(name)));
+
+        string html, text, json = "[";
+        uint32_t mask = network.lineMasks[station];
+        for (int line = 0; line < MaxLines && line < static_cast<int>(network.lineNames.size()); ++line)
+        {
+            if (!(mask & (1u << line)))
+                continue;
+            if (!text.empty())
+            {
+                html += '/';
+                text += '/';
+                json += ',';
+            }
+            html += lineHtml[line] + "</span>";
+            text += lineText[line];
+            json += lineJson[line];
+        }
+        stationLines.push_back(store(html));
+        stationLines.push_back(store(text));
+        stationLines.push_back(store(json + ']'));
+    }
+    pool.shrink_to_fit();
+}
+
+size_t RouteRenderer::memoryBytes() const
+{
+    return pool.capacity() + (stationNames.capacity() + stationLines.capacity() + lineNames.capacity()) * sizeof(Fragment);
+}
+
+void RouteRenderer::render(const RouteResult &route, const FareTable &fares, bool isHoliday, bool hasMetroCard,
+                           Format format, string &output) const
+{
+    const vector<int> &path = route.path;
+    if (path.empty())
+    {
+        output += format == Json ? "{\"error\":\"no route\"}" : format == Text ? "No valid route found.\n"
+                                                                             : "No valid route found.";
+        return;
+    }
+
+    /*
+     * The summary is its fixed text, numbers and the escaped day name; every step is a station name, its lines
+     * and some fixed text, and a line change adds a line and a name
+     */
+    int day = fares.dayType(isHoliday);
+    size_t size = HeaderText[format] + SummaryNumbers * NumberRoom + fares.dayName(day).size() * EscapeGrowth + 2 +
+                  stationNames[path.front() * FormatCount + format].length +
+                  stationNames[path.back() * FormatCount + format].length + path.size() * StepOverhead[format];
+    for (int station : path)
+        size += stationNames[station * FormatCount + format].length + stationLines[station * FormatCount + format].length;
+    for (size_t i = 1; i < route.legs.size(); ++i)
+    {
+        uint8_t line = route.legs[i].line;
+        if (line != NoLine)
+            size += StepOverhead[format] + lineNames[line * FormatCount + format].length +
+                    stationNames[path[route.legs[i].first] * FormatCount + format].length;
+    }
+    output.reserve(output.size() + size);
+
+    if (format == Html)
+        renderHtml(route, fares, day, hasMetroCard, output);
+    else if (format == Text)
+        renderText(route, fares, day, hasMetroCard, output);
+    else
+        renderJson(route, fares, day, hasMetroCard, output);
+}
+
+void RouteRenderer::renderHtml(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                               string &output) const
+{
+    const vector<int> &path = route.path;
+    auto name = [&](int station) { append(output, stationNames[station * FormatCount + Html]); };
+    auto lines = [&](int station) { append(output, stationLines[station * FormatCount + Html]); };
+
+    output += HtmlTitle;
+    name(path.front());
+    output += HtmlTo;
+    name(path.back());
+    output += HtmlTime;
+    appendInteger(output, route.travelTime);
+    output += HtmlDistance;
+    appendFixed(output, route.distance, 2);
+    output += HtmlTransfers;
+    appendInteger(output, route.transfers);
+
+    /* Show the cash fare struck through when the card takes something off */
+    int fare = fares.fare(route.distance, day, false);
+    output += HtmlFare;
+    if (hasMetroCard && fares.cardDiscount() > 0)
+    {
+        output += HtmlCashFare;
+        appendInteger(output, fare);
+        output += HtmlCardFare;
+        appendInteger(output, fares.fare(route.distance, day, true));
+        output += HtmlDiscount;
+        appendInteger(output, fares.cardDiscount());
+        output += HtmlDiscountEnd;
+    }
+    else
+    {
+        output += HtmlFareOnly;
+        appendInteger(output, fare);
+        output += HtmlFareEnd;
+    }
+    if (day != 0)
+    {
+        output += HtmlDay;
+        appendEscapedHtml(output, fares.dayName(day));
+        output += HtmlDayEnd;
+    }
+
+    output += HtmlPath;
+    name(path[0]);
+    output += HtmlStartLines;
+    lines(path[0]);
+    output += HtmlStartEnd;
+
+    int step = 2;
+    size_t nextLeg = 1;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        /* Legs after the first begin with a line change at their boarding station */
+        if (nextLeg < route.legs.size() && route.legs[nextLeg].first == static_cast<int>(i) - 1)
+        {
+            uint8_t line = route.legs[nextLeg++].line;
+            if (line != NoLine)
+            {
+                output += "<p style='margin: 8px 0; padding: 5px;'><b>";
+                appendInteger(output, step++);
+                output += ". Change to</b> ";
+                append(output, lineNames[line * FormatCount + Html]);
+                output += " at ";
+                name(path[i - 1]);
+                output += "</p>";
+            }
+        }
+
+        output += "<p style='margin: 8px 0;'><b>";
+        appendInteger(output, step++);
+        output += ". →</b> ";
+        name(path[i]);
+        output += " [";
+        lines(path[i]);
+        output += "]</p>";
+    }
+
+    output += HtmlEnd;
+}
+
+void RouteRenderer::renderText(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                               string &output) const
+{
+    const vector<int> &path = route.path;
+    auto name = [&](int station) { append(output, stationNames[station * FormatCount + Text]); };
+    auto lines = [&](int station) { append(output, stationLines[station * FormatCount + Text]); };
+
+    output += TextTitle;
+    name(path.front());
+    output += TextTo;
+    name(path.back());
+    output += TextTime;
+    appendInteger(output, route.travelTime);
+    output += TextDistance;
+    appendFixed(output, route.distance, 2);
+    output += TextTransfers;
+    appendInteger(output, route.transfers);
+
+    int fare = fares.fare(route.distance, day, false);
+    output += TextFare;
+    if (hasMetroCard && fares.cardDiscount() > 0)
+    {
+        appendInteger(output, fares.fare(route.distance, day, true));
+        output += TextCashFare;
+        appendInteger(output, fare);
+        output += TextDiscount;
+        appendInteger(output, fares.cardDiscount());
+        output += TextDiscountEnd;
+    }
+    else
+        appendInteger(output, fare);
+    if (day != 0)
+    {
+        output += TextDay;
+        output += fares.dayName(day);
+        output += TextDayEnd;
+    }
+
+    output += TextPath;
+    name(path[0]);
+    output += TextStartLines;
+    lines(path[0]);
+    output += TextStartEnd;
+
+    int step = 2;
+    size_t nextLeg = 1;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        if (nextLeg < route.legs.size() && route.legs[nextLeg].first == static_cast<int>(i) - 1)
+        {
+            uint8_t line = route.legs[nextLeg++].line;
+            if (line != NoLine)
+            {
+                appendInteger(output, step++);
+                output += ". Change to ";
+                append(output, lineNames[line * FormatCount + Text]);
+                output += " Line at ";
+                name(path[i - 1]);
+                output += '\n';
+            }
+        }
+
+        appendInteger(output, step++);
+        output += ". -> ";
+        name(path[i]);
+        output += " [";
+        lines(path[i]);
+        output += "]\n";
+    }
+}
+
+void RouteRenderer::renderJson(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                               string &output) const
+{
+    const vector<int> &path = route.path;
+    auto name = [&](int station) { append(output, stationNames[station * FormatCount + Json]); };
+
+    output += JsonFrom;
+    name(path.front());
+    output += JsonTo;
+    name(path.back());
+    output += JsonMinutes;
+    appendInteger(output, route.travelTime);
+    output += JsonDistance;
+    appendFixed(output, route.distance, 3);
+    output += JsonTransfers;
+    appendInteger(output, route.transfers);
+    output += JsonDay;
+    appendQuotedJson(output, fares.dayName(day));
+    output += JsonFare;
+    appendInteger(output, fares.fare(route.distance, day, false));
+    if (hasMetroCard)
+    {
+        output += JsonCardFare;
+        appendInteger(output, fares.fare(route.distance, day, true));
+    }
+
+    /* Stations in travel order, with a step for every line change */
+    output += JsonSteps;
+    name(path[0]);
+    output += JsonStartLines;
+    append(output, stationLines[path[0] * FormatCount + Json]);
+    output += JsonStartEnd;
+
+    size_t nextLeg = 1;
+    for (size_t i = 1; i < path.size(); i++)
+    {
+        if (nextLeg < route.legs.size() && route.legs[nextLeg].first == static_cast<int>(i) - 1)
+        {
+            uint8_t line = route.legs[nextLeg++].line;
+            if (line != NoLine)
+            {
+                output += ",{\"change\":";
+                append(output, lineNames[line * FormatCount + Json]);
+                output += ",\"station\":";
+                name(path[i - 1]);
+                output += '}';
+            }
+        }
+
+        output += ",{\"station\":";
+        name(path[i]);
+        output += ",\"lines\":";
+        append(output, stationLines[path[i] * FormatCount + Json]);
+        output += '}';
+    }
+    output += JsonEnd;
+}
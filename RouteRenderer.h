@@ -0,0 +1,101 @@
+#ifndef ROUTERENDERER_H
+#define ROUTERENDERER_H
+
+#include "FareTable.h"
+#include "MetroNetwork.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Step-by-step route descriptions as HTML, plain text or JSON
+ *
+ * setNetwork() escapes every station name and line list once for each
+ * format and keeps the results in one text pool. render() then only copies
+ * those fragments and a few numbers into the output, which it sizes up front
+ * from the fragment lengths, so a reused output string is not reallocated
+ * and rendering costs no heap allocation per step.
+ *
+ * The HTML matches what the application shows; text is meant for terminals
+ * and kiosks, JSON is one object on one line. Output is UTF-8.
+ */
+class RouteRenderer
+{
+public:
+    /** @brief Output format */
+    enum Format
+    {
+        Html,
+        Text,
+        Json,
+        FormatCount
+    };
+
+    /**
+     * @brief Construct a renderer without a network; setNetwork() must come before render()
+     */
+    RouteRenderer();
+
+    /**
+     * @brief Construct a renderer for a network
+     * @param network Canonical network the routes refer to
+     */
+    explicit RouteRenderer(const MetroNetwork &network);
+
+    /**
+     * @brief Build the fragments of a network's stations and lines
+     * @param network Canonical network the routes refer to; not referenced afterwards
+     */
+    void setNetwork(const MetroNetwork &network);
+
+    /**
+     * @brief Append the description of a route
+     * @param route Route found by RoutePlanner::findRoute()
+     * @param fares Fare table charging the journey
+     * @param isHoliday Charge the holiday day type
+     * @param hasMetroCard Show the card fare as well
+     * @param format Output format
+     * @param output String the description is appended to
+     */
+    void render(const RouteResult &route, const FareTable &fares, bool isHoliday, bool hasMetroCard, Format format,
+                std::string &output) const;
+
+    /**
+     * @brief HTML colour code of a line
+     * @param line Name of the line
+     * @return Colour such as "#4169E1", dark grey for unknown lines
+     */
+    static const char *lineColor(const std::string &line);
+
+    /** @brief Bytes held by the fragments */
+    size_t memoryBytes() const;
+
+private:
+    /* Position of a fragment in the text pool */
+    struct Fragment
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    /* Output for each format, appended after render() reserved room for it */
+    void renderHtml(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                    std::string &output) const;
+    void renderText(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                    std::string &output) const;
+    void renderJson(const RouteResult &route, const FareTable &fares, int day, bool hasMetroCard,
+                    std::string &output) const;
+
+    /* Add text to the pool and return where it went */
+    Fragment store(const std::string &text);
+
+    /* Append a stored fragment */
+    void append(std::string &output, Fragment fragment) const { output.append(pool, fragment.offset, fragment.length); }
+
+    std::string pool;
+    std::vector<Fragment> stationNames; /**< Escaped name of every station, FormatCount per station */
+    std::vector<Fragment> stationLines; /**< Lines serving every station, FormatCount per station */
+    std::vector<Fragment> lineNames;    /**< Line names for line changes, FormatCount per line */
+};
+
+#endif // ROUTERENDERER_H
@@ -0,0 +1,136 @@
+#include "FareTable.h"
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include "NetworkGenerator.h"
+#include "RoutePlanner.h"
+#include "RouteRenderer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+/*
+ * Checks that RouteRenderer::render() reserves room for the whole route up
+ * front: rendering into an empty string allocates exactly once, for every
+ * format, with and without the card and the holiday rate, including a fare
+ * table whose day names need escaping. Exits with 1 on the first failing
+ * networks.
+ */
+
+namespace
+{
+int failures = 0;
+bool counting = false;
+int allocations = 0;
+
+void fail(const char *network, int from, int to, const char *format, bool isHoliday, bool hasMetroCard, int count)
+{
+    if (failures++ < 20)
+        printf("FAIL %s: %d -> %d as %s%s%s: %d allocations, 1 expected\n", network, from, to, format,
+               isHoliday ? " on a holiday" : "", hasMetroCard ? " with a card" : "", count);
+}
+
+void checkNetwork(const char *network, const vector<Station> &nodes, const vector<vector<Edge>> &graph,
+                  const FareTable &fares, int queries)
+{
+    static const char *const FormatNames[RouteRenderer::FormatCount] = {"html", "text", "json"};
+
+    MetroNetwork metro;
+    buildMetroNetwork(nodes, graph, metro);
+    RoutePlanner planner(metro);
+    RouteRenderer renderer(metro);
+    int stations = static_cast<int>(metro.stations.size());
+    mt19937 random(23);
+    uniform_int_distribution<int> station(0, stations - 1);
+    RouteResult route;
+    for (int i = 0; i < queries; ++i)
+    {
+        int from = station(random);
+        int to = station(random);
+        if (!planner.findRoute(from, to, route))
+            continue;
+
+        for (int format = 0; format < RouteRenderer::FormatCount; ++format)
+        {
+            for (int options = 0; options < 4; ++options)
+            {
+                bool isHoliday = options & 1;
+                bool hasMetroCard = options & 2;
+                string output;
+                allocations = 0;
+                counting = true;
+                renderer.render(route, fares, isHoliday, hasMetroCard, static_cast<RouteRenderer::Format>(format),
+                                output);
+                counting = false;
+                if (allocations != 1)
+                    fail(network, from, to, FormatNames[format], isHoliday, hasMetroCard, allocations);
+            }
+        }
+    }
+}
+}
+
+void *operator new(size_t size)
+{
+    if (counting)
+        ++allocations;
+    if (void *memory = malloc(size ? size : 1))
+        return memory;
+    throw bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    free(memory);
+}
+
+int main()
+{
+    vector<Station> nodes;
+    vector<vector<Edge>> graph;
+    initializeMetroNetwork(nodes, graph);
+
+    /* Long day names full of characters every format escapes */
+    const char *fileName = "RouteRendererTest.fares.csv";
+    FILE *file = fopen(fileName, "w");
+    if (file)
+    {
+        fputs("days,Weekday,<Public & \"Gazetted\" 'Holiday'> \\ <Public & \"Gazetted\" 'Holiday'>\n"
+              "bracket,2,10,10\nbracket,,60,50\ncard_discount,10\ncap,60\n",
+              file);
+        fclose(file);
+    }
+    FareTable escaped;
+    if (!file || !escaped.load(fileName))
+    {
+        printf("FAIL cannot load %s\n", fileName);
+        ++failures;
+    }
+    remove(fileName);
+
+    checkNetwork("delhi", nodes, graph, FareTable::defaultTable(), 100);
+    checkNetwork("delhi", nodes, graph, escaped, 100);
+
+    NetworkGenerator generator;
+    generator.setStationCount(500);
+    generator.generate(nodes, graph);
+    checkNetwork("radial-500", nodes, graph, FareTable::defaultTable(), 100);
+    checkNetwork("radial-500", nodes, graph, escaped, 100);
+
+    if (failures > 0)
+    {
+        printf("%d failures\n", failures);
+        return 1;
+    }
+    printf("All render checks passed\n");
+    return 0;
+}
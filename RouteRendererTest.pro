@@ -0,0 +1,10 @@
+TARGET = RouteRendererTest
+TEMPLATE = app
+CONFIG += console testcase
+CONFIG -= qt app_bundle
+
+include(MetroCore.pri)
+
+# Run by "make check"
+SOURCES += \
+    RouteRendererTest.cpp
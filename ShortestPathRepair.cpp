@@ -0,0 +1,181 @@
+#include "ShortestPathRepair.h"
+#include <algorithm>
+
+using namespace std;
+
+const int ShortestPathRepair::Closed;
+
+void ShortestPathRepair::repairTree(const CsrGraph &graph, const CsrGraph &reverse, int tail, int head, int oldMinutes,
+                                    int newMinutes, vector<int> &distances, vector<int> &previous,
+                                    vector<Change> &changes)
+{
+    int n = graph.nodeCount();
+    if (static_cast<int>(recorded.size()) != n)
+        recorded.assign(n, 0);
+    queue.reset(n);
+    size_t firstChange = changes.size();
+
+    if (newMinutes < oldMinutes)
+    {
+        /* A faster arc can only shorten routes through its head */
+        if (distances[tail] == INT_MAX || distances[tail] + newMinutes >= distances[head])
+            return;
+        record(head, distances[head], changes);
+        distances[head] = distances[tail] + newMinutes;
+        previous[head] = tail;
+        queue.push(head, distances[head]);
+    }
+    else
+    {
+        /* A slower arc only matters if the tree uses it and no parallel arc is as fast */
+        if (previous[head] != tail)
+            return;
+        for (int arc = graph.arcBegin(tail); arc < graph.arcEnd(tail); ++arc)
+        {
+            if (graph.target(arc) == head && distances[tail] + graph.minutes(arc) == distances[head])
+                return;
+        }
+
+        /* Cut off the subtree below the arc; tree arcs still exist, so children are found among the out-arcs */
+        detached.assign(1, head);
+        record(head, distances[head], changes);
+        distances[head] = INT_MAX;
+        previous[head] = -1;
+        for (size_t i = 0; i < detached.size(); ++i)
+        {
+            int node = detached[i];
+            for (int arc = graph.arcBegin(node); arc < graph.arcEnd(node); ++arc)
+            {
+                int child = graph.target(arc);
+                if (previous[child] == node && distances[child] != INT_MAX)
+                {
+                    record(child, distances[child], changes);
+                    distances[child] = INT_MAX;
+                    previous[child] = -1;
+                    detached.push_back(child);
+                }
+            }
+        }
+
+        /* Attach every detached node to its best neighbour outside the subtree, then settle them again */
+        for (int node : detached)
+        {
+            for (int arc = reverse.arcBegin(node); arc < reverse.arcEnd(node); ++arc)
+            {
+                int from = reverse.target(arc);
+                if (recorded[from] || distances[from] == INT_MAX)
+                    continue;
+                int distance = distances[from] + reverse.minutes(arc);
+                if (distance < distances[node])
+                {
+                    distances[node] = distance;
+                    previous[node] = from;
+                }
+            }
+            if (distances[node] != INT_MAX)
+                queue.push(node, distances[node]);
+        }
+    }
+
+    while (!queue.empty())
+    {
+        int key;
+        int node = queue.pop(key);
+        if (key > distances[node])
+            continue;
+
+        for (int arc = graph.arcBegin(node); arc < graph.arcEnd(node); ++arc)
+        {
+            int next = graph.target(arc);
+            int distance = key + graph.minutes(arc);
+            if (distance < distances[next])
+            {
+                record(next, distances[next], changes);
+                distances[next] = distance;
+                previous[next] = node;
+                queue.push(next, distance);
+            }
+        }
+    }
+
+    /* Nodes can end up at their old time over another route; only real changes are reported */
+    size_t kept = firstChange;
+    for (size_t i = firstChange; i < changes.size(); ++i)
+    {
+        recorded[changes[i].node] = 0;
+        if (distances[changes[i].node] != changes[i].oldMinutes)
+            changes[kept++] = changes[i];
+    }
+    changes.resize(kept);
+}
+
+void ShortestPathRepair::searchAround(const CsrGraph &graph, const CsrGraph &reverse, int tail, int head, int radius)
+{
+    search(toTail, reverse, tail, radius);
+    search(fromHead, graph, head, radius);
+}
+
+void ShortestPathRepair::pathThrough(int from, int to, vector<int> &path) const
+{
+    path.clear();
+    for (int at = from; at != -1; at = toTail.previous[at])
+        path.push_back(at);
+
+    /* Links of the forward search lead back to the head */
+    size_t middle = path.size();
+    for (int at = to; at != -1; at = fromHead.previous[at])
+        path.push_back(at);
+    reverse(path.begin() + middle, path.end());
+}
+
+void ShortestPathRepair::search(Search &side, const CsrGraph &arcs, int start, int radius)
+{
+    int n = arcs.nodeCount();
+    if (static_cast<int>(side.distances.size()) != n)
+    {
+        side.distances.assign(n, INT_MAX);
+        side.previous.assign(n, -1);
+    }
+    else
+    {
+        for (int node : side.touched)
+        {
+            side.distances[node] = INT_MAX;
+            side.previous[node] = -1;
+        }
+    }
+    side.touched.assign(1, start);
+    side.distances[start] = 0;
+
+    queue.reset(n);
+    queue.push(start, 0);
+    while (!queue.empty())
+    {
+        int key;
+        int node = queue.pop(key);
+        if (key > side.distances[node])
+            continue;
+
+        for (int arc = arcs.arcBegin(node); arc < arcs.arcEnd(node); ++arc)
+        {
+            int next = arcs.target(arc);
+            int distance = key + arcs.minutes(arc);
+            if (distance > radius || distance >= side.distances[next])
+                continue;
+            if (side.distances[next] == INT_MAX)
+                side.touched.push_back(next);
+            side.distances[next] = distance;
+            side.previous[next] = node;
+            queue.push(next, distance);
+        }
+    }
+}
+
+void ShortestPathRepair::record(int node, int minutes, vector<Change> &changes)
+{
+    if (recorded[node])
+        return;
+    recorded[node] = 1;
+    Change change = {node, minutes};
+    changes.push_back(change);
+}
@@ -0,0 +1,103 @@
+#ifndef SHORTESTPATHREPAIR_H
+#define SHORTESTPATHREPAIR_H
+
+#include "CsrGraph.h"
+#include "PriorityQueues.h"
+#include <climits>
+#include <vector>
+
+/**
+ * @brief Brings shortest path results up to date after a single arc changed
+ *
+ * A delay or closure only affects routes near the arc, so results computed
+ * before the change are repaired instead of recomputed:
+ *
+ * - repairTree() updates a single-source tree from DijkstraEngine in place.
+ *   A faster arc starts a search at its head that only continues while
+ *   times improve. A slower arc of the tree detaches the subtree below it,
+ *   which is attached again from its cheapest neighbours outside and then
+ *   settled once more. Both touch only the nodes whose route changed.
+ * - searchAround() measures travel times to the tail and from the head of
+ *   the arc, up to a radius. A route between two nodes can only gain or lose
+ *   the arc if its time matches the best time through it, which decides
+ *   which cached routes need another look.
+ *
+ * Both graphs must already contain the change. A closed arc travels Closed
+ * minutes here; CsrGraph represents it as an arc back to its own tail.
+ */
+class ShortestPathRepair
+{
+public:
+    /** @brief Travel time of a closed arc */
+    static const int Closed = INT_MAX;
+
+    /**
+     * @brief Node whose travel time a repair changed
+     */
+    struct Change
+    {
+        int node;       /**< Node of the tree */
+        int oldMinutes; /**< Travel time before the change, INT_MAX if unreachable */
+    };
+
+    /**
+     * @brief Repair a single-source tree after one arc changed
+     * @param graph Network with the change applied
+     * @param reverse The same network with every arc reversed
+     * @param tail Node the arc leaves
+     * @param head Node the arc enters
+     * @param oldMinutes Travel time of the arc before the change, Closed if it was closed
+     * @param newMinutes Travel time of the arc after the change, Closed if it is closed now
+     * @param distances Travel times from the origin, updated in place
+     * @param previous Predecessor of every node, updated in place
+     * @param changes Output nodes whose travel time changed
+     */
+    void repairTree(const CsrGraph &graph, const CsrGraph &reverse, int tail, int head, int oldMinutes, int newMinutes,
+                    std::vector<int> &distances, std::vector<int> &previous, std::vector<Change> &changes);
+
+    /**
+     * @brief Search backwards from the tail and forwards from the head of an arc
+     * @param graph Network with the change applied
+     * @param reverse The same network with every arc reversed
+     * @param tail Node the arc leaves
+     * @param head Node the arc enters
+     * @param radius Longest travel time of interest, INT_MAX for no limit
+     */
+    void searchAround(const CsrGraph &graph, const CsrGraph &reverse, int tail, int head, int radius);
+
+    /** @brief Minutes from a node to the tail, INT_MAX beyond the radius of searchAround() */
+    int minutesToTail(int node) const { return toTail.distances[node]; }
+
+    /** @brief Minutes from the head to a node, INT_MAX beyond the radius of searchAround() */
+    int minutesFromHead(int node) const { return fromHead.distances[node]; }
+
+    /**
+     * @brief Route through the arc of the last searchAround()
+     * @param from Node with a finite minutesToTail()
+     * @param to Node with a finite minutesFromHead()
+     * @param path Output nodes from from over tail and head to to
+     */
+    void pathThrough(int from, int to, std::vector<int> &path) const;
+
+private:
+    /* One side of searchAround(); only touched entries are reset */
+    struct Search
+    {
+        std::vector<int> distances;
+        std::vector<int> previous;
+        std::vector<int> touched;
+    };
+
+    void search(Search &side, const CsrGraph &arcs, int start, int radius);
+
+    /* Remember a node's time before its first change */
+    void record(int node, int minutes, std::vector<Change> &changes);
+
+    Search toTail;
+    Search fromHead;
+    BinaryHeapQueue queue;      /**< Takes keys in any order, as re-attaching a subtree needs */
+    std::vector<char> recorded; /**< Nodes already listed in the changes of the current repair */
+    std::vector<int> detached;  /**< Subtree cut off by a slower arc */
+};
+
+#endif // SHORTESTPATHREPAIR_H
@@ -0,0 +1,426 @@
+#include "Timetable.h"
+#include <algorithm>
+#include <cstdio>
+#include <unordered_map>
+
+using namespace std;
+
+const int Timetable::DefaultHeadwayMinutes;
+
+namespace
+{
+/* Patterns kept per line when its branches are enumerated; a tree of b branches has b * (b - 1) */
+const size_t MaxBranchPatterns = 64;
+
+/* Ride between two stations of the network on one line */
+struct Ride
+{
+    int from;
+    int to;
+    int minutes;
+    uint32_t metres;
+    uint8_t line;
+};
+
+/* Length of the ride between two stations, preferring one on the given line */
+uint32_t rideMetres(const MetroNetwork &network, int from, int to, uint8_t line)
+{
+    const CsrGraph &graph = network.graph;
+    uint32_t fallback = 0;
+    bool found = false;
+
+    /* The station state and its platforms, which all follow boarding arcs */
+    int tails[MaxLines + 1];
+    int tailCount = 0;
+    tails[tailCount++] = from;
+    for (int arc = graph.arcBegin(from); arc < graph.arcEnd(from) && tailCount <= MaxLines; ++arc)
+    {
+        int target = graph.target(arc);
+        if (target != from && network.stateStation[target] == from)
+            tails[tailCount++] = target;
+    }
+
+    for (int i = 0; i < tailCount; ++i)
+    {
+        for (int arc = graph.arcBegin(tails[i]); arc < graph.arcEnd(tails[i]); ++arc)
+        {
+            if (network.stateStation[graph.target(arc)] != to)
+                continue;
+            if (network.arcLine[arc] == line)
+                return graph.metres(arc);
+            if (!found)
+            {
+                fallback = graph.metres(arc);
+                found = true;
+            }
+        }
+    }
+    return fallback;
+}
+
+/* Depth-first enumeration of every ride sequence from path's last station to a dead end */
+void enumeratePatterns(const vector<Ride> &rides, const vector<vector<int>> &out, vector<int> &path,
+                       vector<char> &onPath, vector<vector<int>> &found)
+{
+    int at = rides[path.back()].to;
+    bool extended = false;
+    for (int ride : out[at])
+    {
+        if (found.size() >= MaxBranchPatterns)
+            return;
+        int next = rides[ride].to;
+        if (onPath[next])
+            continue;
+
+        extended = true;
+        onPath[next] = 1;
+        path.push_back(ride);
+        enumeratePatterns(rides, out, path, onPath, found);
+        path.pop_back();
+        onPath[next] = 0;
+    }
+    if (!extended)
+        found.push_back(path);
+}
+}
+
+Timetable::Timetable() : patterns(0)
+{
+}
+
+void Timetable::start(const MetroNetwork &network)
+{
+    int stationCount = static_cast<int>(network.stations.size());
+    connectionList.clear();
+    nextConnection.clear();
+    lengths.clear();
+    lines.clear();
+    transfers.resize(stationCount);
+    for (int s = 0; s < stationCount; ++s)
+        transfers[s] = network.transferMinutes[s] * 60;
+    patterns = 0;
+}
+
+void Timetable::addTrip(uint8_t line, const vector<ScheduledStop> &stops, const vector<uint32_t> &metres)
+{
+    /* A train that would arrive before it leaves ends one trip; the rest becomes another */
+    int trip = -1;
+    for (size_t i = 1; i < stops.size(); ++i)
+    {
+        const ScheduledStop &departing = stops[i - 1];
+        const ScheduledStop &arriving = stops[i];
+        if (departing.departure < 0 || arriving.arrival < departing.departure)
+        {
+            trip = -1;
+            continue;
+        }
+
+        if (trip < 0)
+        {
+            trip = static_cast<int>(lines.size());
+            lines.push_back(line);
+        }
+        Connection connection = {departing.departure, arriving.arrival, departing.node, arriving.node, trip};
+        connectionList.push_back(connection);
+        lengths.push_back(metres[i - 1]);
+    }
+}
+
+bool Timetable::finish()
+{
+    /* Rides were added trip by trip; a stable sort keeps that order among equal times,
+       so a trip's rides stay in sequence even when some take no time */
+    size_t count = connectionList.size();
+    vector<int32_t> order(count);
+    for (size_t i = 0; i < count; ++i)
+        order[i] = static_cast<int32_t>(i);
+    stable_sort(order.begin(), order.end(), [&](int32_t a, int32_t b)
+    {
+        const Connection &first = connectionList[a];
+        const Connection &second = connectionList[b];
+        if (first.departure != second.departure)
+            return first.departure < second.departure;
+        return first.arrival < second.arrival;
+    });
+
+    vector<int32_t> position(count);
+    for (size_t i = 0; i < count; ++i)
+        position[order[i]] = static_cast<int32_t>(i);
+
+    vector<Connection> sorted(count);
+    vector<uint32_t> sortedLengths(count);
+    nextConnection.assign(count, -1);
+    for (size_t i = 0; i < count; ++i)
+    {
+        sorted[position[i]] = connectionList[i];
+        sortedLengths[position[i]] = lengths[i];
+        if (i + 1 < count && connectionList[i + 1].trip == connectionList[i].trip)
+            nextConnection[position[i]] = position[i + 1];
+    }
+    connectionList.swap(sorted);
+    lengths.swap(sortedLengths);
+    return !connectionList.empty();
+}
+
+bool Timetable::build(const MetroNetwork &network, const vector<ScheduledTrip> &trips)
+{
+    start(network);
+
+    unordered_map<string, int> lineIndex;
+    for (size_t i = 0; i < network.lineNames.size(); ++i)
+        lineIndex.insert(make_pair(network.lineNames[i], static_cast<int>(i)));
+
+    int nodeCount = static_cast<int>(network.nodeStation.size());
+    vector<ScheduledStop> stops;
+    vector<uint32_t> metres;
+    for (const ScheduledTrip &trip : trips)
+    {
+        auto found = lineIndex.find(trip.line);
+        uint8_t line = found != lineIndex.end() ? static_cast<uint8_t>(found->second) : NoLine;
+
+        /* Stops become stations; several calls at one station are one long stop */
+        stops.clear();
+        for (const ScheduledStop &stop : trip.stops)
+        {
+            if (stop.node < 0 || stop.node >= nodeCount)
+                continue;
+            int station = network.nodeStation[stop.node];
+            if (!stops.empty() && stops.back().node == station)
+            {
+                stops.back().departure = max(stops.back().departure, stop.departure);
+                continue;
+            }
+            ScheduledStop call = {station, stop.arrival, max(stop.arrival, stop.departure)};
+            stops.push_back(call);
+        }
+
+        metres.clear();
+        for (size_t i = 1; i < stops.size(); ++i)
+            metres.push_back(rideMetres(network, stops[i - 1].node, stops[i].node, line));
+        addTrip(line, stops, metres);
+    }
+    return finish();
+}
+
+bool Timetable::generate(const MetroNetwork &network, int firstDeparture, int lastDeparture, int headway)
+{
+    start(network);
+    if (headway <= 0 || lastDeparture < firstDeparture)
+        return false;
+
+    /* Rides between distinct stations, grouped by line */
+    const CsrGraph &graph = network.graph;
+    vector<Ride> rides;
+    for (int state = 0; state < graph.nodeCount(); ++state)
+    {
+        int from = network.stateStation[state];
+        for (int arc = graph.arcBegin(state); arc < graph.arcEnd(state); ++arc)
+        {
+            int to = network.stateStation[graph.target(arc)];
+            if (to == from)
+                continue;
+            Ride ride = {from, to, graph.minutes(arc), graph.metres(arc), network.arcLine[arc]};
+            rides.push_back(ride);
+        }
+    }
+    sort(rides.begin(), rides.end(), [](const Ride &a, const Ride &b)
+    {
+        if (a.line != b.line)
+            return a.line < b.line;
+        return a.from != b.from ? a.from < b.from : a.to < b.to;
+    });
+
+    int stationCount = static_cast<int>(network.stations.size());
+    vector<vector<int>> out(stationCount);
+    vector<int> neighbours(stationCount, 0);
+    vector<char> onPath(stationCount, 0);
+    vector<char> covered(rides.size(), 0);
+    vector<vector<int>> found;
+    vector<int> path, stations;
+    vector<ScheduledStop> stops;
+    vector<uint32_t> metres;
+
+    for (size_t begin = 0; begin < rides.size();)
+    {
+        size_t end = begin;
+        while (end < rides.size() && rides[end].line == rides[begin].line)
+            ++end;
+
+        /* Line graph: rides out of every station, and how many stations each one borders */
+        stations.clear();
+        for (size_t r = begin; r < end; ++r)
+        {
+            const Ride &ride = rides[r];
+            if (out[ride.from].empty())
+                stations.push_back(ride.from);
+            out[ride.from].push_back(static_cast<int>(r));
+        }
+        for (size_t r = begin; r < end; ++r)
+        {
+            /* Count each neighbour once, however many directions join the two */
+            const Ride &ride = rides[r];
+            bool reverseListed = false;
+            for (int other : out[ride.to])
+                reverseListed = reverseListed || rides[other].to == ride.from;
+            if (!reverseListed || ride.from < ride.to)
+            {
+                ++neighbours[ride.from];
+                ++neighbours[ride.to];
+            }
+        }
+
+        /* Branches: every ride sequence leaving a terminal until it cannot go on */
+        found.clear();
+        sort(stations.begin(), stations.end());
+        for (int station : stations)
+        {
+            if (neighbours[station] != 1)
+                continue;
+            onPath[station] = 1;
+            for (int ride : out[station])
+            {
+                if (found.size() >= MaxBranchPatterns)
+                    break;
+                onPath[rides[ride].to] = 1;
+                path.assign(1, ride);
+                enumeratePatterns(rides, out, path, onPath, found);
+                onPath[rides[ride].to] = 0;
+            }
+            onPath[station] = 0;
+        }
+        for (const vector<int> &pattern : found)
+        {
+            for (int ride : pattern)
+                covered[ride] = 1;
+        }
+
+        /* Circles and whatever the branches missed: follow uncovered rides onwards,
+           closing the circle when the walk comes back to its start */
+        for (size_t r = begin; r < end; ++r)
+        {
+            if (covered[r])
+                continue;
+            path.assign(1, static_cast<int>(r));
+            covered[r] = 1;
+            int first = rides[r].from;
+            onPath[first] = 1;
+            onPath[rides[r].to] = 1;
+            for (bool closed = false; !closed;)
+            {
+                int next = -1;
+                for (int ride : out[rides[path.back()].to])
+                {
+                    int to = rides[ride].to;
+                    if (covered[ride] || (onPath[to] && (to != first || path.size() < 2)))
+                        continue;
+                    next = ride;
+                    break;
+                }
+                if (next < 0)
+                    break;
+                closed = rides[next].to == first;
+                covered[next] = 1;
+                onPath[rides[next].to] = 1;
+                path.push_back(next);
+            }
+            for (int ride : path)
+            {
+                onPath[rides[ride].from] = 0;
+                onPath[rides[ride].to] = 0;
+            }
+            found.push_back(path);
+        }
+
+        /* One train per headway along every pattern */
+        for (const vector<int> &pattern : found)
+        {
+            metres.clear();
+            int duration = 0;
+            for (int ride : pattern)
+            {
+                metres.push_back(rides[ride].metres);
+                duration += rides[ride].minutes * 60;
+            }
+
+            /* Trains are already spread along the pattern when service starts, so no
+               station waits for the first train to come all the way from the terminal */
+            int start = firstDeparture - duration / headway * headway;
+            if (start < 0)
+                start += (headway - 1 - start) / headway * headway;
+
+            for (int time = start; time <= lastDeparture; time += headway)
+            {
+                stops.clear();
+                ScheduledStop origin = {rides[pattern[0]].from, time, time};
+                stops.push_back(origin);
+                int at = time;
+                for (int ride : pattern)
+                {
+                    at += rides[ride].minutes * 60;
+                    ScheduledStop call = {rides[ride].to, at, at};
+                    stops.push_back(call);
+                }
+                addTrip(rides[begin].line, stops, metres);
+            }
+        }
+        patterns += static_cast<int>(found.size());
+
+        for (int station : stations)
+            out[station].clear();
+        for (size_t r = begin; r < end; ++r)
+        {
+            neighbours[rides[r].from] = 0;
+            neighbours[rides[r].to] = 0;
+        }
+        begin = end;
+    }
+    return finish();
+}
+
+int Timetable::firstDeparture(int time) const
+{
+    auto first = lower_bound(connectionList.begin(), connectionList.end(), time,
+                             [](const Connection &connection, int value) { return connection.departure < value; });
+    return static_cast<int>(first - connectionList.begin());
+}
+
+size_t Timetable::memoryBytes() const
+{
+    return connectionList.capacity() * sizeof(Connection) + nextConnection.capacity() * sizeof(int32_t) +
+           lengths.capacity() * sizeof(uint32_t) + lines.capacity() + transfers.capacity() * sizeof(int32_t);
+}
+
+bool parseTimeOfDay(const string &text, int &seconds)
+{
+    int parts[3] = {0, 0, 0};
+    int part = 0;
+    int digits = 0;
+    for (char c : text)
+    {
+        if (c == ':')
+        {
+            if (digits == 0 || ++part > 2)
+                return false;
+            digits = 0;
+        }
+        else if (c >= '0' && c <= '9' && digits < (part == 0 ? 3 : 2))
+        {
+            parts[part] = parts[part] * 10 + (c - '0');
+            ++digits;
+        }
+        else
+            return false;
+    }
+    if (part == 0 || digits == 0 || parts[1] > 59 || parts[2] > 59)
+        return false;
+
+    seconds = parts[0] * 3600 + parts[1] * 60 + parts[2];
+    return true;
+}
+
+string formatTimeOfDay(int seconds)
+{
+    char text[16];
+    snprintf(text, sizeof(text), "%02d:%02d", seconds / 3600, seconds / 60 % 60);
+    return text;
+}
@@ -0,0 +1,167 @@
+#ifndef TIMETABLE_H
+#define TIMETABLE_H
+
+#include "MetroData.h"
+#include "MetroNetwork.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+/**
+ * @brief One train ride between two consecutive stations of a trip
+ */
+struct Connection
+{
+    int32_t departure; /**< Seconds after midnight the train leaves from */
+    int32_t arrival;   /**< Seconds after midnight the train reaches to */
+    int32_t from;      /**< Station ID the train leaves */
+    int32_t to;        /**< Station ID the train enters */
+    int32_t trip;      /**< Trip the ride belongs to */
+};
+
+/**
+ * @brief Train services of a network as departure-sorted connections
+ *
+ * Every ride of every trip between two consecutive stations is one
+ * Connection, and all of them sit in one array ordered by departure time.
+ * A query over a time window therefore reads a single contiguous slice front
+ * to back (see ConnectionScan), touching nothing but the 20 bytes of each
+ * connection and the labels of its two stations and its trip. What only
+ * describes a journey afterwards, the next ride of the same trip, ride
+ * lengths and trip lines, lives in separate arrays.
+ *
+ * Stations are those of the MetroNetwork the timetable was built for, so
+ * journeys use the same station IDs and line indices as RoutePlanner.
+ * Changing trains at a station takes its MetroNetwork::transferMinutes.
+ *
+ * Timetables come from explicit trips, as NetworkLoader reads them from a
+ * GTFS feed, or are generated from the network's travel times: every line is
+ * split into patterns, the station sequences its trains run, and each
+ * pattern gets a train at a fixed headway through the service day. Times
+ * are seconds after midnight and may exceed 24 hours.
+ *
+ * The timetable is immutable after build() or generate(), so any number of
+ * ConnectionScan objects on different threads can share it.
+ */
+class Timetable
+{
+public:
+    /** @brief Minutes between two trains of a pattern unless set otherwise */
+    static const int DefaultHeadwayMinutes = 5;
+
+    /**
+     * @brief Construct an empty timetable; isBuilt() is false until build() or generate()
+     */
+    Timetable();
+
+    /**
+     * @brief Build the connections of scheduled trips
+     *
+     * Stops are mapped to stations through MetroNetwork::nodeStation and
+     * consecutive stops at one station are merged. A trip is split where a
+     * train would arrive before it leaves, and trips whose line the network
+     * does not know ride on NoLine.
+     *
+     * @param network Network the trip nodes belong to
+     * @param trips Trips in node IDs, see NetworkLoader::loadGtfs()
+     * @return False if no trip has a usable ride
+     */
+    bool build(const MetroNetwork &network, const std::vector<ScheduledTrip> &trips);
+
+    /**
+     * @brief Generate a regular service from the network's travel times
+     *
+     * Patterns are the station sequences between the terminals of every
+     * line, in both directions, and once around every circle line. Trains
+     * take the current ride minutes of the network between stations and
+     * follow each other every headway seconds. Every station of a pattern
+     * has a train by firstDeparture, as if the first trains had started
+     * early enough, and the last train leaves the first station of the
+     * pattern at lastDeparture.
+     *
+     * @param network Canonical network
+     * @param firstDeparture Seconds after midnight service starts at every station
+     * @param lastDeparture Seconds after midnight of the last trains from the first stations
+     * @param headway Seconds between two trains of a pattern
+     * @return False if the network has no rides or the service is empty
+     */
+    bool generate(const MetroNetwork &network, int firstDeparture, int lastDeparture,
+                  int headway = DefaultHeadwayMinutes * 60);
+
+    /** @brief True once the timetable holds connections */
+    bool isBuilt() const { return !connectionList.empty(); }
+
+    /** @brief Number of stations of the network the timetable was built for */
+    int stationCount() const { return static_cast<int>(transfers.size()); }
+
+    /** @brief Number of trips */
+    int tripCount() const { return static_cast<int>(lines.size()); }
+
+    /** @brief Number of station sequences the generated trips follow, 0 after build() */
+    int patternCount() const { return patterns; }
+
+    /** @brief All connections, ordered by departure and then arrival */
+    const std::vector<Connection> &connections() const { return connectionList; }
+
+    /**
+     * @brief Index of the first connection leaving at or after a time
+     * @param time Seconds after midnight
+     * @return Index into connections(), its size if no train leaves that late
+     */
+    int firstDeparture(int time) const;
+
+    /** @brief Index of the next ride of the same trip, -1 at the end of the trip */
+    int nextInTrip(int connection) const { return nextConnection[connection]; }
+
+    /** @brief Length of a connection in whole metres */
+    uint32_t metres(int connection) const { return lengths[connection]; }
+
+    /** @brief Line of a trip, index into MetroNetwork::lineNames or NoLine */
+    uint8_t tripLine(int trip) const { return lines[trip]; }
+
+    /** @brief Seconds needed to change trains at a station */
+    int transferSeconds(int station) const { return transfers[station]; }
+
+    /**
+     * @brief Heap memory held by the timetable
+     * @return Size in bytes
+     */
+    size_t memoryBytes() const;
+
+private:
+    /* Reset to the stations of a network before adding trips */
+    void start(const MetroNetwork &network);
+
+    /* Append the rides of one trip given as stations, with the metres of every ride */
+    void addTrip(uint8_t line, const std::vector<ScheduledStop> &stops, const std::vector<uint32_t> &metres);
+
+    /* Sort the connections and link the rides of every trip */
+    bool finish();
+
+    std::vector<Connection> connectionList;
+    std::vector<int32_t> nextConnection; /**< Next ride of the same trip, -1 at its end */
+    std::vector<uint32_t> lengths;       /**< Metres of every connection */
+    std::vector<uint8_t> lines;          /**< Line of every trip */
+    std::vector<int32_t> transfers;      /**< Seconds to change trains at every station */
+    int patterns;
+};
+
+/**
+ * @brief Parse a time of day written as H:MM or H:MM:SS
+ * @param text Time, hours may exceed 23
+ * @param seconds Output seconds after midnight
+ * @return False if the text is not a time
+ */
+bool parseTimeOfDay(const std::string &text, int &seconds);
+
+/**
+ * @brief Format seconds after midnight as HH:MM
+ *
+ * Seconds are rounded down, so an arrival reads as the minute it happens in.
+ *
+ * @param seconds Seconds after midnight
+ * @return Time of day, hours past 23 for the next morning
+ */
+std::string formatTimeOfDay(int seconds);
+
+#endif // TIMETABLE_H
@@ -1,7 +1,9 @@
 #ifndef VISUALIZATION_H
 #define VISUALIZATION_H
 
-#include "MetroData.h"
+#include "FareTable.h"
+#include "MetroNetwork.h"
+#include "RouteRenderer.h"
 #include <vector>
 #include <string>
 #include <QString>
@@ -15,17 +17,34 @@ QString getLineColorHTML(const std::string &line);
 
 /**
  * @brief Generate HTML-formatted route information for display in the Qt interface
- * @param path Vector of station IDs in the route path
- * @param stations Vector of all available metro stations
- * @param travelTime Total travel time in minutes
- * @param totalDistance Total distance in kilometers
- * @param fare Base fare calculated for the journey
+ *
+ * Renders with RouteRenderer, whose station and line fragments are built
+ * once per network.
+ *
+ * @param route Route found by RoutePlanner::findRoute()
+ * @param renderer Renderer set up for the network the station IDs refer to
+ * @param fares Fare table charging the journey
  * @param isHoliday Boolean indicating if it's a holiday/Sunday (affects fare)
  * @param hasMetroCard Boolean indicating if the user has a metro card (for discounts)
  * @return QString containing HTML-formatted route information
  */
-QString getRouteHTML(const std::vector<int> &path, const std::vector<Station> &stations,
-                     int travelTime, double totalDistance, int fare,
+QString getRouteHTML(const RouteResult &route, const RouteRenderer &renderer, const FareTable &fares,
                      bool isHoliday = false, bool hasMetroCard = false);
 
-#endif /*VISUALIZATION_H*/ 
+/**
+ * @brief Generate HTML-formatted route information for a route of any network
+ *
+ * Builds a RouteRenderer for the network on every call; callers rendering
+ * many routes should keep one and use the overload above.
+ *
+ * @param route Route found by RoutePlanner::findRoute()
+ * @param network Canonical network the station IDs refer to
+ * @param fares Fare table charging the journey
+ * @param isHoliday Boolean indicating if it's a holiday/Sunday (affects fare)
+ * @param hasMetroCard Boolean indicating if the user has a metro card (for discounts)
+ * @return QString containing HTML-formatted route information
+ */
+QString getRouteHTML(const RouteResult &route, const MetroNetwork &network, const FareTable &fares,
+                     bool isHoliday = false, bool hasMetroCard = false);
+
+#endif /*VISUALIZATION_H*/
@@ -1,10 +1,27 @@
 #include <QApplication>
+#include <QStringList>
+#include <string>
+#include <vector>
 #include "MetroPlannerWindow.h"
 
 int main(int argc, char *argv[])
 {
     QApplication app(argc, argv);
     MetroPlannerWindow window;
+
+    /* Optional network files: a GTFS directory, or stations and edges CSV files, and --fares with a fare table */
+    QStringList arguments = app.arguments();
+    std::vector<std::string> paths;
+    for (int i = 1; i < arguments.size(); i++)
+    {
+        if (arguments[i] == "--fares" && i + 1 < arguments.size())
+            window.loadFareTable(arguments[++i].toStdString());
+        else
+            paths.push_back(arguments[i].toStdString());
+    }
+    if (!paths.empty())
+        window.loadNetwork(paths);
+
     window.show();
     return app.exec();
 }